@@ -5,16 +5,16 @@ in VertexDataOut {
     vec3 ws_position;
     vec3 ws_normal;
     vec2 texture_coordinate;
+    // Material properties, per instance so they come from the vertex shader
+    flat vec3 diffuse_tint;
+    flat vec3 specular_tint;
+    flat vec3 ambient_tint;
+    flat float shininess;
+    flat float texture_scale;
 } frag_in;
 
 layout(location = 0) out vec4 out_colour;
 
-// Material properties
-uniform vec3 diffuse_tint;
-uniform vec3 specular_tint;
-uniform vec3 ambient_tint;
-uniform float shininess;
-
 // Light Data
 #if NUM_PL > 0
 layout (std140) uniform PointLightArray {
@@ -34,15 +34,14 @@ uniform vec3 ws_view_position;
 
 uniform sampler2D diffuse_texture;
 uniform sampler2D specular_map_texture;
-uniform float texture_scale;
 
 void main() {
-    vec2 scaled_texture_coordinate = frag_in.texture_coordinate * texture_scale;
+    vec2 scaled_texture_coordinate = frag_in.texture_coordinate * frag_in.texture_scale;
 
     // Per fragment lighting calculation
     vec3 ws_view_dir = normalize(ws_view_position - frag_in.ws_position);
     LightCalculatioData light_calculation_data = LightCalculatioData(frag_in.ws_position, ws_view_dir, frag_in.ws_normal);
-    Material material = Material(diffuse_tint, specular_tint, ambient_tint, shininess);
+    Material material = Material(frag_in.diffuse_tint, frag_in.specular_tint, frag_in.ambient_tint, frag_in.shininess);
 
     LightingResult lighting_result = total_light_calculation(light_calculation_data, material
         #if NUM_PL > 0
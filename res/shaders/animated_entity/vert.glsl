@@ -12,27 +12,62 @@ out VertexDataOut {
     vec3 ws_position;
     vec3 ws_normal;
     vec2 texture_coordinate;
+    // Material properties
+    flat vec3 diffuse_tint;
+    flat vec3 specular_tint;
+    flat vec3 ambient_tint;
+    flat float shininess;
+    flat float texture_scale;
 } vertex_data_out;
 
-// Per instance data
-uniform mat4 model_matrix;
+// Per instance data, see AnimatedEntityRenderer::InstanceBufferData for the layout
+#define INSTANCE_TEXELS 8
+uniform samplerBuffer instance_buffer;
+uniform int instance_offset;
 
-// Animation Data
-uniform mat4 bone_transforms[BONE_TRANSFORMS];
+// Per draw data
+uniform mat4 mesh_transformation;
+uniform int mesh_bone_offset;
+uniform bool has_bones;
+
+// Animation Data, the bone transforms of every instance
+uniform samplerBuffer bone_palette;
 
 // Global Data
 uniform mat4 projection_view_matrix;
 
+// Each mat4 is stored as 4 texels, one per column
+mat4 fetch_mat4(samplerBuffer buffer, int texel) {
+    return mat4(
+        texelFetch(buffer, texel),
+        texelFetch(buffer, texel + 1),
+        texelFetch(buffer, texel + 2),
+        texelFetch(buffer, texel + 3)
+    );
+}
+
+mat4 fetch_bone(int palette_offset, uint bone_index) {
+    return fetch_mat4(bone_palette, (palette_offset + int(bone_index)) * 4);
+}
+
 void main() {
+    int instance_texel = (instance_offset + gl_InstanceID) * INSTANCE_TEXELS;
+    mat4 model_matrix = fetch_mat4(instance_buffer, instance_texel) * mesh_transformation;
+    vec4 instance_parameters = texelFetch(instance_buffer, instance_texel + 7);
+
     // Transform vertices
-    float sum = dot(bone_weights, vec4(1.0f));
+    mat4 bone_transform = mat4(1.0f);
+    if (has_bones) {
+        int palette_offset = int(instance_parameters.z) + mesh_bone_offset;
+        float sum = dot(bone_weights, vec4(1.0f));
 
-    mat4 bone_transform =
-        bone_weights[0] * bone_transforms[bone_indices[0]]
-        + bone_weights[1] * bone_transforms[bone_indices[1]]
-        + bone_weights[2] * bone_transforms[bone_indices[2]]
-        + bone_weights[3] * bone_transforms[bone_indices[3]]
-        + (1.0f - sum) * mat4(1.0f);
+        bone_transform =
+            bone_weights[0] * fetch_bone(palette_offset, bone_indices[0])
+            + bone_weights[1] * fetch_bone(palette_offset, bone_indices[1])
+            + bone_weights[2] * fetch_bone(palette_offset, bone_indices[2])
+            + bone_weights[3] * fetch_bone(palette_offset, bone_indices[3])
+            + (1.0f - sum) * mat4(1.0f);
+    }
 
     mat4 animation_matrix = model_matrix * bone_transform;
     mat3 normal_matrix = cofactor(animation_matrix);
@@ -44,6 +79,11 @@ void main() {
     vertex_data_out.ws_position = calculated_ws_position;
     vertex_data_out.ws_normal = calculated_ws_normal;
     vertex_data_out.texture_coordinate = texture_coordinate;
+    vertex_data_out.diffuse_tint = texelFetch(instance_buffer, instance_texel + 4).rgb;
+    vertex_data_out.specular_tint = texelFetch(instance_buffer, instance_texel + 5).rgb;
+    vertex_data_out.ambient_tint = texelFetch(instance_buffer, instance_texel + 6).rgb;
+    vertex_data_out.shininess = instance_parameters.x;
+    vertex_data_out.texture_scale = instance_parameters.y;
 
     gl_Position = projection_view_matrix * vec4(calculated_ws_position, 1.0f);
 }
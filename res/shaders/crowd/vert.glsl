@@ -0,0 +1,91 @@
+#version 410 core
+#include "../common/maths.glsl"
+
+// Per vertex data, the positions and normals come from the vertex animation instead
+layout(location = 2) in vec2 texture_coordinate;
+
+out VertexDataOut {
+    vec3 ws_position;
+    vec3 ws_normal;
+    vec2 texture_coordinate;
+    // Material properties
+    flat vec3 diffuse_tint;
+    flat vec3 specular_tint;
+    flat vec3 ambient_tint;
+    flat float shininess;
+    flat float texture_scale;
+} vertex_data_out;
+
+// Per instance data, see CrowdRenderer::InstanceBufferData for the layout
+#define INSTANCE_TEXELS 5
+uniform samplerBuffer instance_buffer;
+uniform int instance_offset;
+
+// Per crowd data, see VertexAnimationTexture for the layout
+#define TEXELS_PER_VERTEX 2
+uniform samplerBuffer vertex_animation;
+uniform int vertex_count;
+uniform int clip_first_frame;
+uniform int clip_frame_count;
+uniform float clip_frames_per_second;
+uniform float clip_duration;
+uniform float clip_time;
+uniform vec3 clip_position_min;
+uniform vec3 clip_position_extent;
+
+// Per draw data
+uniform int draw_vertex_offset;
+
+// Material properties
+uniform vec3 diffuse_tint;
+uniform vec3 specular_tint;
+uniform vec3 ambient_tint;
+uniform float shininess;
+uniform float texture_scale;
+
+// Global Data
+uniform mat4 projection_view_matrix;
+
+int frame_texel(int frame) {
+    return ((clip_first_frame + frame) * vertex_count + draw_vertex_offset + gl_VertexID) * TEXELS_PER_VERTEX;
+}
+
+void main() {
+    int instance_texel = (instance_offset + gl_InstanceID) * INSTANCE_TEXELS;
+    mat4 model_matrix = mat4(
+        texelFetch(instance_buffer, instance_texel),
+        texelFetch(instance_buffer, instance_texel + 1),
+        texelFetch(instance_buffer, instance_texel + 2),
+        texelFetch(instance_buffer, instance_texel + 3)
+    );
+    float phase = texelFetch(instance_buffer, instance_texel + 4).x;
+
+    // Find the two frames either side of this instance's time, wrapping around since the clip loops
+    float time = clip_duration > 0.0f ? mod(clip_time + phase * clip_duration, clip_duration) : 0.0f;
+    float frame = time * clip_frames_per_second;
+    int frame_0 = min(int(frame), clip_frame_count - 1);
+    int frame_1 = (frame_0 + 1) % clip_frame_count;
+    float t = fract(frame);
+
+    int texel_0 = frame_texel(frame_0);
+    int texel_1 = frame_texel(frame_1);
+    // Positions are stored as fractions of the way across the clip's position box, and normals remapped into [0, 1]
+    vec3 position = clip_position_min + mix(texelFetch(vertex_animation, texel_0).xyz, texelFetch(vertex_animation, texel_1).xyz, t) * clip_position_extent;
+    vec3 normal = mix(texelFetch(vertex_animation, texel_0 + 1).xyz, texelFetch(vertex_animation, texel_1 + 1).xyz, t) * 2.0f - 1.0f;
+
+    mat3 normal_matrix = cofactor(model_matrix);
+
+    vec3 ws_position = (model_matrix * vec4(position, 1.0f)).xyz;
+
+    // Pass data to fragment shader
+    vertex_data_out.ws_position = ws_position;
+    vertex_data_out.ws_normal = normalize(normal_matrix * normal);
+    vertex_data_out.texture_coordinate = texture_coordinate;
+    vertex_data_out.diffuse_tint = diffuse_tint;
+    vertex_data_out.specular_tint = specular_tint;
+    vertex_data_out.ambient_tint = ambient_tint;
+    vertex_data_out.shininess = shininess;
+    vertex_data_out.texture_scale = texture_scale;
+
+    gl_Position = projection_view_matrix * vec4(ws_position, 1.0f);
+}
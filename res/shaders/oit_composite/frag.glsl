@@ -0,0 +1,25 @@
+#version 410 core
+
+uniform sampler2D accumulation_texture;
+uniform sampler2D revealage_texture;
+
+out vec4 f_color;
+
+void main() {
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+
+    float revealage = texelFetch(revealage_texture, texel, 0).r;
+    // Nothing transparent was drawn here
+    if (revealage >= 1.0) {
+        discard;
+    }
+
+    vec4 accumulation = texelFetch(accumulation_texture, texel, 0);
+    // Enough bright surfaces can overflow half floats, so fall back to white rather than to nothing
+    if (isinf(max(max(abs(accumulation.r), abs(accumulation.g)), abs(accumulation.b)))) {
+        accumulation.rgb = vec3(accumulation.a);
+    }
+
+    vec3 average_color = accumulation.rgb / max(accumulation.a, 0.00001);
+    f_color = vec4(average_color, 1.0 - revealage);
+}
@@ -3,7 +3,13 @@
 in vec4 v_color;
 in float v_rotation;
 
+#ifdef WEIGHTED_BLENDED_OIT
+// See OitCompositor, the weighted sum of premultiplied colour and alpha, and the revealage
+layout (location = 0) out vec4 f_accumulation;
+layout (location = 1) out float f_revealage;
+#else
 out vec4 f_color;
+#endif
 
 void main() {
     vec2 centered = gl_PointCoord - vec2(0.5);
@@ -29,6 +35,14 @@ void main() {
         alpha = (0.25 - distance_squared) / softness;
     }
 
+#ifdef WEIGHTED_BLENDED_OIT
+    float a = v_color.a * alpha;
+    // Equation 10 from McGuire & Bavoil 2013, favouring surfaces that are close and opaque
+    float weight = clamp(pow(min(1.0, a * 10.0) + 0.01, 3.0) * 1e8 * pow(1.0 - gl_FragCoord.z * 0.9, 3.0), 1e-2, 3e3);
+    f_accumulation = vec4(v_color.rgb * a, a) * weight;
+    f_revealage = a;
+#else
     f_color = v_color;
     f_color.a *= alpha;
+#endif
 } 
\ No newline at end of file
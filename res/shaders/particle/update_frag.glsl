@@ -0,0 +1,4 @@
+#version 410 core
+
+// Never runs, the update pass discards its primitives before rasterisation, but a program needs a fragment shader to link here
+void main() {}
@@ -0,0 +1,147 @@
+#version 410 core
+
+// One vertex per particle slot, see ParticleRenderer::GpuParticle for the layout.
+// Dead slots have no life remaining, and are brought back to life when they fall in this frame's spawn window.
+layout(location = 0) in vec3 position;
+layout(location = 1) in float size;
+layout(location = 2) in vec4 color;
+layout(location = 3) in float rotation;
+layout(location = 4) in vec3 velocity;
+layout(location = 5) in float life_remaining;
+layout(location = 6) in float total_life;
+layout(location = 7) in float angular_velocity;
+
+// Captured by transform feedback, in the same order as the inputs
+out vec3 out_position;
+out float out_size;
+out vec4 out_color;
+out float out_rotation;
+out vec3 out_velocity;
+out float out_life_remaining;
+out float out_total_life;
+out float out_angular_velocity;
+
+// Frame data
+uniform float delta_time;
+uniform uint frame_seed;
+uniform int capacity;
+// The slots [spawn_start, spawn_start + spawn_count) (wrapping around) spawn a particle, if they are dead
+uniform int spawn_start;
+uniform int spawn_count;
+
+// Emission
+uniform vec3 spawn_centre;
+uniform vec2 lifespan_range;
+uniform vec3 velocity_min;
+uniform vec3 velocity_max;
+uniform vec2 size_range;
+uniform vec2 rotation_range;
+uniform vec2 angular_velocity_range;
+uniform vec4 color_start;
+uniform vec4 color_end;
+
+// Forces
+uniform vec3 acceleration;
+uniform vec3 attractor_position;
+uniform float attractor_strength;
+uniform float attractor_radius;
+uniform float turbulence_strength;
+
+// Over the life of a particle
+uniform vec4 end_color;
+uniform float end_size_factor;
+
+uint hash(uint x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// Uniform in [0, 1)
+float random(inout uint state) {
+    state = hash(state);
+    return float(state >> 8) / 16777216.0;
+}
+
+float random_range(inout uint state, float min_value, float max_value) {
+    return mix(min_value, max_value, random(state));
+}
+
+void main() {
+    uint state = hash(uint(gl_VertexID) ^ hash(frame_seed));
+
+    vec3 p = position;
+    float s = size;
+    vec4 c = color;
+    float r = rotation;
+    vec3 v = velocity;
+    float life = life_remaining;
+    float total = total_life;
+    float spin = angular_velocity;
+
+    if (life <= 0.0f) {
+        int window_offset = (gl_VertexID - spawn_start + capacity) % capacity;
+        if (window_offset >= spawn_count) {
+            // Stays dead, with no size so that it isn't drawn
+            out_position = p;
+            out_size = 0.0f;
+            out_color = c;
+            out_rotation = r;
+            out_velocity = v;
+            out_life_remaining = 0.0f;
+            out_total_life = total;
+            out_angular_velocity = spin;
+            return;
+        }
+
+        total = random_range(state, lifespan_range.x, lifespan_range.y);
+        life = total;
+        p = spawn_centre + vec3(random_range(state, -0.5f, 0.5f), random_range(state, -0.5f, 0.5f), random_range(state, -0.5f, 0.5f));
+        v = vec3(random_range(state, velocity_min.x, velocity_max.x), random_range(state, velocity_min.y, velocity_max.y), random_range(state, velocity_min.z, velocity_max.z));
+        s = random_range(state, size_range.x, size_range.y);
+        r = random_range(state, rotation_range.x, rotation_range.y);
+        spin = random_range(state, angular_velocity_range.x, angular_velocity_range.y);
+        c = mix(color_start, color_end, random(state));
+    }
+
+    life -= delta_time;
+    if (life <= 0.0f) {
+        s = 0.0f;
+        life = 0.0f;
+    } else {
+        v += acceleration * delta_time;
+
+        vec3 to_attractor = attractor_position - p;
+        float distance = length(to_attractor);
+        if (attractor_strength != 0.0f && distance < attractor_radius && distance > 0.0f) {
+            v += to_attractor / distance * attractor_strength * (1.0f - distance / attractor_radius) * delta_time;
+        }
+
+        if (turbulence_strength > 0.0f) {
+            vec3 turbulence = vec3(random_range(state, -1.0f, 1.0f), random_range(state, -1.0f, 1.0f), random_range(state, -1.0f, 1.0f));
+            if (dot(turbulence, turbulence) > 0.0f) {
+                v += normalize(turbulence) * turbulence_strength * delta_time;
+            }
+        }
+
+        p += v * delta_time;
+        r += spin * delta_time;
+
+        // Matches ParticlePool::fade
+        float life_ratio = 1.0f - life / total;
+        c = mix(c, end_color, life_ratio);
+        s = mix(s, s * end_size_factor, life_ratio);
+    }
+
+    out_position = p;
+    out_size = s;
+    out_color = c;
+    out_rotation = r;
+    out_velocity = v;
+    out_life_remaining = life;
+    out_total_life = total;
+    out_angular_velocity = spin;
+}
@@ -9,9 +9,22 @@ out vec4 v_color;
 out float v_rotation;
 
 uniform mat4 projection_view_matrix;
+// Identity for particles that are already in world space
+uniform mat4 model_matrix;
+// What the particles' positions are relative to, see ParticleInstance
+uniform vec3 instance_origin;
 
 void main() {
-    gl_Position = projection_view_matrix * vec4(a_position, 1.0);
+    // Dead particles from GPU simulated emitters have no size, so move them outside the clip volume
+    if (a_size <= 0.0) {
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        gl_PointSize = 1.0;
+        v_rotation = 0.0;
+        v_color = vec4(0.0);
+        return;
+    }
+
+    gl_Position = projection_view_matrix * (model_matrix * vec4(a_position, 1.0) + vec4(instance_origin, 0.0));
 
     // Calculate point size based on perspective and particle size
     float distance_to_camera = gl_Position.w;
@@ -0,0 +1,249 @@
+#include "Benchmarks.h"
+
+#include <map>
+#include <cmath>
+#include <algorithm>
+#include <random>
+
+#include "rendering/resources/MeshHierarchy.h"
+#include "rendering/resources/AnimationCompression.h"
+#include "utility/HelperTypes.h"
+
+namespace {
+    /// The keyframe layout AnimationData used before keyframes were flattened into tracks, kept as a baseline.
+    struct MapAnimationData {
+        std::map<double, glm::vec3> positions{};
+        std::map<double, glm::quat> rotations{};
+        std::map<double, glm::vec3> scalings{};
+
+        template<typename Value, typename Interpolate>
+        static Value sample_map(const std::map<double, Value>& keys, double time, Interpolate interpolate) {
+            auto next_key = keys.lower_bound(time);
+            if (next_key == keys.end()) {
+                return keys.rbegin()->second;
+            } else if (next_key->first == time || next_key == keys.begin()) {
+                return next_key->second;
+            }
+            auto next = *next_key;
+            auto prev = *(--next_key);
+            return interpolate(prev.second, next.second, (float) ((time - prev.first) / (next.first - prev.first)));
+        }
+
+        [[nodiscard]] glm::mat4 sample(double time) const {
+            auto mix = [](const glm::vec3& a, const glm::vec3& b, float t) { return glm::mix(a, b, t); };
+            auto slerp = [](const glm::quat& a, const glm::quat& b, float t) { return glm::slerp(a, b, t); };
+            return glm::translate(sample_map(positions, time, mix)) * glm::toMat4(sample_map(rotations, time, slerp)) * glm::scale(sample_map(scalings, time, mix));
+        }
+    };
+
+    /// The flat track layout AnimationData used before clips were compressed, with every key kept at full precision, kept as a baseline.
+    struct FlatAnimationData {
+        KeyframeTrack<glm::vec3> positions{};
+        KeyframeTrack<glm::quat> rotations{};
+        KeyframeTrack<glm::vec3> scalings{};
+
+        template<typename Value>
+        static KeyframeTrack<Value> from_map(const std::map<double, Value>& keys) {
+            KeyframeTrack<Value> track{};
+            for (const auto& [time, value]: keys) {
+                track.times.push_back((float) time);
+                track.values.push_back(value);
+            }
+            return track;
+        }
+
+        [[nodiscard]] glm::mat4 sample(double time, AnimationCursor& cursor) const {
+            auto same = [](const auto& value) { return value; };
+            auto mix = [](const glm::vec3& a, const glm::vec3& b, float t) { return glm::mix(a, b, t); };
+            auto slerp = [](const glm::quat& a, const glm::quat& b, float t) { return glm::slerp(a, b, t); };
+            return glm::translate(positions.sample(time, cursor.position, same, mix))
+                 * glm::toMat4(rotations.sample(time, cursor.rotation, same, slerp))
+                 * glm::scale(scalings.sample(time, cursor.scaling, same, mix));
+        }
+    };
+
+    /// How far apart two unscaled transforms are, as the distance between their positions and the angle between their rotations
+    std::pair<float, float> transform_error(const glm::mat4& a, const glm::mat4& b) {
+        float position_error = glm::distance(glm::vec3{a[3]}, glm::vec3{b[3]});
+        // From the rotation between them, rather than acos of their dot product, which can't resolve angles this small in floats
+        glm::quat difference = glm::conjugate(glm::quat_cast(a)) * glm::quat_cast(b);
+        float rotation_error = 2.0f * std::atan2(glm::length(glm::vec3{difference.x, difference.y, difference.z}), std::abs(difference.w));
+        return {position_error, rotation_error};
+    }
+}
+
+std::string Benchmarks::animation_sampling() {
+    constexpr uint BONES = 100;
+    constexpr uint KEYS = 300; // 10 seconds of keys at 30 fps
+    constexpr double DURATION_TICKS = 10.0;
+    constexpr uint FRAMES = 600; // 10 seconds of playback at 60 fps
+    constexpr uint LOOPS = 5;
+
+    std::mt19937 gen{1234};
+    std::uniform_real_distribution<float> dist{-1.0f, 1.0f};
+
+    // Smooth curves rather than noise, so that key reduction has something to work with, like a real clip
+    std::vector<MapAnimationData> map_clip(BONES);
+    std::vector<FlatAnimationData> flat_clip(BONES);
+    std::vector<RawAnimationChannel> raw_channels(BONES);
+    for (auto bone = 0u; bone < BONES; ++bone) {
+        auto& map_data = map_clip[bone];
+        glm::vec3 frequency{dist(gen), dist(gen), dist(gen)};
+        glm::vec3 axis = glm::normalize(glm::vec3{dist(gen), dist(gen), dist(gen)});
+        for (auto key = 0u; key < KEYS; ++key) {
+            double time = DURATION_TICKS * key / (KEYS - 1);
+            map_data.positions[time] = glm::sin(frequency * (float) time);
+            map_data.rotations[time] = glm::angleAxis(glm::sin(frequency.x * (float) time), axis);
+            map_data.scalings[time] = glm::vec3{1.0f};
+        }
+        flat_clip[bone].positions = FlatAnimationData::from_map(map_data.positions);
+        flat_clip[bone].rotations = FlatAnimationData::from_map(map_data.rotations);
+        flat_clip[bone].scalings = FlatAnimationData::from_map(map_data.scalings);
+        raw_channels[bone] = {bone, map_data.positions, map_data.rotations, map_data.scalings};
+    }
+
+    AnimationCompressionSettings keyed_settings{};
+    AnimationCompressionSettings resampled_settings{};
+    resampled_settings.resample = true;
+    AnimationClip keyed_clip = AnimationCompression::compress_clip(raw_channels, 1.0, keyed_settings);
+    AnimationClip resampled_clip = AnimationCompression::compress_clip(raw_channels, 1.0, resampled_settings);
+
+    // Every path writes out its transforms, so the work can't be optimised away, and the last frame's are checked below with the rest
+    std::vector<glm::mat4> map_results(BONES), flat_results(BONES), keyed_results(BONES), resampled_results(BONES);
+    std::vector<AnimationCursor> flat_cursors(BONES), cursors(BONES);
+    uint frame = 0;
+
+    auto time_of = [&](uint f) { return DURATION_TICKS * (double) (f % FRAMES) / FRAMES; };
+
+    double map_ns = BenchmarkRunner::time_ns(FRAMES * LOOPS, [&]() {
+        double time = time_of(frame++);
+        for (auto bone = 0u; bone < BONES; ++bone) map_results[bone] = map_clip[bone].sample(time);
+    });
+    frame = 0;
+    double flat_ns = BenchmarkRunner::time_ns(FRAMES * LOOPS, [&]() {
+        double time = time_of(frame++);
+        for (auto bone = 0u; bone < BONES; ++bone) flat_results[bone] = flat_clip[bone].sample(time, flat_cursors[bone]);
+    });
+    frame = 0;
+    double keyed_ns = BenchmarkRunner::time_ns(FRAMES * LOOPS, [&]() {
+        double time = time_of(frame++);
+        for (auto bone = 0u; bone < BONES; ++bone) keyed_results[bone] = keyed_clip.channels[bone].sample(time, keyed_clip.position_bounds, cursors[bone]);
+    });
+    frame = 0;
+    double resampled_ns = BenchmarkRunner::time_ns(FRAMES * LOOPS, [&]() {
+        double time = time_of(frame++);
+        for (auto bone = 0u; bone < BONES; ++bone) resampled_results[bone] = resampled_clip.channels[bone].sample(time, resampled_clip.position_bounds);
+    });
+
+    // Each path against the std::map keys, at every frame played back rather than only at the keys, as the clips' stats are measured
+    struct Error {
+        float position = 0.0f;
+        float rotation = 0.0f;
+
+        void add(const glm::mat4& expected, const glm::mat4& actual) {
+            auto [position_error, rotation_error] = transform_error(expected, actual);
+            position = std::max(position, position_error);
+            rotation = std::max(rotation, rotation_error);
+        }
+    } flat_error{}, keyed_error{}, resampled_error{};
+    for (auto f = 0u; f < FRAMES; ++f) {
+        double time = time_of(f);
+        for (auto bone = 0u; bone < BONES; ++bone) {
+            glm::mat4 expected = map_clip[bone].sample(time);
+            AnimationCursor cursor{};
+            flat_error.add(expected, flat_clip[bone].sample(time, cursor));
+            keyed_error.add(expected, keyed_clip.channels[bone].sample(time, keyed_clip.position_bounds));
+            resampled_error.add(expected, resampled_clip.channels[bone].sample(time, resampled_clip.position_bounds));
+        }
+    }
+    for (auto bone = 0u; bone < BONES; ++bone) {
+        flat_error.add(map_results[bone], flat_results[bone]);
+        keyed_error.add(map_results[bone], keyed_results[bone]);
+        resampled_error.add(map_results[bone], resampled_results[bone]);
+    }
+
+    // Every path interpolates between neighbouring keys, so between the keys the error is no more than at the keys either side.
+    // The flat tracks keep every key, so should only differ by rounding, and the compressed clips by what their stats measured at the keys
+    constexpr float ROUNDING_TOLERANCE = 1e-5f;
+    bool flat_matches = flat_error.position <= ROUNDING_TOLERANCE && flat_error.rotation <= ROUNDING_TOLERANCE;
+
+    auto describe = [](const AnimationClip& clip, const Error& error) -> std::string {
+        bool within = error.position <= clip.stats.max_position_error + ROUNDING_TOLERANCE
+                   && error.rotation <= clip.stats.max_rotation_error + ROUNDING_TOLERANCE;
+        return Formatter() << clip.stats.compressed_bytes / 1024.0 << " KiB, max error " << error.position << " (position) "
+                           << glm::degrees(error.rotation) << " deg (rotation), " << (within ? "within" : "NOT within") << " the clip's stats";
+    };
+
+    return Formatter()
+        << "Per frame (" << BONES << " bones, " << KEYS << " keys per track):\n"
+        << "  std::map:                     " << map_ns / 1000.0 << " us, " << keyed_clip.stats.raw_bytes / 1024.0 << " KiB as imported\n"
+        << "  flat tracks + cursors:        " << flat_ns / 1000.0 << " us (" << map_ns / flat_ns << "x), results match: " << (flat_matches ? "yes" : "NO") << "\n"
+        << "  compressed tracks + cursors:  " << keyed_ns / 1000.0 << " us (" << map_ns / keyed_ns << "x), " << describe(keyed_clip, keyed_error) << "\n"
+        << "  resampled tracks (no cursor): " << resampled_ns / 1000.0 << " us (" << map_ns / resampled_ns << "x), " << describe(resampled_clip, resampled_error);
+}
+
+std::string Benchmarks::animation_crowd_update(JobSystem& job_system) {
+    constexpr uint ENTITIES = 512;
+    constexpr uint NODES = 60;
+    constexpr uint KEYS = 120;
+    constexpr double DURATION_TICKS = 4.0;
+    constexpr uint FRAMES = 30;
+
+    std::mt19937 gen{1234};
+    std::uniform_real_distribution<float> dist{-1.0f, 1.0f};
+
+    // A single chain of bones, with every node animated and bound to a bone.
+    // The vertex type is irrelevant, since posing never touches the meshes.
+    MeshHierarchy<glm::vec3> hierarchy{};
+    hierarchy.animations.emplace_back("Benchmark", 1.0, DURATION_TICKS);
+    std::vector<RawAnimationChannel> raw_channels(NODES);
+    for (auto node = 0u; node < NODES; ++node) {
+        hierarchy.node_names.push_back(Formatter() << "Bone " << node);
+        hierarchy.node_parents.push_back(node == 0 ? MeshHierarchy<glm::vec3>::NO_PARENT : node - 1);
+        hierarchy.node_transformations.emplace_back(1.0f);
+        hierarchy.node_rest_transformations.emplace_back(1.0f);
+        hierarchy.bone_bindings.push_back({node, node, glm::mat4{1.0f}});
+
+        auto& channel = raw_channels[node];
+        channel.node = node;
+        for (auto key = 0u; key < KEYS; ++key) {
+            double time = DURATION_TICKS * key / (KEYS - 1);
+            channel.positions[time] = glm::vec3{dist(gen), dist(gen), dist(gen)};
+            channel.rotations[time] = glm::normalize(glm::quat{dist(gen), dist(gen), dist(gen), dist(gen)});
+        }
+    }
+    hierarchy.animation_clips.push_back(AnimationCompression::compress_clip(raw_channels, 1.0, AnimationCompressionSettings{}));
+    hierarchy.bone_count = NODES;
+
+    // Stagger the entities through the clip, as a crowd would be
+    std::vector<AnimationPose> serial_poses(ENTITIES), parallel_poses(ENTITIES);
+    auto time_of = [&](uint entity, uint frame) { return std::fmod(entity * 0.37 + frame / 60.0, DURATION_TICKS); };
+    uint frame = 0;
+
+    double serial_ns = BenchmarkRunner::time_ns(FRAMES, [&]() {
+        for (auto entity = 0u; entity < ENTITIES; ++entity) {
+            hierarchy.calculate_animation(0, time_of(entity, frame), serial_poses[entity]);
+        }
+        ++frame;
+    });
+    frame = 0;
+    double parallel_ns = BenchmarkRunner::time_ns(FRAMES, [&]() {
+        job_system.parallel_for(ENTITIES, 4, [&](uint begin, uint end) {
+            for (auto entity = begin; entity < end; ++entity) {
+                hierarchy.calculate_animation(0, time_of(entity, frame), parallel_poses[entity]);
+            }
+        });
+        ++frame;
+    });
+
+    bool results_match = true;
+    for (auto entity = 0u; entity < ENTITIES; ++entity) {
+        results_match = results_match && serial_poses[entity].bone_transforms == parallel_poses[entity].bone_transforms;
+    }
+
+    return Formatter()
+        << "Per frame (" << ENTITIES << " entities, " << NODES << " bones each):\n"
+        << "  1 thread:  " << serial_ns / 1.0e6 << " ms\n"
+        << "  " << job_system.get_thread_count() << " threads: " << parallel_ns / 1.0e6 << " ms (" << serial_ns / parallel_ns << "x)\n"
+        << "  results match: " << (results_match ? "yes" : "NO");
+}
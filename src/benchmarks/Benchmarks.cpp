@@ -0,0 +1,15 @@
+#include "Benchmarks.h"
+
+void Benchmarks::register_all(BenchmarkRunner& runner, JobSystem& job_system) {
+    runner.register_benchmark("Animation Sampling (100 bones)", animation_sampling);
+    runner.register_benchmark("Animation Crowd Update (512 entities)", [&job_system]() { return animation_crowd_update(job_system); });
+    runner.register_benchmark("Import Bone Weights (200k vertices)", import_bone_weights);
+    runner.register_benchmark("Particle Update (100k particles)", particle_update);
+    runner.register_benchmark("Particle Neighbours (50k particles)", [&job_system]() { return particle_neighbours(job_system); });
+    runner.register_benchmark("Particle Fixed Timestep (5k particles)", [&job_system]() { return particle_fixed_timestep(job_system); });
+    runner.register_benchmark("Particle Collision (100k particles)", [&job_system]() { return particle_collision(job_system); });
+    runner.register_benchmark("Scene Transforms (100k elements)", scene_transforms);
+    runner.register_benchmark("Scene Propagation (50k elements)", [&job_system]() { return scene_propagation(job_system); });
+    runner.register_benchmark("Scene Files (200k elements)", scene_files);
+    runner.register_benchmark("Random Floats (1M floats)", random_floats);
+}
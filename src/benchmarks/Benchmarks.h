@@ -0,0 +1,55 @@
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include <string>
+
+#include "utility/BenchmarkRunner.h"
+#include "utility/JobSystem.h"
+
+/// The set of in-app micro benchmarks, each returns a human readable summary of its results.
+namespace Benchmarks {
+    /// Registers every benchmark below with the runner
+    void register_all(BenchmarkRunner& runner, JobSystem& job_system);
+
+    /// Compares sampling a 100 bone clip from std::map keyframes against flat keyframe tracks, and compressed ones (keyed with cursors, and uniformly resampled),
+    /// checking each against the std::map keys
+    std::string animation_sampling();
+
+    /// Compares posing a crowd of 512 skinned characters on one thread against spreading them across the job system
+    std::string animation_crowd_update(JobSystem& job_system);
+
+    /// Compares choosing the four heaviest bones of every vertex of a 200k vertex skinned mesh through std::map and std::set against fixed slots
+    std::string import_bone_weights();
+
+    /// Compares one update of 100k particles stored as an array of structs, with dead particles erased, against ParticlePool
+    std::string particle_update();
+
+    /// Compares finding the neighbours of 50k particles by checking every pair against SpatialHashGrid, then times building the grid
+    /// and ParticlePool::interact over it on one thread against the job system
+    std::string particle_neighbours(JobSystem& job_system);
+
+    /// Times a fixed timestep emitter of 5k particles, and checks that it plays out byte for byte the same from every restart,
+    /// whatever the frame rate and level of detail
+    std::string particle_fixed_timestep(JobSystem& job_system);
+
+    /// Times building a SignedDistanceField around the same floor split into more and more triangles, and colliding 100k particles with it,
+    /// which should cost the same however many triangles there are
+    std::string particle_collision(JobSystem& job_system);
+
+    /// Compares updating the transforms of 100k scene elements by recursing through a tree of separately allocated elements,
+    /// as the editor did, against sweeping through the ComponentStore
+    std::string scene_transforms();
+
+    /// Compares dragging the root of a 50k element scene by recursing through the tree on every edit, as GroupElement did,
+    /// against marking it dirty and propagating once a frame
+    std::string scene_propagation(JobSystem& job_system);
+
+    /// Compares reading a 200k element scene from json against the binary scene format, one element's json at a time,
+    /// with the transform and material blocks turned into json too, or read out as they are, as loading does
+    std::string scene_files();
+
+    /// Compares drawing 1M floats through a new std::uniform_real_distribution around std::mt19937 each, against RandomStream's range and fill_range
+    std::string random_floats();
+}
+
+#endif //BENCHMARKS_H
@@ -0,0 +1,96 @@
+#include "Benchmarks.h"
+
+#include <map>
+#include <set>
+#include <random>
+#include <cstring>
+
+#include <glm/gtx/component_wise.hpp>
+
+#include "rendering/resources/BoneWeights.h"
+#include "utility/HelperTypes.h"
+
+namespace {
+    /// The way ModelLoader chose each vertex's bones before BoneWeights, kept as a baseline.
+    std::vector<BoneWeights::VertexBoneWeights> map_gather(const aiMesh& mesh) {
+        // [vertex_id] -> (bone_weight -> bone_id)
+        std::vector<std::map<float, std::set<uint>>> bone_weights_total{};
+        bone_weights_total.resize(mesh.mNumVertices, {});
+        for (auto bone_i = 0u; bone_i < mesh.mNumBones; ++bone_i) {
+            const auto* bone = mesh.mBones[bone_i];
+            for (auto weight_i = 0u; weight_i < bone->mNumWeights; ++weight_i) {
+                const auto* weight = &bone->mWeights[weight_i];
+                bone_weights_total[weight->mVertexId][weight->mWeight].insert(bone_i);
+            }
+        }
+
+        std::vector<BoneWeights::VertexBoneWeights> bone_weights;
+        bone_weights.resize(mesh.mNumVertices, {});
+        for (auto vert_i = 0u; vert_i < mesh.mNumVertices; ++vert_i) {
+            const auto& vert = bone_weights_total[vert_i];
+            auto i = 0;
+            for (auto iter = vert.rbegin(); i < 4 && iter != vert.rend(); ++iter) {
+                for (auto inner_iter = iter->second.begin(); i < 4 && inner_iter != iter->second.end(); ++inner_iter) {
+                    bone_weights[vert_i].first[i] = iter->first;
+                    bone_weights[vert_i].second[i] = *inner_iter;
+                    ++i;
+                }
+            }
+            float weight_sum = glm::compAdd(bone_weights[vert_i].first);
+            if (weight_sum != 0.0f) {
+                bone_weights[vert_i].first /= weight_sum;
+            }
+        }
+        return bone_weights;
+    }
+}
+
+std::string Benchmarks::import_bone_weights() {
+    constexpr uint VERTICES = 200000;
+    constexpr uint BONES = 64;
+    constexpr uint INFLUENCES = 6; // Per vertex, more than fit so that the selection has to drop some
+    constexpr uint LOOPS = 3;
+
+    std::mt19937 gen{1234};
+    std::uniform_int_distribution<uint> bone_dist{0, BONES - 1};
+    // Coarse weights, so that plenty of vertices have ties to break
+    std::uniform_int_distribution<uint> weight_dist{0, 16};
+
+    // Only the bones are filled in, gathering never looks at anything else.
+    // The mesh owns and frees the bones and their weights.
+    aiMesh mesh{};
+    mesh.mNumVertices = VERTICES;
+    std::vector<std::vector<aiVertexWeight>> bone_influences(BONES);
+    for (auto vert_i = 0u; vert_i < VERTICES; ++vert_i) {
+        for (auto influence = 0u; influence < INFLUENCES; ++influence) {
+            bone_influences[bone_dist(gen)].emplace_back(vert_i, (float) weight_dist(gen) / 16.0f);
+        }
+    }
+    mesh.mNumBones = BONES;
+    mesh.mBones = new aiBone*[BONES];
+    for (auto bone_i = 0u; bone_i < BONES; ++bone_i) {
+        auto* bone = new aiBone();
+        bone->mName = aiString(std::string(Formatter() << "Bone " << bone_i));
+        bone->mNumWeights = (uint) bone_influences[bone_i].size();
+        bone->mWeights = new aiVertexWeight[bone->mNumWeights];
+        std::copy(bone_influences[bone_i].begin(), bone_influences[bone_i].end(), bone->mWeights);
+        mesh.mBones[bone_i] = bone;
+    }
+
+    std::vector<BoneWeights::VertexBoneWeights> map_weights, slot_weights;
+    double map_ns = BenchmarkRunner::time_ns(LOOPS, [&]() {
+        map_weights = map_gather(mesh);
+    });
+    double slot_ns = BenchmarkRunner::time_ns(LOOPS, [&]() {
+        slot_weights = BoneWeights::gather(mesh);
+    });
+
+    bool results_match = map_weights.size() == slot_weights.size()
+        && std::memcmp(map_weights.data(), slot_weights.data(), map_weights.size() * sizeof(BoneWeights::VertexBoneWeights)) == 0;
+
+    return Formatter()
+        << "Per mesh (" << VERTICES << " vertices, " << BONES << " bones, " << INFLUENCES << " influences per vertex):\n"
+        << "  std::map + std::set: " << map_ns / 1.0e6 << " ms\n"
+        << "  top 4 slots:         " << slot_ns / 1.0e6 << " ms (" << map_ns / slot_ns << "x)\n"
+        << "  results match bit for bit: " << (results_match ? "yes" : "NO");
+}
@@ -0,0 +1,325 @@
+#include "Benchmarks.h"
+
+#include <array>
+#include <cmath>
+#include <random>
+#include <vector>
+#include <cstring>
+
+#include "scene/editor_scene/ParticlePool.h"
+#include "scene/editor_scene/ParticleEmitterElement.h"
+#include "scene/editor_scene/SpatialHashGrid.h"
+#include "utility/HelperTypes.h"
+
+namespace {
+    /// The particle layout ParticleEmitterElement used before ParticlePool, kept as a baseline.
+    struct AosParticle {
+        glm::vec3 position{0.0f};
+        glm::vec3 velocity{0.0f};
+        glm::vec4 color{1.0f};
+        float size = 1.0f;
+        float lifeRemaining = 0.0f;
+        float totalLife = 1.0f;
+        float rotation = 0.0f;
+        float angularVelocity = 0.0f;
+    };
+
+    /// The update loop as ParticleEmitterElement::tick_particles ran it over AosParticle, erasing dead particles in place
+    void aos_update(std::vector<AosParticle>& particles, float dt, const glm::vec3& gravity, const glm::vec3& attractor, float strength, float radius, const glm::vec4& end_color, float end_size_factor) {
+        for (size_t i = 0; i < particles.size();) {
+            AosParticle& p = particles[i];
+            p.lifeRemaining -= dt;
+            if (p.lifeRemaining <= 0.0f) {
+                particles.erase(particles.begin() + (long) i);
+                continue;
+            }
+            p.velocity += gravity * dt;
+            glm::vec3 to_attractor = attractor - p.position;
+            float distance = glm::length(to_attractor);
+            if (distance < radius) {
+                p.velocity += glm::normalize(to_attractor) * strength * (1.0f - distance / radius) * dt;
+            }
+            p.position += p.velocity * dt;
+            p.rotation += p.angularVelocity * dt;
+            float life_ratio = 1.0f - (p.lifeRemaining / p.totalLife);
+            p.color = glm::mix(p.color, end_color, life_ratio);
+            p.size = glm::mix(p.size, p.size * end_size_factor, life_ratio);
+            ++i;
+        }
+    }
+}
+
+std::string Benchmarks::particle_update() {
+    constexpr uint PARTICLES = 100000;
+    constexpr uint FRAMES = 30;
+    constexpr float DT = 1.0f / 60.0f;
+    constexpr float BUDGET_MS = 1.0f;
+
+    const glm::vec3 gravity{0.0f, -0.98f, 0.0f};
+    const glm::vec3 attractor{0.0f, 2.0f, 0.0f};
+    const glm::vec4 end_color{1.0f, 1.0f, 1.0f, 0.0f};
+
+    std::mt19937 gen{1234};
+    std::uniform_real_distribution<float> dist{-1.0f, 1.0f};
+    std::uniform_real_distribution<float> life_dist{1.0f, 3.0f};
+
+    // Particles part way through their lives, as an emitter in a steady state would have, so some die every frame
+    std::vector<AosParticle> aos_particles(PARTICLES);
+    EditorScene::ParticlePool pool{};
+    pool.set_capacity(PARTICLES);
+    for (auto& p: aos_particles) {
+        p.position = {dist(gen), dist(gen), dist(gen)};
+        p.velocity = {dist(gen), dist(gen), dist(gen)};
+        p.totalLife = life_dist(gen);
+        p.lifeRemaining = p.totalLife * (dist(gen) * 0.5f + 0.5f);
+        p.size = 300.0f;
+        p.angularVelocity = dist(gen) * 180.0f;
+        auto i = pool.emit(p.position, p.velocity, p.color, p.size, p.totalLife, p.rotation, p.angularVelocity);
+        pool.lifeRemaining[i] = p.lifeRemaining;
+    }
+
+    double aos_ns = BenchmarkRunner::time_ns(FRAMES, [&]() {
+        aos_update(aos_particles, DT, gravity, attractor, 1.0f, 5.0f, end_color, 0.0f);
+    });
+    double pool_ns = BenchmarkRunner::time_ns(FRAMES, [&]() {
+        pool.age(DT);
+        pool.accelerate(gravity, DT);
+        pool.attract(attractor, 1.0f, 5.0f, DT);
+        pool.integrate(DT);
+        pool.fade(end_color, 0.0f);
+    });
+
+    double pool_ms = pool_ns / 1.0e6;
+    return Formatter()
+        << "Per frame (" << PARTICLES << " particles at the start, " << aos_particles.size() << " left after " << FRAMES << " frames):\n"
+        << "  std::vector<Particle> + erase: " << aos_ns / 1.0e6 << " ms\n"
+        << "  ParticlePool (SoA + swap):     " << pool_ms << " ms (" << aos_ns / pool_ns << "x), "
+        << (pool_ms <= BUDGET_MS ? "within" : "OVER") << " the " << BUDGET_MS << " ms budget\n"
+        << "  live particles match: " << (aos_particles.size() == pool.count ? "yes" : "NO");
+}
+
+std::string Benchmarks::particle_neighbours(JobSystem& job_system) {
+    constexpr uint PARTICLES = 50000;
+    constexpr uint FRAMES = 30;
+    // The all pairs check is far too slow to run over every particle, so it's timed over this many and scaled up
+    constexpr uint BRUTE_FORCE_SAMPLE = 1000;
+    constexpr float DT = 1.0f / 60.0f;
+    // A cube this wide holds 50 particles per unit cubed, so each has around 26 neighbours within the radius
+    constexpr float EXTENT = 10.0f;
+
+    EditorScene::ParticleInteraction interaction{};
+    interaction.radius = 0.5f;
+    interaction.separation = 1.0f;
+    interaction.cohesion = 0.5f;
+    interaction.alignment = 0.5f;
+    interaction.viscosity = 0.5f;
+
+    std::mt19937 gen{1234};
+    std::uniform_real_distribution<float> position_dist{0.0f, EXTENT};
+    std::uniform_real_distribution<float> velocity_dist{-1.0f, 1.0f};
+
+    EditorScene::ParticlePool serial_pool{};
+    serial_pool.set_capacity(PARTICLES);
+    for (auto i = 0u; i < PARTICLES; ++i) {
+        glm::vec3 position{position_dist(gen), position_dist(gen), position_dist(gen)};
+        glm::vec3 velocity{velocity_dist(gen), velocity_dist(gen), velocity_dist(gen)};
+        serial_pool.emit(position, velocity, glm::vec4{1.0f}, 1.0f, 10.0f, 0.0f, 0.0f);
+    }
+    EditorScene::ParticlePool parallel_pool = serial_pool;
+
+    JobSystem no_workers{0};
+    EditorScene::SpatialHashGrid serial_grid{}, parallel_grid{};
+
+    // Every particle against every sampled particle, as interactions had to be done without the grid
+    uint brute_force_pairs = 0;
+    double brute_force_ns = BenchmarkRunner::time_ns(1, [&]() {
+        for (auto i = 0u; i < BRUTE_FORCE_SAMPLE; ++i) {
+            glm::vec3 position = serial_pool.get_position(i);
+            for (auto j = 0u; j < PARTICLES; ++j) {
+                glm::vec3 offset = serial_pool.get_position(j) - position;
+                brute_force_pairs += j != i && glm::dot(offset, offset) <= interaction.radius * interaction.radius;
+            }
+        }
+    }) * PARTICLES / BRUTE_FORCE_SAMPLE;
+
+    serial_grid.build(serial_pool, interaction.radius, no_workers);
+    uint grid_pairs = 0;
+    for (auto i = 0u; i < BRUTE_FORCE_SAMPLE; ++i) {
+        serial_grid.for_each_neighbour(serial_pool.get_position(i), interaction.radius, [&](uint slot, const glm::vec3&, float) {
+            grid_pairs += serial_grid.get_sorted_particles()[slot] != i;
+        });
+    }
+
+    double serial_build_ns = BenchmarkRunner::time_ns(FRAMES, [&]() {
+        serial_grid.build(serial_pool, interaction.radius, no_workers);
+    });
+    double parallel_build_ns = BenchmarkRunner::time_ns(FRAMES, [&]() {
+        parallel_grid.build(parallel_pool, interaction.radius, job_system);
+    });
+    // The velocities drift apart from the start over the frames, but the particles stay put so the grid stays valid
+    double serial_interact_ns = BenchmarkRunner::time_ns(FRAMES, [&]() {
+        serial_pool.interact(serial_grid, interaction, DT, no_workers);
+    });
+    double parallel_interact_ns = BenchmarkRunner::time_ns(FRAMES, [&]() {
+        parallel_pool.interact(parallel_grid, interaction, DT, job_system);
+    });
+
+    bool results_match = serial_pool.velocityX == parallel_pool.velocityX
+                      && serial_pool.velocityY == parallel_pool.velocityY
+                      && serial_pool.velocityZ == parallel_pool.velocityZ;
+
+    double serial_ns = serial_build_ns + serial_interact_ns;
+    double parallel_ns = parallel_build_ns + parallel_interact_ns;
+    return Formatter()
+        << "Per step (" << PARTICLES << " particles, " << (float) grid_pairs / BRUTE_FORCE_SAMPLE << " neighbours each on average):\n"
+        << "  All pairs (from " << BRUTE_FORCE_SAMPLE << " particles): " << brute_force_ns / 1.0e6 << " ms, just finding neighbours\n"
+        << "  Grid, 1 thread:  " << serial_ns / 1.0e6 << " ms (build " << serial_build_ns / 1.0e6 << " ms, interact " << serial_interact_ns / 1.0e6 << " ms), "
+        << brute_force_ns / serial_ns << "x\n"
+        << "  Grid, " << job_system.get_thread_count() << " threads: " << parallel_ns / 1.0e6 << " ms (build " << parallel_build_ns / 1.0e6 << " ms, interact " << parallel_interact_ns / 1.0e6 << " ms), "
+        << serial_ns / parallel_ns << "x over 1 thread\n"
+        << "  neighbours match all pairs: " << (grid_pairs == brute_force_pairs ? "yes" : "NO")
+        << ", threaded results match: " << (results_match ? "yes" : "NO");
+}
+
+std::string Benchmarks::particle_fixed_timestep(JobSystem& job_system) {
+    constexpr uint STEPS = 600;
+    constexpr float STEP_RATE = 60.0f;
+    // Steps per tick of the uneven run, within maxSubSteps so no time is dropped
+    constexpr uint STEPS_PER_TICK = 4;
+
+    EditorScene::ParticleEmitterElement emitter{EditorScene::NullElementRef, "Benchmark Emitter"};
+    emitter.seed = 1234;
+    emitter.fixedTimestep = true;
+    emitter.fixedStepRate = STEP_RATE;
+    emitter.maxSubSteps = (int) STEPS_PER_TICK;
+    emitter.emissionRate = 2000.0f;
+    emitter.maxParticles = 5000;
+    emitter.turbulenceStrength = 1.0f;
+    emitter.attractorStrength = 0.5f;
+    emitter.interaction.radius = 0.1f;
+    emitter.interaction.separation = 1.0f;
+    emitter.interaction.viscosity = 0.5f;
+    EditorScene::SceneElement::components().propagate(job_system);
+
+    // The uneven run ticks a power of two multiple of this, so the time built up divides into whole steps exactly
+    const float step = 1.0f / STEP_RATE;
+
+    // One step every tick, at full detail
+    auto run_steady = [&]() {
+        emitter.restart();
+        emitter.lodVisible = true;
+        emitter.lodStepInterval = 1;
+        emitter.lodEmissionScale = 1.0f;
+        for (auto tick = 0u; tick < STEPS; ++tick) {
+            emitter.tick_particles(step, job_system, nullptr);
+        }
+        return emitter.particles;
+    };
+
+    // The first run builds the shared curl noise field, so the replay is the one timed
+    EditorScene::ParticlePool steady = run_steady();
+    EditorScene::ParticlePool replayed{};
+    double steady_ns = BenchmarkRunner::time_ns(1, [&]() { replayed = run_steady(); });
+
+    // The same steps at a quarter of the frame rate, with the LOD changing every tick, which mustn't make any difference
+    emitter.restart();
+    for (auto tick = 0u; tick < STEPS / STEPS_PER_TICK; ++tick) {
+        emitter.lodVisible = tick % 3 != 0;
+        emitter.lodStepInterval = 1u << (tick % 3);
+        emitter.lodEmissionScale = tick % 2 == 0 ? 0.25f : 1.0f;
+        emitter.tick_particles((float) STEPS_PER_TICK * step, job_system, nullptr);
+    }
+    EditorScene::ParticlePool uneven = emitter.particles;
+
+    // Only the live particles, and not the previous positions, which depend on which steps were drawn from
+    auto same_particles = [](const EditorScene::ParticlePool& a, const EditorScene::ParticlePool& b) {
+        if (a.count != b.count) return false;
+        auto same = [&](const std::vector<float>& x, const std::vector<float>& y) { return std::memcmp(x.data(), y.data(), a.count * sizeof(float)) == 0; };
+        return same(a.positionX, b.positionX) && same(a.positionY, b.positionY) && same(a.positionZ, b.positionZ)
+            && same(a.velocityX, b.velocityX) && same(a.velocityY, b.velocityY) && same(a.velocityZ, b.velocityZ)
+            && same(a.colorR, b.colorR) && same(a.colorG, b.colorG) && same(a.colorB, b.colorB) && same(a.colorA, b.colorA)
+            && same(a.size, b.size) && same(a.lifeRemaining, b.lifeRemaining) && same(a.totalLife, b.totalLife)
+            && same(a.rotation, b.rotation) && same(a.angularVelocity, b.angularVelocity);
+    };
+
+    return Formatter()
+        << "Per step (" << STEPS << " steps at " << STEP_RATE << " Hz, " << steady.count << " particles at the end): " << steady_ns / STEPS / 1000.0 << " us\n"
+        << "  restarts match: " << (same_particles(steady, replayed) ? "yes" : "NO")
+        << ", match at " << STEPS_PER_TICK << " steps per tick with the LOD changing: " << (same_particles(steady, uneven) ? "yes" : "NO");
+}
+
+std::string Benchmarks::particle_collision(JobSystem& job_system) {
+    constexpr uint PARTICLES = 100000;
+    constexpr uint ITERATIONS = 20;
+    // The same as the static collision field in MasterRenderScene
+    constexpr float CELL_SIZE = 0.25f;
+    constexpr float BAND = 1.0f;
+    constexpr float RADIUS = 0.05f;
+    // A bumpy floor this wide, split into more and more triangles over the same surface, so that every run collides the same particles
+    constexpr float EXTENT = 20.0f;
+    constexpr std::array<uint, 4> SUBDIVISIONS{16, 64, 256, 512};
+
+    auto height = [](float x, float z) { return 0.5f * std::sin(x) * std::sin(z); };
+
+    std::mt19937 gen{1234};
+    std::uniform_real_distribution<float> across_dist{-EXTENT / 2.0f, EXTENT / 2.0f};
+    std::uniform_real_distribution<float> above_dist{-0.25f, 2.0f};
+    std::uniform_real_distribution<float> velocity_dist{-1.0f, 1.0f};
+
+    // Around the floor, most within the band, as in a fountain spraying onto it
+    EditorScene::ParticlePool start{};
+    start.set_capacity(PARTICLES);
+    for (auto i = 0u; i < PARTICLES; ++i) {
+        float x = across_dist(gen);
+        float z = across_dist(gen);
+        glm::vec3 position{x, height(x, z) + above_dist(gen), z};
+        glm::vec3 velocity{velocity_dist(gen), -2.0f, velocity_dist(gen)};
+        start.emit(position, velocity, glm::vec4{1.0f}, 1.0f, 10.0f, 0.0f, 0.0f);
+    }
+
+    Formatter result{};
+    result << "Colliding " << PARTICLES << " particles, with the field built across " << job_system.get_thread_count() << " threads:";
+    double first_collide_ns = 0.0;
+    double last_collide_ns = 0.0;
+    for (auto subdivisions: SUBDIVISIONS) {
+        std::vector<SignedDistanceField::Triangle> triangles{};
+        triangles.reserve(2 * subdivisions * subdivisions);
+        float step = EXTENT / (float) subdivisions;
+        auto vertex = [&](uint i, uint j) {
+            float x = -EXTENT / 2.0f + (float) i * step;
+            float z = -EXTENT / 2.0f + (float) j * step;
+            return glm::vec3{x, height(x, z), z};
+        };
+        for (auto i = 0u; i < subdivisions; ++i) {
+            for (auto j = 0u; j < subdivisions; ++j) {
+                // Wound so the faces point up
+                triangles.push_back({vertex(i, j), vertex(i, j + 1), vertex(i + 1, j)});
+                triangles.push_back({vertex(i + 1, j), vertex(i, j + 1), vertex(i + 1, j + 1)});
+            }
+        }
+
+        SignedDistanceField field{};
+        double build_ns = BenchmarkRunner::time_ns(1, [&]() { field.build(triangles, CELL_SIZE, BAND, job_system); });
+
+        // Each run starts from the same particles, since colliding moves them out of the surface
+        EditorScene::ParticlePool pool{};
+        double collide_ns = 0.0;
+        for (auto iteration = 0u; iteration < ITERATIONS; ++iteration) {
+            pool = start;
+            collide_ns += BenchmarkRunner::time_ns(1, [&]() { pool.collide(field, nullptr, RADIUS, 0.3f, 0.1f, job_system); });
+        }
+        collide_ns /= ITERATIONS;
+
+        uint pushed_out = 0;
+        for (auto i = 0u; i < PARTICLES; ++i) {
+            pushed_out += pool.get_position(i) != start.get_position(i);
+        }
+
+        if (first_collide_ns == 0.0) first_collide_ns = collide_ns;
+        last_collide_ns = collide_ns;
+        result << "\n  " << triangles.size() << " triangles: collide " << collide_ns / 1.0e6 << " ms (" << pushed_out << " pushed out), build "
+               << build_ns / 1.0e6 << " ms (" << field.get_brick_count() << " bricks, " << field.memory_size() / (1024.0 * 1024.0) << " MB)";
+    }
+    result << "\n  collide at the most triangles over the fewest: " << last_collide_ns / first_collide_ns << "x";
+    return result;
+}
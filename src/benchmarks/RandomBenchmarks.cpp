@@ -0,0 +1,57 @@
+#include "Benchmarks.h"
+
+#include <random>
+#include <vector>
+#include <cstring>
+
+#include "utility/Random.h"
+#include "utility/HelperTypes.h"
+
+std::string Benchmarks::random_floats() {
+    // Plenty to give stable timings
+    constexpr uint FLOATS = 1000000;
+    constexpr uint ITERATIONS = 20;
+    constexpr float MIN = -1.0f;
+    constexpr float MAX = 1.0f;
+
+    std::vector<float> out(FLOATS);
+
+    // How Random::range used to work, a new distribution around a shared std::mt19937 for every float
+    std::mt19937 mt_gen{1234};
+    double mt_ns = BenchmarkRunner::time_ns(ITERATIONS, [&]() {
+        for (auto& value: out) {
+            std::uniform_real_distribution<float> dist(MIN, MAX);
+            value = dist(mt_gen);
+        }
+    });
+
+    RandomStream range_stream{1234};
+    double range_ns = BenchmarkRunner::time_ns(ITERATIONS, [&]() {
+        for (auto& value: out) {
+            value = range_stream.range(MIN, MAX);
+        }
+    });
+
+    RandomStream fill_stream{1234};
+    double fill_ns = BenchmarkRunner::time_ns(ITERATIONS, [&]() {
+        fill_stream.fill_range(out.data(), out.size(), MIN, MAX);
+    });
+
+    // The batch fill must give exactly the same floats as one range call at a time
+    std::vector<float> expected(FLOATS);
+    RandomStream check_range{99, 7};
+    RandomStream check_fill{99, 7};
+    for (auto& value: expected) {
+        value = check_range.range(MIN, MAX);
+    }
+    check_fill.fill_range(out.data(), out.size(), MIN, MAX);
+    bool matches = std::memcmp(out.data(), expected.data(), FLOATS * sizeof(float)) == 0;
+
+    auto per_float = [](double ns) { return ns / FLOATS; };
+    return Formatter()
+        << "Per float, over " << FLOATS << " floats in [" << MIN << ", " << MAX << "):\n"
+        << "  std::mt19937 + new distribution: " << per_float(mt_ns) << " ns\n"
+        << "  RandomStream::range (PCG32):     " << per_float(range_ns) << " ns (" << mt_ns / range_ns << "x)\n"
+        << "  RandomStream::fill_range:        " << per_float(fill_ns) << " ns (" << mt_ns / fill_ns << "x)\n"
+        << "  fill_range matches range: " << (matches ? "yes" : "NO");
+}
@@ -0,0 +1,349 @@
+#include "Benchmarks.h"
+
+#include <list>
+#include <memory>
+#include <random>
+#include <vector>
+#include <sstream>
+
+#include <glm/gtx/transform.hpp>
+
+#include "scene/editor_scene/ComponentStore.h"
+#include "scene/editor_scene/SceneBinary.h"
+#include "utility/HelperTypes.h"
+
+namespace {
+    /// What the renderer reads for an entity, allocated on its own as RenderedEntity is
+    struct RenderTarget {
+        glm::mat4 model_matrix{1.0f};
+        BaseLitEntityMaterial material{glm::vec4{1.0f}, glm::vec4{1.0f}, glm::vec4{1.0f}, 512.0f, 1.0f};
+    };
+
+    /// The element layout from before the ComponentStore, kept as a baseline: each element its own allocation holding its transforms,
+    /// pointing at its own render target, with its children in a list of further allocations
+    struct TreeElement {
+        TreeElement* parent = nullptr;
+        std::string name;
+        glm::mat4 transform{1.0f};
+        glm::vec3 position{0.0f};
+        glm::vec3 euler_rotation{0.0f};
+        glm::vec3 scale{1.0f};
+        BaseLitEntityMaterial material{glm::vec4{1.0f}, glm::vec4{1.0f}, glm::vec4{1.0f}, 512.0f, 1.0f};
+        std::shared_ptr<RenderTarget> target;
+        std::list<std::unique_ptr<TreeElement>> children{};
+
+        virtual ~TreeElement() = default;
+
+        /// As the elements' update_instance_data did it, recursing into the children of groups
+        virtual void update_instance_data() {
+            glm::mat4 rotation_matrix = glm::rotate(euler_rotation.x, glm::vec3{1.0f, 0.0f, 0.0f}) *
+                                        glm::rotate(euler_rotation.y, glm::vec3{0.0f, 1.0f, 0.0f}) *
+                                        glm::rotate(euler_rotation.z, glm::vec3{0.0f, 0.0f, 1.0f});
+            transform = glm::translate(position) * rotation_matrix * glm::scale(scale);
+            if (parent != nullptr) {
+                transform = parent->transform * transform;
+            }
+            if (target) {
+                target->model_matrix = transform;
+                target->material = material;
+            }
+            for (const auto& child: children) {
+                child->update_instance_data();
+            }
+        }
+    };
+}
+
+std::string Benchmarks::scene_transforms() {
+    constexpr uint GROUPS = 100;
+    constexpr uint ENTITIES_PER_GROUP = 999;
+    constexpr uint ITERATIONS = 20;
+
+    std::mt19937 gen{1234};
+    std::uniform_real_distribution<float> dist{-10.0f, 10.0f};
+    auto random_vec3 = [&]() { return glm::vec3{dist(gen), dist(gen), dist(gen)}; };
+
+    // Both layouts are built side by side, as an editor session would interleave them with everything else it allocates
+    std::list<std::unique_ptr<TreeElement>> tree_roots{};
+    std::vector<std::shared_ptr<RenderTarget>> tree_targets{};
+    std::vector<std::shared_ptr<RenderTarget>> store_targets{};
+    EditorScene::ComponentStore store{};
+    for (uint g = 0; g < GROUPS; ++g) {
+        glm::vec3 position = random_vec3();
+        glm::vec3 rotation = glm::radians(random_vec3() * 18.0f);
+
+        auto group = std::make_unique<TreeElement>();
+        group->name = Formatter() << "Benchmark Group " << g;
+        group->position = position;
+        group->euler_rotation = rotation;
+        EditorScene::ElementId group_id = store.create({});
+        store.use_trs(group_id, position, rotation, glm::vec3{1.0f});
+
+        for (uint e = 0; e < ENTITIES_PER_GROUP; ++e) {
+            position = random_vec3();
+            rotation = glm::radians(random_vec3() * 18.0f);
+
+            auto entity = std::make_unique<TreeElement>();
+            entity->parent = group.get();
+            entity->name = Formatter() << "Benchmark Entity " << g << "." << e;
+            entity->position = position;
+            entity->euler_rotation = rotation;
+            entity->target = std::make_shared<RenderTarget>();
+            tree_targets.push_back(entity->target);
+            group->children.push_back(std::move(entity));
+
+            EditorScene::ElementId entity_id = store.create(group_id);
+            store.use_trs(entity_id, position, rotation, glm::vec3{1.0f});
+            store_targets.push_back(std::make_shared<RenderTarget>());
+            store.link_model_matrix(entity_id, &store_targets.back()->model_matrix);
+            store.add_lit_material(entity_id, store_targets.back()->material);
+            store.link_lit_material(entity_id, &store_targets.back()->material);
+        }
+        tree_roots.push_back(std::move(group));
+    }
+
+    double tree_ns = BenchmarkRunner::time_ns(ITERATIONS, [&]() {
+        for (const auto& root: tree_roots) {
+            root->update_instance_data();
+        }
+    });
+
+    double store_ns = BenchmarkRunner::time_ns(ITERATIONS, [&]() {
+        store.update_world_transforms();
+        store.write_render_links();
+    });
+
+    // The store builds the rotation in one go rather than from three matrices, so only matches to within rounding
+    bool matches = true;
+    for (size_t i = 0; i < tree_targets.size() && matches; ++i) {
+        for (int column = 0; column < 4; ++column) {
+            glm::vec4 difference = glm::abs(tree_targets[i]->model_matrix[column] - store_targets[i]->model_matrix[column]);
+            matches &= glm::all(glm::lessThan(difference, glm::vec4{1e-3f}));
+        }
+    }
+
+    auto ms = [](double ns) { return ns / 1e6; };
+    return Formatter()
+        << "Updating every transform and writing it out, over " << GROUPS * (ENTITIES_PER_GROUP + 1) << " elements in " << GROUPS << " groups:\n"
+        << "  Recursing through the element tree: " << ms(tree_ns) << " ms\n"
+        << "  ComponentStore sweeps:              " << ms(store_ns) << " ms (" << tree_ns / store_ns << "x)\n"
+        << "  Results match: " << (matches ? "yes" : "NO");
+}
+
+std::string Benchmarks::scene_propagation(JobSystem& job_system) {
+    constexpr uint GROUPS = 100;
+    constexpr uint ENTITIES_PER_GROUP = 500;
+    constexpr uint EDITS_PER_FRAME = 10;
+    constexpr uint ITERATIONS = 20;
+
+    std::mt19937 gen{1234};
+    std::uniform_real_distribution<float> dist{-10.0f, 10.0f};
+    auto random_vec3 = [&]() { return glm::vec3{dist(gen), dist(gen), dist(gen)}; };
+
+    // One root group over everything, the worst case for an edit
+    auto tree_root = std::make_unique<TreeElement>();
+    std::vector<std::shared_ptr<RenderTarget>> tree_targets{};
+    std::vector<std::shared_ptr<RenderTarget>> store_targets{};
+    EditorScene::ComponentStore store{};
+    EditorScene::ElementId root_id = store.create({});
+    store.use_trs(root_id, glm::vec3{0.0f}, glm::vec3{0.0f}, glm::vec3{1.0f});
+    EditorScene::ElementId leaf_id{};
+    for (uint g = 0; g < GROUPS; ++g) {
+        glm::vec3 position = random_vec3();
+        glm::vec3 rotation = glm::radians(random_vec3() * 18.0f);
+
+        auto group = std::make_unique<TreeElement>();
+        group->parent = tree_root.get();
+        group->position = position;
+        group->euler_rotation = rotation;
+        EditorScene::ElementId group_id = store.create(root_id);
+        store.use_trs(group_id, position, rotation, glm::vec3{1.0f});
+
+        for (uint e = 0; e < ENTITIES_PER_GROUP; ++e) {
+            position = random_vec3();
+            rotation = glm::radians(random_vec3() * 18.0f);
+
+            auto entity = std::make_unique<TreeElement>();
+            entity->parent = group.get();
+            entity->position = position;
+            entity->euler_rotation = rotation;
+            entity->target = std::make_shared<RenderTarget>();
+            tree_targets.push_back(entity->target);
+            group->children.push_back(std::move(entity));
+
+            leaf_id = store.create(group_id);
+            store.use_trs(leaf_id, position, rotation, glm::vec3{1.0f});
+            store_targets.push_back(std::make_shared<RenderTarget>());
+            store.link_model_matrix(leaf_id, &store_targets.back()->model_matrix);
+            store.add_lit_material(leaf_id, store_targets.back()->material);
+            store.link_lit_material(leaf_id, &store_targets.back()->material);
+        }
+        tree_root->children.push_back(std::move(group));
+    }
+    store.propagate(job_system);
+
+    // Dragging the root's position slider, which used to recurse through everything under it on every change
+    float offset = 0.0f;
+    double tree_ns = BenchmarkRunner::time_ns(ITERATIONS, [&]() {
+        for (uint edit = 0; edit < EDITS_PER_FRAME; ++edit) {
+            tree_root->position.x = offset += 0.01f;
+            tree_root->update_instance_data();
+        }
+    });
+
+    offset = 0.0f;
+    double store_ns = BenchmarkRunner::time_ns(ITERATIONS, [&]() {
+        for (uint edit = 0; edit < EDITS_PER_FRAME; ++edit) {
+            store.position(root_id).x = offset += 0.01f;
+            store.mark_dirty(root_id);
+        }
+        store.propagate(job_system);
+    });
+
+    double leaf_ns = BenchmarkRunner::time_ns(ITERATIONS, [&]() {
+        store.position(leaf_id).y += 0.01f;
+        store.mark_dirty(leaf_id);
+        store.propagate(job_system);
+    });
+    store.position(leaf_id).y -= 0.01f * ITERATIONS;
+    store.mark_dirty(leaf_id);
+    store.propagate(job_system);
+
+    bool matches = true;
+    for (size_t i = 0; i < tree_targets.size() && matches; ++i) {
+        for (int column = 0; column < 4; ++column) {
+            glm::vec4 difference = glm::abs(tree_targets[i]->model_matrix[column] - store_targets[i]->model_matrix[column]);
+            matches &= glm::all(glm::lessThan(difference, glm::vec4{1e-3f}));
+        }
+    }
+
+    auto ms = [](double ns) { return ns / 1e6; };
+    return Formatter()
+        << EDITS_PER_FRAME << " edits in a frame to the root of " << GROUPS * (ENTITIES_PER_GROUP + 1) + 1 << " elements:\n"
+        << "  Recursing through the element tree on each edit: " << ms(tree_ns) << " ms\n"
+        << "  Marking dirty, then one ComponentStore::propagate: " << ms(store_ns) << " ms (" << tree_ns / store_ns << "x, "
+        << job_system.get_thread_count() << " threads)\n"
+        << "One edit to a leaf, then propagate: " << ms(leaf_ns) * 1000.0 << " us\n"
+        << "  Results match: " << (matches ? "yes" : "NO");
+}
+
+std::string Benchmarks::scene_files() {
+    constexpr uint GROUPS = 200;
+    constexpr uint ENTITIES_PER_GROUP = 999;
+    constexpr uint ITERATIONS = 3;
+
+    std::mt19937 gen{1234};
+    std::uniform_real_distribution<float> dist{-10.0f, 10.0f};
+    auto random_vec3 = [&]() { return glm::vec3{dist(gen), dist(gen), dist(gen)}; };
+    auto local_transform = [&]() {
+        return json{
+            {"position", random_vec3()},
+            {"euler_rotation", glm::radians(random_vec3() * 18.0f)},
+            {"scale", glm::vec3{1.0f}},
+        };
+    };
+    auto texture = [](const char* filename) {
+        return json{{"filename", filename}, {"is_srgb", true}, {"is_flipped", true}};
+    };
+
+    // Laid out as EditorScene saves it, with the entities as EntityElement::into_json gives them
+    json scene = json::array();
+    for (uint g = 0; g < GROUPS; ++g) {
+        json children = json::array();
+        for (uint e = 0; e < ENTITIES_PER_GROUP; ++e) {
+            children.push_back({
+                {"label", "Entity"},
+                {"name", Formatter() << "Entity " << g << "." << e},
+                {"enabled", true},
+                {"local_transform", local_transform()},
+                {"material", {
+                    {"diffuse_tint", glm::vec4{1.0f}},
+                    {"specular_tint", glm::vec4{1.0f}},
+                    {"ambient_tint", glm::vec4{1.0f}},
+                    {"shininess", 128.0f},
+                    {"texture_scale", 1.0f},
+                }},
+                {"model", e % 2 ? "cube.obj" : "sphere.obj"},
+                {"diffuse_texture", texture("textures/default_white.png")},
+                {"specular_map_texture", texture("textures/default_black.png")},
+                {"texture_scale", 1.0f},
+            });
+        }
+        scene.push_back({
+            {"label", "Group"},
+            {"name", Formatter() << "Group " << g},
+            {"enabled", true},
+            {"local_transform", local_transform()},
+            {"children", children},
+        });
+    }
+
+    std::string json_text = scene.dump(4);
+    std::stringstream binary_stream{};
+    EditorScene::SceneBinary::json_to_binary(scene, binary_stream);
+    std::string binary_text = binary_stream.str();
+    scene = nullptr;
+
+    // Each only visits the elements, with the json for each that from_json would be handed, as loading does
+    uint json_elements = 0;
+    double json_ns = BenchmarkRunner::time_ns(ITERATIONS, [&]() {
+        json data = json::parse(json_text);
+        json_elements = 0;
+        std::function<void(const json&)> visit = [&](const json& j) {
+            json_elements += j["label"].get_ref<const std::string&>().empty() ? 0 : 1;
+            if (j.contains("children")) {
+                for (const auto& child: j["children"]) visit(child);
+            }
+        };
+        for (const auto& item: data) visit(item);
+    });
+
+    // Either with the blocks turned into json too, as element_json gives them, or read out as they are, as loading does
+    uint binary_elements = 0;
+    float block_sum = 0.0f;
+    auto time_binary = [&](bool blocks_as_json) {
+        return BenchmarkRunner::time_ns(ITERATIONS, [&]() {
+            EditorScene::SceneBinary::Reader reader{std::vector<char>(binary_text.begin(), binary_text.end())};
+            binary_elements = 0;
+            block_sum = 0.0f;
+            std::function<void(size_t)> visit = [&](size_t offset) {
+                json j = blocks_as_json ? reader.element_json(offset) : reader.element_properties_json(offset);
+                binary_elements += j["label"].get_ref<const std::string&>().empty() ? 0 : 1;
+                if (!blocks_as_json) {
+                    auto blocks = reader.element_blocks(offset);
+                    if (blocks.transform.has_value()) block_sum += blocks.transform->position.x;
+                    if (blocks.lit_material.has_value()) block_sum += blocks.lit_material->shininess;
+                }
+                auto header = reader.element_header(offset);
+                size_t child = reader.first_child(offset);
+                for (auto i = 0u; i < header.child_count; ++i) {
+                    visit(child);
+                    child += reader.element_header(child).subtree_size;
+                }
+            };
+            size_t offset = reader.first_root();
+            for (auto i = 0u; i < reader.get_root_count(); ++i) {
+                visit(offset);
+                offset += reader.element_header(offset).subtree_size;
+            }
+        });
+    };
+    double binary_json_ns = time_binary(true);
+    double binary_ns = time_binary(false);
+
+    bool round_trips = true;
+    {
+        EditorScene::SceneBinary::Reader reader{std::vector<char>(binary_text.begin(), binary_text.end())};
+        round_trips = EditorScene::SceneBinary::binary_to_json(reader) == json::parse(json_text);
+    }
+
+    auto ms = [](double ns) { return ns / 1e6; };
+    auto mib = [](size_t bytes) { return (float) bytes / (1024.0f * 1024.0f); };
+    return Formatter()
+        << "Reading a scene of " << GROUPS * (ENTITIES_PER_GROUP + 1) << " elements, without building the elements themselves:\n"
+        << "  Json (" << mib(json_text.size()) << " MiB), parsed whole: " << ms(json_ns) << " ms, " << json_elements << " elements\n"
+        << "  Binary (" << mib(binary_text.size()) << " MiB), one element at a time, with the blocks as json: " << ms(binary_json_ns) << " ms (" << json_ns / binary_json_ns << "x)\n"
+        << "  Binary, with the blocks read out as they are: " << ms(binary_ns) << " ms (" << json_ns / binary_ns << "x), "
+        << binary_elements << " elements\n"
+        << "  Converts back to the same json: " << (round_trips ? "yes" : "NO");
+}
@@ -2,6 +2,9 @@
 #include "rendering/imgui/ImGuiManager.h"
 #include "utility/OpenGL.h"
 #include "utility/PerformanceCounter.h"
+#include "utility/JobSystem.h"
+#include "utility/BenchmarkRunner.h"
+#include "benchmarks/Benchmarks.h"
 #include "rendering/resources/ModelLoader.h"
 #include "rendering/resources/TextureLoader.h"
 #include "rendering/renders/MasterRenderer.h"
@@ -41,11 +44,18 @@ int main() {
         // Create a performance counter, to measure the FPS
         PerformanceCounter performance_counter{};
 
+        // Create the worker threads, for spreading per-frame work (like posing animated entities) across cores
+        JobSystem job_system{};
+
+        // Create the runner for the in-app micro benchmarks
+        BenchmarkRunner benchmark_runner{};
+        Benchmarks::register_all(benchmark_runner, job_system);
+
         // Create an instance of the MasterRenderer which controls all the rendering
         MasterRenderer master_renderer{};
 
         // Set up the model and texture loads, pointing them to a relative path to look in for files.
-        ModelLoader model_loader{"res/models"};
+        ModelLoader model_loader{"res/models", job_system};
         TextureLoader texture_loader{"res/textures"};
 
         // Create a scene manager and give it two scene constructors, one for the editor scene,
@@ -65,6 +75,7 @@ int main() {
             window_manager,
             model_loader,
             texture_loader,
+            job_system,
             true
         };
         // Use the handle of the editor scene to switch to it, making it the starting scene
@@ -95,7 +106,9 @@ int main() {
                 if (ImGui::Begin("Options & Info", nullptr, ImGuiWindowFlags_NoFocusOnAppearing)) {
                     scene_manager.add_imgui_options_section(scene_context);
                     master_renderer.add_imgui_options_section(window_manager);
+                    model_loader.add_imgui_options_section();
                     performance_counter.add_imgui_options_section((float) window_manager.get_delta_time());
+                    benchmark_runner.add_imgui_options_section();
                 }
                 ImGui::End();
             }
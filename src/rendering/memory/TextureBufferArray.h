@@ -0,0 +1,79 @@
+#ifndef TEXTURE_BUFFER_ARRAY_H
+#define TEXTURE_BUFFER_ARRAY_H
+
+#include <vector>
+#include <algorithm>
+#include <glad/gl.h>
+
+#include "utility/HelperTypes.h"
+
+/// A helper class that abstracts over a Buffer Texture (GL_TEXTURE_BUFFER) as a type safe, growable array.
+/// Unlike a uniform array it isn't limited to a few kilobytes, and is read in the shader with texelFetch on a samplerBuffer.
+///
+/// The texel format is fixed to RGBA32F, so T must be made of whole vec4s (e.g. glm::vec4 or glm::mat4, which is 4 texels, one per column).
+template<typename T>
+class TextureBufferArray : NonCopyable {
+    static_assert(sizeof(T) % (4 * sizeof(float)) == 0, "TextureBufferArray elements must be a whole number of RGBA32F texels");
+
+    uint buffer = 0;
+    uint texture = 0;
+    // The number of elements the GPU side buffer currently has space for
+    size_t capacity = 0;
+public:
+    /// The CPU side buffer that will be mirrored on the GPU, resize it freely between uploads
+    std::vector<T> data{};
+
+    TextureBufferArray();
+    /// Upload the CPU side to the GPU, growing the GPU side if needed.
+    /// The old contents are orphaned rather than overwritten, so this won't stall on draws that are still using them.
+    void upload();
+    /// Bind the buffer texture to the specified texture unit
+    void bind(uint texture_unit) const;
+
+    ~TextureBufferArray();
+};
+
+template<typename T>
+TextureBufferArray<T>::TextureBufferArray() {
+    glGenBuffers(1, &buffer);
+    glGenTextures(1, &texture);
+
+    // Start with space for a single element, so the texture always has a valid data store
+    capacity = 1;
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, capacity * sizeof(T), nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+template<typename T>
+void TextureBufferArray<T>::upload() {
+    if (data.empty()) return;
+
+    if (data.size() > capacity) {
+        // Grow geometrically, so that a slowly growing scene doesn't reallocate every frame
+        capacity = std::max(data.size(), capacity * 2);
+    }
+
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, capacity * sizeof(T), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, data.size() * sizeof(T), data.data());
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+template<typename T>
+void TextureBufferArray<T>::bind(uint texture_unit) const {
+    glActiveTexture(GL_TEXTURE0 + texture_unit);
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+}
+
+template<typename T>
+TextureBufferArray<T>::~TextureBufferArray() {
+    glDeleteTextures(1, &texture);
+    glDeleteBuffers(1, &buffer);
+}
+
+#endif //TEXTURE_BUFFER_ARRAY_H
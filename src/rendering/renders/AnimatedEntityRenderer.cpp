@@ -1,36 +1,187 @@
 #include "AnimatedEntityRenderer.h"
 
+#include <tuple>
+#include <atomic>
+#include <cstdint>
+#include <algorithm>
+
+#include "rendering/imgui/ImGuiManager.h"
+#include "utility/Math.h"
+
 AnimatedEntityRenderer::AnimatedEntityShader::AnimatedEntityShader() :
-    BaseLitEntityShader("Animated Entity", "animated_entity/vert.glsl", "animated_entity/frag.glsl", {{"BONE_TRANSFORMS", BONE_TRANSFORMS_STR}}) {
+    BaseLitEntityShader("Animated Entity", "animated_entity/vert.glsl", "animated_entity/frag.glsl") {
 
     get_uniforms_set_bindings();
 }
 
 void AnimatedEntityRenderer::AnimatedEntityShader::get_uniforms_set_bindings() {
     BaseLitEntityShader::get_uniforms_set_bindings(); // Call the base implementation to load all the common uniforms
-    bone_transforms_location = get_uniform_location("bone_transforms");
+    instance_offset_location = get_uniform_location("instance_offset");
+    mesh_transformation_location = get_uniform_location("mesh_transformation");
+    mesh_bone_offset_location = get_uniform_location("mesh_bone_offset");
+    has_bones_location = get_uniform_location("has_bones");
+    // Buffer texture bindings
+    set_binding("bone_palette", BONE_PALETTE_BINDING);
+    set_binding("instance_buffer", INSTANCE_BUFFER_BINDING);
 }
 
-void AnimatedEntityRenderer::AnimatedEntityShader::set_model_matrix(const glm::mat4& model_matrix) {
-    glProgramUniformMatrix4fv(id(), model_matrix_location, 1, GL_FALSE, &model_matrix[0][0]);
+void AnimatedEntityRenderer::AnimatedEntityShader::set_draw_data(uint instance_offset, const glm::mat4& mesh_transformation, uint mesh_bone_offset, bool has_bones) {
+    glProgramUniform1i(id(), instance_offset_location, (int) instance_offset);
+    glProgramUniformMatrix4fv(id(), mesh_transformation_location, 1, GL_FALSE, &mesh_transformation[0][0]);
+    glProgramUniform1i(id(), mesh_bone_offset_location, (int) mesh_bone_offset);
+    glProgramUniform1i(id(), has_bones_location, has_bones ? 1 : 0);
 }
 
-void AnimatedEntityRenderer::AnimatedEntityShader::set_bone_transforms(const std::vector<glm::mat4>& bone_transforms) {
-    glProgramUniformMatrix4fv(id(), bone_transforms_location, std::min(BONE_TRANSFORMS, (int) bone_transforms.size()), GL_FALSE, &bone_transforms[0][0][0]);
+AnimatedEntityRenderer::InstanceBufferData AnimatedEntityRenderer::InstanceBufferData::from_entity(const Entity& entity, uint palette_offset) {
+    const auto& material = entity.instance_data.material;
+    return {
+        entity.instance_data.model_matrix,
+        glm::vec4{glm::vec3{material.diffuse_tint} * material.diffuse_tint.a, 0.0f},
+        glm::vec4{glm::vec3{material.specular_tint} * material.specular_tint.a, 0.0f},
+        glm::vec4{glm::vec3{material.ambient_tint} * material.ambient_tint.a, 0.0f},
+        // The offset is stored as a float, which is exact up to 2^24 bones
+        glm::vec4{material.shininess, material.texture_scale, (float) palette_offset, 0.0f}
+    };
+}
+
+/// Whether two entities can be drawn with the same instanced draw
+static bool same_batch(const AnimatedEntityRenderer::Entity& a, const AnimatedEntityRenderer::Entity& b) {
+    return a.mesh_hierarchy == b.mesh_hierarchy
+        && a.render_data.diffuse_texture == b.render_data.diffuse_texture
+        && a.render_data.specular_map_texture == b.render_data.specular_map_texture;
 }
 
 AnimatedEntityRenderer::AnimatedEntityRenderer::AnimatedEntityRenderer() : shader() {}
 
+void AnimatedEntityRenderer::AnimatedEntityRenderer::prepare_frame(const RenderScene& render_scene, JobSystem& job_system) {
+    frame_entities.clear();
+    for (const auto& entity: render_scene.entities) {
+        frame_entities.push_back(entity.get());
+    }
+
+    // Sort so that the entities that can be instanced together form contiguous runs
+    std::sort(frame_entities.begin(), frame_entities.end(), [](const Entity* a, const Entity* b) {
+        return std::make_tuple(a->mesh_hierarchy.get(), a->render_data.diffuse_texture.get(), a->render_data.specular_map_texture.get())
+             < std::make_tuple(b->mesh_hierarchy.get(), b->render_data.diffuse_texture.get(), b->render_data.specular_map_texture.get());
+    });
+
+    // Lay out each entity's bones one after another in the palette
+    palette_offsets.resize(frame_entities.size());
+    uint palette_size = 0;
+    for (auto i = 0u; i < frame_entities.size(); ++i) {
+        palette_offsets[i] = palette_size;
+        palette_size += frame_entities[i]->mesh_hierarchy->bone_count;
+    }
+    bone_palette.data.resize(palette_size);
+    instance_buffer.data.resize(frame_entities.size());
+
+    std::atomic<uint> evaluated{0}, interpolated{0}, reduced_bones{0}, offscreen{0};
+    const auto& projection_view = render_scene.global_data.projection_view_matrix;
+
+    // Each entity only writes to its own pose and its own parts of the buffers, and the mesh hierarchies are only read,
+    // so the entities can be posed in any order
+    job_system.parallel_for((uint) frame_entities.size(), 4, [&, this](uint begin, uint end) {
+        for (auto i = begin; i < end; ++i) {
+            auto* entity = frame_entities[i];
+            const auto& hierarchy = *entity->mesh_hierarchy;
+            auto& pose = entity->animation_pose;
+
+            // Pick the level of detail from how big the entity is on screen
+            uint update_interval = 1;
+            bool include_optional_nodes = true;
+            if (lod_settings.enabled && entity->animation_id != NONE_ANIMATION) {
+                const auto& model_matrix = entity->instance_data.model_matrix;
+                // The bind pose sphere doesn't cover limbs that swing out of it, so prefer the bounds of the clip around the current time
+                const auto& bounds = hierarchy.get_animation_bounds(entity->animation_id, entity->animation_time_seconds);
+                glm::vec3 local_centre = bounds.is_empty() ? hierarchy.bounding_centre : bounds.centre();
+                float local_radius = bounds.is_empty() ? hierarchy.bounding_radius : bounds.radius();
+
+                glm::vec3 centre = model_matrix * glm::vec4{local_centre, 1.0f};
+                float scale = std::max({glm::length(glm::vec3{model_matrix[0]}), glm::length(glm::vec3{model_matrix[1]}), glm::length(glm::vec3{model_matrix[2]})});
+                float radius = local_radius * scale;
+
+                if (!sphere_in_frustum(projection_view, centre, radius)) {
+                    update_interval = lod_settings.offscreen_update_interval;
+                    include_optional_nodes = false;
+                    ++offscreen;
+                } else {
+                    float size = projected_sphere_size(projection_view, centre, radius);
+                    // Round up to a power of two, so that entities that update together keep updating together
+                    while (update_interval < lod_settings.max_update_interval && size * (float) (update_interval * 2) <= lod_settings.full_rate_size) {
+                        update_interval *= 2;
+                    }
+                    include_optional_nodes = size >= lod_settings.optional_bones_size;
+                    if (!include_optional_nodes) ++reduced_bones;
+                }
+                update_interval = std::max(1u, update_interval);
+            }
+
+            bool changed = pose.evaluated_animation_id != entity->animation_id || pose.bone_transforms.size() != hierarchy.bone_count;
+            ++pose.frames_since_update;
+            if (changed || pose.frames_since_update >= pose.update_interval || update_interval < pose.update_interval) {
+                if (update_interval > 1 && !changed) {
+                    // Keep the last pose to blend from, until the next update
+                    pose.previous_bone_transforms.swap(pose.bone_transforms);
+                }
+                hierarchy.calculate_animation(entity->animation_id, entity->animation_time_seconds, pose, include_optional_nodes);
+                if (changed) {
+                    pose.previous_bone_transforms = pose.bone_transforms;
+                    // Spread out the updates of entities that start at the same time, so they don't all land on the same frame
+                    pose.frames_since_update = (uint) (reinterpret_cast<uintptr_t>(entity) / alignof(Entity)) % update_interval;
+                } else {
+                    pose.frames_since_update = 0;
+                }
+                pose.update_interval = update_interval;
+                pose.evaluated_animation_id = entity->animation_id;
+                ++evaluated;
+            } else {
+                ++interpolated;
+            }
+
+            // In between updates, blend from the previous pose to the latest, which keeps motion smooth at the cost of lagging by one update
+            auto palette = bone_palette.data.begin() + palette_offsets[i];
+            if (pose.update_interval > 1) {
+                float t = std::min(1.0f, (float) pose.frames_since_update / (float) pose.update_interval);
+                for (auto bone = 0u; bone < hierarchy.bone_count; ++bone) {
+                    palette[bone] = pose.previous_bone_transforms[bone] + (pose.bone_transforms[bone] - pose.previous_bone_transforms[bone]) * t;
+                }
+            } else {
+                std::copy(pose.bone_transforms.begin(), pose.bone_transforms.end(), palette);
+            }
+
+            instance_buffer.data[i] = InstanceBufferData::from_entity(*entity, palette_offsets[i]);
+        }
+    });
+
+    lod_stats = {evaluated, interpolated, reduced_bones, offscreen};
+}
+
 void AnimatedEntityRenderer::AnimatedEntityRenderer::render(const RenderScene& render_scene, const LightScene& light_scene) {
     shader.use();
     shader.set_global_data(render_scene.global_data);
 
     shader.set_directional_lights(light_scene.get_directional_lights(BaseLitEntityShader::MAX_DL, 0));
 
-    for (const auto& entity: render_scene.entities) {
-        shader.set_instance_data(entity->instance_data);
+    // The only per frame uploads, everything per entity is read from these
+    bone_palette.upload();
+    bone_palette.bind(AnimatedEntityShader::BONE_PALETTE_BINDING);
+    instance_buffer.upload();
+    instance_buffer.bind(AnimatedEntityShader::INSTANCE_BUFFER_BINDING);
+
+    for (auto first = 0u; first < frame_entities.size();) {
+        const auto& entity = *frame_entities[first];
+
+        // Find the run of entities to draw together, which is just this one without instancing
+        uint count = 1;
+        glm::vec3 position = entity.instance_data.model_matrix[3];
+        if (instancing) {
+            while (first + count < frame_entities.size() && same_batch(entity, *frame_entities[first + count])) {
+                position += glm::vec3{frame_entities[first + count]->instance_data.model_matrix[3]};
+                ++count;
+            }
+            position /= (float) count;
+        }
 
-        glm::vec3 position = entity->instance_data.model_matrix[3];
         // IMPORTANT NOTE:
         // This call has the potential to recompile the shader if the value for "NUM_PL" changes.
         // If this where to happen for every entity, it would MASSIVELY kill performance (and possibly just not even work at all).
@@ -40,22 +191,39 @@ void AnimatedEntityRenderer::AnimatedEntityRenderer::render(const RenderScene& r
         shader.set_point_lights(light_scene.get_nearest_point_lights(position, BaseLitEntityShader::MAX_PL, 1));
 
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, entity->render_data.diffuse_texture->get_texture_id());
+        glBindTexture(GL_TEXTURE_2D, entity.render_data.diffuse_texture->get_texture_id());
         glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, entity->render_data.specular_map_texture->get_texture_id());
+        glBindTexture(GL_TEXTURE_2D, entity.render_data.specular_map_texture->get_texture_id());
 
-        entity->mesh_hierarchy->calculate_animation(entity->animation_id, entity->animation_time_seconds);
-        entity->mesh_hierarchy->visit_nodes([this, &entity](const MeshHierarchyNode& node, glm::mat4 accumulated_transformation) {
-            for (const auto& mesh_id: node.meshes) {
-                const auto& mesh = entity->mesh_hierarchy->meshes[mesh_id];
+        for (const auto& draw: entity.mesh_hierarchy->draw_list) {
+            const auto& mesh = entity.mesh_hierarchy->meshes[draw.mesh];
 
-                shader.set_model_matrix(entity->instance_data.model_matrix * accumulated_transformation);
-                if (!mesh.bone_transforms.empty()) shader.set_bone_transforms(mesh.bone_transforms);
+            shader.set_draw_data(first, draw.transformation, mesh.bone_offset, !mesh.bones.empty());
 
-                glBindVertexArray(mesh.model->get_vao());
-                glDrawElementsBaseVertex(GL_TRIANGLES, mesh.model->get_index_count(), GL_UNSIGNED_INT, nullptr, mesh.model->get_vertex_offset());
-            }
-        });
+            glBindVertexArray(mesh.model->get_vao());
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, mesh.model->get_index_count(), GL_UNSIGNED_INT, nullptr, (int) count, mesh.model->get_vertex_offset());
+        }
+
+        first += count;
+    }
+}
+
+void AnimatedEntityRenderer::AnimatedEntityRenderer::add_imgui_lod_section() {
+    if (ImGui::CollapsingHeader("Animation LOD")) {
+        ImGui::Checkbox("Enabled", &lod_settings.enabled);
+        ImGui::DragFloat("Full Rate Size", &lod_settings.full_rate_size, 0.005f, 0.0f, 1.0f);
+        ImGui::DragFloat("Optional Bones Size", &lod_settings.optional_bones_size, 0.005f, 0.0f, 1.0f);
+        int max_update_interval = (int) lod_settings.max_update_interval;
+        if (ImGui::SliderInt("Max Update Interval", &max_update_interval, 1, 32)) {
+            lod_settings.max_update_interval = (uint) max_update_interval;
+        }
+        int offscreen_update_interval = (int) lod_settings.offscreen_update_interval;
+        if (ImGui::SliderInt("Offscreen Update Interval", &offscreen_update_interval, 1, 64)) {
+            lod_settings.offscreen_update_interval = (uint) offscreen_update_interval;
+        }
+
+        ImGui::Text("Evaluated: %u, Interpolated: %u", lod_stats.evaluated, lod_stats.interpolated);
+        ImGui::Text("Without Optional Bones: %u, Offscreen: %u", lod_stats.reduced_bones, lod_stats.offscreen);
     }
 }
 
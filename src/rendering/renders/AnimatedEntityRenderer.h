@@ -15,12 +15,11 @@
 #include "rendering/resources/ModelLoader.h"
 #include "rendering/resources/TextureHandle.h"
 #include "rendering/memory/UniformBufferArray.h"
+#include "rendering/memory/TextureBufferArray.h"
+#include "utility/JobSystem.h"
 
 #include "rendering/renders/shaders/BaseLitEntityShader.h"
 
-#define BONE_TRANSFORMS 64
-#define BONE_TRANSFORMS_STR "64"
-
 namespace AnimatedEntityRenderer {
     struct VertexData {
         glm::vec3 position;
@@ -42,28 +41,92 @@ namespace AnimatedEntityRenderer {
 
     using RenderScene = RenderScene<Entity, GlobalData>;
 
+    /// The per instance data read by the shader from the instance buffer, so that many instances can be drawn in one call.
+    /// Must match the layout read in animated_entity/vert.glsl
+    struct InstanceBufferData {
+        glm::mat4 model_matrix;
+        // Material, with the tints already scaled
+        glm::vec4 diffuse_tint;
+        glm::vec4 specular_tint;
+        glm::vec4 ambient_tint;
+        // (shininess, texture_scale, palette_offset, unused)
+        glm::vec4 parameters;
+
+        static InstanceBufferData from_entity(const Entity& entity, uint palette_offset);
+    };
+
     class AnimatedEntityShader : public BaseLitEntityShader {
-        // Animation Data
-        int bone_transforms_location{};
     public:
-        AnimatedEntityShader();
+        static constexpr uint BONE_PALETTE_BINDING = 2;
+        static constexpr uint INSTANCE_BUFFER_BINDING = 3;
 
-        void set_model_matrix(const glm::mat4& model_matrix);
+    private:
+        // Per draw data
+        int instance_offset_location{};
+        int mesh_transformation_location{};
+        int mesh_bone_offset_location{};
+        int has_bones_location{};
+    public:
+        AnimatedEntityShader();
 
-        void set_bone_transforms(const std::vector<glm::mat4>& bone_transforms);
+        /// Set the data for drawing one mesh of a hierarchy, for the instances starting at instance_offset in the instance buffer.
+        /// mesh_bone_offset is the mesh's bone_offset, which is added to each instance's offset into the bone palette.
+        void set_draw_data(uint instance_offset, const glm::mat4& mesh_transformation, uint mesh_bone_offset, bool has_bones);
     private:
         // Override get_uniforms_set_bindings to get the extra uniform for bone transforms
         void get_uniforms_set_bindings() override;
     };
 
+    /// Controls how the animation of entities is simplified as they get smaller on screen
+    struct AnimationLodSettings {
+        bool enabled = true;
+        // The size on screen, as a fraction of the screen height, above which entities are animated every frame.
+        // Each halving of size below this doubles the frames between updates
+        float full_rate_size = 0.2f;
+        // Below this size, optional bones (fingers, face, etc.) are left in their rest pose
+        float optional_bones_size = 0.05f;
+        uint max_update_interval = 8;
+        // For entities that are entirely outside the view
+        uint offscreen_update_interval = 16;
+    };
+
+    /// How many entities were at each level of detail in the last frame
+    struct AnimationLodStats {
+        uint evaluated = 0;
+        uint interpolated = 0;
+        uint reduced_bones = 0;
+        uint offscreen = 0;
+    };
+
     class AnimatedEntityRenderer {
         AnimatedEntityShader shader;
+        // The entities of the current frame, sorted so that entities that can be instanced together are next to each other
+        std::vector<Entity*> frame_entities{};
+        // [frame_entity_id] -> where the entity's bones start in the bone_palette
+        std::vector<uint> palette_offsets{};
+        // The bone transforms of every entity for the current frame
+        TextureBufferArray<glm::mat4> bone_palette{};
+        // [frame_entity_id] -> instance data
+        TextureBufferArray<InstanceBufferData> instance_buffer{};
 
     public:
+        /// If enabled, entities with the same model and textures are drawn with a single instanced draw per mesh.
+        /// This shares the point lights nearest to the group's centre, rather than each entity using its own.
+        bool instancing = false;
+
+        AnimationLodSettings lod_settings{};
+        AnimationLodStats lod_stats{};
+
         AnimatedEntityRenderer();
 
+        /// Evaluate the animation pose of every entity, spread across the job system's threads,
+        /// and gather them into the frame's bone palette. Must be called before render, which then only has to upload and draw.
+        void prepare_frame(const RenderScene& render_scene, JobSystem& job_system);
         void render(const RenderScene& render_scene, const LightScene& light_scene);
 
+        /// Adds controls for the animation LOD settings, and shows the stats from the last frame
+        void add_imgui_lod_section();
+
         bool refresh_shaders();
     };
 }
@@ -0,0 +1,143 @@
+#include "CrowdRenderer.h"
+
+#include <cmath>
+
+CrowdRenderer::CrowdEntity::CrowdEntity(std::shared_ptr<MeshHierarchy<VertexData>> mesh_hierarchy, const EntityMaterial& material, RenderData render_data)
+    : AnimatedEntityInterface(), mesh_hierarchy(std::move(mesh_hierarchy)), material(material), render_data(std::move(render_data)) {}
+
+std::shared_ptr<CrowdRenderer::CrowdEntity> CrowdRenderer::CrowdEntity::create(std::shared_ptr<MeshHierarchy<VertexData>> mesh_hierarchy, const EntityMaterial& material, RenderData render_data) {
+    return std::make_shared<CrowdEntity>(std::move(mesh_hierarchy), material, std::move(render_data));
+}
+
+const std::vector<std::tuple<std::string, double, double>>& CrowdRenderer::CrowdEntity::get_animations() const {
+    return mesh_hierarchy->animations;
+}
+
+uint& CrowdRenderer::CrowdEntity::get_animation_id() {
+    return animation_id;
+}
+
+double& CrowdRenderer::CrowdEntity::get_animation_time_seconds() {
+    return animation_time_seconds;
+}
+
+double CrowdRenderer::CrowdEntity::get_animation_duration_seconds() const {
+    if (animation_id >= mesh_hierarchy->animations.size()) {
+        return 0.0;
+    }
+    const auto& [animation_name, ticks_per_second, duration_ticks] = mesh_hierarchy->animations[animation_id];
+    return duration_ticks / ticks_per_second;
+}
+
+const AnimationClipStats& CrowdRenderer::CrowdEntity::get_animation_stats(uint animation_id) const {
+    return mesh_hierarchy->animation_clips.at(animation_id).stats;
+}
+
+CrowdRenderer::CrowdShader::CrowdShader() :
+    BaseLitEntityShader("Crowd", "crowd/vert.glsl", "animated_entity/frag.glsl") {
+
+    get_uniforms_set_bindings();
+}
+
+void CrowdRenderer::CrowdShader::get_uniforms_set_bindings() {
+    BaseLitEntityShader::get_uniforms_set_bindings(); // Call the base implementation to load all the common uniforms
+    instance_offset_location = get_uniform_location("instance_offset");
+    vertex_count_location = get_uniform_location("vertex_count");
+    clip_first_frame_location = get_uniform_location("clip_first_frame");
+    clip_frame_count_location = get_uniform_location("clip_frame_count");
+    clip_frames_per_second_location = get_uniform_location("clip_frames_per_second");
+    clip_duration_location = get_uniform_location("clip_duration");
+    clip_time_location = get_uniform_location("clip_time");
+    clip_position_min_location = get_uniform_location("clip_position_min");
+    clip_position_extent_location = get_uniform_location("clip_position_extent");
+    draw_vertex_offset_location = get_uniform_location("draw_vertex_offset");
+    // Buffer texture bindings
+    set_binding("vertex_animation", VERTEX_ANIMATION_BINDING);
+    set_binding("instance_buffer", INSTANCE_BUFFER_BINDING);
+}
+
+void CrowdRenderer::CrowdShader::set_crowd_data(uint instance_offset, const VertexAnimationTexture& vertex_animation, const BakedClip& clip, float clip_time) {
+    glProgramUniform1i(id(), instance_offset_location, (int) instance_offset);
+    glProgramUniform1i(id(), vertex_count_location, (int) vertex_animation.vertex_count);
+    glProgramUniform1i(id(), clip_first_frame_location, (int) clip.first_frame);
+    glProgramUniform1i(id(), clip_frame_count_location, (int) clip.frame_count);
+    glProgramUniform1f(id(), clip_frames_per_second_location, clip.frames_per_second);
+    glProgramUniform1f(id(), clip_duration_location, clip.duration_seconds);
+    glProgramUniform1f(id(), clip_time_location, clip_time);
+    glProgramUniform3fv(id(), clip_position_min_location, 1, &clip.position_min[0]);
+    glProgramUniform3fv(id(), clip_position_extent_location, 1, &clip.position_extent[0]);
+}
+
+void CrowdRenderer::CrowdShader::set_draw_data(int draw_vertex_offset) {
+    glProgramUniform1i(id(), draw_vertex_offset_location, draw_vertex_offset);
+}
+
+CrowdRenderer::CrowdRenderer::CrowdRenderer() : shader() {}
+
+void CrowdRenderer::CrowdRenderer::render(const RenderScene& render_scene, const LightScene& light_scene) {
+    // Gather every member of every crowd, the only per frame upload
+    instance_buffer.data.clear();
+    for (const auto& entity: render_scene.entities) {
+        for (const auto& member: entity->members) {
+            instance_buffer.data.push_back({member.model_matrix, glm::vec4{member.phase, 0.0f, 0.0f, 0.0f}});
+        }
+    }
+    if (instance_buffer.data.empty()) return;
+
+    shader.use();
+    shader.set_global_data(render_scene.global_data);
+
+    shader.set_directional_lights(light_scene.get_directional_lights(BaseLitEntityShader::MAX_DL, 0));
+
+    instance_buffer.upload();
+    instance_buffer.bind(CrowdShader::INSTANCE_BUFFER_BINDING);
+
+    uint instance_offset = 0;
+    for (const auto& entity: render_scene.entities) {
+        auto count = (uint) entity->members.size();
+        const auto& vertex_animation = entity->mesh_hierarchy->vertex_animation;
+        if (count == 0 || vertex_animation == nullptr) {
+            instance_offset += count;
+            continue;
+        }
+
+        // The whole crowd shares the point lights nearest to its centre
+        glm::vec3 centre{0.0f};
+        for (const auto& member: entity->members) {
+            centre += glm::vec3{member.model_matrix[3]};
+        }
+        centre /= (float) count;
+        // See the note in AnimatedEntityRenderer::render about set_point_lights recompiling the shader
+        shader.set_point_lights(light_scene.get_nearest_point_lights(centre, BaseLitEntityShader::MAX_PL, 1));
+
+        shader.set_instance_data(BaseLitEntityInstanceData{glm::mat4{1.0f}, entity->material});
+
+        const auto& clip = vertex_animation->get_clip(entity->animation_id);
+        // Wrapped here in double precision, so that the shader only ever sees a small time
+        auto clip_time = clip.duration_seconds > 0.0f ? (float) std::fmod(entity->animation_time_seconds, (double) clip.duration_seconds) : 0.0f;
+        shader.set_crowd_data(instance_offset, *vertex_animation, clip, clip_time);
+        vertex_animation->bind(CrowdShader::VERTEX_ANIMATION_BINDING);
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, entity->render_data.diffuse_texture->get_texture_id());
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, entity->render_data.specular_map_texture->get_texture_id());
+
+        const auto& draw_list = entity->mesh_hierarchy->draw_list;
+        for (auto draw_i = 0u; draw_i < draw_list.size(); ++draw_i) {
+            const auto& model = entity->mesh_hierarchy->meshes[draw_list[draw_i].mesh].model;
+
+            // gl_VertexID includes the base vertex, so take it back off to get the index into the draw's baked vertices
+            shader.set_draw_data((int) vertex_animation->draw_vertex_offsets[draw_i] - model->get_vertex_offset());
+
+            glBindVertexArray(model->get_vao());
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, model->get_index_count(), GL_UNSIGNED_INT, nullptr, (int) count, model->get_vertex_offset());
+        }
+
+        instance_offset += count;
+    }
+}
+
+bool CrowdRenderer::CrowdRenderer::refresh_shaders() {
+    return shader.reload_files();
+}
@@ -0,0 +1,117 @@
+#ifndef CROWD_RENDERER_H
+#define CROWD_RENDERER_H
+
+#include <vector>
+#include <memory>
+
+#include <glm/glm.hpp>
+
+#include "rendering/scene/Lights.h"
+#include "rendering/scene/RenderScene.h"
+#include "rendering/scene/RenderedEntity.h"
+#include "rendering/resources/VertexAnimationTexture.h"
+#include "rendering/memory/TextureBufferArray.h"
+
+#include "AnimatedEntityRenderer.h"
+
+#include "rendering/renders/shaders/BaseLitEntityShader.h"
+
+namespace CrowdRenderer {
+    // Crowds draw the same meshes as animated entities, but only read the texture coordinates from them,
+    // the positions and normals come from the hierarchy's baked vertex_animation instead
+    using VertexData = AnimatedEntityRenderer::VertexData;
+
+    using EntityMaterial = BaseLitEntityMaterial;
+    using GlobalData = BaseLitEntityGlobalData;
+    using RenderData = BaseLitEntityRenderData;
+
+    /// A single member of a crowd
+    struct CrowdMember {
+        glm::mat4 model_matrix;
+        // How far ahead of the crowd this member is in the clip, as a fraction of the clip's duration,
+        // so that it stays spread out whichever clip is playing
+        float phase;
+    };
+
+    /// Many instances of the same baked MeshHierarchy, all playing the same clip from their own phase.
+    /// The whole crowd is drawn with one instanced draw per mesh, with no pose evaluation on the CPU.
+    ///
+    /// Implements AnimatedEntityInterface, so the Animator can play the crowd like any other animated entity.
+    struct CrowdEntity : public AnimatedEntityInterface {
+        // Must have been loaded with ModelLoader::load_baked_hierarchy_from_file, otherwise the crowd isn't drawn
+        std::shared_ptr<MeshHierarchy<VertexData>> mesh_hierarchy;
+        EntityMaterial material;
+        RenderData render_data;
+        std::vector<CrowdMember> members{};
+
+        // Animation Data
+        uint animation_id = NONE_ANIMATION; // NONE_ANIMATION means the rest pose
+        double animation_time_seconds = 0.0;
+
+        CrowdEntity(std::shared_ptr<MeshHierarchy<VertexData>> mesh_hierarchy, const EntityMaterial& material, RenderData render_data);
+
+        static std::shared_ptr<CrowdEntity> create(std::shared_ptr<MeshHierarchy<VertexData>> mesh_hierarchy, const EntityMaterial& material, RenderData render_data);
+
+        [[nodiscard]] const std::vector<std::tuple<std::string, double, double>>& get_animations() const override;
+        [[nodiscard]] uint& get_animation_id() override;
+        [[nodiscard]] double& get_animation_time_seconds() override;
+        [[nodiscard]] double get_animation_duration_seconds() const override;
+        [[nodiscard]] const AnimationClipStats& get_animation_stats(uint animation_id) const override;
+    };
+
+    using Entity = CrowdEntity;
+
+    using RenderScene = RenderScene<Entity, GlobalData>;
+
+    /// The per member data read by the shader from the instance buffer.
+    /// Must match the layout read in crowd/vert.glsl
+    struct InstanceBufferData {
+        glm::mat4 model_matrix;
+        // (phase, unused, unused, unused)
+        glm::vec4 parameters;
+    };
+
+    class CrowdShader : public BaseLitEntityShader {
+    public:
+        static constexpr uint VERTEX_ANIMATION_BINDING = 2;
+        static constexpr uint INSTANCE_BUFFER_BINDING = 3;
+
+    private:
+        // Per crowd data
+        int instance_offset_location{};
+        int vertex_count_location{};
+        int clip_first_frame_location{};
+        int clip_frame_count_location{};
+        int clip_frames_per_second_location{};
+        int clip_duration_location{};
+        int clip_time_location{};
+        int clip_position_min_location{};
+        int clip_position_extent_location{};
+        // Per draw data
+        int draw_vertex_offset_location{};
+    public:
+        CrowdShader();
+
+        /// Set the data for drawing a crowd, whose members start at instance_offset in the instance buffer
+        void set_crowd_data(uint instance_offset, const VertexAnimationTexture& vertex_animation, const BakedClip& clip, float clip_time);
+        /// Set where the vertices of the current draw start in each frame of the vertex animation
+        void set_draw_data(int draw_vertex_offset);
+    private:
+        void get_uniforms_set_bindings() override;
+    };
+
+    class CrowdRenderer {
+        CrowdShader shader;
+        // [member of every crowd] -> instance data, gathered each frame
+        TextureBufferArray<InstanceBufferData> instance_buffer{};
+
+    public:
+        CrowdRenderer();
+
+        void render(const RenderScene& render_scene, const LightScene& light_scene);
+
+        bool refresh_shaders();
+    };
+}
+
+#endif //CROWD_RENDERER_H
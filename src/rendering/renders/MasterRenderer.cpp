@@ -7,7 +7,7 @@
 #include "scene/SceneInterface.h"
 #include "rendering/renders/ParticleRenderer.h"
 
-MasterRenderer::MasterRenderer() : entity_renderer(), animated_entity_renderer(), emissive_entity_renderer(), render_settings() {
+MasterRenderer::MasterRenderer() : entity_renderer(), animated_entity_renderer(), emissive_entity_renderer(), crowd_renderer(), oit_compositor(), render_settings() {
     glEnable(GL_DEPTH_TEST);
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
     glEnable(GL_CULL_FACE);
@@ -22,19 +22,52 @@ void MasterRenderer::update(const Window& window) {
 }
 
 void MasterRenderer::render_scene(MasterRenderScene& render_scene, const SceneContext& scene_context) {
-    // Animate any animated entities
+    auto stage_start = std::chrono::steady_clock::now();
+    stage_timings.thread_count = scene_context.job_system.get_thread_count();
+
+    // Animate any animated entities, then pose them all up front so that the renderer only has to upload the results
     render_scene.animator.animate(scene_context.window_manager.get_delta_time());
-    
+    animated_entity_renderer.prepare_frame(render_scene.animated_entity_scene, scene_context.job_system);
+    record_stage(stage_timings.animation_update, stage_start);
+
     // Render all entity types
     entity_renderer.render(render_scene.entity_scene, render_scene.light_scene);
+    record_stage(stage_timings.entity_render, stage_start);
     animated_entity_renderer.render(render_scene.animated_entity_scene, render_scene.light_scene);
+    record_stage(stage_timings.animated_entity_render, stage_start);
     emissive_entity_renderer.render(render_scene.emissive_entity_scene);
-    
+    record_stage(stage_timings.emissive_entity_render, stage_start);
+    crowd_renderer.render(render_scene.crowd_scene, render_scene.light_scene);
+    record_stage(stage_timings.crowd_render, stage_start);
+
     // Render particles
     if (render_scene.particle_renderer) {
-        render_scene.particle_renderer->prepare_frame(render_scene.get_particle_systems(), scene_context.window, render_scene.entity_scene.global_data);
-        render_scene.particle_renderer->render(render_scene.entity_scene.global_data);
+        auto& particle_renderer = *render_scene.particle_renderer;
+        particle_renderer.blend_mode = render_settings.particle_blend_mode;
+        particle_renderer.lod_settings = render_settings.particle_lod;
+        particle_renderer.prepare_frame(render_scene.get_particle_systems(), scene_context.window, render_scene.entity_scene.global_data, scene_context.job_system);
+        if (render_settings.particle_blend_mode == ParticleRenderer::BlendMode::OrderIndependent) {
+            oit_compositor.begin(scene_context.window);
+            particle_renderer.render(render_scene.entity_scene.global_data);
+            oit_compositor.composite();
+        } else {
+            particle_renderer.render(render_scene.entity_scene.global_data);
+        }
+        stage_timings.particle_sort = particle_renderer.last_sort_milliseconds;
+        stage_timings.particles_sorted = particle_renderer.get_sorted_count();
+        particle_lod_stats = particle_renderer.lod_stats;
     }
+    record_stage(stage_timings.particles, stage_start);
+}
+
+void MasterRenderer::record_stage(float& stage_time, std::chrono::steady_clock::time_point& stage_start) {
+    // How much of each new sample to blend in, small enough to keep the numbers readable
+    constexpr float SMOOTHING = 0.05f;
+
+    auto now = std::chrono::steady_clock::now();
+    float milliseconds = std::chrono::duration<float, std::milli>(now - stage_start).count();
+    stage_time += (milliseconds - stage_time) * SMOOTHING;
+    stage_start = now;
 }
 
 void MasterRenderer::sync() {
@@ -76,6 +109,39 @@ void MasterRenderer::add_imgui_options_section(WindowManager& window_manager) {
                 render_settings.fps_cap = 24.0f;
             }
         }
+
+        if (ImGui::Checkbox("Instanced Animated Entities", &render_settings.instanced_animated_entities)) {
+            animated_entity_renderer.instancing = render_settings.instanced_animated_entities;
+        }
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Draw animated entities with the same model and textures together,\nsharing the point lights nearest to the group's centre");
+        }
+
+        const char* blend_mode_names[] = {"Unsorted", "Depth Sorted", "Order Independent"};
+        int blend_mode = (int) render_settings.particle_blend_mode;
+        if (ImGui::Combo("Particle Blending", &blend_mode, blend_mode_names, IM_ARRAYSIZE(blend_mode_names))) {
+            render_settings.particle_blend_mode = (ParticleRenderer::BlendMode) blend_mode;
+        }
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Depth Sorted draws the particles of every emitter back to front together, so that overlapping emitters blend correctly.\n"
+                              "Order Independent approximates the same blend with weighted blended OIT, with no sort");
+        }
+    }
+
+    animated_entity_renderer.add_imgui_lod_section();
+    ParticleRenderer::add_imgui_lod_section(render_settings.particle_lod, particle_lod_stats);
+
+    if (ImGui::CollapsingHeader("Frame Stage Timings")) {
+        // These are CPU times, so the GPU work for the render stages will mostly show up when the buffers are swapped
+        ImGui::Text("Animation Update: %.3f ms (%u threads)", stage_timings.animation_update, stage_timings.thread_count);
+        ImGui::Text("Entity Render: %.3f ms", stage_timings.entity_render);
+        ImGui::Text("Animated Entity Render: %.3f ms", stage_timings.animated_entity_render);
+        ImGui::Text("Emissive Entity Render: %.3f ms", stage_timings.emissive_entity_render);
+        ImGui::Text("Crowd Render: %.3f ms", stage_timings.crowd_render);
+        ImGui::Text("Particles: %.3f ms", stage_timings.particles);
+        if (render_settings.particle_blend_mode == ParticleRenderer::BlendMode::DepthSorted) {
+            ImGui::Text("  Depth Sort: %.3f ms (%zu particles)", stage_timings.particle_sort, stage_timings.particles_sorted);
+        }
     }
 
     if (ImGui::CollapsingHeader("Shader Options")) {
@@ -87,6 +153,8 @@ void MasterRenderer::add_imgui_options_section(WindowManager& window_manager) {
             failures += entity_renderer.refresh_shaders() ? 0 : 1;
             failures += animated_entity_renderer.refresh_shaders() ? 0 : 1;
             failures += emissive_entity_renderer.refresh_shaders() ? 0 : 1;
+            failures += crowd_renderer.refresh_shaders() ? 0 : 1;
+            failures += oit_compositor.refresh_shaders() ? 0 : 1;
         }
         if (glfwGetTime() - 2.0 <= last_time) {
             ImGui::SameLine();
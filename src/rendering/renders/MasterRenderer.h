@@ -1,9 +1,14 @@
 #ifndef MASTER_RENDERER_H
 #define MASTER_RENDERER_H
 
+#include <chrono>
+
 #include "utility/SyncManager.h"
 #include "EntityRenderer.h"
 #include "EmissiveEntityRenderer.h"
+#include "CrowdRenderer.h"
+#include "OitCompositor.h"
+#include "ParticleRenderer.h"
 #include "rendering/scene/MasterRenderScene.h"
 #include "system_interfaces/WindowManager.h"
 #include "scene/SceneInterface.h"
@@ -14,6 +19,8 @@ class MasterRenderer {
     EntityRenderer::EntityRenderer entity_renderer;
     AnimatedEntityRenderer::AnimatedEntityRenderer animated_entity_renderer;
     EmissiveEntityRenderer::EmissiveEntityRenderer emissive_entity_renderer;
+    CrowdRenderer::CrowdRenderer crowd_renderer;
+    OitCompositor::OitCompositor oit_compositor;
     SyncManager sync_manager;
 
     struct RenderSettings {
@@ -23,7 +30,30 @@ class MasterRenderer {
         bool v_sync = false;
         bool enable_fps_cap = true;
         float fps_cap = 240.0f;
+        bool instanced_animated_entities = false;
+        ParticleRenderer::BlendMode particle_blend_mode = ParticleRenderer::BlendMode::Unsorted;
+        ParticleRenderer::ParticleLodSettings particle_lod{};
     } render_settings;
+
+    // From the particle renderer of the last scene rendered, for the options section
+    ParticleRenderer::ParticleLodStats particle_lod_stats{};
+
+    // The CPU time spent on each stage of render_scene, in milliseconds, smoothed over recent frames
+    struct StageTimings {
+        float animation_update = 0.0f;
+        float entity_render = 0.0f;
+        float animated_entity_render = 0.0f;
+        float emissive_entity_render = 0.0f;
+        float crowd_render = 0.0f;
+        float particles = 0.0f;
+        // Part of particles, not smoothed
+        float particle_sort = 0.0f;
+        size_t particles_sorted = 0;
+        uint thread_count = 1;
+    } stage_timings;
+
+    /// Blend the time since stage_start into the smoothed stage_time, then restart stage_start for the next stage
+    static void record_stage(float& stage_time, std::chrono::steady_clock::time_point& stage_start);
 public:
     MasterRenderer();
 
@@ -0,0 +1,158 @@
+#include "OitCompositor.h"
+
+#include <stdexcept>
+#include <iostream>
+
+#include "utility/HelperTypes.h"
+
+OitCompositor::CompositeShader::CompositeShader() :
+    ShaderInterface("OIT Composite", "oit_composite/vert.glsl", "oit_composite/frag.glsl",
+                    [&]() { get_uniforms_set_bindings(); }) {
+    get_uniforms_set_bindings();
+}
+
+void OitCompositor::CompositeShader::get_uniforms_set_bindings() {
+    set_binding("accumulation_texture", ACCUMULATION_BINDING);
+    set_binding("revealage_texture", REVEALAGE_BINDING);
+}
+
+OitCompositor::OitCompositor::OitCompositor() : shader() {
+    glGenFramebuffers(1, &framebuffer);
+    glGenTextures(1, &accumulation_texture);
+    glGenTextures(1, &revealage_texture);
+    glGenRenderbuffers(1, &depth_renderbuffer);
+    glGenVertexArrays(1, &empty_vao);
+}
+
+OitCompositor::OitCompositor::~OitCompositor() {
+    glDeleteVertexArrays(1, &empty_vao);
+    glDeleteRenderbuffers(1, &depth_renderbuffer);
+    glDeleteTextures(1, &revealage_texture);
+    glDeleteTextures(1, &accumulation_texture);
+    glDeleteFramebuffers(1, &framebuffer);
+}
+
+std::pair<uint, bool> OitCompositor::OitCompositor::default_depth_format() {
+    int depth_bits = 0, stencil_bits = 0, component_type = 0;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, GL_DEPTH, GL_FRAMEBUFFER_ATTACHMENT_DEPTH_SIZE, &depth_bits);
+    glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, GL_DEPTH, GL_FRAMEBUFFER_ATTACHMENT_COMPONENT_TYPE, &component_type);
+    glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, GL_STENCIL, GL_FRAMEBUFFER_ATTACHMENT_STENCIL_SIZE, &stencil_bits);
+
+    bool has_stencil = stencil_bits > 0;
+    if (component_type == GL_FLOAT) {
+        return {has_stencil ? GL_DEPTH32F_STENCIL8 : GL_DEPTH_COMPONENT32F, has_stencil};
+    }
+    if (depth_bits > 24) {
+        // There is no 32 bit normalised depth with stencil, but any stencil the window has isn't used
+        return {GL_DEPTH_COMPONENT32, false};
+    }
+    if (depth_bits > 16 || has_stencil) {
+        return {has_stencil ? GL_DEPTH24_STENCIL8 : GL_DEPTH_COMPONENT24, has_stencil};
+    }
+    return {GL_DEPTH_COMPONENT16, false};
+}
+
+void OitCompositor::OitCompositor::resize(glm::ivec2 new_size) {
+    size = new_size;
+    depth_blit_checked = false;
+    depth_blit_works = true;
+
+    auto allocate_texture = [&](uint texture, int internal_format, uint format) {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internal_format, size.x, size.y, 0, format, GL_HALF_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    };
+    allocate_texture(accumulation_texture, GL_RGBA16F, GL_RGBA);
+    allocate_texture(revealage_texture, GL_R16F, GL_RED);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // Depth is only blitted between matching formats, so use whatever the driver gave the default framebuffer,
+    // which needn't be the 32 bits the window asks for, and may or may not come with stencil
+    auto [depth_format, has_stencil] = default_depth_format();
+    glBindRenderbuffer(GL_RENDERBUFFER, depth_renderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, depth_format, size.x, size.y);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, accumulation_texture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, revealage_texture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, has_stencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_renderbuffer);
+    const uint draw_buffers[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+    glDrawBuffers(2, draw_buffers);
+
+    auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        throw std::runtime_error(Formatter() << "OIT framebuffer of " << size.x << "x" << size.y << " is incomplete, status: " << status);
+    }
+}
+
+void OitCompositor::OitCompositor::begin(const Window& window) {
+    auto window_size = window.get_framebuffer_size();
+    if (window_size != size) {
+        resize(window_size);
+    }
+
+    // Cleared first, so that if the blit fails, transparent surfaces are only drawn over the opaque scene rather than tested against garbage
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glDepthMask(GL_TRUE);
+    glClear(GL_DEPTH_BUFFER_BIT);
+
+    if (depth_blit_works) {
+        if (!depth_blit_checked) {
+            // Drop any earlier errors, so only the blit's are seen
+            while (glGetError() != GL_NO_ERROR) {}
+        }
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, size.x, size.y, 0, 0, size.x, size.y, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+        if (!depth_blit_checked) {
+            depth_blit_checked = true;
+            auto error = glGetError();
+            if (error != GL_NO_ERROR) {
+                depth_blit_works = false;
+                std::cerr << "Failed to copy the scene's depth for order independent transparency (error " << error
+                          << "), transparent particles won't be hidden by opaque objects" << std::endl;
+            }
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    }
+
+    // Nothing accumulated, and everything revealed
+    const float clear_accumulation[] = {0.0f, 0.0f, 0.0f, 0.0f};
+    const float clear_revealage[] = {1.0f, 0.0f, 0.0f, 0.0f};
+    glClearBufferfv(GL_COLOR, 0, clear_accumulation);
+    glClearBufferfv(GL_COLOR, 1, clear_revealage);
+}
+
+void OitCompositor::OitCompositor::composite() {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    shader.use();
+    glActiveTexture(GL_TEXTURE0 + CompositeShader::ACCUMULATION_BINDING);
+    glBindTexture(GL_TEXTURE_2D, accumulation_texture);
+    glActiveTexture(GL_TEXTURE0 + CompositeShader::REVEALAGE_BINDING);
+    glBindTexture(GL_TEXTURE_2D, revealage_texture);
+
+    // The composite writes the average colour with an alpha of the total coverage, so it blends like any other transparent surface
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    glBindVertexArray(empty_vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+
+    glDisable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
+    glActiveTexture(GL_TEXTURE0);
+    glUseProgram(0);
+}
+
+bool OitCompositor::OitCompositor::refresh_shaders() {
+    return shader.reload_files();
+}
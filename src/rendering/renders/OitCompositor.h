@@ -0,0 +1,60 @@
+#ifndef OIT_COMPOSITOR_H
+#define OIT_COMPOSITOR_H
+
+#include <utility>
+
+#include "rendering/renders/shaders/ShaderInterface.h"
+#include "system_interfaces/Window.h"
+
+/// Weighted blended order independent transparency (McGuire & Bavoil 2013).
+/// Transparent surfaces are drawn in any order into an accumulation and a revealage target,
+/// then composite resolves them over the opaque scene in a single full screen pass.
+namespace OitCompositor {
+    class CompositeShader : public ShaderInterface {
+    public:
+        static constexpr uint ACCUMULATION_BINDING = 0;
+        static constexpr uint REVEALAGE_BINDING = 1;
+
+        CompositeShader();
+    private:
+        void get_uniforms_set_bindings();
+    };
+
+    class OitCompositor {
+        CompositeShader shader;
+        uint framebuffer{};
+        // RGBA16F, sum of weighted premultiplied colour in rgb, and of weighted alpha in a
+        uint accumulation_texture{};
+        // R16F, the product of (1 - alpha), so how much of the opaque scene still shows through
+        uint revealage_texture{};
+        // A copy of the opaque scene's depth, so transparent surfaces behind opaque ones are still hidden.
+        // In the same format as the default framebuffer's depth, which is whatever the driver chose, as blitting needs them to match
+        uint depth_renderbuffer{};
+        // The first blit after a resize is checked for errors, and if it fails, the depth is left cleared from then on
+        bool depth_blit_checked = false;
+        bool depth_blit_works = true;
+        // The full screen triangle is generated from gl_VertexID, but core profile still needs a vao bound to draw
+        uint empty_vao{};
+        glm::ivec2 size{0, 0};
+
+        void resize(glm::ivec2 new_size);
+        /// The depth format of the default framebuffer, and whether it has stencil too
+        static std::pair<uint, bool> default_depth_format();
+    public:
+        OitCompositor();
+        OitCompositor(const OitCompositor&) = delete;
+        OitCompositor& operator=(const OitCompositor&) = delete;
+        ~OitCompositor();
+
+        /// Bind and clear the targets, sized to the window, ready for transparent surfaces to be drawn.
+        /// Copies the depth of the default framebuffer, so must be called after the opaque scene is drawn.
+        /// If it can't be copied, transparent surfaces are drawn without being hidden by the opaque scene.
+        void begin(const Window& window);
+        /// Blend the accumulated transparent surfaces over the default framebuffer, and bind it again
+        void composite();
+
+        bool refresh_shaders();
+    };
+}
+
+#endif //OIT_COMPOSITOR_H
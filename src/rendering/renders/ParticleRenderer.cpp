@@ -3,14 +3,20 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
+#include <chrono>
+#include <algorithm>
 #include <glad/gl.h>
+#include "rendering/imgui/ImGuiManager.h"
 #include "scene/editor_scene/ParticleEmitterElement.h"
+#include "utility/Math.h"
+#include "utility/RadixSort.h"
 
 namespace ParticleRenderer {
 
-ParticleShader::ParticleShader() : 
+ParticleShader::ParticleShader(std::unordered_map<std::string, std::string> frag_defines) :
     ShaderInterface("Particle", "particle/vert.glsl", "particle/frag.glsl", 
-                   [&]() { get_uniforms_set_bindings(); }) {
+                   [&]() { get_uniforms_set_bindings(); }, {}, std::move(frag_defines)) {
+    get_uniforms_set_bindings();
 }
 
 bool ParticleShader::init_shader() {
@@ -19,134 +25,585 @@ bool ParticleShader::init_shader() {
 
 void ParticleShader::get_uniforms_set_bindings() {
     projection_matrix_location = get_uniform_location("projection_matrix");
+    projection_view_matrix_location = get_uniform_location("projection_view_matrix");
+    model_matrix_location = get_uniform_location("model_matrix");
+    instance_origin_location = get_uniform_location("instance_origin");
 }
 
-ParticleRenderer::ParticleRenderer() {
-    // Create VAO
+GpuParticleBuffers::GpuParticleBuffers(uint capacity) : capacity(capacity) {
+    // Every slot starts dead, with no life remaining
+    std::vector<GpuParticle> initial_particles(capacity, GpuParticle{});
+
+    glGenBuffers(2, vbos.data());
+    glGenVertexArrays(2, update_vaos.data());
+    glGenVertexArrays(2, render_vaos.data());
+
+    auto float_attribute = [](uint index, int size, size_t offset) {
+        glEnableVertexAttribArray(index);
+        glVertexAttribPointer(index, size, GL_FLOAT, GL_FALSE, sizeof(GpuParticle), (void*) offset);
+    };
+
+    for (auto i = 0u; i < 2; ++i) {
+        glBindBuffer(GL_ARRAY_BUFFER, vbos[i]);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) (capacity * sizeof(GpuParticle)), initial_particles.data(), GL_DYNAMIC_COPY);
+
+        glBindVertexArray(update_vaos[i]);
+        float_attribute(0, 3, offsetof(GpuParticle, position));
+        float_attribute(1, 1, offsetof(GpuParticle, size));
+        float_attribute(2, 4, offsetof(GpuParticle, color));
+        float_attribute(3, 1, offsetof(GpuParticle, rotation));
+        float_attribute(4, 3, offsetof(GpuParticle, velocity));
+        float_attribute(5, 1, offsetof(GpuParticle, life_remaining));
+        float_attribute(6, 1, offsetof(GpuParticle, total_life));
+        float_attribute(7, 1, offsetof(GpuParticle, angular_velocity));
+
+        // Same locations as InstanceStream's vao, so particle/vert.glsl can draw either
+        glBindVertexArray(render_vaos[i]);
+        float_attribute(0, 3, offsetof(GpuParticle, position));
+        float_attribute(1, 1, offsetof(GpuParticle, size));
+        float_attribute(2, 4, offsetof(GpuParticle, color));
+        float_attribute(3, 1, offsetof(GpuParticle, rotation));
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+GpuParticleBuffers::~GpuParticleBuffers() {
+    glDeleteVertexArrays(2, render_vaos.data());
+    glDeleteVertexArrays(2, update_vaos.data());
+    glDeleteBuffers(2, vbos.data());
+}
+
+ParticleUpdateShader::ParticleUpdateShader() :
+    ShaderInterface("Particle Update", "particle/update_vert.glsl", "particle/update_frag.glsl",
+                    [&]() { get_uniforms_set_bindings(); }, {}, {},
+                    {"out_position", "out_size", "out_color", "out_rotation", "out_velocity", "out_life_remaining", "out_total_life", "out_angular_velocity"}) {
+    get_uniforms_set_bindings();
+}
+
+void ParticleUpdateShader::get_uniforms_set_bindings() {
+    delta_time_location = get_uniform_location("delta_time");
+    frame_seed_location = get_uniform_location("frame_seed");
+    capacity_location = get_uniform_location("capacity");
+    spawn_start_location = get_uniform_location("spawn_start");
+    spawn_count_location = get_uniform_location("spawn_count");
+    spawn_centre_location = get_uniform_location("spawn_centre");
+    lifespan_range_location = get_uniform_location("lifespan_range");
+    velocity_min_location = get_uniform_location("velocity_min");
+    velocity_max_location = get_uniform_location("velocity_max");
+    size_range_location = get_uniform_location("size_range");
+    rotation_range_location = get_uniform_location("rotation_range");
+    angular_velocity_range_location = get_uniform_location("angular_velocity_range");
+    color_start_location = get_uniform_location("color_start");
+    color_end_location = get_uniform_location("color_end");
+    acceleration_location = get_uniform_location("acceleration");
+    attractor_position_location = get_uniform_location("attractor_position");
+    attractor_strength_location = get_uniform_location("attractor_strength");
+    attractor_radius_location = get_uniform_location("attractor_radius");
+    turbulence_strength_location = get_uniform_location("turbulence_strength");
+    end_color_location = get_uniform_location("end_color");
+    end_size_factor_location = get_uniform_location("end_size_factor");
+}
+
+void ParticleUpdateShader::set_emitter_data(const EditorScene::ParticleEmitterElement& emitter, const GpuParticleBuffers& buffers, float delta_time, uint spawn_count) {
+    // Particles in world space spawn around the emitter, otherwise around the origin of the emitter's space
+    glm::vec3 spawn_centre = emitter.worldSpaceParticles ? glm::vec3(emitter.transform()[3]) : glm::vec3(0.0f);
+
+    glProgramUniform1f(id(), delta_time_location, delta_time);
+    glProgramUniform1ui(id(), frame_seed_location, buffers.frame);
+    glProgramUniform1i(id(), capacity_location, (int) buffers.get_capacity());
+    glProgramUniform1i(id(), spawn_start_location, (int) buffers.spawn_cursor);
+    glProgramUniform1i(id(), spawn_count_location, (int) spawn_count);
+    glProgramUniform3fv(id(), spawn_centre_location, 1, glm::value_ptr(spawn_centre));
+    glProgramUniform2f(id(), lifespan_range_location, emitter.particleLifespanMin, emitter.particleLifespanMax);
+    glProgramUniform3fv(id(), velocity_min_location, 1, glm::value_ptr(emitter.initialVelocityMin));
+    glProgramUniform3fv(id(), velocity_max_location, 1, glm::value_ptr(emitter.initialVelocityMax));
+    glProgramUniform2f(id(), size_range_location, emitter.initialSizeMin, emitter.initialSizeMax);
+    glProgramUniform2f(id(), rotation_range_location, emitter.initialRotationMin, emitter.initialRotationMax);
+    glProgramUniform2f(id(), angular_velocity_range_location, emitter.angularVelocityMin, emitter.angularVelocityMax);
+    glProgramUniform4fv(id(), color_start_location, 1, glm::value_ptr(emitter.initialColorStart));
+    glProgramUniform4fv(id(), color_end_location, 1, glm::value_ptr(emitter.initialColorEnd));
+    glm::vec3 acceleration = emitter.gravity + emitter.windForce;
+    glProgramUniform3fv(id(), acceleration_location, 1, glm::value_ptr(acceleration));
+    glProgramUniform3fv(id(), attractor_position_location, 1, glm::value_ptr(emitter.attractorPosition));
+    glProgramUniform1f(id(), attractor_strength_location, emitter.attractorStrength);
+    glProgramUniform1f(id(), attractor_radius_location, emitter.attractorRadius);
+    glProgramUniform1f(id(), turbulence_strength_location, emitter.turbulenceStrength);
+    glProgramUniform4fv(id(), end_color_location, 1, glm::value_ptr(emitter.endColor));
+    glProgramUniform1f(id(), end_size_factor_location, emitter.endSizeFactor);
+}
+
+InstanceStream::InstanceStream() : persistent(GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage) {
     glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
+    allocate(INITIAL_STREAM_CAPACITY);
+}
+
+InstanceStream::~InstanceStream() {
+    for (const auto& region : in_flight) {
+        glDeleteSync(region.fence);
+    }
+    if (persistent || region_mapping != nullptr) {
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    glDeleteBuffers(1, &vbo);
+    glDeleteVertexArrays(1, &vao);
+}
+
+void InstanceStream::wait(GLsync fence) {
+    // Flush on the first wait, so the fence is sure to be reached
+    GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    while (glClientWaitSync(fence, flags, 1000000) == GL_TIMEOUT_EXPIRED) {
+        flags = 0;
+    }
+    glDeleteSync(fence);
+}
+
+void InstanceStream::allocate(size_t new_capacity) {
+    while (!in_flight.empty()) {
+        wait(in_flight.front().fence);
+        in_flight.pop_front();
+    }
+
+    if (vbo != 0) {
+        if (persistent) {
+            glBindBuffer(GL_ARRAY_BUFFER, vbo);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+        }
+        glDeleteBuffers(1, &vbo);
+    }
+
+    capacity = new_capacity;
+    cursor = 0;
+    auto size = (GLsizeiptr) (capacity * sizeof(ParticleInstance));
 
-    // Create VBO for particle data
     glGenBuffers(1, &vbo);
+    glBindVertexArray(vao);
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
-
-    // Allocate buffer for maximum number of particles
-    glBufferData(GL_ARRAY_BUFFER, MAX_PARTICLES_PER_DRAW * sizeof(ParticleInstance), nullptr, GL_DYNAMIC_DRAW);
+    if (persistent) {
+        // Coherent, so that writes are visible to draws issued after them without any explicit flush
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+        persistent_mapping = (ParticleInstance*) glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+    } else {
+        glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    }
 
     // Position
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance), (void*)offsetof(ParticleInstance, position));
-    
+    glVertexAttribPointer(0, 3, GL_HALF_FLOAT, GL_FALSE, sizeof(ParticleInstance), (void*)offsetof(ParticleInstance, position));
+
     // Size
     glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance), (void*)offsetof(ParticleInstance, size));
-    
+    glVertexAttribPointer(1, 1, GL_HALF_FLOAT, GL_FALSE, sizeof(ParticleInstance), (void*)offsetof(ParticleInstance, size));
+
     // Colour
     glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance), (void*)offsetof(ParticleInstance, color));
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ParticleInstance), (void*)offsetof(ParticleInstance, color));
 
     // Rotation
     glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance), (void*)offsetof(ParticleInstance, rotation));
+    glVertexAttribPointer(3, 1, GL_HALF_FLOAT, GL_FALSE, sizeof(ParticleInstance), (void*)offsetof(ParticleInstance, rotation));
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
-ParticleRenderer::~ParticleRenderer() {
-    if (vbo != 0) {
-        glDeleteBuffers(1, &vbo);
-        vbo = 0;
+ParticleInstance* InstanceStream::reserve(size_t count) {
+    // In case the last frame's region was never drawn
+    finish_writes();
+
+    region_begin = 0;
+    region_size = count;
+    if (count == 0) {
+        return nullptr;
     }
-    if (vao != 0) {
-        glDeleteVertexArrays(1, &vao);
-        vao = 0;
+
+    // Rather than drop particles, grow so that every frame in flight has room for this many
+    if (count * FRAMES_IN_FLIGHT > capacity) {
+        allocate(std::max(count * FRAMES_IN_FLIGHT, capacity * 2));
     }
+
+    bool wrapped = cursor + count > capacity;
+    if (wrapped) {
+        cursor = 0;
+    }
+    region_begin = cursor;
+    cursor += count;
+
+    if (persistent) {
+        // Regions are reused oldest first, so waiting from the front frees up the ones overlapping this region
+        auto overlaps = [&](const InFlightRegion& region) { return region.begin < region_begin + count && region_begin < region.end; };
+        while (std::any_of(in_flight.begin(), in_flight.end(), overlaps)) {
+            wait(in_flight.front().fence);
+            in_flight.pop_front();
+        }
+        region_mapping = persistent_mapping + region_begin;
+        return region_mapping;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    if (wrapped) {
+        // Orphan the old storage, the driver keeps it around until the draws from it are done
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) (capacity * sizeof(ParticleInstance)), nullptr, GL_STREAM_DRAW);
+    }
+    // Nothing drawn since the last orphaning has used this region, so there's nothing to synchronise with
+    region_mapping = (ParticleInstance*) glMapBufferRange(GL_ARRAY_BUFFER,
+                                                          (GLintptr) (region_begin * sizeof(ParticleInstance)),
+                                                          (GLsizeiptr) (count * sizeof(ParticleInstance)),
+                                                          GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return region_mapping;
 }
 
-void ParticleRenderer::prepare_frame(const std::vector<std::shared_ptr<EditorScene::ParticleEmitterElement>>& particle_systems, const Window& window, const BaseEntityGlobalData& global_data) {
-    std::vector<ParticleInstance> instances;
-    instances.reserve(MAX_PARTICLES_PER_DRAW);
-    
+void InstanceStream::finish_writes() {
+    if (region_mapping == nullptr) {
+        return;
+    }
+    if (!persistent) {
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    region_mapping = nullptr;
+}
+
+void InstanceStream::fence() {
+    if (persistent && region_size > 0) {
+        in_flight.push_back({glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), region_begin, region_begin + region_size});
+    }
+}
+
+ParticleRenderer::ParticleRenderer() = default;
+
+void ParticleRenderer::simulate_on_gpu(EditorScene::ParticleEmitterElement& system) {
+    auto capacity = (uint) std::max(system.maxParticles, 0);
+    if (capacity == 0) {
+        system.gpuParticles = nullptr;
+        return;
+    }
+    if (system.gpuParticles == nullptr || system.gpuParticles->get_capacity() != capacity) {
+        system.gpuParticles = std::make_shared<GpuParticleBuffers>(capacity);
+    }
+    auto& buffers = *system.gpuParticles;
+
+    auto spawn_count = (uint) std::clamp(system.gpuPendingEmission, 0, (int) capacity);
+    update_shader.set_emitter_data(system, buffers, system.gpuPendingDeltaTime, spawn_count);
+    system.gpuPendingDeltaTime = 0.0f;
+    system.gpuPendingEmission = 0;
+
+    // Read the current state and write the next state into the other buffer, without drawing anything
+    glBindVertexArray(buffers.get_update_vao());
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, buffers.get_feedback_buffer());
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, (int) capacity);
+    glEndTransformFeedback();
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+
+    buffers.swap();
+    buffers.spawn_cursor = (buffers.spawn_cursor + spawn_count) % capacity;
+    ++buffers.frame;
+}
+
+bool ParticleRenderer::get_emitter_sphere(const EditorScene::ParticleEmitterElement& system, glm::vec3& centre, float& radius) const {
+    if (system.worldBounds.is_empty()) {
+        return false;
+    }
+    // Sizes only grow over a particle's life if endSizeFactor is above one
+    float max_size = std::max(system.initialSizeMax, system.initialSizeMax * system.endSizeFactor);
+    centre = system.worldBounds.centre();
+    radius = system.worldBounds.radius() + 0.5f * max_size * sprite_world_scale;
+    return true;
+}
+
+void ParticleRenderer::assign_instance_ranges(const std::vector<std::shared_ptr<EditorScene::ParticleEmitterElement>>& particle_systems, const BaseEntityGlobalData& last_global_data) {
+    // The particles are only drawn relative to the camera, so it needn't be exact
+    glm::vec3 origin = last_global_data.camera_position;
+    instance_origin = origin;
+
+    // Padded, since the emitters will have moved on a frame by the time they're drawn, and an emitter wrongly left offscreen pops in
+    constexpr float VISIBILITY_PADDING = 0.1f;
+    const auto& projection_view = last_global_data.projection_view_matrix;
+    uint full_rate = 0;
+    uint reduced = 0;
+    uint offscreen = 0;
     for (const auto& system : particle_systems) {
-        if (!system || !system) {
-            continue;
-        };
+        if (!system || !system->enabled || system->gpuSimulation) continue;
 
-        if (!system->enabled) {
-            continue;
+        // Pick the level of detail from how big the emitter's particles are on screen
+        bool visible = true;
+        uint step_interval = 1;
+        float emission_scale = 1.0f;
+        glm::vec3 centre;
+        float radius;
+        if (lod_settings.enabled && get_emitter_sphere(*system, centre, radius)) {
+            radius *= 1.0f + VISIBILITY_PADDING;
+            if (!sphere_in_frustum(projection_view, centre, radius)) {
+                visible = !lod_settings.offscreen_ageing_only;
+                ++offscreen;
+            } else if (system->fixedTimestep) {
+                // Always stepped and emitting in full, see ParticleEmitterElement::tick_particles
+                ++full_rate;
+            } else {
+                float size = projected_sphere_size(projection_view, centre, radius);
+                // Round up to a power of two, like the animation LOD, so that emitters step together
+                while (step_interval < lod_settings.max_step_interval && size * (float) (step_interval * 2) <= lod_settings.full_rate_size) {
+                    step_interval *= 2;
+                }
+                if (lod_settings.full_rate_size > 0.0f) {
+                    emission_scale = clamp(size / lod_settings.full_rate_size, std::min(lod_settings.min_emission_scale, 1.0f), 1.0f);
+                }
+                ++(step_interval > 1 || emission_scale < 1.0f ? reduced : full_rate);
+            }
+        } else {
+            ++full_rate;
         }
+        system->lodVisible = visible;
+        system->lodStepInterval = std::max(1u, step_interval);
+        system->lodEmissionScale = emission_scale;
+    }
+    lod_stats.full_rate = full_rate;
+    lod_stats.reduced = reduced;
+    lod_stats.offscreen = offscreen;
+
+    // Depth sorted emitters write to the staging, everything else straight into the stream
+    size_t stream_total = 0;
+    size_t staging_total = 0;
+    for (const auto& system : particle_systems) {
+        if (!system) continue;
+        // Offscreen emitters that are only ageing write nothing, so need no room
+        bool writes = !system->gpuSimulation && system->enabled && system->lodVisible;
+        system->instanceCapacity = writes ? (size_t) std::max(system->maxParticles, 0) : 0;
+        system->instanceCount = 0;
+        system->instanceDepthSorted = blend_mode == BlendMode::DepthSorted && system->depthSorted;
+        system->instanceOrigin = origin;
+        auto& total = system->instanceDepthSorted ? staging_total : stream_total;
+        system->instanceOffset = total;
+        total += system->instanceCapacity;
+    }
 
-        if (system->particles.empty() && system->enabled) {
+    // The sorted particles go after every unsorted emitter's range, in the same region
+    sorted_offset = stream_total;
+    stream_output = stream.reserve(stream_total + staging_total);
+    // Only ever grows, so it isn't reallocated from frame to frame unless an emitter's maximum goes up
+    if (sort_staging.size() < staging_total) {
+        sort_staging.resize(staging_total);
+    }
+
+    for (const auto& system : particle_systems) {
+        if (!system) continue;
+        auto* output = system->instanceDepthSorted ? sort_staging.data() : stream_output;
+        system->instanceOutput = system->instanceCapacity > 0 ? output + system->instanceOffset : nullptr;
+    }
+}
+
+void ParticleRenderer::depth_sort_instances(const BaseEntityGlobalData& global_data, JobSystem& job_system) {
+    // Depth sorting splits into chunks of at least this many particles
+    constexpr uint MIN_CHUNK = 4096;
+    // Depths are quantised to this many bits, plenty to separate particles that overlap on screen
+    constexpr uint KEY_BITS = 16;
+    constexpr float KEY_MAX = (float) ((1u << KEY_BITS) - 1);
+
+    auto sort_start = std::chrono::steady_clock::now();
+
+    // Each item is (key << 32 | instance index), the index rides along with the key through the sort
+    sort_items.clear();
+    for (const auto& [first, count] : sort_ranges) {
+        for (auto i = (uint) first; i < (uint) (first + count); ++i) {
+            sort_items.push_back(i);
         }
+    }
+    auto item_count = (uint) sort_items.size();
 
-        glm::mat4 emitter_transform = glm::mat4(1.0f);
+    sort_depths.resize(item_count);
+    // Positions are relative to the origin the emitters were given, which the camera has since moved away from
+    glm::vec3 origin_offset = instance_origin - global_data.camera_position;
+    job_system.parallel_for(item_count, MIN_CHUNK, [&](uint begin, uint end) {
+        for (auto i = begin; i < end; ++i) {
+            sort_depths[i] = glm::dot(sort_staging[sort_items[i]].get_position() + origin_offset, global_data.camera_front);
+        }
+    });
+    auto [min_depth, max_depth] = std::minmax_element(sort_depths.begin(), sort_depths.end());
+    float depth_offset = *min_depth;
+    float depth_scale = *max_depth > *min_depth ? KEY_MAX / (*max_depth - *min_depth) : 0.0f;
 
-        for (const auto& p : system->particles) {
-            if (instances.size() >= MAX_PARTICLES_PER_DRAW) {
-                break; 
-            }
+    // Keyed by inverted depth, so that the sort puts the furthest particles first and they're drawn back to front
+    job_system.parallel_for(item_count, MIN_CHUNK, [&](uint begin, uint end) {
+        for (auto i = begin; i < end; ++i) {
+            auto key = (uint64_t) (KEY_MAX - (sort_depths[i] - depth_offset) * depth_scale + 0.5f);
+            sort_items[i] |= key << 32;
+        }
+    });
 
-            glm::vec3 final_position = p.position;
-            if (!system->worldSpaceParticles) {
-                 final_position = glm::vec3(system->transform * glm::vec4(p.position, 1.0f));
-            }
+    RadixSort::sort(sort_items, sort_scratch, 32, KEY_BITS, job_system);
+
+    // Gathered straight into the stream, after the unsorted emitters' ranges
+    ParticleInstance* sorted_output = stream_output + sorted_offset;
+    job_system.parallel_for(item_count, MIN_CHUNK, [&](uint begin, uint end) {
+        for (auto i = begin; i < end; ++i) {
+            sorted_output[i] = sort_staging[(uint32_t) sort_items[i]];
+        }
+    });
+    sorted_count = item_count;
+
+    last_sort_milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - sort_start).count();
+}
+
+void ParticleRenderer::prepare_frame(const std::vector<std::shared_ptr<EditorScene::ParticleEmitterElement>>& particle_systems, const Window& window, const BaseEntityGlobalData& global_data, JobSystem& job_system) {
+    gpu_draws.clear();
+    draw_firsts.clear();
+    draw_counts.clear();
+    sort_ranges.clear();
+    sorted_count = 0;
+    last_sort_milliseconds = 0.0f;
+
+    // The y row of the projection view has the length of the projection's y scale, see projected_sphere_size
+    const auto& projection_view = global_data.projection_view_matrix;
+    float y_scale = glm::length(glm::vec3{projection_view[0][1], projection_view[1][1], projection_view[2][1]});
+    auto viewport_height = (float) window.get_framebuffer_height();
+    sprite_world_scale = y_scale > 0.0f && viewport_height > 0.0f ? 2.0f / (viewport_height * y_scale) : 0.0f;
+
+    uint culled = 0;
+    bool gpu_pass_started = false;
+    for (const auto& system : particle_systems) {
+        if (!system || !system->enabled) {
+            continue;
+        }
 
+        // GPU simulated emitters never leave the GPU, they're stepped here and drawn from their own buffers in render
+        if (system->gpuSimulation) {
+            if (!gpu_pass_started) {
+                update_shader.use();
+                glEnable(GL_RASTERIZER_DISCARD);
+                gpu_pass_started = true;
+            }
+            simulate_on_gpu(*system);
+            if (system->gpuParticles != nullptr) {
+                gpu_draws.emplace_back(system->gpuParticles, system->worldSpaceParticles ? glm::mat4(1.0f) : system->transform());
+            }
+            continue;
+        }
+        system->gpuParticles = nullptr;
 
-            // Create particle instance
-            instances.push_back({
-                final_position,
-                p.size,
-                p.color,
-                p.rotation
-            });
+        // The emitter has already written its particles out while ticking, so there's nothing to upload
+        if (system->instanceCount == 0 || stream_output == nullptr) {
+            continue;
         }
-        if (instances.size() >= MAX_PARTICLES_PER_DRAW) {
-            break;
+        // Checked against this frame's camera, the emitter's LOD was picked with the last frame's
+        glm::vec3 centre;
+        float radius;
+        if (get_emitter_sphere(*system, centre, radius) && !sphere_in_frustum(projection_view, centre, radius)) {
+            ++culled;
+            continue;
         }
+        // Sorting the particles of every emitter that allows it together, so that overlapping emitters blend correctly
+        if (system->instanceDepthSorted) {
+            sort_ranges.emplace_back(system->instanceOffset, system->instanceCount);
+            continue;
+        }
+        draw_firsts.push_back((int) (stream.get_region_begin() + system->instanceOffset));
+        draw_counts.push_back((int) system->instanceCount);
     }
 
-    // Upload particle data
-    if (!instances.empty()) {
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(ParticleInstance), instances.data());
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    lod_stats.culled = culled;
+
+    if (!sort_ranges.empty()) {
+        depth_sort_instances(global_data, job_system);
     }
+    stream.finish_writes();
+    stream_output = nullptr;
 
-    num_particles_to_render = instances.size();
+    if (gpu_pass_started) {
+        glDisable(GL_RASTERIZER_DISCARD);
+        glBindVertexArray(0);
+    }
 }
 
 void ParticleRenderer::render(const BaseEntityGlobalData& global_data) {
-    if (num_particles_to_render == 0) {
+    if (draw_counts.empty() && sorted_count == 0 && gpu_draws.empty()) {
         return;
     }
 
-    shader.use();
+    bool order_independent = blend_mode == BlendMode::OrderIndependent;
+    const auto& active_shader = order_independent ? oit_shader : shader;
+    active_shader.use();
 
-    glUniformMatrix4fv(shader.projection_view_matrix_location, 1, GL_FALSE, glm::value_ptr(global_data.projection_view_matrix));
+    glUniformMatrix4fv(active_shader.projection_view_matrix_location, 1, GL_FALSE, glm::value_ptr(global_data.projection_view_matrix));
+    // CPU simulated particles were moved into world space as they were gathered, relative to instance_origin
+    glm::mat4 identity(1.0f);
+    glUniformMatrix4fv(active_shader.model_matrix_location, 1, GL_FALSE, glm::value_ptr(identity));
+    glUniform3fv(active_shader.instance_origin_location, 1, glm::value_ptr(instance_origin));
     
-    // Set up blending for particles
+    // Set up blending for particles.
+    // Particles still test against the opaque scene's depth, but mustn't hide each other, in either mode:
+    // the transparent corners of the unsorted particles, drawn first, would otherwise clip the sorted ones behind them
     glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_FALSE);
+    if (order_independent) {
+        // Accumulation sums, and revealage multiplies by (1 - alpha), so neither cares about draw order
+        glBlendFunci(0, GL_ONE, GL_ONE);
+        glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+    } else {
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    }
     
     // Enable point size
     glEnable(GL_PROGRAM_POINT_SIZE);
     
     // Draw particles
-    glBindVertexArray(vao);
-    glDrawArrays(GL_POINTS, 0, num_particles_to_render);
+    glBindVertexArray(stream.get_vao());
+    glMultiDrawArrays(GL_POINTS, draw_firsts.data(), draw_counts.data(), (int) draw_counts.size());
     glGetError();
+
+    // Then the depth sorted particles of every other emitter, back to front, on top of the unsorted ones
+    if (sorted_count > 0) {
+        glDrawArrays(GL_POINTS, (int) (stream.get_region_begin() + sorted_offset), (int) sorted_count);
+    }
+    stream.fence();
+
+    // Every slot of a GPU simulated emitter is drawn, the dead ones are moved out of view by the vertex shader
+    glm::vec3 no_origin(0.0f);
+    glUniform3fv(active_shader.instance_origin_location, 1, glm::value_ptr(no_origin));
+    for (const auto& [buffers, model_matrix] : gpu_draws) {
+        glUniformMatrix4fv(active_shader.model_matrix_location, 1, GL_FALSE, glm::value_ptr(model_matrix));
+        glBindVertexArray(buffers->get_render_vao());
+        glDrawArrays(GL_POINTS, 0, (int) buffers->get_capacity());
+    }
     glBindVertexArray(0);
 
     // Restore OpenGL state
     glDisable(GL_PROGRAM_POINT_SIZE);
     glDisable(GL_BLEND);
+    glDepthMask(GL_TRUE);
     glUseProgram(0);
 }
 
+void add_imgui_lod_section(ParticleLodSettings& settings, const ParticleLodStats& stats) {
+    if (ImGui::CollapsingHeader("Particle LOD")) {
+        ImGui::Checkbox("Enabled##particle_lod", &settings.enabled);
+        ImGui::DragFloat("Full Rate Size##particle_lod", &settings.full_rate_size, 0.005f, 0.0f, 1.0f);
+        int max_step_interval = (int) settings.max_step_interval;
+        if (ImGui::SliderInt("Max Step Interval", &max_step_interval, 1, 16)) {
+            settings.max_step_interval = (uint) max_step_interval;
+        }
+        ImGui::SliderFloat("Min Emission Scale", &settings.min_emission_scale, 0.0f, 1.0f);
+        ImGui::Checkbox("Offscreen Ageing Only", &settings.offscreen_ageing_only);
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Emitters outside the view only count down their particles' lives, and don't emit or move them.\nFixed timestep emitters still step, but aren't drawn");
+        }
+
+        ImGui::Text("Full Rate: %u, Reduced: %u", stats.full_rate, stats.reduced);
+        ImGui::Text("Offscreen: %u, Culled: %u", stats.offscreen, stats.culled);
+    }
+}
+
 bool ParticleRenderer::refresh_shaders() {
     shader.cleanup();
     bool success = shader.reload_files();
+    success &= oit_shader.reload_files();
+    success &= update_shader.reload_files();
     if (!success) {
         std::cerr << "Error: ParticleRenderer failed to refresh shader." << std::endl;
     }
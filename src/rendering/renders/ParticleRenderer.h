@@ -1,6 +1,8 @@
 #ifndef PARTICLE_RENDERER_H
 #define PARTICLE_RENDERER_H
 
+#include <array>
+#include <deque>
 #include <memory>
 #include <vector>
 #include <glm/glm.hpp>
@@ -11,46 +13,260 @@
 #include "rendering/resources/TextureHandle.h"
 #include "rendering/renders/shaders/BaseLitEntityShader.h"
 #include "scene/editor_scene/ParticleEmitterElement.h"
+#include "utility/JobSystem.h"
 
 // Forward declaration
 namespace EditorScene { class ParticleEmitterElement; }
 
 namespace ParticleRenderer {
 
-    // Maximum number of particles to render in a single draw call
-    static constexpr size_t MAX_PARTICLES_PER_DRAW = 100000;
+    // How many particles the instance stream starts with room for, over all the frames in flight, it grows to fit
+    static constexpr size_t INITIAL_STREAM_CAPACITY = 300000;
 
-    struct ParticleInstance {
+    /// How overlapping particles are blended together
+    enum class BlendMode {
+        // Each emitter's particles in simulation order, cheapest but overlapping particles can pop as they swap places
+        Unsorted,
+        // Sorted back to front on the CPU every frame, see ParticleRenderer::depth_sort_instances
+        DepthSorted,
+        // Weighted blended into OitCompositor's targets, which the caller must bind before render and composite after
+        OrderIndependent
+    };
+
+    /// Controls how CPU simulated emitters are simplified as the bounds of their particles get smaller on screen, or leave it.
+    /// Emitters outside the view are never drawn, whatever the settings
+    struct ParticleLodSettings {
+        bool enabled = true;
+        // The size on screen, as a fraction of the screen height, above which emitters are stepped every frame at their full emission rate.
+        // Each halving of size below this doubles the frames between steps
+        float full_rate_size = 0.1f;
+        uint max_step_interval = 4;
+        // Below full_rate_size, emission falls off in proportion to size, down to this fraction of the emitter's rate
+        float min_emission_scale = 0.25f;
+        // If set, emitters entirely outside the view only age their particles, or for fixed timestep ones aren't written out,
+        // see ParticleEmitterElement::tick_particles
+        bool offscreen_ageing_only = true;
+    };
+
+    /// How many CPU simulated emitters were at each level of detail in the last frame
+    struct ParticleLodStats {
+        uint full_rate = 0;
+        uint reduced = 0;
+        uint offscreen = 0;
+        // Not drawn, which includes offscreen emitters that still stepped because offscreen_ageing_only is off
+        uint culled = 0;
+    };
+
+    /// Adds controls for the particle LOD settings, and shows the stats from the last frame
+    void add_imgui_lod_section(ParticleLodSettings& settings, const ParticleLodStats& stats);
+
+    // Written by the emitters themselves, into the ranges assigned by ParticleRenderer::assign_instance_ranges
+    using ParticleInstance = EditorScene::ParticleInstance;
+
+    /// The state of one particle slot of a GPU simulated emitter, as written by transform feedback in particle/update_vert.glsl.
+    /// The first four fields are read at the same attribute locations as ParticleInstance's, so the same buffer can be drawn directly.
+    struct GpuParticle {
         glm::vec3 position;
         float size;
         glm::vec4 color;
         float rotation;
+        glm::vec3 velocity;
+        float life_remaining; // A slot with no life remaining is free to spawn into
+        float total_life;
+        float angular_velocity;
+    };
+
+    /// The two buffers a GPU simulated emitter ping-pongs its particles between, each frame one is read and the other is written.
+    /// Owned by the emitter, so the particles live as long as it does.
+    class GpuParticleBuffers {
+        std::array<uint, 2> vbos{};
+        // Reads every field, for the update pass
+        std::array<uint, 2> update_vaos{};
+        // Reads just the drawn fields
+        std::array<uint, 2> render_vaos{};
+        uint capacity;
+        // The buffer holding the latest state
+        uint current = 0;
+    public:
+        // Where the next spawn window starts, it moves around the slots so that spawns land in slots that have had the longest to die
+        uint spawn_cursor = 0;
+        // Seeds the update shader's randomness
+        uint frame = 0;
+
+        explicit GpuParticleBuffers(uint capacity);
+        GpuParticleBuffers(const GpuParticleBuffers&) = delete;
+        GpuParticleBuffers& operator=(const GpuParticleBuffers&) = delete;
+        ~GpuParticleBuffers();
+
+        [[nodiscard]] uint get_capacity() const { return capacity; }
+        [[nodiscard]] uint get_update_vao() const { return update_vaos[current]; }
+        [[nodiscard]] uint get_render_vao() const { return render_vaos[current]; }
+        [[nodiscard]] uint get_feedback_buffer() const { return vbos[1 - current]; }
+
+        /// Make the buffer just written by transform feedback the current one
+        void swap() { current = 1 - current; }
+    };
+
+    /// A ring buffer of particle instances that is written straight from the CPU, with one region reserved per frame.
+    /// Each region is only written once the GPU has finished drawing whatever was in that part of the ring before,
+    /// so writing never stalls on the previous frame's draws.
+    ///
+    /// When ARB_buffer_storage is available the buffer is mapped persistently, and each frame's region is fenced once it has been drawn.
+    /// Otherwise (e.g. OpenGL 4.1 on macOS) each region is mapped unsynchronised, and the buffer is orphaned whenever the ring wraps around,
+    /// so that the driver keeps the old storage alive for the draws still reading it.
+    class InstanceStream {
+        // How many frames of regions can be written ahead of the GPU before writing waits for it
+        static constexpr size_t FRAMES_IN_FLIGHT = 3;
+
+        struct InFlightRegion {
+            GLsync fence;
+            size_t begin;
+            size_t end;
+        };
+
+        uint vao{}, vbo{};
+        size_t capacity{};
+        bool persistent{};
+        ParticleInstance* persistent_mapping = nullptr;
+        // Where the next region starts
+        size_t cursor = 0;
+        // Regions that have been drawn from, oldest first, persistent only
+        std::deque<InFlightRegion> in_flight{};
+
+        size_t region_begin = 0;
+        size_t region_size = 0;
+        // The current region while it can be written, nullptr once finish_writes is called
+        ParticleInstance* region_mapping = nullptr;
+
+        /// Replace the buffer with an empty one of new_capacity instances, waiting for any draws from the old one
+        void allocate(size_t new_capacity);
+        static void wait(GLsync fence);
+    public:
+        InstanceStream();
+        InstanceStream(const InstanceStream&) = delete;
+        InstanceStream& operator=(const InstanceStream&) = delete;
+        ~InstanceStream();
+
+        /// Start this frame's region, with room for count instances, and return where to write them.
+        /// The pointer can be written from any thread, until finish_writes is called.
+        ParticleInstance* reserve(size_t count);
+        /// Must be called once the region has been written, before drawing from it
+        void finish_writes();
+        /// Must be called after the last draw from the region
+        void fence();
+
+        [[nodiscard]] uint get_vao() const { return vao; }
+        /// The index of the region's first instance in the buffer, to add to offsets within the region when drawing
+        [[nodiscard]] size_t get_region_begin() const { return region_begin; }
     };
 
     class ParticleShader : public ShaderInterface {
     public:
-        ParticleShader();
+        /// Define WEIGHTED_BLENDED_OIT in frag_defines to write to OitCompositor's targets instead of the colour buffer
+        explicit ParticleShader(std::unordered_map<std::string, std::string> frag_defines = {});
         
         // Uniform locations
         int view_matrix_location{};
         int projection_matrix_location{};
         int projection_view_matrix_location{};
+        int model_matrix_location{};
+        int instance_origin_location{};
         
     private:
         bool init_shader();
         void get_uniforms_set_bindings();
     };
 
+    /// Steps GPU simulated emitters with transform feedback, see particle/update_vert.glsl
+    class ParticleUpdateShader : public ShaderInterface {
+        int delta_time_location{};
+        int frame_seed_location{};
+        int capacity_location{};
+        int spawn_start_location{};
+        int spawn_count_location{};
+        int spawn_centre_location{};
+        int lifespan_range_location{};
+        int velocity_min_location{};
+        int velocity_max_location{};
+        int size_range_location{};
+        int rotation_range_location{};
+        int angular_velocity_range_location{};
+        int color_start_location{};
+        int color_end_location{};
+        int acceleration_location{};
+        int attractor_position_location{};
+        int attractor_strength_location{};
+        int attractor_radius_location{};
+        int turbulence_strength_location{};
+        int end_color_location{};
+        int end_size_factor_location{};
+    public:
+        ParticleUpdateShader();
+
+        /// Set everything the update pass needs from the emitter, for a step of delta_time that spawns up to spawn_count particles
+        void set_emitter_data(const EditorScene::ParticleEmitterElement& emitter, const GpuParticleBuffers& buffers, float delta_time, uint spawn_count);
+    private:
+        void get_uniforms_set_bindings();
+    };
+
     class ParticleRenderer {
         ParticleShader shader;
-        unsigned int vao{0}, vbo{0};
-        size_t num_particles_to_render{0};
+        ParticleShader oit_shader{{{"WEIGHTED_BLENDED_OIT", "1"}}};
+        ParticleUpdateShader update_shader;
+        // [every unsorted CPU simulated emitter's range, then the depth sorted particles] -> drawn particle
+        InstanceStream stream{};
+        ParticleInstance* stream_output = nullptr;
+        // What this frame's instance positions are relative to
+        glm::vec3 instance_origin{0.0f};
+        // World units per unit of particle size, the size being in pixels at a distance of one unit, from the last frame's viewport.
+        // A particle's sprite reaches out this times half its size from its position, at any distance
+        float sprite_world_scale = 0.0f;
+        // The ranges of the stream to draw this frame, for glMultiDrawArrays
+        std::vector<int> draw_firsts{};
+        std::vector<int> draw_counts{};
+
+        // [every depth sorted emitter's range] -> particle to sort, on the CPU since the stream is slow to read back
+        std::vector<ParticleInstance> sort_staging{};
+        // Where in this frame's region the depth sorted particles are written, after every unsorted emitter's range
+        size_t sorted_offset = 0;
+        size_t sorted_count = 0;
+        // The (first, count) ranges of sort_staging to sort this frame
+        std::vector<std::pair<size_t, size_t>> sort_ranges{};
+        // Reused between frames to save reallocating
+        std::vector<uint64_t> sort_items{};
+        std::vector<uint64_t> sort_scratch{};
+        std::vector<float> sort_depths{};
+        // GPU simulated emitters to draw straight from their buffers this frame, with their model matrices
+        std::vector<std::pair<std::shared_ptr<GpuParticleBuffers>, glm::mat4>> gpu_draws{};
+
+        /// Step a GPU simulated emitter by the time and emission it has built up since the last frame
+        void simulate_on_gpu(EditorScene::ParticleEmitterElement& system);
+        /// The sphere around an emitter's worldBounds, grown to cover the sprites of particles at the edge.
+        /// Returns false if the emitter has no bounds yet, so should be treated as visible
+        [[nodiscard]] bool get_emitter_sphere(const EditorScene::ParticleEmitterElement& system, glm::vec3& centre, float& radius) const;
+        /// Merge the sort_ranges, radix sort them back to front by their quantised depth along the camera's view, and write the result to the stream
+        void depth_sort_instances(const BaseEntityGlobalData& global_data, JobSystem& job_system);
 
     public:
+        BlendMode blend_mode = BlendMode::Unsorted;
+        // How long this frame's depth sort took, in DepthSorted mode, including uploading the result
+        float last_sort_milliseconds = 0.0f;
+
+        ParticleLodSettings lod_settings{};
+        ParticleLodStats lod_stats{};
+
         ParticleRenderer();
-        ~ParticleRenderer();
 
-        void prepare_frame(const std::vector<std::shared_ptr<EditorScene::ParticleEmitterElement>>& particle_systems, const Window& window, const BaseEntityGlobalData& global_data);
+        /// Give every CPU simulated emitter a range of this frame's stream region big enough for its maximum particles,
+        /// with positions relative to the camera, and pick its level of detail from how big its bounds are on screen.
+        /// Only the last frame's camera is known before ticking, which is close enough for both.
+        /// Must be called before the emitters are ticked, and they must be ticked before prepare_frame
+        void assign_instance_ranges(const std::vector<std::shared_ptr<EditorScene::ParticleEmitterElement>>& particle_systems, const BaseEntityGlobalData& last_global_data);
+
+        /// Step the GPU simulated emitters, and gather the ranges of the CPU simulated emitters in view to draw, skipping the rest
+        void prepare_frame(const std::vector<std::shared_ptr<EditorScene::ParticleEmitterElement>>& particle_systems, const Window& window, const BaseEntityGlobalData& global_data, JobSystem& job_system);
+        /// How many particles were depth sorted this frame
+        [[nodiscard]] size_t get_sorted_count() const { return sorted_count; }
         void render(const BaseEntityGlobalData& global_data);
         
         bool refresh_shaders();
@@ -4,8 +4,9 @@ ShaderInterface::ShaderInterface(std::string name, const std::string& vertex_pat
                                  const std::string& fragment_path,
                                  std::function<void()> setup,
                                  std::unordered_map<std::string, std::string> vert_defines,
-                                 std::unordered_map<std::string, std::string> frag_defines)
-    : uniform_locations(), uniform_block_indices(), shader_name(std::move(name)), vertex_path(vertex_path), fragment_path(fragment_path), setup(std::move(setup)), vert_defines(std::move(vert_defines)), frag_defines(std::move(frag_defines)) {
+                                 std::unordered_map<std::string, std::string> frag_defines,
+                                 std::vector<std::string> feedback_varyings)
+    : uniform_locations(), uniform_block_indices(), shader_name(std::move(name)), vertex_path(vertex_path), fragment_path(fragment_path), setup(std::move(setup)), vert_defines(std::move(vert_defines)), frag_defines(std::move(frag_defines)), feedback_varyings(std::move(feedback_varyings)) {
 
     vertex_code = load_shader_file(SHADER_DIR + "/" + vertex_path).value(); // Will throw exception on failure
     fragment_code = load_shader_file(SHADER_DIR + "/" + fragment_path).value(); // Will throw exception on failure
@@ -16,7 +17,7 @@ ShaderInterface::ShaderInterface(std::string name, const std::string& vertex_pat
     auto vertexShader = compile_shader_code(realisedVertexCode, GL_VERTEX_SHADER, shader_name).value(); // Will throw exception on failure
     auto fragmentShader = compile_shader_code(realisedFragmentCode, GL_FRAGMENT_SHADER, shader_name).value(); // Will throw exception on failure
 
-    program_id = link_program(vertexShader, fragmentShader, shader_name).value(); // Will throw exception on failure
+    program_id = link_program(vertexShader, fragmentShader, shader_name, this->feedback_varyings).value(); // Will throw exception on failure
 
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
@@ -63,7 +64,7 @@ void ShaderInterface::recompile(
     uint fragment_shader = compile_shader_code(realised_fragment_code, GL_FRAGMENT_SHADER, shader_name).value(); // Will throw exception on failure
 
     auto old_program = program_id;
-    program_id = link_program(vertex_shader, fragment_shader, shader_name).value(); // Will throw exception on failure
+    program_id = link_program(vertex_shader, fragment_shader, shader_name, feedback_varyings).value(); // Will throw exception on failure
 
     glDeleteProgram(old_program);
     glDeleteShader(vertex_shader);
@@ -237,11 +238,21 @@ ShaderInterface::compile_shader_code(const std::string& shader_code,
     return shader;
 }
 
-std::optional<uint> ShaderInterface::link_program(uint vertex_shader, uint fragment_shader, const std::string& shader_name) {
+std::optional<uint> ShaderInterface::link_program(uint vertex_shader, uint fragment_shader, const std::string& shader_name, const std::vector<std::string>& feedback_varyings) {
     uint program = glCreateProgram();
 
     glAttachShader(program, vertex_shader);
     glAttachShader(program, fragment_shader);
+
+    // Must be set before linking to take effect
+    if (!feedback_varyings.empty()) {
+        std::vector<const char*> varying_names{};
+        for (const auto& varying: feedback_varyings) {
+            varying_names.push_back(varying.c_str());
+        }
+        glTransformFeedbackVaryings(program, (int) varying_names.size(), varying_names.data(), GL_INTERLEAVED_ATTRIBS);
+    }
+
     glLinkProgram(program);
 
     // print linking errors if any
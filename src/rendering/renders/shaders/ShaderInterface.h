@@ -35,14 +35,19 @@ class ShaderInterface {
 
     std::unordered_map<std::string, std::string> vert_defines;
     std::unordered_map<std::string, std::string> frag_defines;
+
+    // The vertex shader outputs captured by transform feedback, interleaved in this order, empty for none
+    std::vector<std::string> feedback_varyings;
 public:
     /// Construct the interface, proving the name of shaders (used for error formatting), the paths to the vertex
     /// and fragment shaders, also a setup function which is called initially and when the shader is reloaded from disk (hot loaded).
-    /// Also can specify some #define K V, that will be applied to the shaders
+    /// Also can specify some #define K V, that will be applied to the shaders, and the vertex shader outputs
+    /// to capture with transform feedback, which are written interleaved into a single buffer in the order given.
     ShaderInterface(std::string name, const std::string& vertex_path, const std::string& fragment_path,
                     std::function<void()> setup,
                     std::unordered_map<std::string, std::string> vert_defines = {},
-                    std::unordered_map<std::string, std::string> frag_defines = {});
+                    std::unordered_map<std::string, std::string> frag_defines = {},
+                    std::vector<std::string> feedback_varyings = {});
 
     [[nodiscard]] uint id() const;
 
@@ -73,7 +78,7 @@ private:
 
     static std::optional<uint> compile_shader_code(const std::string& shader_code, uint shader_type, const std::string& shader_name);
 
-    static std::optional<uint> link_program(uint vertex_shader, uint fragment_shader, const std::string& shader_name);
+    static std::optional<uint> link_program(uint vertex_shader, uint fragment_shader, const std::string& shader_name, const std::vector<std::string>& feedback_varyings);
 
 protected:
     [[nodiscard]] int get_uniform_location(const std::string& name);
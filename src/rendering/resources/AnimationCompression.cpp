@@ -0,0 +1,196 @@
+#include "AnimationCompression.h"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include <imgui/imgui.h>
+
+namespace {
+    // Spans of dropped keys longer than this aren't considered, to keep reduction from going quadratic on long clips
+    constexpr uint MAX_REDUCTION_SPAN = 256;
+
+    template<typename Value>
+    using Keys = std::vector<std::pair<double, Value>>;
+
+    glm::vec3 mix(const glm::vec3& a, const glm::vec3& b, float t) {
+        return glm::mix(a, b, t);
+    }
+
+    glm::quat slerp(const glm::quat& a, const glm::quat& b, float t) {
+        return glm::slerp(a, b, t);
+    }
+
+    float distance(const glm::vec3& a, const glm::vec3& b) {
+        return glm::distance(a, b);
+    }
+
+    /// The angle of the rotation between two rotations.
+    /// From the rotation taking one to the other, since acos of their dot product can't resolve angles below about a milliradian in floats
+    float angle_between(const glm::quat& a, const glm::quat& b) {
+        glm::quat difference = glm::conjugate(glm::normalize(a)) * glm::normalize(b);
+        return 2.0f * std::atan2(glm::length(glm::vec3{difference.x, difference.y, difference.z}), std::abs(difference.w));
+    }
+
+    /// Sample a track of imported keys, the same way KeyframeTrack::sample does
+    template<typename Value, typename Interpolate>
+    Value sample_keys(const Keys<Value>& keys, double time, Interpolate interpolate) {
+        auto next = std::lower_bound(keys.begin(), keys.end(), time, [](const auto& key, double t) { return key.first < t; });
+        if (next == keys.end()) {
+            return keys.back().second;
+        }
+        if (next->first == time || next == keys.begin()) {
+            return next->second;
+        }
+        auto prev = next - 1;
+        return interpolate(prev->second, next->second, (float) ((time - prev->first) / (next->first - prev->first)));
+    }
+
+    /// Greedily drop keys that interpolating between the nearest kept keys either side reproduces within max_error.
+    /// Returns the indices of the keys to keep, which always includes the first and last.
+    template<typename Value, typename Interpolate, typename Error>
+    std::vector<uint> reduce_keys(const Keys<Value>& keys, float max_error, Interpolate interpolate, Error error) {
+        std::vector<uint> kept{0};
+        if (keys.size() == 1) return kept;
+
+        // A track that never leaves the first value only needs that one key
+        bool constant = std::all_of(keys.begin(), keys.end(), [&](const auto& key) { return error(keys[0].second, key.second) <= max_error; });
+        if (constant) return kept;
+
+        uint anchor = 0;
+        for (auto candidate = 2u; candidate < keys.size(); ++candidate) {
+            bool fits = candidate - anchor <= MAX_REDUCTION_SPAN;
+            for (auto i = anchor + 1; fits && i < candidate; ++i) {
+                float t = (float) ((keys[i].first - keys[anchor].first) / (keys[candidate].first - keys[anchor].first));
+                fits = error(interpolate(keys[anchor].second, keys[candidate].second, t), keys[i].second) <= max_error;
+            }
+            if (!fits) {
+                // The previous candidate was the furthest that worked, so it has to stay
+                anchor = candidate - 1;
+                kept.push_back(anchor);
+            }
+        }
+        kept.push_back((uint) keys.size() - 1);
+
+        return kept;
+    }
+
+    /// Build a track from the imported keys, either resampled onto a uniform grid, key reduced, or as is.
+    template<typename Stored, typename Value, typename Interpolate, typename Error, typename Pack>
+    KeyframeTrack<Stored> build_track(const std::map<double, Value>& key_map, float max_error, double ticks_per_second, const AnimationCompressionSettings& settings,
+                                      Interpolate interpolate, Error error, Pack pack) {
+        KeyframeTrack<Stored> track{};
+        if (key_map.empty()) return track;
+
+        Keys<Value> keys{key_map.begin(), key_map.end()};
+
+        if (settings.resample) {
+            double first_time = keys.front().first;
+            double length = keys.back().first - first_time;
+            double target_interval = ticks_per_second / std::max(1.0f, settings.resample_rate);
+
+            // Round to a whole number of intervals, so that the last key lands exactly on the end of the track
+            auto intervals = (uint) std::max(0.0, std::round(length / target_interval));
+            track.start_time = (float) first_time;
+            track.interval = intervals > 0 ? (float) (length / intervals) : 0.0f;
+            track.values.reserve(intervals + 1);
+            for (auto i = 0u; i <= intervals; ++i) {
+                track.values.push_back(pack(sample_keys(keys, track.key_time(i), interpolate)));
+            }
+            return track;
+        }
+
+        std::vector<uint> kept{};
+        if (settings.reduce_keys) {
+            kept = reduce_keys(keys, max_error, interpolate, error);
+        } else {
+            kept.resize(keys.size());
+            for (auto i = 0u; i < keys.size(); ++i) kept[i] = i;
+        }
+
+        track.times.reserve(kept.size());
+        track.values.reserve(kept.size());
+        for (auto i: kept) {
+            track.times.push_back((float) keys[i].first);
+            track.values.push_back(pack(keys[i].second));
+        }
+        return track;
+    }
+
+    /// The largest error of the track against the imported keys, measured at each imported key
+    template<typename Stored, typename Value, typename Unpack, typename Interpolate, typename Error>
+    float max_track_error(const KeyframeTrack<Stored>& track, const std::map<double, Value>& keys, Unpack unpack, Interpolate interpolate, Error error) {
+        float max_error = 0.0f;
+        KeyframeCursor cursor = 0;
+        for (const auto& [time, value]: keys) {
+            max_error = std::max(max_error, error(track.sample(time, cursor, unpack, interpolate), value));
+        }
+        return max_error;
+    }
+}
+
+AnimationClip AnimationCompression::compress_clip(const std::vector<RawAnimationChannel>& channels, double ticks_per_second, const AnimationCompressionSettings& settings) {
+    AnimationClip clip{};
+
+    // Find the bounds of every position in the clip, to quantise within
+    glm::vec3 min{std::numeric_limits<float>::max()};
+    glm::vec3 max{std::numeric_limits<float>::lowest()};
+    for (const auto& channel: channels) {
+        for (const auto& [time, position]: channel.positions) {
+            min = glm::min(min, position);
+            max = glm::max(max, position);
+        }
+    }
+    if (min.x <= max.x) {
+        clip.position_bounds = {min, max - min};
+    }
+    const auto& bounds = clip.position_bounds;
+
+    auto pack_position = [&bounds](const glm::vec3& value) { return PackedVec3::pack(value, bounds); };
+    auto unpack_position = [&bounds](const PackedVec3& packed) { return packed.unpack(bounds); };
+    auto pack_rotation = [](const glm::quat& value) { return PackedQuat::pack(value); };
+    auto unpack_rotation = [](const PackedQuat& packed) { return packed.unpack(); };
+    auto identity = [](const glm::vec3& value) { return value; };
+
+    auto& stats = clip.stats;
+    clip.channels.reserve(channels.size());
+    for (const auto& raw: channels) {
+        auto& channel = clip.channels.emplace_back();
+        channel.node = raw.node;
+        channel.positions = build_track<PackedVec3>(raw.positions, settings.max_position_error, ticks_per_second, settings, mix, distance, pack_position);
+        channel.rotations = build_track<PackedQuat>(raw.rotations, settings.max_rotation_error, ticks_per_second, settings, slerp, angle_between, pack_rotation);
+        channel.scalings = build_track<glm::vec3>(raw.scalings, settings.max_scaling_error, ticks_per_second, settings, mix, distance, identity);
+
+        // As imported, each key has a double time and full precision value
+        stats.raw_bytes += raw.positions.size() * (sizeof(double) + sizeof(glm::vec3))
+                         + raw.rotations.size() * (sizeof(double) + sizeof(glm::quat))
+                         + raw.scalings.size() * (sizeof(double) + sizeof(glm::vec3));
+        stats.compressed_bytes += channel.memory_size();
+        stats.raw_keys += (uint) (raw.positions.size() + raw.rotations.size() + raw.scalings.size());
+        stats.compressed_keys += channel.positions.size() + channel.rotations.size() + channel.scalings.size();
+
+        stats.max_position_error = std::max(stats.max_position_error, max_track_error(channel.positions, raw.positions, unpack_position, mix, distance));
+        stats.max_rotation_error = std::max(stats.max_rotation_error, max_track_error(channel.rotations, raw.rotations, unpack_rotation, slerp, angle_between));
+        stats.max_scaling_error = std::max(stats.max_scaling_error, max_track_error(channel.scalings, raw.scalings, identity, mix, distance));
+    }
+
+    return clip;
+}
+
+bool AnimationCompression::add_imgui_settings(AnimationCompressionSettings& settings) {
+    bool changed = false;
+
+    changed |= ImGui::Checkbox("Resample To Uniform Keys", &settings.resample);
+    if (settings.resample) {
+        changed |= ImGui::DragFloat("Resample Rate (keys/s)", &settings.resample_rate, 1.0f, 1.0f, 120.0f);
+    } else {
+        changed |= ImGui::Checkbox("Reduce Keys", &settings.reduce_keys);
+        if (settings.reduce_keys) {
+            changed |= ImGui::DragFloat("Max Position Error", &settings.max_position_error, 0.0001f, 0.0f, 0.1f, "%.4f");
+            changed |= ImGui::DragFloat("Max Rotation Error (rad)", &settings.max_rotation_error, 0.0001f, 0.0f, 0.1f, "%.4f");
+            changed |= ImGui::DragFloat("Max Scaling Error", &settings.max_scaling_error, 0.0001f, 0.0f, 0.1f, "%.4f");
+        }
+    }
+
+    return changed;
+}
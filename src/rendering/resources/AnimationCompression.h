@@ -0,0 +1,47 @@
+#ifndef ANIMATION_COMPRESSION_H
+#define ANIMATION_COMPRESSION_H
+
+#include <map>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+#include "MeshHierarchy.h"
+#include "utility/HelperTypes.h"
+
+/// The keys of a single channel, as imported
+struct RawAnimationChannel {
+    // The node this channel animates
+    uint node = 0;
+    std::map<double, glm::vec3> positions{};
+    std::map<double, glm::quat> rotations{};
+    std::map<double, glm::vec3> scalings{};
+};
+
+/// How animation clips are compressed when a hierarchy is imported
+struct AnimationCompressionSettings {
+    // Remove keys that interpolating between the keys either side of them reproduces within the errors below
+    bool reduce_keys = true;
+    // In model units
+    float max_position_error = 0.0005f;
+    // In radians
+    float max_rotation_error = 0.0005f;
+    float max_scaling_error = 0.0005f;
+
+    // Resample every track onto a uniform grid, so that finding the keys around a time is O(1), instead of reducing keys
+    bool resample = false;
+    // In keys per second
+    float resample_rate = 30.0f;
+};
+
+namespace AnimationCompression {
+    /// Compress the channels of one animation, quantising positions within the bounds of the whole clip,
+    /// and packing rotations with the smallest three encoding. Also measures how well that went, into the clip's stats.
+    AnimationClip compress_clip(const std::vector<RawAnimationChannel>& channels, double ticks_per_second, const AnimationCompressionSettings& settings);
+
+    /// Adds controls for editing the settings, returns true if any changed
+    bool add_imgui_settings(AnimationCompressionSettings& settings);
+}
+
+#endif //ANIMATION_COMPRESSION_H
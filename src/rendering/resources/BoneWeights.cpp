@@ -0,0 +1,29 @@
+#include "BoneWeights.h"
+
+#include <glm/gtx/component_wise.hpp>
+
+std::vector<BoneWeights::VertexBoneWeights> BoneWeights::gather(const aiMesh& mesh) {
+    // [vertex_id] -> heaviest influences
+    std::vector<TopInfluences> influences(mesh.mNumVertices);
+    for (auto bone_i = 0u; bone_i < mesh.mNumBones; ++bone_i) {
+        const auto* bone = mesh.mBones[bone_i];
+        for (auto weight_i = 0u; weight_i < bone->mNumWeights; ++weight_i) {
+            const auto& weight = bone->mWeights[weight_i];
+            influences[weight.mVertexId].insert(weight.mWeight, bone_i);
+        }
+    }
+
+    std::vector<VertexBoneWeights> bone_weights(mesh.mNumVertices);
+    for (auto vert_i = 0u; vert_i < mesh.mNumVertices; ++vert_i) {
+        auto& [weights, bones] = bone_weights[vert_i];
+        weights = influences[vert_i].weights;
+        bones = influences[vert_i].bones;
+
+        float weight_sum = glm::compAdd(weights);
+        if (weight_sum != 0.0f) {
+            // Normalise the sum of the weights
+            weights /= weight_sum;
+        }
+    }
+    return bone_weights;
+}
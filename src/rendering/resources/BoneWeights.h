@@ -0,0 +1,53 @@
+#ifndef BONE_WEIGHTS_H
+#define BONE_WEIGHTS_H
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#include <assimp/mesh.h>
+
+#include "utility/HelperTypes.h"
+
+namespace BoneWeights {
+    /// The most bones that can influence a single vertex
+    constexpr uint MAX_INFLUENCES = 4;
+
+    /// (bone_weights, bone_indices), the layout VertexCollection takes
+    using VertexBoneWeights = std::pair<glm::vec4, glm::uvec4>;
+
+    /// The heaviest influences on one vertex seen so far, kept sorted heaviest first in fixed slots, so gathering doesn't allocate.
+    struct TopInfluences {
+        glm::vec4 weights{0.0f};
+        glm::uvec4 bones{0u};
+        uint count = 0;
+
+        /// Ties in weight are broken by the lower bone id, and an influence already held is ignored
+        void insert(float weight, uint bone) {
+            uint slot = 0;
+            while (slot < count && (weights[slot] > weight || (weights[slot] == weight && bones[slot] < bone))) {
+                ++slot;
+            }
+            if (slot == MAX_INFLUENCES || (slot < count && weights[slot] == weight && bones[slot] == bone)) {
+                return;
+            }
+
+            // Shuffle the lighter influences down, dropping the lightest if the slots are full
+            count = std::min(count + 1, MAX_INFLUENCES);
+            for (auto i = count - 1; i > slot; --i) {
+                weights[i] = weights[i - 1];
+                bones[i] = bones[i - 1];
+            }
+            weights[slot] = weight;
+            bones[slot] = bone;
+        }
+    };
+
+    /// Pick the up to MAX_INFLUENCES heaviest bones of every vertex of the mesh, and normalise their weights to sum to one.
+    /// The bone indices are into the mesh's own mBones.
+    std::vector<VertexBoneWeights> gather(const aiMesh& mesh);
+}
+
+#endif //BONE_WEIGHTS_H
@@ -1,50 +1,99 @@
 #include "MeshHierarchy.h"
 
-glm::mat4 AnimationData::sample(double time) const {
+#include <glm/gtx/component_wise.hpp>
+
+// The components left after dropping the largest all lie in [-1/sqrt(2), 1/sqrt(2)]
+static constexpr float SMALLEST_THREE_RANGE = 0.70710678118f;
+static constexpr float SMALLEST_THREE_MAX = 32767.0f; // 15 bits
+static constexpr float PACKED_VEC3_MAX = 65535.0f; // 16 bits
+
+PackedQuat PackedQuat::pack(const glm::quat& value) {
+    glm::quat q = glm::normalize(value);
+
+    uint largest = 0;
+    for (auto i = 1u; i < 4; ++i) {
+        if (std::abs(q[(int) i]) > std::abs(q[(int) largest])) largest = i;
+    }
+    // q and -q are the same rotation, so make the dropped component positive so it can be rebuilt with a sqrt
+    if (q[(int) largest] < 0.0f) q = -q;
+
+    uint64_t packed = largest;
+    for (auto i = 0u; i < 4; ++i) {
+        if (i == largest) continue;
+        float normalised = glm::clamp(q[(int) i] / SMALLEST_THREE_RANGE * 0.5f + 0.5f, 0.0f, 1.0f);
+        packed = (packed << 15) | (uint64_t) std::lround(normalised * SMALLEST_THREE_MAX);
+    }
+
+    return PackedQuat{{(uint16_t) packed, (uint16_t) (packed >> 16), (uint16_t) (packed >> 32)}};
+}
+
+glm::quat PackedQuat::unpack() const {
+    uint64_t packed = (uint64_t) bits[0] | ((uint64_t) bits[1] << 16) | ((uint64_t) bits[2] << 32);
+    uint largest = (uint) (packed >> 45) & 3u;
+
+    glm::quat q{};
+    float sum_squares = 0.0f;
+    // Components were packed in order, so the last one is in the lowest bits
+    for (int i = 3; i >= 0; --i) {
+        if ((uint) i == largest) continue;
+        float normalised = (float) (packed & 0x7FFFu) / SMALLEST_THREE_MAX;
+        packed >>= 15;
+        q[i] = (normalised * 2.0f - 1.0f) * SMALLEST_THREE_RANGE;
+        sum_squares += q[i] * q[i];
+    }
+    q[(int) largest] = std::sqrt(std::max(0.0f, 1.0f - sum_squares));
+
+    return q;
+}
+
+PackedVec3 PackedVec3::pack(const glm::vec3& value, const QuantisationBounds& bounds) {
+    PackedVec3 packed{};
+    for (auto i = 0; i < 3; ++i) {
+        float normalised = bounds.extent[i] > 0.0f ? glm::clamp((value[i] - bounds.min[i]) / bounds.extent[i], 0.0f, 1.0f) : 0.0f;
+        packed.bits[i] = (uint16_t) std::lround(normalised * PACKED_VEC3_MAX);
+    }
+    return packed;
+}
+
+glm::vec3 PackedVec3::unpack(const QuantisationBounds& bounds) const {
+    return bounds.min + glm::vec3{bits[0], bits[1], bits[2]} / PACKED_VEC3_MAX * bounds.extent;
+}
+
+glm::mat4 skinning_matrix(const SkinningVertex& vertex, const glm::mat4* bones) {
+    const auto& weights = vertex.bone_weights;
+    return weights[0] * bones[vertex.bone_indices[0]]
+         + weights[1] * bones[vertex.bone_indices[1]]
+         + weights[2] * bones[vertex.bone_indices[2]]
+         + weights[3] * bones[vertex.bone_indices[3]]
+         + (1.0f - glm::compAdd(weights)) * glm::mat4{1.0f};
+}
+
+glm::mat4 AnimationData::sample(double time, const QuantisationBounds& position_bounds) const {
+    AnimationCursor cursor{};
+    return sample(time, position_bounds, cursor);
+}
+
+glm::mat4 AnimationData::sample(double time, const QuantisationBounds& position_bounds, AnimationCursor& cursor) const {
     glm::vec3 position{0.0f};
     if (!positions.empty()) {
-        auto next_key = positions.lower_bound(time);
-        if (next_key == positions.end()) {
-            position = positions.rbegin()->second;
-        } else if (next_key->first == time || next_key == positions.begin()) {
-            position = next_key->second;
-        } else {
-            auto next = *next_key;
-            auto prev = *(--next_key);
-
-            position = glm::mix(prev.second, next.second, (float) ((time - prev.first) / (next.first - prev.first)));
-        }
+        position = positions.sample(time, cursor.position,
+                                    [&position_bounds](const PackedVec3& packed) { return packed.unpack(position_bounds); },
+                                    [](const glm::vec3& a, const glm::vec3& b, float t) { return glm::mix(a, b, t); });
     }
 
     glm::quat rotation{1.0f, 0.0f, 0.0f, 0.0f};
     if (!rotations.empty()) {
-        auto next_key = rotations.lower_bound(time);
-        if (next_key == rotations.end()) {
-            rotation = rotations.rbegin()->second;
-        } else if (next_key->first == time || next_key == rotations.begin()) {
-            rotation = next_key->second;
-        } else {
-            auto next = *next_key;
-            auto prev = *(--next_key);
-
-            rotation = glm::slerp(prev.second, next.second, (float) ((time - prev.first) / (next.first - prev.first)));
-        }
+        rotation = rotations.sample(time, cursor.rotation,
+                                    [](const PackedQuat& packed) { return packed.unpack(); },
+                                    [](const glm::quat& a, const glm::quat& b, float t) { return glm::slerp(a, b, t); });
     }
 
     glm::vec3 scaling{1.0f};
     if (!scalings.empty()) {
-        auto next_key = scalings.lower_bound(time);
-        if (next_key == scalings.end()) {
-            scaling = scalings.rbegin()->second;
-        } else if (next_key->first == time || next_key == scalings.begin()) {
-            scaling = next_key->second;
-        } else {
-            auto next = *next_key;
-            auto prev = *(--next_key);
-
-            scaling = glm::mix(prev.second, next.second, (float) ((time - prev.first) / (next.first - prev.first)));
-        }
+        scaling = scalings.sample(time, cursor.scaling,
+                                  [](const glm::vec3& value) { return value; },
+                                  [](const glm::vec3& a, const glm::vec3& b, float t) { return glm::mix(a, b, t); });
     }
 
     return glm::translate(position) * glm::toMat4(rotation) * glm::scale(scaling);
-}
\ No newline at end of file
+}
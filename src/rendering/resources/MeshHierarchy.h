@@ -1,10 +1,14 @@
 #ifndef MESH_HIERARCHY_H
 #define MESH_HIERARCHY_H
 
+#include <array>
+#include <cmath>
 #include <vector>
-#include <map>
+#include <cstdint>
+#include <algorithm>
 #include <memory>
-#include <functional>
+#include <climits>
+#include <optional>
 #include <unordered_map>
 
 #include <glm/glm.hpp>
@@ -12,38 +16,254 @@
 #include <glm/gtx/quaternion.hpp>
 
 #include "ModelHandle.h"
+#include "utility/Math.h"
 
 #define NONE_ANIMATION UINT_MAX
 
+class VertexAnimationTexture;
+
+/// A unit quaternion packed into 48 bits with the "smallest three" encoding:
+/// the largest component is dropped (it can be rebuilt since the quaternion has unit length, and made positive since q and -q are the same rotation),
+/// leaving 2 bits for which component was dropped and 15 bits for each of the other three, which all lie within [-1/sqrt(2), 1/sqrt(2)].
+struct PackedQuat {
+    std::array<uint16_t, 3> bits{};
+
+    static PackedQuat pack(const glm::quat& value);
+    [[nodiscard]] glm::quat unpack() const;
+};
+
+/// The range that a clip's positions are quantised within
+struct QuantisationBounds {
+    glm::vec3 min{0.0f};
+    glm::vec3 extent{0.0f};
+};
+
+/// A vec3 quantised to 16 bits per component within some QuantisationBounds
+struct PackedVec3 {
+    std::array<uint16_t, 3> bits{};
+
+    static PackedVec3 pack(const glm::vec3& value, const QuantisationBounds& bounds);
+    [[nodiscard]] glm::vec3 unpack(const QuantisationBounds& bounds) const;
+};
+
+/// A cached index into a KeyframeTrack, remembering where the last sample landed so that
+/// sampling sequential times can resume from there instead of searching the whole track again.
+using KeyframeCursor = uint;
+
+/// A single channel of keyframes (e.g. the positions of one node), stored as contiguous arrays sorted by time.
+/// The values may be stored packed (e.g. PackedQuat), in which case sampling is given a function to unpack them.
+///
+/// A track is either keyed at arbitrary times, or uniformly sampled, in which case the times aren't stored at all
+/// and key i is at start_time + i * interval, so finding the keys around a time is O(1).
+template<typename Stored>
+struct KeyframeTrack {
+    // Key times in ticks, empty if the track is uniformly sampled
+    std::vector<float> times{};
+    std::vector<Stored> values{};
+    // Only used if the track is uniformly sampled
+    float start_time = 0.0f;
+    float interval = 0.0f;
+
+    [[nodiscard]] bool empty() const {
+        return values.empty();
+    }
+
+    [[nodiscard]] uint size() const {
+        return (uint) values.size();
+    }
+
+    [[nodiscard]] bool is_uniform() const {
+        return times.empty();
+    }
+
+    [[nodiscard]] float key_time(uint key) const {
+        return is_uniform() ? start_time + (float) key * interval : times[key];
+    }
+
+    /// The memory used by the keys of the track, in bytes
+    [[nodiscard]] size_t memory_size() const {
+        return times.size() * sizeof(float) + values.size() * sizeof(Stored);
+    }
+
+    /// Find the index of the first key with a time >= the given time (i.e. std::lower_bound),
+    /// starting the search from the cursor, which is then updated to the result.
+    [[nodiscard]] uint find_key(double time, KeyframeCursor& cursor) const;
+
+    /// Sample the track at the given time, unpacking and interpolating between the two surrounding keys.
+    /// Times outside the track are clamped to the first/last key.
+    template<typename Unpack, typename Interpolate>
+    [[nodiscard]] auto sample(double time, KeyframeCursor& cursor, Unpack unpack, Interpolate interpolate) const;
+};
+
+/// The cursors for each of the three tracks in an AnimationData
+struct AnimationCursor {
+    KeyframeCursor position = 0;
+    KeyframeCursor rotation = 0;
+    KeyframeCursor scaling = 0;
+};
+
+/// A single channel of a clip, animating one node.
+/// Positions are quantised within the bounds of the clip, rotations are packed with the smallest three encoding, and scalings are left as is.
 struct AnimationData {
-    std::map<double, glm::vec3> positions{};
-    std::map<double, glm::quat> rotations{};
-    std::map<double, glm::vec3> scalings{};
+    // The node this channel animates
+    uint node = 0;
+    KeyframeTrack<PackedVec3> positions{};
+    KeyframeTrack<PackedQuat> rotations{};
+    KeyframeTrack<glm::vec3> scalings{};
 
-    [[nodiscard]] glm::mat4 sample(double time) const;
+    [[nodiscard]] glm::mat4 sample(double time, const QuantisationBounds& position_bounds) const;
+    [[nodiscard]] glm::mat4 sample(double time, const QuantisationBounds& position_bounds, AnimationCursor& cursor) const;
+
+    [[nodiscard]] size_t memory_size() const {
+        return positions.memory_size() + rotations.memory_size() + scalings.memory_size();
+    }
 };
 
-struct MeshHierarchyNode {
-    std::vector<uint> meshes{};
-    glm::mat4 transformation{1.0f};
-    // [(mesh_index, bone_id, offset_matrix)]
-    std::vector<std::tuple<uint, uint, glm::mat4>> bones{};
-    // { animation_id } -> { Animation Data }
-    std::unordered_map<int, AnimationData> animation_data{};
-    std::vector<MeshHierarchyNode> children{};
+/// How well an animation clip was compressed on import
+struct AnimationClipStats {
+    // The memory used by the keys as imported, with double times and full precision values
+    size_t raw_bytes = 0;
+    size_t compressed_bytes = 0;
+    uint raw_keys = 0;
+    uint compressed_keys = 0;
+    // The largest difference between the imported and compressed clips, measured at every imported key
+    float max_position_error = 0.0f;
+    // In radians
+    float max_rotation_error = 0.0f;
+    float max_scaling_error = 0.0f;
+};
+
+/// The channels of a single animation
+struct AnimationClip {
+    // [channel_id] -> { Animation Data }, the channel_id is also the index of the channel's cursor
+    std::vector<AnimationData> channels{};
+    QuantisationBounds position_bounds{};
+    AnimationClipStats stats{};
+
+    // A box around the skinned meshes over the whole clip, in the hierarchy's space, see ModelLoader::compute_animation_bounds
+    BoundingBox bounds{};
+    // [segment_id] -> a box around the skinned meshes over that segment, the clip is split into segments of equal duration
+    std::vector<BoundingBox> segment_bounds{};
 };
 
+template<typename Stored>
+uint KeyframeTrack<Stored>::find_key(double time, KeyframeCursor& cursor) const {
+    const auto count = size();
+
+    if (is_uniform()) {
+        // Straight to the key, then correct for any rounding so that this matches the lower_bound of the keyed case
+        uint key = 0;
+        if (interval > 0.0f && time > start_time) {
+            key = (uint) std::min((double) count, std::ceil((time - start_time) / interval));
+        }
+        if (key > 0 && key_time(key - 1) >= time) --key;
+        if (key < count && key_time(key) < time) ++key;
+        cursor = key;
+        return key;
+    }
+
+    // How far to walk forwards from the cursor before giving up and doing a binary search
+    constexpr uint MAX_LINEAR_STEPS = 4;
+
+    uint key = std::min(cursor, count);
+
+    if (key > 0 && times[key - 1] >= time) {
+        // Went backwards (e.g. a looping animation wrapped around), so search everything before the cursor
+        key = (uint) (std::lower_bound(times.begin(), times.begin() + key, time) - times.begin());
+    } else {
+        // The common case, time has moved forward by a small amount, so only a few keys need to be stepped over
+        uint steps = 0;
+        while (key < count && times[key] < time && steps < MAX_LINEAR_STEPS) {
+            ++key;
+            ++steps;
+        }
+        if (key < count && times[key] < time) {
+            key = (uint) (std::lower_bound(times.begin() + key, times.end(), time) - times.begin());
+        }
+    }
+
+    cursor = key;
+    return key;
+}
+
+template<typename Stored>
+template<typename Unpack, typename Interpolate>
+auto KeyframeTrack<Stored>::sample(double time, KeyframeCursor& cursor, Unpack unpack, Interpolate interpolate) const {
+    uint next = find_key(time, cursor);
+    if (next == size()) {
+        return unpack(values.back());
+    }
+    if (key_time(next) == time || next == 0) {
+        return unpack(values[next]);
+    }
+
+    uint prev = next - 1;
+    double prev_time = key_time(prev);
+    return interpolate(unpack(values[prev]), unpack(values[next]), (float) ((time - prev_time) / (key_time(next) - prev_time)));
+}
+
+/// Binds a bone of a mesh to the node of the hierarchy that drives it
+struct BoneBinding {
+    uint node;
+    // Index into AnimationPose::bone_transforms, i.e. the mesh's bone_offset + the bone_id
+    uint palette_index;
+    glm::mat4 offset_matrix;
+};
+
+/// A mesh to draw, along with the accumulated (static) node transformation to draw it with
+struct MeshDraw {
+    uint mesh;
+    glm::mat4 transformation;
+};
+
+/// A vertex of a mesh as imported, kept on the CPU so that the mesh can be skinned without the GPU (e.g. for baking)
+struct SkinningVertex {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec4 bone_weights;
+    // Relative to the mesh's bone_offset
+    glm::uvec4 bone_indices;
+};
+
+/// The transformation that skins a vertex with the given bones, where bones points at the first bone of the vertex's mesh.
+/// This matches animated_entity/vert.glsl, so any weight missing from a sum of 1 is given to the identity.
+/// Only valid for meshes that have bones.
+glm::mat4 skinning_matrix(const SkinningVertex& vertex, const glm::mat4* bones);
+
 template<typename VertexData>
 struct ModelInfo {
     std::shared_ptr<ModelHandle<VertexData>> model{};
     // { bone_name } -> { bone_id }
     std::unordered_map<std::string, uint> bones{};
-    // Computed based on an input time
+    // Where this mesh's bones start in AnimationPose::bone_transforms
+    uint bone_offset = 0;
+    // [vertex_id] -> the vertex as imported, in the same order as in the model
+    std::vector<SkinningVertex> skinning_vertices{};
+
+    ModelInfo(const std::shared_ptr<ModelHandle<VertexData>>& model, const std::unordered_map<std::string, uint>& bones, uint bone_offset, std::vector<SkinningVertex> skinning_vertices)
+        : model(model), bones(bones), bone_offset(bone_offset), skinning_vertices(std::move(skinning_vertices)) {}
+};
+
+/// The result of evaluating an animation of a MeshHierarchy.
+///
+/// This is owned by each instance rather than the (shared, immutable) MeshHierarchy,
+/// so that any number of instances of the same file can be posed independently, and in parallel.
+struct AnimationPose {
+    // [channel_id] -> keyframe cursors, to make sampling sequential times cheap
+    std::vector<AnimationCursor> cursors{};
+    // [node_id] -> global transformation, scratch space for the evaluation
+    std::vector<glm::mat4> node_transforms{};
+    // [bone_offset + bone_id] -> bone transform, for the bones of every mesh in the hierarchy
     std::vector<glm::mat4> bone_transforms{};
 
-    ModelInfo(const std::shared_ptr<ModelHandle<VertexData>>& model, const std::unordered_map<std::string, uint>& bones) : model(model), bones(bones) {
-        bone_transforms.resize(bones.size(), glm::mat4{1.0f});
-    }
+    // Animation LOD state, for when the pose isn't evaluated every frame, see AnimatedEntityRenderer::prepare_frame
+    // The pose evaluated before bone_transforms, which is blended towards bone_transforms in between updates
+    std::vector<glm::mat4> previous_bone_transforms{};
+    // Frames between evaluations, and frames since the last one
+    uint update_interval = 1;
+    uint frames_since_update = 0;
+    // The animation the bone_transforms were evaluated for
+    uint evaluated_animation_id = NONE_ANIMATION;
 };
 
 class BaseMeshHierarchy : private NonCopyable {
@@ -52,31 +272,68 @@ public:
 };
 
 /// A struct representing a hierarchy of meshes, for use in animation.
+///
+/// The node tree is flattened at load time into arrays indexed by node, ordered so that every parent comes
+/// before its children, which lets a pose be evaluated with a single linear pass instead of a recursive traversal.
 template<typename VertexData>
 struct MeshHierarchy : public BaseMeshHierarchy {
+    static constexpr uint NO_PARENT = UINT_MAX;
+
     std::vector<ModelInfo<VertexData>> meshes{};
-    // { bone_name } -> [(mesh_index, bone_id, offset_matrix)]
-    std::unordered_map<std::string, std::vector<std::tuple<uint, uint, glm::mat4>>> total_bones{};
     // [animation_id] -> (animation_name, ticks_per_second, duration_ticks)
     std::vector<std::tuple<std::string, double, double>> animations{};
+    // [animation_id] -> { Animation Clip }
+    std::vector<AnimationClip> animation_clips{};
     // The name of the file the MeshHierarchy was loaded from, if any
     std::optional<std::string> filename{};
-    MeshHierarchyNode root_node{};
+
+    // [node_id] -> node_name
+    std::vector<std::string> node_names{};
+    // [node_id] -> parent node_id, or NO_PARENT for the root
+    std::vector<uint> node_parents{};
+    // [node_id] -> static transformation relative to the parent
+    std::vector<glm::mat4> node_transformations{};
+    // [node_id] -> transformation used when the node is not animated, identity for nodes outside a skeleton
+    std::vector<glm::mat4> node_rest_transformations{};
+    // [node_id] -> whether the node is a small detail bone (fingers, face, etc.), or below one, which can be skipped when far away
+    std::vector<uint8_t> node_optional{};
+    // Every bone of every mesh, and the node that drives it
+    std::vector<BoneBinding> bone_bindings{};
+    // The total number of bones across all meshes, i.e. the size of AnimationPose::bone_transforms
+    uint bone_count = 0;
+    // A sphere around the meshes in their rest pose, for estimating how big the hierarchy is on screen
+    glm::vec3 bounding_centre{0.0f};
+    float bounding_radius = 0.0f;
+    // A box around the skinned meshes in their rest pose, see AnimationClip::bounds for the boxes of each clip
+    BoundingBox rest_bounds{};
+    // Every mesh to draw, precomputed from the static node transformations
+    std::vector<MeshDraw> draw_list{};
+    // Every clip baked into a texture for playing back in the vertex shader, null unless loaded with ModelLoader::load_baked_hierarchy_from_file
+    std::shared_ptr<VertexAnimationTexture> vertex_animation{};
 
     explicit MeshHierarchy(const std::optional<std::string>& filename = std::nullopt) : filename(filename) {}
 
-    /// Set the transformation field of each node to the correct state for the given time
-    void calculate_animation(uint animation_id, double time_seconds);
-    /// Recursively iterator over node tree
-    void visit_nodes(std::function<void(const MeshHierarchyNode& node, glm::mat4 accumulated_transformation)> fn);
+    /// Compute the bone transforms of each mesh for the given time into the given pose, which is resized as needed.
+    /// Optional nodes are left in their rest pose if include_optional_nodes is false.
+    /// This doesn't modify the hierarchy, so it is safe to call concurrently as long as each call has its own pose.
+    void calculate_animation(uint animation_id, double time_seconds, AnimationPose& pose, bool include_optional_nodes = true) const;
+
+    /// A box that contains the skinned meshes at the given time of an animation, without evaluating the pose.
+    /// This is the box of the segment of the clip around the time, or the rest pose's box for NONE_ANIMATION.
+    [[nodiscard]] const BoundingBox& get_animation_bounds(uint animation_id, double time_seconds) const;
+
+    /// Call visit(draw_id, vertex, transformation) for every vertex of every draw in the draw_list, where transformation
+    /// takes the vertex into the hierarchy's space in the given pose, just like animated_entity/vert.glsl does.
+    template<typename Visit>
+    void visit_skinned_vertices(const AnimationPose& pose, Visit visit) const;
 };
 
 template<typename VertexData>
-void MeshHierarchy<VertexData>::calculate_animation(uint animation_id, double time_seconds) {
+void MeshHierarchy<VertexData>::calculate_animation(uint animation_id, double time_seconds, AnimationPose& pose, bool include_optional_nodes) const {
+    pose.bone_transforms.resize(bone_count);
+
     if (animation_id == NONE_ANIMATION) {
-        for (auto& mesh: meshes) {
-            std::fill(mesh.bone_transforms.begin(), mesh.bone_transforms.end(), glm::mat4{1.0f});
-        }
+        std::fill(pose.bone_transforms.begin(), pose.bone_transforms.end(), glm::mat4{1.0f});
         return;
     }
 
@@ -84,43 +341,64 @@ void MeshHierarchy<VertexData>::calculate_animation(uint animation_id, double ti
         throw std::runtime_error(Formatter() << "Invalid animation id: " << animation_id);
     }
 
-    std::function<void(const MeshHierarchyNode& node, glm::mat4 accumulated_transformation, bool is_skeleton)> animate;
     double time_ticks = time_seconds * std::get<1>(animations[animation_id]);
+    const auto& clip = animation_clips[animation_id];
+    const auto& channels = clip.channels;
+    if (pose.cursors.size() < channels.size()) {
+        pose.cursors.resize(channels.size());
+    }
 
-    animate = [&animate, this, animation_id, time_ticks](const MeshHierarchyNode& node, glm::mat4 accumulated_transformation, bool is_skeleton) {
-        is_skeleton |= !node.bones.empty();
-        glm::mat4 transform = is_skeleton ? node.transformation : glm::mat4{1.0f};
-        const auto animation = node.animation_data.find(animation_id);
-        if (animation != node.animation_data.end()) {
-            transform = animation->second.sample(time_ticks);
-        }
-        accumulated_transformation = accumulated_transformation * transform;
+    // Local transformations
+    auto& node_transforms = pose.node_transforms;
+    node_transforms.assign(node_rest_transformations.begin(), node_rest_transformations.end());
+    for (auto channel_i = 0u; channel_i < channels.size(); ++channel_i) {
+        const auto& channel = channels[channel_i];
+        if (!include_optional_nodes && node_optional[channel.node]) continue;
+        node_transforms[channel.node] = channel.sample(time_ticks, clip.position_bounds, pose.cursors[channel_i]);
+    }
 
-        for (const auto& [mesh_id, bone_id, offset_matrix]: node.bones) {
-            meshes[mesh_id].bone_transforms[bone_id] = accumulated_transformation * offset_matrix;
-        }
+    // Accumulate into global transformations, parents always come before children so are already accumulated
+    for (auto node_i = 1u; node_i < node_transforms.size(); ++node_i) {
+        node_transforms[node_i] = node_transforms[node_parents[node_i]] * node_transforms[node_i];
+    }
 
-        for (const auto& child: node.children) {
-            animate(child, accumulated_transformation, is_skeleton);
-        }
-    };
+    for (const auto& binding: bone_bindings) {
+        pose.bone_transforms[binding.palette_index] = node_transforms[binding.node] * binding.offset_matrix;
+    }
+}
+
+template<typename VertexData>
+const BoundingBox& MeshHierarchy<VertexData>::get_animation_bounds(uint animation_id, double time_seconds) const {
+    if (animation_id >= animation_clips.size()) {
+        return rest_bounds;
+    }
+    const auto& clip = animation_clips[animation_id];
+    if (clip.segment_bounds.empty()) {
+        return clip.bounds.is_empty() ? rest_bounds : clip.bounds;
+    }
 
-    animate(root_node, glm::mat4{1.0f}, false);
+    const auto& [name, ticks_per_second, duration_ticks] = animations[animation_id];
+    const auto& segment_bounds = clip.segment_bounds;
+    double duration_seconds = duration_ticks / ticks_per_second;
+    uint segment = 0;
+    if (duration_seconds > 0.0 && time_seconds > 0.0) {
+        segment = (uint) std::min((double) segment_bounds.size() - 1.0, std::floor(time_seconds / duration_seconds * (double) segment_bounds.size()));
+    }
+    return segment_bounds[segment];
 }
 
 template<typename VertexData>
-void MeshHierarchy<VertexData>::visit_nodes(std::function<void(const MeshHierarchyNode&, glm::mat4)> fn) {
-    std::function<void(const MeshHierarchyNode& node, glm::mat4 accumulated_transformation)> visit;
-
-    visit = [&visit, &fn](const MeshHierarchyNode& node, glm::mat4 accumulated_transformation) {
-        accumulated_transformation = accumulated_transformation * node.transformation;
-        fn(node, accumulated_transformation);
-        for (const auto& child: node.children) {
-            visit(child, accumulated_transformation);
-        }
-    };
+template<typename Visit>
+void MeshHierarchy<VertexData>::visit_skinned_vertices(const AnimationPose& pose, Visit visit) const {
+    for (auto draw_i = 0u; draw_i < draw_list.size(); ++draw_i) {
+        const auto& draw = draw_list[draw_i];
+        const auto& mesh = meshes[draw.mesh];
+        bool has_bones = !mesh.bones.empty();
 
-    visit(root_node, glm::mat4{1.0f});
+        for (const auto& vertex: mesh.skinning_vertices) {
+            visit(draw_i, vertex, has_bones ? draw.transformation * skinning_matrix(vertex, pose.bone_transforms.data() + mesh.bone_offset) : draw.transformation);
+        }
+    }
 }
 
 #endif //MESH_HIERARCHY_H
@@ -2,9 +2,11 @@
 #define MODEL_HANDLE_H
 
 #include <string>
+#include <vector>
 #include <optional>
 
 #include <glad/gl.h>
+#include <glm/glm.hpp>
 #include "utility/HelperTypes.h"
 
 /// A type-erased version of ModelHandle for polymorphic usages
@@ -23,6 +25,10 @@ class ModelHandle : public BaseModelHandle {
     int vertex_offset;
 
     std::optional<std::string> filename{};
+
+    // The model's triangles in its own space, kept on the CPU so that particles can collide with it, empty unless loaded from a file
+    std::vector<glm::vec3> collision_positions{};
+    std::vector<uint> collision_indices{};
 public:
     ModelHandle(uint vertex_vbo, uint index_vbo, uint vao, int index_count, int vertex_offset, std::optional<std::string> filename = {});
 
@@ -33,6 +39,10 @@ public:
     [[nodiscard]] int get_vertex_offset() const;
     [[nodiscard]] const std::optional<std::string>& get_filename() const;
 
+    void set_collision_geometry(std::vector<glm::vec3> positions, std::vector<uint> indices);
+    [[nodiscard]] const std::vector<glm::vec3>& get_collision_positions() const { return collision_positions; }
+    [[nodiscard]] const std::vector<uint>& get_collision_indices() const { return collision_indices; }
+
     ~ModelHandle() override;
 };
 
@@ -70,6 +80,12 @@ const std::optional<std::string>& ModelHandle<VertexData>::get_filename() const
     return filename;
 }
 
+template<typename VertexData>
+void ModelHandle<VertexData>::set_collision_geometry(std::vector<glm::vec3> positions, std::vector<uint> indices) {
+    collision_positions = std::move(positions);
+    collision_indices = std::move(indices);
+}
+
 template<typename VertexData>
 ModelHandle<VertexData>::~ModelHandle() {
     glDeleteVertexArrays(1, &vao);
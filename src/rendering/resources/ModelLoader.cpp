@@ -1,4 +1,6 @@
 #include "ModelLoader.h"
+#include <cctype>
+#include <algorithm>
 #include <filesystem>
 
 const std::vector<std::string>& ModelLoader::get_available_models(bool force_refresh) {
@@ -13,4 +15,52 @@ const std::vector<std::string>& ModelLoader::get_available_models(bool force_ref
     std::sort(available_models.value().begin(), available_models.value().end());
 
     return available_models.value();
-}
\ No newline at end of file
+}
+
+bool ModelLoader::is_detail_bone_name(const std::string& name) {
+    static const std::vector<std::string> DETAIL_BONE_NAMES = {
+        "finger", "thumb", "index", "middle", "ring", "pinky", "toe",
+        "eye", "eyeball", "eyelid", "lid", "brow", "eyebrow", "jaw", "lip", "tongue", "cheek", "face"
+    };
+
+    // Split into words, at anything that isn't a letter, and where a lower case letter is followed by an upper case one,
+    // so "mixamorig:LeftHandIndex1", "Bip01 L Finger0" and "toe_end.L" give "index", "finger" and "toe",
+    // but "String", "Collider" and "Surface" are whole words that don't match anything
+    std::vector<std::string> words{""};
+    for (auto i = 0u; i < name.size(); ++i) {
+        auto c = (unsigned char) name[i];
+        if (!std::isalpha(c)) {
+            if (!words.back().empty()) words.emplace_back();
+            continue;
+        }
+        if (std::isupper(c) && i > 0 && std::islower((unsigned char) name[i - 1])) {
+            words.emplace_back();
+        }
+        words.back().push_back((char) std::tolower(c));
+    }
+
+    return std::any_of(words.begin(), words.end(), [](const std::string& word) {
+        // Plurals too, for "Toes" and "Eyes"
+        std::string singular = word.size() > 1 && word.back() == 's' ? word.substr(0, word.size() - 1) : word;
+        return std::find(DETAIL_BONE_NAMES.begin(), DETAIL_BONE_NAMES.end(), word) != DETAIL_BONE_NAMES.end()
+            || std::find(DETAIL_BONE_NAMES.begin(), DETAIL_BONE_NAMES.end(), singular) != DETAIL_BONE_NAMES.end();
+    });
+}
+
+void ModelLoader::add_imgui_options_section() {
+    if (ImGui::CollapsingHeader("Animation Import")) {
+        ImGui::TextWrapped("Applies to models loaded after changing, so reselect a model to see the effect.");
+        bool changed = AnimationCompression::add_imgui_settings(animation_compression);
+        changed |= ImGui::DragFloat("Vertex Animation Bake Rate (frames/s)", &vertex_animation_rate, 1.0f, 1.0f, 120.0f);
+        changed |= ImGui::DragFloat("Animation Bounds Rate (samples/s)", &animation_bounds_rate, 1.0f, 1.0f, 120.0f);
+        int segments = (int) animation_bounds_segments;
+        if (ImGui::SliderInt("Animation Bounds Segments", &segments, 1, 64)) {
+            animation_bounds_segments = (uint) segments;
+            changed = true;
+        }
+        if (changed) {
+            // Forget the cached hierarchies, so they get compressed and baked again with the new settings
+            hierarchy_cache.clear();
+        }
+    }
+}
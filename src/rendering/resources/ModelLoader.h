@@ -2,6 +2,8 @@
 #define MODEL_LOADER_H
 
 #include <map>
+#include <limits>
+#include <algorithm>
 #include <set>
 #include <utility>
 #include <vector>
@@ -22,6 +24,10 @@
 
 #include "ModelHandle.h"
 #include "MeshHierarchy.h"
+#include "AnimationCompression.h"
+#include "BoneWeights.h"
+#include "VertexAnimationTexture.h"
+#include "utility/JobSystem.h"
 
 struct VertexCollection {
     std::vector<glm::vec3> positions;
@@ -41,10 +47,21 @@ class ModelLoader {
     // Map (relative_path, vertex_type) -> (last_modified, weak_handle)
     std::unordered_map<std::pair<std::string, std::type_index>, std::pair<std::filesystem::file_time_type, std::weak_ptr<BaseModelHandle>>, PairHash> cache{};
     std::unordered_map<std::pair<std::string, std::type_index>, std::pair<std::filesystem::file_time_type, std::weak_ptr<BaseMeshHierarchy>>, PairHash> hierarchy_cache{};
+
+    AnimationCompressionSettings animation_compression{};
+    // In frames per second, for baking vertex animation
+    float vertex_animation_rate = 30.0f;
+    // In samples per second, for finding the bounds of each clip
+    float animation_bounds_rate = 30.0f;
+    // How many pieces each clip's duration is split into, each with their own bounds
+    uint animation_bounds_segments = 8;
+
+    // For spreading the work of baking across threads
+    JobSystem& job_system;
 public:
     /// Construct the loader with a import_path which is prepended to any path you try and load.
     /// It also scans the directory for all files, which is used to populate the list of get_available_models()
-    explicit ModelLoader(std::string import_path) : import_path(std::move(import_path)) {}
+    ModelLoader(std::string import_path, JobSystem& job_system) : import_path(std::move(import_path)), job_system(job_system) {}
 
     /// Loads the provided model data into GPU memory
     template<typename VertexData>
@@ -58,22 +75,44 @@ public:
     template<typename VertexData>
     std::shared_ptr<MeshHierarchy<VertexData>> load_hierarchy_from_file(const std::string& file);
 
+    /// Load the file specified as a hierarchy, like load_hierarchy_from_file, and also bake its clips into its vertex_animation if they aren't already.
+    template<typename VertexData>
+    std::shared_ptr<MeshHierarchy<VertexData>> load_baked_hierarchy_from_file(const std::string& file);
+
+    /// Sample every clip of the hierarchy at the vertex animation rate, skinning the vertices on the CPU, and upload the results into a texture.
+    /// Each frame is independent, so they are spread across the job system's threads.
+    template<typename VertexData>
+    std::shared_ptr<VertexAnimationTexture> bake_vertex_animation(const MeshHierarchy<VertexData>& mesh_hierarchy);
+
     /// Helper method to provide a selector over all the model files in the import_path directory.
     template<typename VertexData>
     bool add_imgui_model_selector(const std::string& caption, std::shared_ptr<ModelHandle<VertexData>>& model_handle);
 
     /// Helper method to provide a selector over all the model files in the import_path directory, but to be loaded as a hierarchy.
+    /// If baked is set, the hierarchy is loaded with load_baked_hierarchy_from_file.
     template<typename VertexData>
-    bool add_imgui_hierarchy_selector(const std::string& caption, std::shared_ptr<MeshHierarchy<VertexData>>& mesh_hierarchy);
+    bool add_imgui_hierarchy_selector(const std::string& caption, std::shared_ptr<MeshHierarchy<VertexData>>& mesh_hierarchy, bool baked = false);
 
     /// Helper method to provide a selector over all the model files in the import_path directory.
     /// if force_refresh is selected, it will rescan the directory, otherwise it just uses a cached list from the last scan.
     const std::vector<std::string>& get_available_models(bool force_refresh = false);
 
+    /// Adds controls for the import settings to the current ImGUI window
+    void add_imgui_options_section();
+
     /// Free up any resources.
     void cleanup() {}
 
 private:
+    /// Whether a node's name suggests it is a small detail bone, like a finger or part of the face.
+    /// Matches whole words of the name, so "LeftHandIndex1" is a detail bone but "Collider" isn't
+    static bool is_detail_bone_name(const std::string& name);
+
+    /// Find the bounds of the rest pose and of every clip (and every segment of each clip) of the hierarchy,
+    /// by sampling the clips at the animation bounds rate and skinning the vertices on the CPU. The samples are spread across the job system's threads.
+    template<typename VertexData>
+    void compute_animation_bounds(MeshHierarchy<VertexData>& mesh_hierarchy);
+
     template<typename VertexData>
     static void load_node(const aiScene* scene, const aiNode* node, std::vector<VertexData>& vertices, std::vector<uint>& indices, glm::mat4 parent_transform);
 };
@@ -146,6 +185,13 @@ std::shared_ptr<ModelHandle<VertexData>> ModelLoader::load_from_file(const std::
     load_node(scene, scene->mRootNode, vertices, indices, glm::mat4{1.0f});
 
     auto model = load_from_data(vertices, indices, file);
+    // Only the positions, since that's all collision needs
+    std::vector<glm::vec3> collision_positions{};
+    collision_positions.reserve(vertices.size());
+    for (const auto& vertex: vertices) {
+        collision_positions.push_back(vertex.position);
+    }
+    model->set_collision_geometry(std::move(collision_positions), std::move(indices));
 
     importer.FreeScene();
 
@@ -244,6 +290,10 @@ std::shared_ptr<MeshHierarchy<VertexData>> ModelLoader::load_hierarchy_from_file
 
     // {index into scene->mMeshes} -> {index into mesh_hierarchy->models}
     std::unordered_map<uint, uint> mesh_index_map{};
+    // { bone_name } -> [(palette_index, offset_matrix)]
+    std::unordered_map<std::string, std::vector<std::pair<uint, glm::mat4>>> total_bones{};
+    // [hierarchy_mesh_id] -> (centre, radius) of a sphere around the mesh's vertices
+    std::vector<std::pair<glm::vec3, float>> mesh_spheres{};
 
     for (auto mesh_i = 0u; mesh_i < scene->mNumMeshes; ++mesh_i) {
         const auto* mesh = scene->mMeshes[mesh_i];
@@ -255,43 +305,22 @@ std::shared_ptr<MeshHierarchy<VertexData>> ModelLoader::load_hierarchy_from_file
         const auto n = reinterpret_cast<glm::vec3*>(mesh->mNormals);
         const auto t = reinterpret_cast<glm::vec3*>(mesh->mTextureCoords[0]);
 
+        // The index this mesh will have in mesh_hierarchy->meshes, and where its bones will start in a pose
+        auto hierarchy_mesh_i = (uint) mesh_hierarchy->meshes.size();
+        auto bone_offset = mesh_hierarchy->bone_count;
+
         // { bone_name } -> { bone_id }
         std::unordered_map<std::string, uint> bone_names{};
 
-        // [vertex_id] -> (bone_weight -> bone_id)
-        std::vector<std::map<float, std::set<uint>>> bone_weights_total{};
-        bone_weights_total.resize(mesh->mNumVertices, {});
         for (auto bone_i = 0u; bone_i < mesh->mNumBones; ++bone_i) {
             const auto* bone = mesh->mBones[bone_i];
             bone_names[bone->mName.C_Str()] = bone_i;
             auto ai_offset_matrix = bone->mOffsetMatrix;
-            mesh_hierarchy->total_bones[bone->mName.C_Str()].push_back({mesh_i, bone_i, reinterpret_cast<glm::mat4&>(ai_offset_matrix.Transpose())});
-
-            for (auto weight_i = 0u; weight_i < bone->mNumWeights; ++weight_i) {
-                const auto* weight = &bone->mWeights[weight_i];
-                bone_weights_total[weight->mVertexId][weight->mWeight].insert(bone_i);
-            }
+            total_bones[bone->mName.C_Str()].emplace_back(bone_offset + bone_i, reinterpret_cast<glm::mat4&>(ai_offset_matrix.Transpose()));
         }
 
-        // [vertex_id] -> ([bone_id; 4], [bone_weight; 4])
-        std::vector<std::pair<glm::vec4, glm::uvec4>> bone_weights;
-        bone_weights.resize(mesh->mNumVertices, {});
-        for (auto vert_i = 0u; vert_i < mesh->mNumVertices; ++vert_i) {
-            const auto& vert = bone_weights_total[vert_i];
-            auto i = 0;
-            for (auto iter = vert.rbegin(); i < 4 && iter != vert.rend(); ++iter) {
-                for (auto inner_iter = iter->second.begin(); i < 4 && inner_iter != iter->second.end(); ++inner_iter) {
-                    bone_weights[vert_i].first[i] = iter->first;
-                    bone_weights[vert_i].second[i] = *inner_iter;
-                    ++i;
-                }
-            }
-            float weight_sum = glm::compAdd(bone_weights[vert_i].first);
-            if (weight_sum != 0.0f) {
-                // Normalise the sum of the weights
-                bone_weights[vert_i].first /= weight_sum;
-            }
-        }
+        // [vertex_id] -> ([bone_weight; 4], [bone_id; 4])
+        std::vector<BoneWeights::VertexBoneWeights> bone_weights = BoneWeights::gather(*mesh);
 
         VertexCollection vertex_collection{
             v ? std::vector<glm::vec3>{v, v + mesh->mNumVertices} : std::vector<glm::vec3>{},
@@ -303,25 +332,57 @@ std::shared_ptr<MeshHierarchy<VertexData>> ModelLoader::load_hierarchy_from_file
         std::vector<VertexData> vertices{};
         VertexData::from_mesh(vertex_collection, vertices);
 
+        // Keep a CPU side copy of what skinning needs, for baking
+        std::vector<SkinningVertex> skinning_vertices{};
+        if (v) {
+            skinning_vertices.reserve(mesh->mNumVertices);
+            for (auto vert_i = 0u; vert_i < mesh->mNumVertices; ++vert_i) {
+                skinning_vertices.push_back({v[vert_i], n ? n[vert_i] : glm::vec3{0.0f}, bone_weights[vert_i].first, bone_weights[vert_i].second});
+            }
+        }
+
         std::vector<uint> indices{};
         for (auto face_i = 0u; face_i < mesh->mNumFaces; ++face_i) {
             aiFace face = mesh->mFaces[face_i];
             indices.insert(indices.end(), face.mIndices, face.mIndices + face.mNumIndices);
         }
 
-        mesh_index_map[mesh_i] = (int) mesh_hierarchy->meshes.size();
+        // A sphere around the vertices, for the bounding sphere of the whole hierarchy
+        glm::vec3 vertex_centre{0.0f};
+        float vertex_radius = 0.0f;
+        if (v && mesh->mNumVertices > 0) {
+            glm::vec3 vertex_min{std::numeric_limits<float>::max()};
+            glm::vec3 vertex_max{std::numeric_limits<float>::lowest()};
+            for (auto vert_i = 0u; vert_i < mesh->mNumVertices; ++vert_i) {
+                vertex_min = glm::min(vertex_min, v[vert_i]);
+                vertex_max = glm::max(vertex_max, v[vert_i]);
+            }
+            vertex_centre = (vertex_min + vertex_max) * 0.5f;
+            for (auto vert_i = 0u; vert_i < mesh->mNumVertices; ++vert_i) {
+                vertex_radius = std::max(vertex_radius, glm::distance(vertex_centre, v[vert_i]));
+            }
+        }
+        mesh_spheres.emplace_back(vertex_centre, vertex_radius);
+
+        mesh_index_map[mesh_i] = hierarchy_mesh_i;
         mesh_hierarchy->meshes.push_back(ModelInfo{
             load_from_data(vertices, indices),
-            bone_names
+            bone_names,
+            bone_offset,
+            std::move(skinning_vertices)
         });
+        mesh_hierarchy->bone_count += mesh->mNumBones;
     }
 
     if (mesh_hierarchy->meshes.empty()) {
         throw std::runtime_error(Formatter() << "Failed to load model (" << file << "): \n\t" << "No triangle meshes");
     }
 
-    // { node_name } -> [(animation_id, node_animation)]
-    std::unordered_map<std::string, std::vector<std::pair<uint, const aiNodeAnim*>>> animations{};
+    // [animation_id] -> [channel_id] -> keys as imported, which are compressed into the hierarchy once they are all gathered
+    std::vector<std::vector<RawAnimationChannel>> raw_animations(scene->mNumAnimations);
+
+    // { node_name } -> [(animation_id, channel_id, node_animation)]
+    std::unordered_map<std::string, std::vector<std::tuple<uint, uint, const aiNodeAnim*>>> animations{};
     for (auto animation_i = 0u; animation_i < scene->mNumAnimations; ++animation_i) {
         const auto* animation = scene->mAnimations[animation_i];
         std::string name = animation->mName.C_Str();
@@ -332,47 +393,116 @@ std::shared_ptr<MeshHierarchy<VertexData>> ModelLoader::load_hierarchy_from_file
 
         for (auto channel_i = 0u; channel_i < animation->mNumChannels; ++channel_i) {
             const auto* node_animation = animation->mChannels[channel_i];
-            animations[node_animation->mNodeName.C_Str()].emplace_back(animation_i, node_animation);
+            animations[node_animation->mNodeName.C_Str()].emplace_back(animation_i, channel_i, node_animation);
         }
+        // Channels start unbound, and are bound to their node while flattening the node tree below
+        raw_animations[animation_i].resize(animation->mNumChannels, RawAnimationChannel{MeshHierarchy<VertexData>::NO_PARENT});
     }
 
-    std::function<void(const aiNode* node, MeshHierarchyNode& hierarchy_node)> load_hierarchy_node;
+    // Flatten the node tree in depth first order, so that parents always come before their children
+    struct PendingNode {
+        const aiNode* node;
+        uint parent;
+        bool is_skeleton;
+        glm::mat4 parent_transformation;
+    };
+    std::vector<PendingNode> pending_nodes{{scene->mRootNode, MeshHierarchy<VertexData>::NO_PARENT, false, glm::mat4{1.0f}}};
+
+    while (!pending_nodes.empty()) {
+        auto [node, parent, is_skeleton, parent_transformation] = pending_nodes.back();
+        pending_nodes.pop_back();
+
+        auto node_i = (uint) mesh_hierarchy->node_parents.size();
 
-    load_hierarchy_node = [&mesh_index_map, &load_hierarchy_node, &mesh_hierarchy, &animations](const aiNode* node, MeshHierarchyNode& hierarchy_node) {
         auto ai_transformation = node->mTransformation;
-        hierarchy_node.transformation = reinterpret_cast<glm::mat4&>(ai_transformation.Transpose());
+        glm::mat4 transformation = reinterpret_cast<glm::mat4&>(ai_transformation.Transpose());
+        glm::mat4 accumulated_transformation = parent_transformation * transformation;
+
+        const auto bones = total_bones.find(node->mName.C_Str());
+        if (bones != total_bones.end()) {
+            is_skeleton = true;
+            for (const auto& [palette_index, offset_matrix]: bones->second) {
+                mesh_hierarchy->bone_bindings.push_back({node_i, palette_index, offset_matrix});
+            }
+        }
+
+        mesh_hierarchy->node_names.emplace_back(node->mName.C_Str());
+        mesh_hierarchy->node_parents.push_back(parent);
+        mesh_hierarchy->node_transformations.push_back(transformation);
+        mesh_hierarchy->node_rest_transformations.push_back(is_skeleton ? transformation : glm::mat4{1.0f});
+        bool parent_optional = parent != MeshHierarchy<VertexData>::NO_PARENT && mesh_hierarchy->node_optional[parent];
+        mesh_hierarchy->node_optional.push_back(parent_optional || is_detail_bone_name(node->mName.C_Str()));
+
         for (auto mesh_i = 0u; mesh_i < node->mNumMeshes; ++mesh_i) {
-            hierarchy_node.meshes.push_back(mesh_index_map[node->mMeshes[mesh_i]]);
+            const auto mesh = mesh_index_map.find(node->mMeshes[mesh_i]);
+            if (mesh != mesh_index_map.end()) {
+                mesh_hierarchy->draw_list.push_back({mesh->second, accumulated_transformation});
+            }
         }
-        const auto& bones = mesh_hierarchy->total_bones[node->mName.C_Str()];
-        hierarchy_node.bones.insert(hierarchy_node.bones.end(), bones.begin(), bones.end());
 
         const auto animation = animations.find(node->mName.C_Str());
         if (animation != animations.end()) {
-            for (const auto& [animation_id, node_animation]: animation->second) {
-                auto& animation_data = hierarchy_node.animation_data[animation_id];
+            for (const auto& [animation_id, channel_id, node_animation]: animation->second) {
+                // Gather the keys into maps, to sort them and drop duplicate times
+                auto& raw_channel = raw_animations[animation_id][channel_id];
+                raw_channel.node = node_i;
                 for (auto i = 0u; i < node_animation->mNumPositionKeys; ++i) {
                     const auto& key = node_animation->mPositionKeys[i];
-                    animation_data.positions[key.mTime] = glm::vec3{key.mValue.x, key.mValue.y, key.mValue.z};
+                    raw_channel.positions[key.mTime] = glm::vec3{key.mValue.x, key.mValue.y, key.mValue.z};
                 }
                 for (auto i = 0u; i < node_animation->mNumRotationKeys; ++i) {
                     const auto& key = node_animation->mRotationKeys[i];
-                    animation_data.rotations[key.mTime] = glm::quat{key.mValue.w, key.mValue.x, key.mValue.y, key.mValue.z};
+                    raw_channel.rotations[key.mTime] = glm::quat{key.mValue.w, key.mValue.x, key.mValue.y, key.mValue.z};
                 }
                 for (auto i = 0u; i < node_animation->mNumScalingKeys; ++i) {
                     const auto& key = node_animation->mScalingKeys[i];
-                    animation_data.scalings[key.mTime] = glm::vec3{key.mValue.x, key.mValue.y, key.mValue.z};
+                    raw_channel.scalings[key.mTime] = glm::vec3{key.mValue.x, key.mValue.y, key.mValue.z};
                 }
             }
         }
 
-        hierarchy_node.children.resize(node->mNumChildren);
-        for (auto child_i = 0u; child_i < node->mNumChildren; ++child_i) {
-            load_hierarchy_node(node->mChildren[child_i], hierarchy_node.children[child_i]);
+        // Pushed in reverse so that children are visited in file order
+        for (auto child_i = node->mNumChildren; child_i > 0; --child_i) {
+            pending_nodes.push_back({node->mChildren[child_i - 1], node_i, is_skeleton, accumulated_transformation});
         }
-    };
+    }
 
-    load_hierarchy_node(scene->mRootNode, mesh_hierarchy->root_node);
+    // Merge the spheres of every mesh, placed where they are drawn, into one around the whole hierarchy
+    glm::vec3 spheres_min{std::numeric_limits<float>::max()};
+    glm::vec3 spheres_max{std::numeric_limits<float>::lowest()};
+    for (const auto& draw: mesh_hierarchy->draw_list) {
+        glm::vec3 centre = draw.transformation * glm::vec4{mesh_spheres[draw.mesh].first, 1.0f};
+        spheres_min = glm::min(spheres_min, centre);
+        spheres_max = glm::max(spheres_max, centre);
+    }
+    if (!mesh_hierarchy->draw_list.empty()) {
+        mesh_hierarchy->bounding_centre = (spheres_min + spheres_max) * 0.5f;
+    }
+    for (const auto& draw: mesh_hierarchy->draw_list) {
+        const auto& [centre, radius] = mesh_spheres[draw.mesh];
+        glm::vec3 transformed_centre = draw.transformation * glm::vec4{centre, 1.0f};
+        float scale = std::max({glm::length(glm::vec3{draw.transformation[0]}), glm::length(glm::vec3{draw.transformation[1]}), glm::length(glm::vec3{draw.transformation[2]})});
+        mesh_hierarchy->bounding_radius = std::max(mesh_hierarchy->bounding_radius, glm::distance(mesh_hierarchy->bounding_centre, transformed_centre) + radius * scale);
+    }
+
+    for (auto animation_i = 0u; animation_i < raw_animations.size(); ++animation_i) {
+        auto& channels = raw_animations[animation_i];
+        // Drop any channels that target a node which doesn't exist
+        channels.erase(std::remove_if(channels.begin(), channels.end(), [](const RawAnimationChannel& channel) {
+            return channel.node == MeshHierarchy<VertexData>::NO_PARENT;
+        }), channels.end());
+
+        const auto& [name, ticks_per_second, duration_ticks] = mesh_hierarchy->animations[animation_i];
+        mesh_hierarchy->animation_clips.push_back(AnimationCompression::compress_clip(channels, ticks_per_second, animation_compression));
+
+        const auto& stats = mesh_hierarchy->animation_clips.back().stats;
+        std::cout << "Compressed animation \"" << name << "\" of (" << file << "): "
+                  << stats.raw_bytes / 1024.0 << " KiB -> " << stats.compressed_bytes / 1024.0 << " KiB, max error: "
+                  << stats.max_position_error << " (position), " << glm::degrees(stats.max_rotation_error) << " degrees (rotation), "
+                  << stats.max_scaling_error << " (scaling)" << std::endl;
+    }
+
+    compute_animation_bounds(*mesh_hierarchy);
 
     importer.FreeScene();
 
@@ -381,6 +511,146 @@ std::shared_ptr<MeshHierarchy<VertexData>> ModelLoader::load_hierarchy_from_file
     return mesh_hierarchy;
 }
 
+template<typename VertexData>
+std::shared_ptr<MeshHierarchy<VertexData>> ModelLoader::load_baked_hierarchy_from_file(const std::string& file) {
+    auto mesh_hierarchy = load_hierarchy_from_file<VertexData>(file);
+    // The bake is kept with the cached hierarchy, so it only happens once per import
+    if (mesh_hierarchy->vertex_animation == nullptr) {
+        mesh_hierarchy->vertex_animation = bake_vertex_animation(*mesh_hierarchy);
+    }
+    return mesh_hierarchy;
+}
+
+template<typename VertexData>
+std::shared_ptr<VertexAnimationTexture> ModelLoader::bake_vertex_animation(const MeshHierarchy<VertexData>& mesh_hierarchy) {
+    constexpr uint TEXELS_PER_VERTEX = VertexAnimationTexture::TEXELS_PER_VERTEX;
+
+    // Lay out the vertices of every draw one after the other
+    std::vector<uint> draw_vertex_offsets{};
+    uint vertex_count = 0;
+    for (const auto& draw: mesh_hierarchy.draw_list) {
+        draw_vertex_offsets.push_back(vertex_count);
+        vertex_count += (uint) mesh_hierarchy.meshes[draw.mesh].skinning_vertices.size();
+    }
+
+    // [frame] -> (animation_id, time_seconds) to sample, starting with the rest pose
+    std::vector<std::pair<uint, double>> frame_samples{{NONE_ANIMATION, 0.0}};
+    std::vector<BakedClip> clips{};
+    for (auto animation_i = 0u; animation_i < mesh_hierarchy.animations.size(); ++animation_i) {
+        const auto& [name, ticks_per_second, duration_ticks] = mesh_hierarchy.animations[animation_i];
+        auto duration_seconds = (float) (duration_ticks / ticks_per_second);
+
+        // Round to a whole number of frames, so that looping from the last frame back to the first takes the same time as any other frame
+        BakedClip clip{(uint) frame_samples.size(), std::max(1u, (uint) std::lround(duration_seconds * vertex_animation_rate)), 0.0f, duration_seconds};
+        const auto& clip_bounds = mesh_hierarchy.animation_clips[animation_i].bounds;
+        clip.set_position_box(clip_bounds.is_empty() ? mesh_hierarchy.rest_bounds : clip_bounds);
+        if (clip.frame_count > 1) {
+            clip.frames_per_second = (float) clip.frame_count / duration_seconds;
+        }
+        for (auto frame = 0u; frame < clip.frame_count; ++frame) {
+            frame_samples.emplace_back(animation_i, clip.frames_per_second > 0.0f ? frame / clip.frames_per_second : 0.0);
+        }
+        clips.push_back(clip);
+    }
+
+    BakedClip rest_clip{};
+    rest_clip.set_position_box(mesh_hierarchy.rest_bounds);
+
+    auto frame_count = (uint) frame_samples.size();
+    std::vector<uint64_t> texels((size_t) frame_count * vertex_count * TEXELS_PER_VERTEX);
+
+    job_system.parallel_for(frame_count, 1, [&](uint begin, uint end) {
+        AnimationPose pose{};
+        for (auto frame = begin; frame < end; ++frame) {
+            const auto& [animation_id, time_seconds] = frame_samples[frame];
+            mesh_hierarchy.calculate_animation(animation_id, time_seconds, pose);
+            const auto& clip = animation_id < clips.size() ? clips[animation_id] : rest_clip;
+
+            // The vertices are visited in the same order they are laid out in
+            auto* out = texels.data() + (size_t) frame * vertex_count * TEXELS_PER_VERTEX;
+            mesh_hierarchy.visit_skinned_vertices(pose, [&out, &clip](uint, const SkinningVertex& vertex, const glm::mat4& transform) {
+                glm::mat3 normal_matrix = glm::mat3(
+                    glm::cross(glm::vec3(transform[1]), glm::vec3(transform[2])),
+                    glm::cross(glm::vec3(transform[2]), glm::vec3(transform[0])),
+                    glm::cross(glm::vec3(transform[0]), glm::vec3(transform[1]))
+                );
+                glm::vec3 normal = normal_matrix * vertex.normal;
+                float normal_length = glm::length(normal);
+
+                out[0] = VertexAnimationTexture::pack_position(glm::vec3{transform * glm::vec4{vertex.position, 1.0f}}, clip);
+                out[1] = VertexAnimationTexture::pack_normal(normal_length > 0.0f ? normal / normal_length : normal);
+                out += VertexAnimationTexture::TEXELS_PER_VERTEX;
+            });
+        }
+    });
+
+    auto vertex_animation = std::make_shared<VertexAnimationTexture>(texels, vertex_count, frame_count, std::move(draw_vertex_offsets), std::move(clips), rest_clip);
+    std::cout << "Baked vertex animation of (" << mesh_hierarchy.filename.value_or("Generated Model") << "): "
+              << frame_count << " frames of " << vertex_count << " vertices, " << vertex_animation->memory_size() / (1024.0 * 1024.0) << " MiB" << std::endl;
+    return vertex_animation;
+}
+
+template<typename VertexData>
+void ModelLoader::compute_animation_bounds(MeshHierarchy<VertexData>& mesh_hierarchy) {
+    // Sampling can miss the very furthest a vertex reaches between two samples, so pad the boxes by a little to make up for it
+    constexpr float SAMPLING_PADDING = 0.02f;
+
+    struct BoundsSample {
+        uint animation_id;
+        double time_seconds;
+        // The segments of the clip this sample bounds, samples on the boundary between two segments count for both
+        uint first_segment;
+        uint last_segment;
+    };
+
+    // Every sample of every clip, starting with the rest pose, so they can all be spread across the threads at once
+    std::vector<BoundsSample> samples{{NONE_ANIMATION, 0.0, 0, 0}};
+    for (auto animation_i = 0u; animation_i < mesh_hierarchy.animations.size(); ++animation_i) {
+        const auto& [name, ticks_per_second, duration_ticks] = mesh_hierarchy.animations[animation_i];
+        double duration_seconds = duration_ticks / ticks_per_second;
+        uint segments = duration_seconds > 0.0 ? std::max(1u, animation_bounds_segments) : 1u;
+
+        // A whole number of samples per segment, so that the segment boundaries land on samples
+        auto samples_per_segment = (uint) std::max(1.0, std::ceil(duration_seconds * animation_bounds_rate / segments));
+        uint sample_count = segments * samples_per_segment;
+        for (auto sample_i = 0u; sample_i <= sample_count; ++sample_i) {
+            uint segment = std::min(sample_i / samples_per_segment, segments - 1);
+            bool on_boundary = sample_i % samples_per_segment == 0 && sample_i > 0 && sample_i < sample_count;
+            samples.push_back({animation_i, duration_seconds * sample_i / sample_count, on_boundary ? segment - 1 : segment, segment});
+        }
+        mesh_hierarchy.animation_clips[animation_i].segment_bounds.assign(segments, BoundingBox{});
+    }
+
+    std::vector<BoundingBox> sample_bounds(samples.size());
+    job_system.parallel_for((uint) samples.size(), 4, [&](uint begin, uint end) {
+        AnimationPose pose{};
+        for (auto sample_i = begin; sample_i < end; ++sample_i) {
+            mesh_hierarchy.calculate_animation(samples[sample_i].animation_id, samples[sample_i].time_seconds, pose);
+            auto& bounds = sample_bounds[sample_i];
+            mesh_hierarchy.visit_skinned_vertices(pose, [&bounds](uint, const SkinningVertex& vertex, const glm::mat4& transform) {
+                bounds.expand(glm::vec3{transform * glm::vec4{vertex.position, 1.0f}});
+            });
+        }
+    });
+
+    mesh_hierarchy.rest_bounds = sample_bounds[0];
+    for (auto sample_i = 1u; sample_i < samples.size(); ++sample_i) {
+        const auto& sample = samples[sample_i];
+        auto& clip = mesh_hierarchy.animation_clips[sample.animation_id];
+        clip.bounds.expand(sample_bounds[sample_i]);
+        for (auto segment = sample.first_segment; segment <= sample.last_segment; ++segment) {
+            clip.segment_bounds[segment].expand(sample_bounds[sample_i]);
+        }
+    }
+
+    for (auto& clip: mesh_hierarchy.animation_clips) {
+        clip.bounds.pad(SAMPLING_PADDING);
+        for (auto& bounds: clip.segment_bounds) {
+            bounds.pad(SAMPLING_PADDING);
+        }
+    }
+}
+
 template<typename VertexData>
 bool ModelLoader::add_imgui_model_selector(const std::string& caption, std::shared_ptr<ModelHandle<VertexData>>& model_handle) {
     std::string current_selection = model_handle->get_filename().value_or("Generated Model");
@@ -416,7 +686,7 @@ bool ModelLoader::add_imgui_model_selector(const std::string& caption, std::shar
 }
 
 template<typename VertexData>
-bool ModelLoader::add_imgui_hierarchy_selector(const std::string& caption, std::shared_ptr<MeshHierarchy<VertexData>>& mesh_hierarchy) {
+bool ModelLoader::add_imgui_hierarchy_selector(const std::string& caption, std::shared_ptr<MeshHierarchy<VertexData>>& mesh_hierarchy, bool baked) {
     std::string current_selection = mesh_hierarchy->filename.value_or("Generated Model");
 
     bool changed = false;
@@ -429,7 +699,7 @@ bool ModelLoader::add_imgui_hierarchy_selector(const std::string& caption, std::
             const bool is_selected = mesh_hierarchy->filename.has_value() && current_selection == model;
             if (ImGui::Selectable(model.c_str(), is_selected)) {
                 try {
-                    mesh_hierarchy = load_hierarchy_from_file<VertexData>(model);
+                    mesh_hierarchy = baked ? load_baked_hierarchy_from_file<VertexData>(model) : load_hierarchy_from_file<VertexData>(model);
                     changed = true;
                 } catch (const std::exception& e) {
                     std::cerr << "Error while trying to update model hierarchy file:" << std::endl;
@@ -0,0 +1,69 @@
+#include "VertexAnimationTexture.h"
+
+#include <stdexcept>
+
+#include <glad/gl.h>
+#include <glm/gtc/packing.hpp>
+
+void BakedClip::set_position_box(const BoundingBox& box) {
+    if (box.is_empty()) {
+        position_min = glm::vec3{0.0f};
+        position_extent = glm::vec3{0.0f};
+        return;
+    }
+    position_min = box.min;
+    position_extent = box.max - box.min;
+}
+
+VertexAnimationTexture::VertexAnimationTexture(const std::vector<uint64_t>& texels, uint vertex_count, uint frame_count, std::vector<uint> draw_vertex_offsets, std::vector<BakedClip> clips,
+                                               BakedClip rest_clip)
+    : vertex_count(vertex_count), frame_count(frame_count), draw_vertex_offsets(std::move(draw_vertex_offsets)), clips(std::move(clips)), rest_clip(rest_clip) {
+
+    int max_texels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texels);
+    if (texels.size() > (size_t) max_texels) {
+        throw std::runtime_error(Formatter() << "Failed to bake vertex animation: \n\t" << texels.size() << " texels is more than the limit of " << max_texels
+                                             << ", try a lower bake rate");
+    }
+
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, (long) (texels.size() * sizeof(uint64_t)), texels.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA16, buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+uint64_t VertexAnimationTexture::pack_position(const glm::vec3& position, const BakedClip& clip) {
+    glm::vec3 fraction{0.0f};
+    for (auto i = 0; i < 3; ++i) {
+        // The clip's box is sampled at a different rate to the bake, so could just miss a position
+        fraction[i] = clip.position_extent[i] > 0.0f ? glm::clamp((position[i] - clip.position_min[i]) / clip.position_extent[i], 0.0f, 1.0f) : 0.0f;
+    }
+    return glm::packUnorm4x16(glm::vec4{fraction, 0.0f});
+}
+
+uint64_t VertexAnimationTexture::pack_normal(const glm::vec3& normal) {
+    return glm::packUnorm4x16(glm::vec4{normal * 0.5f + 0.5f, 0.0f});
+}
+
+const BakedClip& VertexAnimationTexture::get_clip(uint animation_id) const {
+    return animation_id < clips.size() ? clips[animation_id] : rest_clip;
+}
+
+size_t VertexAnimationTexture::memory_size() const {
+    return (size_t) frame_count * vertex_count * TEXELS_PER_VERTEX * sizeof(uint64_t);
+}
+
+void VertexAnimationTexture::bind(uint texture_unit) const {
+    glActiveTexture(GL_TEXTURE0 + texture_unit);
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+}
+
+VertexAnimationTexture::~VertexAnimationTexture() {
+    glDeleteTextures(1, &texture);
+    glDeleteBuffers(1, &buffer);
+}
@@ -0,0 +1,72 @@
+#ifndef VERTEX_ANIMATION_TEXTURE_H
+#define VERTEX_ANIMATION_TEXTURE_H
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "utility/HelperTypes.h"
+#include "utility/Math.h"
+
+/// Where a clip's frames are in a VertexAnimationTexture, and how fast to play them
+struct BakedClip {
+    uint first_frame = 0;
+    uint frame_count = 1;
+    // 0 for a clip with a single frame
+    float frames_per_second = 0.0f;
+    float duration_seconds = 0.0f;
+    // The box the clip's positions are stored within, each component as a fraction of the way across it
+    glm::vec3 position_min{0.0f};
+    glm::vec3 position_extent{0.0f};
+
+    /// Store positions within a box, which should hold every position of the clip. Empty boxes store everything at their min
+    void set_position_box(const BoundingBox& box);
+};
+
+/// The skinned position and normal of every vertex of a MeshHierarchy, for every frame of every clip sampled at a fixed rate,
+/// so that the clips can be played back entirely in the vertex shader with no pose evaluation on the CPU.
+///
+/// Stored as a buffer texture of 16 bit normalised RGBA texels, 2 per vertex per frame (position then normal), frame after frame,
+/// so a vertex is at texel (frame * vertex_count + vertex) * TEXELS_PER_VERTEX.
+/// Positions are stored as fractions of the way across their clip's position box, so they are just as precise however far the model is from its origin,
+/// where half floats would step by 1/32 of a unit beyond 32 units. Normals are stored as normal * 0.5 + 0.5.
+/// Within a frame, the vertices of each entry of the hierarchy's draw_list follow one after the other,
+/// already transformed by the entry's transformation. Frame 0 is the rest pose, which is used when no clip is selected.
+class VertexAnimationTexture : private NonCopyable {
+    uint buffer = 0;
+    uint texture = 0;
+public:
+    static constexpr uint TEXELS_PER_VERTEX = 2;
+
+    // The number of vertices in each frame
+    uint vertex_count = 0;
+    uint frame_count = 0;
+    // [draw_id] -> where the vertices of the draw start within a frame
+    std::vector<uint> draw_vertex_offsets{};
+    // [animation_id] -> { Baked Clip }
+    std::vector<BakedClip> clips{};
+    // A single frame clip of the rest pose
+    BakedClip rest_clip{};
+
+    /// Upload the texels, which are 16 bit normalised RGBA (e.g. from pack_position and pack_normal).
+    /// Throws if there are too many for a buffer texture on this GPU.
+    VertexAnimationTexture(const std::vector<uint64_t>& texels, uint vertex_count, uint frame_count, std::vector<uint> draw_vertex_offsets, std::vector<BakedClip> clips,
+                           BakedClip rest_clip);
+
+    static uint64_t pack_position(const glm::vec3& position, const BakedClip& clip);
+    static uint64_t pack_normal(const glm::vec3& normal);
+
+    /// The clip for an animation_id, or the rest pose if the id is NONE_ANIMATION or out of range
+    [[nodiscard]] const BakedClip& get_clip(uint animation_id) const;
+
+    /// The memory used on the GPU, in bytes
+    [[nodiscard]] size_t memory_size() const;
+
+    /// Bind the buffer texture to the specified texture unit
+    void bind(uint texture_unit) const;
+
+    ~VertexAnimationTexture();
+};
+
+#endif //VERTEX_ANIMATION_TEXTURE_H
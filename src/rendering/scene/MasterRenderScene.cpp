@@ -2,10 +2,22 @@
 #include "rendering/renders/ParticleRenderer.h"
 #include "scene/editor_scene/ParticleEmitterElement.h"
 
+#include <chrono>
+#include <cstring>
+#include <functional>
+
+namespace {
+    // Coarse enough that a room's worth of geometry is a few megabytes, while particles still settle within a few centimetres of surfaces
+    constexpr float COLLISION_CELL_SIZE = 0.25f;
+    // How far from the surfaces distances are stored, particles further out than this skip collision after one lookup
+    constexpr float COLLISION_BAND = 1.0f;
+}
+
 void MasterRenderScene::use_camera(const CameraInterface& camera_interface) {
     entity_scene.global_data.use_camera(camera_interface);
     animated_entity_scene.global_data.use_camera(camera_interface);
     emissive_entity_scene.global_data.use_camera(camera_interface);
+    crowd_scene.global_data.use_camera(camera_interface);
 }
 
 void MasterRenderScene::insert_entity(std::shared_ptr<EntityRenderer::Entity> entity) {
@@ -20,6 +32,10 @@ void MasterRenderScene::insert_entity(std::shared_ptr<EmissiveEntityRenderer::En
     emissive_entity_scene.entities.insert(std::move(entity));
 }
 
+void MasterRenderScene::insert_entity(std::shared_ptr<CrowdRenderer::Entity> entity) {
+    crowd_scene.entities.insert(std::move(entity));
+}
+
 bool MasterRenderScene::remove_entity(const std::shared_ptr<EntityRenderer::Entity>& entity) {
     return entity_scene.entities.erase(entity) != 0;
 }
@@ -32,6 +48,10 @@ bool MasterRenderScene::remove_entity(const std::shared_ptr<EmissiveEntityRender
     return emissive_entity_scene.entities.erase(entity) != 0;
 }
 
+bool MasterRenderScene::remove_entity(const std::shared_ptr<CrowdRenderer::Entity>& entity) {
+    return crowd_scene.entities.erase(entity) != 0;
+}
+
 void MasterRenderScene::insert_light(std::shared_ptr<PointLight> point_light) {
     light_scene.point_lights.insert(std::move(point_light));
 }
@@ -84,6 +104,63 @@ void MasterRenderScene::remove_particle_system(EditorScene::ParticleEmitterEleme
     }
 }
 
+void MasterRenderScene::assign_particle_instance_ranges() {
+    if (particle_renderer) {
+        // The camera from the last frame, since this frame's isn't known until the scene has ticked
+        particle_renderer->assign_instance_ranges(particle_systems, entity_scene.global_data);
+    }
+}
+
+void MasterRenderScene::update_static_collision_field() {
+    if (static_collision_build.valid() && static_collision_build.wait_for(std::chrono::seconds{0}) == std::future_status::ready) {
+        static_collision_field = static_collision_build.get();
+        static_collision_signature = static_collision_build_signature;
+    }
+
+    // Summed so that it doesn't depend on the order of the set
+    size_t signature = entity_scene.entities.size();
+    for (const auto& entity: entity_scene.entities) {
+        size_t entity_signature = std::hash<const void*>{}(entity.get()) * 31 + std::hash<const void*>{}(entity->model.get());
+        const float* matrix = &entity->instance_data.model_matrix[0][0];
+        for (int i = 0; i < 16; ++i) {
+            uint32_t bits;
+            std::memcpy(&bits, &matrix[i], sizeof(bits));
+            entity_signature = entity_signature * 31 + bits;
+        }
+        signature += std::hash<size_t>{}(entity_signature);
+    }
+    // While a build is running, any later changes wait for it, so that dragging an entity doesn't queue up a build every frame
+    if (signature == static_collision_signature || static_collision_build.valid()) return;
+
+    // Only the models and where they are are copied here, the triangles are gathered in the background.
+    // The models' collision geometry is set once when they are loaded, so the build can read it while the entities change
+    std::vector<std::pair<std::shared_ptr<ModelHandle<EntityRenderer::VertexData>>, glm::mat4>> instances{};
+    instances.reserve(entity_scene.entities.size());
+    for (const auto& entity: entity_scene.entities) {
+        if (!entity->model) continue;
+        instances.emplace_back(entity->model, entity->instance_data.model_matrix);
+    }
+
+    static_collision_build_signature = signature;
+    static_collision_build = std::async(std::launch::async, [instances = std::move(instances), &job_system = collision_job_system]() {
+        std::vector<SignedDistanceField::Triangle> triangles{};
+        for (const auto& [model, model_matrix]: instances) {
+            const auto& positions = model->get_collision_positions();
+            const auto& indices = model->get_collision_indices();
+            for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+                triangles.push_back({
+                    glm::vec3{model_matrix * glm::vec4{positions[indices[i]], 1.0f}},
+                    glm::vec3{model_matrix * glm::vec4{positions[indices[i + 1]], 1.0f}},
+                    glm::vec3{model_matrix * glm::vec4{positions[indices[i + 2]], 1.0f}}
+                });
+            }
+        }
+        SignedDistanceField field{};
+        field.build(triangles, COLLISION_CELL_SIZE, COLLISION_BAND, job_system);
+        return field;
+    });
+}
+
 const std::vector<std::shared_ptr<EditorScene::ParticleEmitterElement>>& MasterRenderScene::get_particle_systems() const {
     return particle_systems;
 }
@@ -10,12 +10,16 @@
 #include "rendering/renders/EntityRenderer.h"
 #include "rendering/renders/AnimatedEntityRenderer.h"
 #include "rendering/renders/EmissiveEntityRenderer.h"
+#include "rendering/renders/CrowdRenderer.h"
+#include "utility/SignedDistanceField.h"
+#include "utility/JobSystem.h"
 
 namespace EditorScene { class ParticleEmitterElement; }
 namespace ParticleRenderer { class ParticleRenderer; }
 
 #include <vector>
 #include <memory>
+#include <future>
 #include <algorithm>
 #include <unordered_map>
 
@@ -26,6 +30,7 @@ class MasterRenderScene {
     EntityRenderer::RenderScene entity_scene{};
     AnimatedEntityRenderer::RenderScene animated_entity_scene{};
     EmissiveEntityRenderer::RenderScene emissive_entity_scene{};
+    CrowdRenderer::RenderScene crowd_scene{};
     std::unique_ptr<ParticleRenderer::ParticleRenderer> particle_renderer;
 
     LightScene light_scene{};
@@ -34,6 +39,15 @@ class MasterRenderScene {
     // A unique_ptr to shared_ptr mapping to help with lifetime management
     std::unordered_map<EditorScene::ParticleEmitterElement*, std::shared_ptr<EditorScene::ParticleEmitterElement>> particle_system_references;
 
+    // Around the entity_scene's models, for particles to collide with, and what the entities were when it was built
+    SignedDistanceField static_collision_field{};
+    size_t static_collision_signature = 0;
+    // Rebuilds of the static collision field run off the main thread, on their own workers so that they don't hold up the frame's
+    // parallel_for calls, and are swapped in once they're done. Declared in this order so the build is waited for before its workers stop
+    JobSystem collision_job_system{std::max(1u, JobSystem::default_worker_count() / 2)};
+    std::future<SignedDistanceField> static_collision_build{};
+    size_t static_collision_build_signature = 0;
+
 public:
     MasterRenderScene();
     ~MasterRenderScene();
@@ -43,10 +57,12 @@ public:
     void insert_entity(std::shared_ptr<EntityRenderer::Entity> entity);
     void insert_entity(std::shared_ptr<AnimatedEntityRenderer::Entity> entity);
     void insert_entity(std::shared_ptr<EmissiveEntityRenderer::Entity> entity);
+    void insert_entity(std::shared_ptr<CrowdRenderer::Entity> entity);
 
     bool remove_entity(const std::shared_ptr<EntityRenderer::Entity>& entity);
     bool remove_entity(const std::shared_ptr<AnimatedEntityRenderer::Entity>& entity);
     bool remove_entity(const std::shared_ptr<EmissiveEntityRenderer::Entity>& entity);
+    bool remove_entity(const std::shared_ptr<CrowdRenderer::Entity>& entity);
 
     void insert_light(std::shared_ptr<PointLight> point_light);
     void insert_light(std::shared_ptr<DirectionalLight> directional_light); // Task H - Directional Light Element
@@ -58,12 +74,20 @@ public:
     void add_particle_system(EditorScene::ParticleEmitterElement* system);
     void remove_particle_system(EditorScene::ParticleEmitterElement* system);
     const std::vector<std::shared_ptr<EditorScene::ParticleEmitterElement>>& get_particle_systems() const; // Getter for EditorScene to tick particles
+    void assign_particle_instance_ranges(); // Must be called before ticking particles, so each system knows where to write its particles
+
+    /// Start rebuilding the static collision field in the background if the entity_scene's entities, their models, or where they are,
+    /// have changed since it was last built, and swap in the last rebuild if it has finished. Until then the old field stays in use.
+    /// When nothing has changed, this is only a pass over the entities
+    void update_static_collision_field();
+    [[nodiscard]] const SignedDistanceField& get_static_collision_field() const { return static_collision_field; }
     
     // Clear all entities, lights, and particles
     void clear() {
         entity_scene.entities.clear();
         animated_entity_scene.entities.clear();
         emissive_entity_scene.entities.clear();
+        crowd_scene.entities.clear();
         light_scene.point_lights.clear();
         particle_systems.clear();
     }
@@ -33,6 +33,7 @@ struct AnimatedEntityInterface {
     [[nodiscard]] virtual uint& get_animation_id() = 0;
     [[nodiscard]] virtual double& get_animation_time_seconds() = 0;
     [[nodiscard]] virtual double get_animation_duration_seconds() const = 0;
+    [[nodiscard]] virtual const AnimationClipStats& get_animation_stats(uint animation_id) const = 0;
     virtual ~AnimatedEntityInterface() = default;
 };
 
@@ -46,6 +47,8 @@ struct AnimatedRenderedEntity : public AnimatedEntityInterface {
     // Animation Data
     uint animation_id = NONE_ANIMATION; // NONE_ANIMATION means disabled
     double animation_time_seconds = 0.0;
+    // The output of the animation, owned per instance since the mesh_hierarchy is shared
+    AnimationPose animation_pose{};
 
     AnimatedRenderedEntity(const std::shared_ptr<MeshHierarchy<VertexData>>& mesh_hierarchy, InstanceData instance_data, RenderData render_data);
 
@@ -70,6 +73,10 @@ struct AnimatedRenderedEntity : public AnimatedEntityInterface {
         const auto& [animation_name, ticks_per_second, duration_ticks] = mesh_hierarchy->animations[animation_id];
         return duration_ticks / ticks_per_second;
     }
+
+    [[nodiscard]] const AnimationClipStats& get_animation_stats(uint animation_id) const override {
+        return mesh_hierarchy->animation_clips.at(animation_id).stats;
+    }
 };
 
 template<typename VertexData, typename InstanceData, typename RenderData>
@@ -1,5 +1,7 @@
 #include "EditorScene.h"
 
+#include <algorithm>
+
 #include <tinyfiledialogs/tinyfiledialogs.h>
 
 #include "rendering/imgui/ImGuiManager.h"
@@ -8,6 +10,7 @@
 
 #include "editor_scene/EntityElement.h"
 #include "editor_scene/AnimatedEntityElement.h"
+#include "editor_scene/CrowdElement.h"
 #include "editor_scene/EmissiveEntityElement.h"
 #include "editor_scene/PointLightElement.h"
 #include "editor_scene/DirectionalLightElement.h"  // Task H - Directional Light Element
@@ -53,8 +56,8 @@ void EditorScene::EditorScene::open(const SceneContext& scene_context) {
         )
     );
 
-    /// Update the transform, to propagate the position, rotation, scale, etc.. from the SceneElement to the actual Entity
-    plane->update_instance_data();
+    /// Queue the transform to be updated, to propagate the position, rotation, scale, etc.. from the SceneElement to the actual Entity
+    plane->mark_dirty();
     /// Add the SceneElement to the render scene, and add to the root of the tree
     plane->add_to_render_scene(render_scene);
     scene_root->push_back(std::move(plane));
@@ -85,8 +88,8 @@ void EditorScene::EditorScene::open(const SceneContext& scene_context) {
         )
     );
 
-    /// Update the transform, to propagate the position, rotation, scale, etc.. from the SceneElement to the actual Entity
-    default_light->update_instance_data();
+    /// Set the local transform from the position, the light and its sphere are then brought along by the first tick
+    default_light->update_local_transform();
     /// Add the SceneElement to the render scene, and add to the root of the tree
     default_light->add_to_render_scene(render_scene);
     scene_root->push_back(std::move(default_light));
@@ -97,6 +100,7 @@ void EditorScene::EditorScene::open(const SceneContext& scene_context) {
     entity_generators = {
         {EntityElement::ELEMENT_TYPE_NAME,         [](const SceneContext& scene_context, ElementRef parent) { return EntityElement::new_default(scene_context, parent); }},
         {AnimatedEntityElement::ELEMENT_TYPE_NAME, [](const SceneContext& scene_context, ElementRef parent) { return AnimatedEntityElement::new_default(scene_context, parent); }},
+        {CrowdElement::ELEMENT_TYPE_NAME,          [](const SceneContext& scene_context, ElementRef parent) { return CrowdElement::new_default(scene_context, parent); }},
         {EmissiveEntityElement::ELEMENT_TYPE_NAME, [](const SceneContext& scene_context, ElementRef parent) { return EmissiveEntityElement::new_default(scene_context, parent); }},
         {ParticleEmitterElement::ELEMENT_TYPE_NAME, [](const SceneContext& scene_context, ElementRef parent) { return ParticleEmitterElement::new_default(scene_context, parent); }},
     };
@@ -111,6 +115,7 @@ void EditorScene::EditorScene::open(const SceneContext& scene_context) {
     json_generators = {
         {EntityElement::ELEMENT_TYPE_NAME,         [](const SceneContext& scene_context, ElementRef parent, const json& j) { return EntityElement::from_json(scene_context, parent, j); }},
         {AnimatedEntityElement::ELEMENT_TYPE_NAME, [](const SceneContext& scene_context, ElementRef parent, const json& j) { return AnimatedEntityElement::from_json(scene_context, parent, j); }},
+        {CrowdElement::ELEMENT_TYPE_NAME,          [](const SceneContext& scene_context, ElementRef parent, const json& j) { return CrowdElement::from_json(scene_context, parent, j); }},
         {EmissiveEntityElement::ELEMENT_TYPE_NAME, [](const SceneContext& scene_context, ElementRef parent, const json& j) { return EmissiveEntityElement::from_json(scene_context, parent, j); }},
         {PointLightElement::ELEMENT_TYPE_NAME,     [](const SceneContext& scene_context, ElementRef parent, const json& j) { return PointLightElement::from_json(scene_context, parent, j); }},
         {DirectionalLightElement::ELEMENT_TYPE_NAME, [](const SceneContext& scene_context, ElementRef parent, const json& j) { return DirectionalLightElement::from_json(scene_context, parent, j); }},  // Task H - Directional Light Element
@@ -143,12 +148,30 @@ std::pair<TickResponseType, std::shared_ptr<SceneInterface>> EditorScene::Editor
         add_imgui_scene_hierarchy(scene_context);
     }
 
-    // Particle systems
-    for (const auto& particle_system : render_scene.get_particle_systems()) {
-        if (particle_system && particle_system->enabled) {
-            particle_system->tick_particles(delta_time, scene_context);
-        }
+    // Everything edited this frame, however many times, is brought up to date in one pass, before anything reads the transforms
+    SceneElement::components().propagate(scene_context.job_system);
+
+    // Particle systems, each emitter only touches its own state and its own range of the instance buffer,
+    // so they can all be ticked at once
+    const auto& particle_systems = render_scene.get_particle_systems();
+    render_scene.assign_particle_instance_ranges();
+    // Only kept up to date while something collides with it, and then only rebuilt, in the background, when the static entities change
+    bool any_collision = std::any_of(particle_systems.begin(), particle_systems.end(), [](const auto& particle_system) {
+        return particle_system && particle_system->enabled && particle_system->collideWithScene && !particle_system->gpuSimulation;
+    });
+    const SignedDistanceField* collision_field = nullptr;
+    if (any_collision) {
+        render_scene.update_static_collision_field();
+        collision_field = &render_scene.get_static_collision_field();
     }
+    scene_context.job_system.parallel_for((uint) particle_systems.size(), 1, [&](uint begin, uint end) {
+        for (auto i = begin; i < end; ++i) {
+            const auto& particle_system = particle_systems[i];
+            if (particle_system && particle_system->enabled) {
+                particle_system->tick_particles(delta_time, scene_context.job_system, collision_field);
+            }
+        }
+    });
 
     /// Default to telling the SceneManager to continue ticking
     return {TickResponseType::Continue, nullptr};
@@ -210,8 +233,8 @@ void EditorScene::EditorScene::add_imgui_selection_editor(const SceneContext& sc
             /// Adds the SceneElements custom property editors
             (*selected_element)->add_imgui_edit_section(render_scene, scene_context);
 
-            // For AnimatedEntityElement, it has an additional section for animation controls.
-            auto* animated_selected_element = dynamic_cast<AnimatedEntityElement*>(selected_element->get());
+            // For animated elements (AnimatedEntityElement and CrowdElement), there is an additional section for animation controls.
+            auto* animated_selected_element = dynamic_cast<AnimationComponent*>(selected_element->get());
             if (animated_selected_element != nullptr) {
                 // add_imgui_edit_section was already called by the generic call above.
                 // Now call its animation-specific UI.
@@ -317,7 +340,7 @@ void EditorScene::EditorScene::add_imgui_scene_hierarchy(const SceneContext& sce
                 "New Group"
             );
 
-            new_group->update_instance_data();
+            new_group->mark_dirty();
             selected_element = list->insert(insert_at, std::move(new_group));
         }
 
@@ -431,27 +454,33 @@ void EditorScene::EditorScene::add_imgui_scene_hierarchy(const SceneContext& sce
         bool shift_is_pressed = scene_context.window.is_key_pressed(GLFW_KEY_LEFT_SHIFT) || scene_context.window.is_key_pressed(GLFW_KEY_RIGHT_SHIFT);
 
         if (ImGui::Button("Open (Ctrl + O)") || (scene_context.window.was_key_pressed(GLFW_KEY_O) && ctrl_is_pressed && !shift_is_pressed)) {
-            load_from_json_file(scene_context);
+            load_from_file(scene_context);
         }
 
         ImGui::SameLine();
 
         if (ImGui::Button("Save (Ctrl + S)") || (scene_context.window.was_key_pressed(GLFW_KEY_S) && ctrl_is_pressed && !shift_is_pressed)) {
-            save_to_json_file();
+            save_to_file();
         }
 
         ImGui::SameLine();
 
         if (ImGui::Button("Save As (Ctrl + Shift + S)") || (scene_context.window.was_key_pressed(GLFW_KEY_S) && ctrl_is_pressed && shift_is_pressed)) {
-            const char* filter = "*.json";
+            const char* filters[] = {"*.json", "*.scene"};
             const auto init_path = (std::filesystem::current_path() / "scene.json").string();
-            const char* path = tinyfd_saveFileDialog("Save Scene", init_path.c_str(), 1, &filter, "Json Files");
+            const char* path = tinyfd_saveFileDialog("Save Scene", init_path.c_str(), 2, filters, "Scene Files (.json, or .scene for binary)");
             if (path != nullptr) {
                 save_path = path;
-                save_to_json_file();
+                save_to_file();
             }
         }
 
+        if (ImGui::Button("Convert Json <-> Binary")) {
+            convert_scene_file();
+        }
+        ImGui::SameLine();
+        ImGui::HelpMarker("Converts a scene file to the other format without opening it. Json is easier to diff, binary (.scene) loads much faster");
+
         if (save_path.has_value()) {
             ImGui::InputText("File Path", &save_path.value(), ImGuiInputTextFlags_ReadOnly);
             scene_context.window.set_title_suffix(Formatter() << "Open File: [" << save_path.value() << "]");
@@ -492,7 +521,7 @@ void EditorScene::EditorScene::visit_children_and_root(ElementRef root, const st
     }
 }
 
-json EditorScene::EditorScene::element_to_labelled_json(const SceneElement& element) {
+json EditorScene::EditorScene::element_to_labelled_json_without_children(const SceneElement& element) {
     json j = element.into_json();
     j["label"] = element.element_type_name();
     element.store_json(j);
@@ -502,6 +531,12 @@ json EditorScene::EditorScene::element_to_labelled_json(const SceneElement& elem
         std::cerr << j["error"] << std::endl;
     }
 
+    return j;
+}
+
+json EditorScene::EditorScene::element_to_labelled_json(const SceneElement& element) {
+    json j = element_to_labelled_json_without_children(element);
+
     auto children = element.get_children();
     if (children != nullptr) {
         json children_json = json::array();
@@ -516,11 +551,11 @@ json EditorScene::EditorScene::element_to_labelled_json(const SceneElement& elem
     return j;
 }
 
-void EditorScene::EditorScene::add_labelled_json_element(const SceneContext& scene_context, ElementRef parent, const ElementList& list, const json& j) {
+EditorScene::ElementRef EditorScene::EditorScene::add_element_from_json(const SceneContext& scene_context, ElementRef parent, const ElementList& list, const json& j) {
     if (j.contains("error")) {
         std::cerr << "Unable to load element due to error, so skipping. Error:" << std::endl;
         std::cerr << j["error"] << std::endl;
-        return;
+        return NullElementRef;
     }
 
     std::string label = j["label"];
@@ -528,19 +563,22 @@ void EditorScene::EditorScene::add_labelled_json_element(const SceneContext& sce
     auto gen = json_generators.find(label);
     if (gen == json_generators.end()) {
         std::cerr << "No generator for label: [" << label << "]" << std::endl;
-        return;
+        return NullElementRef;
     }
 
-    ElementRef ref;
-    {
-        auto element = gen->second(scene_context, parent, j);
-        element->load_json(j);
+    auto element = gen->second(scene_context, parent, j);
+    element->load_json(j);
 
-        element->add_to_render_scene(render_scene);
-        list->push_back(std::move(element));
-        ref = list->end();
-        ref--;
-    }
+    element->add_to_render_scene(render_scene);
+    list->push_back(std::move(element));
+    ElementRef ref = list->end();
+    ref--;
+    return ref;
+}
+
+void EditorScene::EditorScene::add_labelled_json_element(const SceneContext& scene_context, ElementRef parent, const ElementList& list, const json& j) {
+    ElementRef ref = add_element_from_json(scene_context, parent, list, j);
+    if (is_null(ref)) return;
 
     if (j.contains("children")) {
         for (const auto& child: j["children"]) {
@@ -549,13 +587,73 @@ void EditorScene::EditorScene::add_labelled_json_element(const SceneContext& sce
     }
 }
 
-void EditorScene::EditorScene::save_to_json_file() {
+void EditorScene::EditorScene::element_to_binary(SceneBinary::Writer& writer, const SceneElement& element) {
+    auto children = element.get_children();
+    writer.begin_element(element_to_labelled_json_without_children(element), children != nullptr);
+    if (children != nullptr) {
+        for (auto& child: *children) {
+            element_to_binary(writer, *child);
+        }
+    }
+    writer.end_element();
+}
+
+void EditorScene::EditorScene::add_binary_element(const SceneContext& scene_context, ElementRef parent, const ElementList& list, const SceneBinary::Reader& reader, size_t offset) {
+    auto header = reader.element_header(offset);
+    if (header.child_count > 0 && !(header.flags & SceneBinary::HAS_CHILDREN)) {
+        throw std::runtime_error("Binary scene element has children but can't have any");
+    }
+
+    // Only this element's remaining properties are decoded as json, and its children after it's built,
+    // so the json is only ever for one element at a time
+    ElementRef ref = add_element_from_json(scene_context, parent, list, reader.element_properties_json(offset));
+    if (is_null(ref)) return;
+
+    // The blocks go straight into the ComponentStore, over the defaults from_json left in place without them
+    auto& store = SceneElement::components();
+    ElementId id = (*ref)->id;
+    auto blocks = reader.element_blocks(offset);
+    if (blocks.transform.has_value()) {
+        if (!store.uses_trs(id)) {
+            throw std::runtime_error(Formatter() << "Binary scene element has a transform its type doesn't use: " << (*ref)->element_type_name());
+        }
+        const auto& transform = blocks.transform.value();
+        store.position(id) = transform.position;
+        store.euler_rotation(id) = transform.euler_rotation;
+        store.scale(id) = transform.scale;
+    }
+    if (blocks.lit_material.has_value()) {
+        if (!store.has_lit_material(id)) {
+            throw std::runtime_error(Formatter() << "Binary scene element has a material its type doesn't use: " << (*ref)->element_type_name());
+        }
+        const auto& block = blocks.lit_material.value();
+        auto& material = store.lit_material(id);
+        material.diffuse_tint = block.diffuse_tint;
+        material.specular_tint = block.specular_tint;
+        material.ambient_tint = block.ambient_tint;
+        material.shininess = block.shininess;
+        material.texture_scale = block.texture_scale;
+    }
+    (*ref)->mark_dirty();
+
+    ElementList children = (*ref)->get_children();
+    if (header.child_count > 0 && children == nullptr) {
+        throw std::runtime_error(Formatter() << "Binary scene element has children but its type can't have any: " << (*ref)->element_type_name());
+    }
+    size_t child = reader.first_child(offset);
+    for (auto i = 0u; i < header.child_count; ++i) {
+        add_binary_element(scene_context, ref, children, reader, child);
+        child += reader.element_header(child).subtree_size;
+    }
+}
+
+void EditorScene::EditorScene::save_to_file() {
     auto old_path = save_path;
 
     if (!save_path.has_value()) {
-        const char* filter = "*.json";
+        const char* filters[] = {"*.json", "*.scene"};
         const auto init_path = (std::filesystem::current_path() / "scene.json").string();
-        const char* path = tinyfd_saveFileDialog("Save Scene", init_path.c_str(), 1, &filter, "Json Files");
+        const char* path = tinyfd_saveFileDialog("Save Scene", init_path.c_str(), 2, filters, "Scene Files (.json, or .scene for binary)");
         if (path == nullptr) return;
         save_path = path;
     }
@@ -570,16 +668,28 @@ void EditorScene::EditorScene::save_to_json_file() {
     }
 
     try {
-        json j = json::array();
+        std::filesystem::create_directories(std::filesystem::path(save_path.value()).parent_path());
 
-        for (auto& iter: *scene_root) {
-            j.push_back(element_to_labelled_json(*iter));
-        }
+        if (std::filesystem::path(save_path.value()).extension() == SceneBinary::FILE_EXTENSION) {
+            SceneBinary::Writer writer{};
+            for (auto& iter: *scene_root) {
+                element_to_binary(writer, *iter);
+            }
 
-        std::filesystem::create_directories(std::filesystem::path(save_path.value()).parent_path());
-        std::ofstream file(save_path.value());
-        file << j.dump(4);
-        file.flush();
+            std::ofstream file(save_path.value(), std::ios::binary);
+            writer.write_to(file);
+            file.flush();
+        } else {
+            json j = json::array();
+
+            for (auto& iter: *scene_root) {
+                j.push_back(element_to_labelled_json(*iter));
+            }
+
+            std::ofstream file(save_path.value());
+            file << j.dump(4);
+            file.flush();
+        }
     } catch (const std::exception& e) {
         if (std::filesystem::exists(save_path.value())) {
             std::filesystem::remove(save_path.value());
@@ -601,7 +711,7 @@ void EditorScene::EditorScene::save_to_json_file() {
     }
 }
 
-void EditorScene::EditorScene::load_from_json_file(const SceneContext& scene_context) {
+void EditorScene::EditorScene::load_from_file(const SceneContext& scene_context) {
     const auto init_path = (std::filesystem::current_path() / "scene.json").string();
 
 #ifdef __APPLE__
@@ -610,8 +720,8 @@ void EditorScene::EditorScene::load_from_json_file(const SceneContext& scene_con
 
     const char* path = tinyfd_openFileDialog("Open Scene", init_path.c_str(), 0, nullptr, nullptr, false);
 #else
-    const char* filter = "*.json";
-    const char* path = tinyfd_openFileDialog("Open Scene", init_path.c_str(), 1, &filter, "Json Files", false);
+    const char* filters[] = {"*.json", "*.scene"};
+    const char* path = tinyfd_openFileDialog("Open Scene", init_path.c_str(), 2, filters, "Scene Files", false);
 #endif
 
     if (path == nullptr) return;
@@ -631,15 +741,21 @@ void EditorScene::EditorScene::load_from_json_file(const SceneContext& scene_con
     try {
         selected_element = NullElementRef;
 
-        std::ifstream f(save_path.value());
-        json data = json::parse(f);
-
-        for (const auto& item: data) {
-            add_labelled_json_element(scene_context, NullElementRef, scene_root, item);
-        }
+        // Told apart by their contents rather than their extension, so either loads whatever it's called
+        if (SceneBinary::Reader::is_binary_file(save_path.value())) {
+            auto reader = SceneBinary::Reader::from_file(save_path.value());
+            size_t offset = reader.first_root();
+            for (auto i = 0u; i < reader.get_root_count(); ++i) {
+                add_binary_element(scene_context, NullElementRef, scene_root, reader, offset);
+                offset += reader.element_header(offset).subtree_size;
+            }
+        } else {
+            std::ifstream f(save_path.value());
+            json data = json::parse(f);
 
-        for (auto& item: *scene_root) {
-            item->update_instance_data();
+            for (const auto& item: data) {
+                add_labelled_json_element(scene_context, NullElementRef, scene_root, item);
+            }
         }
     } catch (const std::exception& e) {
         std::swap(save_path, old_path);
@@ -664,3 +780,34 @@ void EditorScene::EditorScene::load_from_json_file(const SceneContext& scene_con
         tinyfd_messageBox("Failed to open File", "See Console For Error", "ok", "error", 1);
     }
 }
+
+void EditorScene::EditorScene::convert_scene_file() {
+    const auto init_path = (std::filesystem::current_path() / "scene.json").string();
+#ifdef __APPLE__
+    // See load_from_file
+    const char* from = tinyfd_openFileDialog("Convert Scene", init_path.c_str(), 0, nullptr, nullptr, false);
+#else
+    const char* filters[] = {"*.json", "*.scene"};
+    const char* from = tinyfd_openFileDialog("Convert Scene", init_path.c_str(), 2, filters, "Scene Files", false);
+#endif
+    if (from == nullptr) return;
+    // The dialogs reuse their buffer, so the first path needs copying before the second dialog
+    std::filesystem::path from_path = from;
+
+    bool to_binary = !SceneBinary::Reader::is_binary_file(from_path);
+    std::filesystem::path suggested = from_path;
+    suggested.replace_extension(to_binary ? SceneBinary::FILE_EXTENSION : ".json");
+    const char* to_filter = to_binary ? "*.scene" : "*.json";
+    const char* to = tinyfd_saveFileDialog("Save Converted Scene", suggested.string().c_str(), 1, &to_filter, to_binary ? "Binary Scene Files" : "Json Files");
+    if (to == nullptr) return;
+
+    try {
+        SceneBinary::convert_file(from_path, to);
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to convert file: [" << from_path.string() << "]" << std::endl;
+        std::cerr << "Error:" << std::endl;
+        std::cerr << e.what() << std::endl;
+
+        tinyfd_messageBox("Failed to convert File", "See Console For Error", "ok", "error", 1);
+    }
+}
@@ -8,6 +8,7 @@
 #include <utility>
 
 #include "editor_scene/SceneElement.h"
+#include "editor_scene/SceneBinary.h"
 #include "scene/SceneContext.h"
 
 /// A namespace for all the things related to the EditorScene, since it's rather complicated
@@ -77,9 +78,22 @@ namespace EditorScene {
         [[nodiscard]] static json element_to_labelled_json(const SceneElement& element);
         void add_labelled_json_element(const SceneContext& scene_context, ElementRef parent, const ElementList& list, const json& j);
 
-        /// Main save/load calls, which use the current save_path or pop-up a native file dialog
-        void save_to_json_file();
-        void load_from_json_file(const SceneContext& scene_context);
+        /// The same for the binary scene files, which go through the same json one element at a time, see SceneBinary
+        static void element_to_binary(SceneBinary::Writer& writer, const SceneElement& element);
+        void add_binary_element(const SceneContext& scene_context, ElementRef parent, const ElementList& list, const SceneBinary::Reader& reader, size_t offset);
+
+        /// Builds one element from its labelled json, ignoring any children, and adds it to the render scene and list.
+        /// Returns NullElementRef if the element was skipped, in which case so should its children be
+        ElementRef add_element_from_json(const SceneContext& scene_context, ElementRef parent, const ElementList& list, const json& j);
+        /// The labelled json of just the element, without its children
+        [[nodiscard]] static json element_to_labelled_json_without_children(const SceneElement& element);
+
+        /// Main save/load calls, which use the current save_path or pop-up a native file dialog.
+        /// Paths ending in SceneBinary::FILE_EXTENSION are saved as binary, anything else as json, and either loads
+        void save_to_file();
+        void load_from_file(const SceneContext& scene_context);
+        /// Pops up native file dialogs for a scene file and where to put it, and converts it between json and binary, without loading it
+        static void convert_scene_file();
     };
 }
 
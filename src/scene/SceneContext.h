@@ -4,6 +4,7 @@
 #include "system_interfaces/WindowManager.h"
 #include "rendering/resources/TextureLoader.h"
 #include "rendering/resources/ModelLoader.h"
+#include "utility/JobSystem.h"
 
 /// Definition of the struct that is a collection of things a scene needs
 struct SceneContext {
@@ -11,6 +12,7 @@ struct SceneContext {
     WindowManager& window_manager;
     ModelLoader& model_loader;
     TextureLoader& texture_loader;
+    JobSystem& job_system;
     bool imgui_enabled;
 };
 
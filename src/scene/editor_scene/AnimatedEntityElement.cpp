@@ -30,7 +30,7 @@ std::unique_ptr<EditorScene::AnimatedEntityElement> EditorScene::AnimatedEntityE
         rendered_entity
     );
 
-    new_entity->update_instance_data();
+    new_entity->mark_dirty();
     return new_entity;
 }
 
@@ -44,8 +44,7 @@ std::unique_ptr<EditorScene::AnimatedEntityElement> EditorScene::AnimatedEntityE
     new_entity->rendered_entity->render_data.diffuse_texture = texture_from_json(scene_context, j["diffuse_texture"]);
     new_entity->rendered_entity->render_data.specular_map_texture = texture_from_json(scene_context, j["specular_map_texture"]);
     
-    new_entity->material.texture_scale = j["texture_scale"]; // Task E
-    new_entity->rendered_entity->instance_data.material.texture_scale = new_entity->material.texture_scale;
+    new_entity->material().texture_scale = j["texture_scale"]; // Task E
 
     json animation_parameters = j["animation_parameters"];
     new_entity->animation_parameters.animation_id = animation_parameters["animation_id"];
@@ -55,7 +54,7 @@ std::unique_ptr<EditorScene::AnimatedEntityElement> EditorScene::AnimatedEntityE
     new_entity->rendered_entity->animation_id = animation_parameters["animation_id"];
     new_entity->rendered_entity->animation_time_seconds = animation_parameters["animation_time_seconds"];
 
-    new_entity->update_instance_data();
+    new_entity->mark_dirty();
     return new_entity;
 }
 
@@ -72,7 +71,7 @@ json EditorScene::AnimatedEntityElement::into_json() const {
         {"model", rendered_entity->mesh_hierarchy->filename.value()},
         {"diffuse_texture", texture_to_json(rendered_entity->render_data.diffuse_texture)},
         {"specular_map_texture", texture_to_json(rendered_entity->render_data.specular_map_texture)},
-        {"texture_scale", rendered_entity->instance_data.material.texture_scale}, // Task E
+        {"texture_scale", material().texture_scale}, // Task E
         {"animation_parameters", {
             {"animation_id", animation_parameters.animation_id},
             {"speed", animation_parameters.speed},
@@ -91,24 +90,26 @@ void EditorScene::AnimatedEntityElement::add_imgui_edit_section(MasterRenderScen
     
     // Material Properties
     ImGui::Text("Material Properties");
+    auto& material = this->material();
+    bool material_changed = false;
     
     // Diffuse properties
     ImGui::Text("Diffuse");
-    ImGui::ColorEdit3("Diffuse Color", &rendered_entity->instance_data.material.diffuse_tint[0]);
-    ImGui::DragFloat("Diffuse Intensity", &rendered_entity->instance_data.material.diffuse_tint.a, 0.01f, 0.0f, 1.0f);
+    material_changed |= ImGui::ColorEdit3("Diffuse Color", &material.diffuse_tint[0]);
+    material_changed |= ImGui::DragFloat("Diffuse Intensity", &material.diffuse_tint.a, 0.01f, 0.0f, 1.0f);
     ImGui::Spacing();
 
     // Specular properties
     ImGui::Text("Specular");
-    ImGui::ColorEdit3("Specular Color", &rendered_entity->instance_data.material.specular_tint[0]);
-    ImGui::DragFloat("Specular Intensity", &rendered_entity->instance_data.material.specular_tint.a, 0.01f, 0.0f, 1.0f);
-    ImGui::DragFloat("Shininess", &rendered_entity->instance_data.material.shininess, 1.0f, 0.0f, 150.0f);
+    material_changed |= ImGui::ColorEdit3("Specular Color", &material.specular_tint[0]);
+    material_changed |= ImGui::DragFloat("Specular Intensity", &material.specular_tint.a, 0.01f, 0.0f, 1.0f);
+    material_changed |= ImGui::DragFloat("Shininess", &material.shininess, 1.0f, 0.0f, 150.0f);
     ImGui::Spacing();
 
     // Ambient properties
     ImGui::Text("Ambient");
-    ImGui::ColorEdit3("Ambient Color", &rendered_entity->instance_data.material.ambient_tint[0]);
-    ImGui::DragFloat("Ambient Intensity", &rendered_entity->instance_data.material.ambient_tint.a, 0.01f, 0.0f, 1.0f);
+    material_changed |= ImGui::ColorEdit3("Ambient Color", &material.ambient_tint[0]);
+    material_changed |= ImGui::DragFloat("Ambient Intensity", &material.ambient_tint.a, 0.01f, 0.0f, 1.0f);
     ImGui::Spacing();
 
     ImGui::DragDisableCursor(scene_context.window);
@@ -123,22 +124,11 @@ void EditorScene::AnimatedEntityElement::add_imgui_edit_section(MasterRenderScen
     scene_context.texture_loader.add_imgui_texture_selector("Specular Map", rendered_entity->render_data.specular_map_texture, false);
     ImGui::Spacing();
 
-    ImGui::DragFloat("Texture Scale", &rendered_entity->instance_data.material.texture_scale, 0.1f, 1.0f, 25.0f); // Task E
-}
-
-void EditorScene::AnimatedEntityElement::update_instance_data() {
-    transform = calc_model_matrix();
+    material_changed |= ImGui::DragFloat("Texture Scale", &material.texture_scale, 0.1f, 1.0f, 25.0f); // Task E
 
-    if (!EditorScene::is_null(parent)) {
-        // Post multiply by transform so that local transformations are applied first
-        transform = (*parent)->transform * transform;
+    if (material_changed) {
+        mark_dirty();
     }
-
-    float temp_texture_scale = rendered_entity->instance_data.material.texture_scale;
-
-    rendered_entity->instance_data.model_matrix = transform;
-    rendered_entity->instance_data.material = material;
-    rendered_entity->instance_data.material.texture_scale = temp_texture_scale; // Task E
 }
 
 const char* EditorScene::AnimatedEntityElement::element_type_name() const {
@@ -16,7 +16,10 @@ namespace EditorScene {
         AnimationParameters animation_parameters{};
 
         AnimatedEntityElement(const ElementRef& parent, std::string name, const glm::vec3& position, const glm::vec3& euler_rotation, const glm::vec3& scale, std::shared_ptr<AnimatedEntityRenderer::Entity> rendered_entity) :
-            SceneElement(parent, std::move(name)), LocalTransformComponent(position, euler_rotation, scale), LitMaterialComponent(rendered_entity->instance_data.material), AnimationComponent(), rendered_entity(std::move(rendered_entity)) {}
+            SceneElement(parent, std::move(name)), LocalTransformComponent(position, euler_rotation, scale), LitMaterialComponent(rendered_entity->instance_data.material), AnimationComponent(), rendered_entity(std::move(rendered_entity)) {
+            components().link_model_matrix(id, &this->rendered_entity->instance_data.model_matrix);
+            components().link_lit_material(id, &this->rendered_entity->instance_data.material);
+        }
 
         static std::unique_ptr<AnimatedEntityElement> new_default(const SceneContext& scene_context, ElementRef parent);
         static std::unique_ptr<AnimatedEntityElement> from_json(const SceneContext& scene_context, ElementRef parent, const json& j);
@@ -24,8 +27,6 @@ namespace EditorScene {
 
         void add_imgui_edit_section(MasterRenderScene& render_scene, const SceneContext& scene_context) override;
 
-        void update_instance_data() override;
-
         void add_to_render_scene(MasterRenderScene& target_render_scene) override {
             target_render_scene.insert_entity(rendered_entity);
         }
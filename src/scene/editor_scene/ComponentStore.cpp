@@ -0,0 +1,328 @@
+#include "ComponentStore.h"
+
+#include "SceneElement.h"
+
+#include <cmath>
+
+namespace EditorScene {
+
+ComponentStore& ComponentStore::shared() {
+    static ComponentStore store{};
+    return store;
+}
+
+uint ComponentStore::slot_of(ElementId id) const {
+    return id_slots[id.index];
+}
+
+// Task B: Entity Rotation
+glm::mat4 ComponentStore::calc_trs_matrix(const glm::vec3& position, const glm::vec3& euler_rotation, const glm::vec3& scale) {
+    // translate(position) * rotate(x) * rotate(y) * rotate(z) * scale(scale), multiplied out by hand,
+    // since building and multiplying the separate matrices costs more than the rest of a transform sweep put together
+    float cx = std::cos(euler_rotation.x), sx = std::sin(euler_rotation.x);
+    float cy = std::cos(euler_rotation.y), sy = std::sin(euler_rotation.y);
+    float cz = std::cos(euler_rotation.z), sz = std::sin(euler_rotation.z);
+
+    return {
+        glm::vec4{cy * cz, cx * sz + sx * sy * cz, sx * sz - cx * sy * cz, 0.0f} * scale.x,
+        glm::vec4{-cy * sz, cx * cz - sx * sy * sz, sx * cz + cx * sy * sz, 0.0f} * scale.y,
+        glm::vec4{sy, -sx * cy, cx * cy, 0.0f} * scale.z,
+        glm::vec4{position, 1.0f}
+    };
+}
+
+ElementId ComponentStore::create(ElementId parent) {
+    // Scenes that are edited without ever being swept still get their dead slots back
+    if (dead_slots > owners.size() / 2) {
+        compact();
+    }
+
+    uint index;
+    if (!free_ids.empty()) {
+        index = free_ids.back();
+        free_ids.pop_back();
+    } else {
+        index = (uint) id_slots.size();
+        id_slots.push_back(NONE);
+        id_generations.push_back(0);
+    }
+
+    auto slot = (uint) owners.size();
+    id_slots[index] = slot;
+    owners.push_back(index);
+    parents.push_back(parent.valid() ? slot_of(parent) : NONE);
+    local_from_trs.push_back(0);
+    positions.emplace_back(0.0f);
+    euler_rotations.emplace_back(0.0f);
+    scales.emplace_back(1.0f);
+    local_transforms.emplace_back(1.0f);
+    world_transforms.emplace_back(1.0f);
+    model_matrix_links.push_back(nullptr);
+    lit_material_indices.push_back(NONE);
+    dirty_flags.push_back(0);
+    watchers.push_back(nullptr);
+    hierarchy_changed = true;
+
+    ElementId id{index, id_generations[index]};
+    mark_dirty(id);
+    return id;
+}
+
+void ComponentStore::destroy(ElementId id) {
+    if (!id.valid() || id_generations[id.index] != id.generation) return;
+    uint slot = slot_of(id);
+
+    uint material = lit_material_indices[slot];
+    if (material != NONE) {
+        // The order of the materials doesn't matter, so the last one fills the gap
+        uint last = (uint) lit_materials.size() - 1;
+        if (material != last) {
+            lit_materials[material] = lit_materials[last];
+            lit_material_links[material] = lit_material_links[last];
+            lit_material_owners[material] = lit_material_owners[last];
+            lit_material_indices[lit_material_owners[material]] = material;
+        }
+        lit_materials.pop_back();
+        lit_material_links.pop_back();
+        lit_material_owners.pop_back();
+        lit_material_indices[slot] = NONE;
+    }
+
+    owners[slot] = NONE;
+    model_matrix_links[slot] = nullptr;
+    watchers[slot] = nullptr;
+    ++dead_slots;
+    hierarchy_changed = true;
+
+    id_slots[id.index] = NONE;
+    ++id_generations[id.index];
+    free_ids.push_back(id.index);
+}
+
+void ComponentStore::compact() {
+    if (dead_slots == 0) return;
+
+    // [old slot] -> new slot, for fixing up the parents, which always come earlier so are already remapped
+    std::vector<uint> new_slots(owners.size(), NONE);
+    uint next = 0;
+    for (uint slot = 0; slot < (uint) owners.size(); ++slot) {
+        if (owners[slot] == NONE) continue;
+        new_slots[slot] = next;
+        owners[next] = owners[slot];
+        // A child outliving its parent becomes a root rather than pointing at whatever moves into the parent's place
+        parents[next] = parents[slot] == NONE ? NONE : new_slots[parents[slot]];
+        local_from_trs[next] = local_from_trs[slot];
+        positions[next] = positions[slot];
+        euler_rotations[next] = euler_rotations[slot];
+        scales[next] = scales[slot];
+        local_transforms[next] = local_transforms[slot];
+        world_transforms[next] = world_transforms[slot];
+        model_matrix_links[next] = model_matrix_links[slot];
+        lit_material_indices[next] = lit_material_indices[slot];
+        dirty_flags[next] = dirty_flags[slot];
+        watchers[next] = watchers[slot];
+
+        id_slots[owners[next]] = next;
+        if (lit_material_indices[next] != NONE) {
+            lit_material_owners[lit_material_indices[next]] = next;
+        }
+        ++next;
+    }
+
+    owners.resize(next);
+    parents.resize(next);
+    local_from_trs.resize(next);
+    positions.resize(next);
+    euler_rotations.resize(next);
+    scales.resize(next);
+    local_transforms.resize(next);
+    world_transforms.resize(next);
+    model_matrix_links.resize(next);
+    lit_material_indices.resize(next);
+    dirty_flags.resize(next);
+    watchers.resize(next);
+    dead_slots = 0;
+}
+
+void ComponentStore::use_trs(ElementId id, const glm::vec3& position, const glm::vec3& euler_rotation, const glm::vec3& scale) {
+    uint slot = slot_of(id);
+    local_from_trs[slot] = 1;
+    positions[slot] = position;
+    euler_rotations[slot] = euler_rotation;
+    scales[slot] = scale;
+    mark_dirty(id);
+}
+
+void ComponentStore::set_local_transform(ElementId id, const glm::mat4& local_transform) {
+    uint slot = slot_of(id);
+    local_from_trs[slot] = 0;
+    local_transforms[slot] = local_transform;
+    mark_dirty(id);
+}
+
+void ComponentStore::link_model_matrix(ElementId id, glm::mat4* model_matrix) {
+    model_matrix_links[slot_of(id)] = model_matrix;
+}
+
+void ComponentStore::add_lit_material(ElementId id, const BaseLitEntityMaterial& material) {
+    uint slot = slot_of(id);
+    mark_dirty(id);
+    if (lit_material_indices[slot] != NONE) {
+        lit_materials[lit_material_indices[slot]] = material;
+        return;
+    }
+    lit_material_indices[slot] = (uint) lit_materials.size();
+    lit_materials.push_back(material);
+    lit_material_links.push_back(nullptr);
+    lit_material_owners.push_back(slot);
+}
+
+void ComponentStore::link_lit_material(ElementId id, BaseLitEntityMaterial* material) {
+    lit_material_links[lit_material_indices[slot_of(id)]] = material;
+}
+
+void ComponentStore::watch_world_transform(ElementId id, SceneElement* element) {
+    watchers[slot_of(id)] = element;
+}
+
+void ComponentStore::mark_dirty(ElementId id) {
+    if (!id.valid() || id_generations[id.index] != id.generation) return;
+    uint slot = slot_of(id);
+    if (dirty_flags[slot] & LOCAL_DIRTY) return;
+    dirty_flags[slot] |= LOCAL_DIRTY;
+    dirty_ids.push_back(id.index);
+}
+
+void ComponentStore::rebuild_children() {
+    // Counting sort of the slots by parent, which keeps each element's children in slot order
+    child_starts.assign(owners.size() + 1, 0);
+    for (uint parent: parents) {
+        if (parent != NONE) ++child_starts[parent + 1];
+    }
+    for (size_t slot = 0; slot < owners.size(); ++slot) {
+        child_starts[slot + 1] += child_starts[slot];
+    }
+
+    child_slots.resize(child_starts.back());
+    std::vector<uint> next_child(child_starts.begin(), child_starts.end() - 1);
+    for (uint slot = 0; slot < (uint) owners.size(); ++slot) {
+        if (parents[slot] != NONE) {
+            child_slots[next_child[parents[slot]]++] = slot;
+        }
+    }
+    hierarchy_changed = false;
+}
+
+void ComponentStore::update_slot(uint slot) {
+    if (local_from_trs[slot] && (dirty_flags[slot] & LOCAL_DIRTY)) {
+        local_transforms[slot] = calc_trs_matrix(positions[slot], euler_rotations[slot], scales[slot]);
+    }
+    uint parent = parents[slot];
+    // Post multiply by the local transform so that local transformations are applied first
+    world_transforms[slot] = parent == NONE ? local_transforms[slot] : world_transforms[parent] * local_transforms[slot];
+    dirty_flags[slot] = 0;
+
+    if (model_matrix_links[slot] != nullptr) {
+        *model_matrix_links[slot] = world_transforms[slot];
+    }
+    uint material = lit_material_indices[slot];
+    if (material != NONE && lit_material_links[material] != nullptr) {
+        *lit_material_links[material] = lit_materials[material];
+    }
+}
+
+void ComponentStore::propagate(JobSystem& job_system) {
+    if (dirty_ids.empty()) return;
+    compact();
+    if (hierarchy_changed) {
+        rebuild_children();
+    }
+
+    // The edited elements that have nothing edited above them, since everything else dirty is somewhere under one of those.
+    // Checking up the parents is cheap, as it stops at the first edited one, and trees are shallow
+    if (dirty_levels.empty()) {
+        dirty_levels.emplace_back();
+    }
+    dirty_levels[0].clear();
+    for (uint index: dirty_ids) {
+        uint slot = id_slots[index];
+        // Destroyed since, or already queued through a reused id
+        if (slot == NONE || (dirty_flags[slot] & WORLD_DIRTY)) continue;
+
+        bool under_edited = false;
+        for (uint parent = parents[slot]; parent != NONE && !under_edited; parent = parents[parent]) {
+            under_edited = dirty_flags[parent] & LOCAL_DIRTY;
+        }
+        if (under_edited) continue;
+
+        dirty_flags[slot] |= WORLD_DIRTY;
+        dirty_levels[0].push_back(slot);
+    }
+    dirty_ids.clear();
+
+    // Each depth only reads the world transforms of the one above, so the elements within a depth are independent
+    size_t depth_count = 0;
+    while (!dirty_levels[depth_count].empty()) {
+        const auto& level = dirty_levels[depth_count];
+        if (level.size() >= PARALLEL_LEVEL_SIZE) {
+            job_system.parallel_for((uint) level.size(), PARALLEL_LEVEL_SIZE / 4, [&](uint begin, uint end) {
+                for (auto i = begin; i < end; ++i) {
+                    update_slot(level[i]);
+                }
+            });
+        } else {
+            for (uint slot: level) {
+                update_slot(slot);
+            }
+        }
+
+        ++depth_count;
+        if (dirty_levels.size() == depth_count) {
+            dirty_levels.emplace_back();
+        }
+        auto& next_level = dirty_levels[depth_count];
+        next_level.clear();
+        for (uint slot: dirty_levels[depth_count - 1]) {
+            for (uint child = child_starts[slot]; child < child_starts[slot + 1]; ++child) {
+                dirty_flags[child_slots[child]] |= WORLD_DIRTY;
+                next_level.push_back(child_slots[child]);
+            }
+        }
+    }
+
+    // Watchers touch their own renderer objects, and some (the crowds) allocate, so are left to the main thread
+    for (size_t depth = 0; depth < depth_count; ++depth) {
+        for (uint slot: dirty_levels[depth]) {
+            if (watchers[slot] != nullptr) {
+                watchers[slot]->update_instance_data();
+            }
+        }
+    }
+}
+
+void ComponentStore::update_world_transforms() {
+    compact();
+    for (uint slot = 0; slot < (uint) owners.size(); ++slot) {
+        if (local_from_trs[slot]) {
+            local_transforms[slot] = calc_trs_matrix(positions[slot], euler_rotations[slot], scales[slot]);
+        }
+        uint parent = parents[slot];
+        world_transforms[slot] = parent == NONE ? local_transforms[slot] : world_transforms[parent] * local_transforms[slot];
+    }
+}
+
+void ComponentStore::write_render_links() {
+    compact();
+    for (uint slot = 0; slot < (uint) owners.size(); ++slot) {
+        if (model_matrix_links[slot] != nullptr) {
+            *model_matrix_links[slot] = world_transforms[slot];
+        }
+    }
+    for (uint material = 0; material < (uint) lit_materials.size(); ++material) {
+        if (lit_material_links[material] != nullptr) {
+            *lit_material_links[material] = lit_materials[material];
+        }
+    }
+}
+
+} // namespace EditorScene
@@ -0,0 +1,155 @@
+#ifndef COMPONENT_STORE_H
+#define COMPONENT_STORE_H
+
+#include <vector>
+#include <cstdint>
+#include <limits>
+
+#include <glm/glm.hpp>
+
+#include "utility/HelperTypes.h"
+#include "utility/JobSystem.h"
+#include "rendering/renders/shaders/BaseLitEntityShader.h"
+
+namespace EditorScene {
+    class SceneElement;
+
+    /// A stable handle to an element's components in the ComponentStore, which stays valid however many other elements come and go,
+    /// where the components themselves move around as the store is compacted
+    struct ElementId {
+        static constexpr uint INVALID = std::numeric_limits<uint>::max();
+
+        uint index = INVALID;
+        uint generation = 0;
+
+        [[nodiscard]] bool valid() const { return index != INVALID; }
+    };
+
+    /// The transforms, materials and render links of every scene element, in dense arrays, so that updating every transform,
+    /// or writing every element's render data out, is a sweep through memory in order rather than a walk over a tree of separate allocations.
+    /// SceneElement and its components are views over their slot in here.
+    ///
+    /// Slots are kept in creation order. An element's parent always exists before it does, and elements are never moved to a new parent,
+    /// so every slot comes after its parent's, and a single sweep in order sees each parent's world transform before its children need it.
+    /// Destroying an element only marks its slot dead, and the dead slots are squeezed out, keeping the order, before the next sweep.
+    ///
+    /// Edits only mark the element dirty. Once a frame, propagate brings every dirty element, and everything under it, up to date,
+    /// so any number of edits in a frame cost one update, and an edit to one element never touches the rest of the scene.
+    ///
+    /// Elements are only ever created, edited and destroyed on the main thread, so there is one store, shared by every scene.
+    class ComponentStore {
+        static constexpr uint NONE = std::numeric_limits<uint>::max();
+        // Bits of dirty_flags
+        static constexpr uint8_t LOCAL_DIRTY = 1;
+        static constexpr uint8_t WORLD_DIRTY = 2;
+        // Depths of a dirty subtree with at least this many elements are split across the job system
+        static constexpr uint PARALLEL_LEVEL_SIZE = 4096;
+
+        // [id index] -> slot, or NONE if the id is free
+        std::vector<uint> id_slots{};
+        // [id index] -> how many times the id has been handed out, so that a stale ElementId can be told apart
+        std::vector<uint> id_generations{};
+        std::vector<uint> free_ids{};
+        uint dead_slots = 0;
+
+        // [slot] -> the id index that owns it, or NONE if it has been destroyed and is waiting to be compacted out
+        std::vector<uint> owners{};
+        // [slot] -> the parent's slot, or NONE for the elements at the root of the scene
+        std::vector<uint> parents{};
+        // [slot] -> if the local transform is built from the position, rotation and scale below, rather than set directly
+        std::vector<uint8_t> local_from_trs{};
+        // [slot] -> position, euler rotation in radians, and scale, see LocalTransformComponent
+        std::vector<glm::vec3> positions{}, euler_rotations{}, scales{};
+        // [slot] -> transform relative to the parent
+        std::vector<glm::mat4> local_transforms{};
+        // [slot] -> transform including every ancestor's transform
+        std::vector<glm::mat4> world_transforms{};
+        // [slot] -> where the renderer reads the element's world transform from, or null
+        std::vector<glm::mat4*> model_matrix_links{};
+        // [slot] -> the element's lit material, or NONE
+        std::vector<uint> lit_material_indices{};
+        // [slot] -> LOCAL_DIRTY if the element has been edited since the last propagate,
+        // WORLD_DIRTY while propagate has it queued because it, or something above it, was edited
+        std::vector<uint8_t> dirty_flags{};
+        // [slot] -> the element to call update_instance_data on once propagate has updated its world transform, or null
+        std::vector<SceneElement*> watchers{};
+
+        // The id indices of the elements marked LOCAL_DIRTY, in no particular order. Ids rather than slots, since slots move when compacting
+        std::vector<uint> dirty_ids{};
+        // The children of each slot, packed together, [slot] -> where its children start in child_slots, with one past the end at the back.
+        // Only rebuilt when elements have been created or destroyed since
+        std::vector<uint> child_starts{}, child_slots{};
+        bool hierarchy_changed = false;
+        // Kept between propagates to save reallocating them, [depth below the edited element] -> slots at that depth
+        std::vector<std::vector<uint>> dirty_levels{};
+
+        // Lit materials, packed separately since only entities have them. [lit material] -> ...
+        std::vector<BaseLitEntityMaterial> lit_materials{};
+        // Where the renderer reads the material from, or null
+        std::vector<BaseLitEntityMaterial*> lit_material_links{};
+        // The slot that owns the material, so that it can be pointed back at when the materials are swapped around
+        std::vector<uint> lit_material_owners{};
+
+        [[nodiscard]] uint slot_of(ElementId id) const;
+        /// Squeeze out the dead slots, keeping the rest in order
+        void compact();
+        void rebuild_children();
+        /// Bring one slot's local and world transforms up to date, and write them and its material through its links
+        void update_slot(uint slot);
+        static glm::mat4 calc_trs_matrix(const glm::vec3& position, const glm::vec3& euler_rotation, const glm::vec3& scale);
+
+    public:
+        static ComponentStore& shared();
+
+        /// Add an element under parent, or at the root if parent is invalid, with identity transforms and no links
+        ElementId create(ElementId parent);
+        /// Free the element's components, and its id for reuse. Links into the renderer are dropped, not written to
+        void destroy(ElementId id);
+
+        [[nodiscard]] size_t size() const { return owners.size() - dead_slots; }
+
+        // Local transform, either as position, rotation and scale, or set directly.
+        // Changing the position, rotation or scale through the references needs a mark_dirty after
+        void use_trs(ElementId id, const glm::vec3& position, const glm::vec3& euler_rotation, const glm::vec3& scale);
+        [[nodiscard]] bool uses_trs(ElementId id) const { return local_from_trs[slot_of(id)] != 0; }
+        [[nodiscard]] glm::vec3& position(ElementId id) { return positions[slot_of(id)]; }
+        [[nodiscard]] glm::vec3& euler_rotation(ElementId id) { return euler_rotations[slot_of(id)]; }
+        [[nodiscard]] glm::vec3& scale(ElementId id) { return scales[slot_of(id)]; }
+        [[nodiscard]] const glm::vec3& position(ElementId id) const { return positions[slot_of(id)]; }
+        [[nodiscard]] const glm::vec3& euler_rotation(ElementId id) const { return euler_rotations[slot_of(id)]; }
+        [[nodiscard]] const glm::vec3& scale(ElementId id) const { return scales[slot_of(id)]; }
+        void set_local_transform(ElementId id, const glm::mat4& local_transform);
+
+        [[nodiscard]] const glm::mat4& world_transform(ElementId id) const { return world_transforms[slot_of(id)]; }
+
+        // Render links, each written with the element's world transform or material by write_render_links
+        void link_model_matrix(ElementId id, glm::mat4* model_matrix);
+        void add_lit_material(ElementId id, const BaseLitEntityMaterial& material);
+        void link_lit_material(ElementId id, BaseLitEntityMaterial* material);
+        [[nodiscard]] bool has_lit_material(ElementId id) const { return lit_material_indices[slot_of(id)] != NONE; }
+        [[nodiscard]] BaseLitEntityMaterial& lit_material(ElementId id) { return lit_materials[lit_material_indices[slot_of(id)]]; }
+        [[nodiscard]] const BaseLitEntityMaterial& lit_material(ElementId id) const { return lit_materials[lit_material_indices[slot_of(id)]]; }
+
+        /// Have element->update_instance_data() called by propagate whenever it updates the element,
+        /// for elements that derive more from their world transform than what is written through their links
+        void watch_world_transform(ElementId id, SceneElement* element);
+
+        /// Queue the element, and so everything under it, to be brought up to date by the next propagate.
+        /// Elements start out dirty, and use_trs, set_local_transform and add_lit_material mark them dirty too
+        void mark_dirty(ElementId id);
+        [[nodiscard]] size_t dirty_count() const { return dirty_ids.size(); }
+
+        /// Update the local and world transforms of every dirty element and everything under it, write them and their materials
+        /// through their links, then call update_instance_data on any watchers among them, and clear the dirty flags.
+        /// Goes one depth at a time, since each depth only needs the one above, with the larger ones split across the job system
+        void propagate(JobSystem& job_system);
+
+        /// Recompute every element's local and world transforms, in one pass in slot order, whether dirty or not, leaving the dirty flags alone
+        void update_world_transforms();
+        /// Write every element's world transform and material through its links, in one pass in slot order
+        void write_render_links();
+    };
+
+} // namespace EditorScene
+
+#endif // COMPONENT_STORE_H
@@ -0,0 +1,186 @@
+#include "CrowdElement.h"
+
+#include <random>
+
+#include <glm/gtx/transform.hpp>
+
+#include "rendering/imgui/ImGuiManager.h"
+#include "scene/SceneContext.h"
+
+std::unique_ptr<EditorScene::CrowdElement> EditorScene::CrowdElement::new_default(const SceneContext& scene_context, ElementRef parent) {
+    auto rendered_entity = CrowdRenderer::Entity::create(
+        scene_context.model_loader.load_baked_hierarchy_from_file<CrowdRenderer::VertexData>("cube.obj"),
+        CrowdRenderer::EntityMaterial{
+            {1.0f, 1.0f, 1.0f, 1.0f},
+            {1.0f, 1.0f, 1.0f, 1.0f},
+            {1.0f, 1.0f, 1.0f, 1.0f},
+            512.0f,
+            1.0f
+        },
+        CrowdRenderer::RenderData{
+            scene_context.texture_loader.default_white_texture(),
+            scene_context.texture_loader.default_white_texture()
+        }
+    );
+
+    auto new_entity = std::make_unique<CrowdElement>(
+        parent,
+        "New Animated Crowd",
+        glm::vec3{0.0f},
+        glm::vec3{0.0f},
+        glm::vec3{1.0f},
+        rendered_entity
+    );
+
+    new_entity->mark_dirty();
+    return new_entity;
+}
+
+std::unique_ptr<EditorScene::CrowdElement> EditorScene::CrowdElement::from_json(const SceneContext& scene_context, EditorScene::ElementRef parent, const json& j) {
+    auto new_entity = new_default(scene_context, parent);
+
+    new_entity->update_local_transform_from_json(j);
+    new_entity->update_material_from_json(j);
+
+    new_entity->rendered_entity->mesh_hierarchy = scene_context.model_loader.load_baked_hierarchy_from_file<CrowdRenderer::VertexData>(j["model"]);
+    new_entity->rendered_entity->render_data.diffuse_texture = texture_from_json(scene_context, j["diffuse_texture"]);
+    new_entity->rendered_entity->render_data.specular_map_texture = texture_from_json(scene_context, j["specular_map_texture"]);
+
+    json layout = j["layout"];
+    new_entity->rows = layout["rows"];
+    new_entity->columns = layout["columns"];
+    new_entity->spacing = layout["spacing"];
+    new_entity->phase_spread = layout["phase_spread"];
+    new_entity->seed = layout["seed"];
+
+    json animation_parameters = j["animation_parameters"];
+    new_entity->animation_parameters.animation_id = animation_parameters["animation_id"];
+    new_entity->animation_parameters.speed = animation_parameters["speed"];
+    new_entity->animation_parameters.paused = animation_parameters["paused"];
+    new_entity->animation_parameters.loop = animation_parameters["loop"];
+    new_entity->rendered_entity->animation_id = animation_parameters["animation_id"];
+    new_entity->rendered_entity->animation_time_seconds = animation_parameters["animation_time_seconds"];
+
+    new_entity->mark_dirty();
+    return new_entity;
+}
+
+json EditorScene::CrowdElement::into_json() const {
+    if (!rendered_entity->mesh_hierarchy->filename.has_value()) {
+        return {
+            {"error", Formatter() << "Animated Crowd [" << name << "]'s model does not have a filename so can not be exported, and has been skipped."}
+        };
+    }
+
+    return {
+        local_transform_into_json(),
+        material_into_json(),
+        {"model", rendered_entity->mesh_hierarchy->filename.value()},
+        {"diffuse_texture", texture_to_json(rendered_entity->render_data.diffuse_texture)},
+        {"specular_map_texture", texture_to_json(rendered_entity->render_data.specular_map_texture)},
+        {"layout", {
+            {"rows", rows},
+            {"columns", columns},
+            {"spacing", spacing},
+            {"phase_spread", phase_spread},
+            {"seed", seed},
+        }},
+        {"animation_parameters", {
+            {"animation_id", animation_parameters.animation_id},
+            {"speed", animation_parameters.speed},
+            {"paused", animation_parameters.paused},
+            {"loop", animation_parameters.loop},
+            {"animation_time_seconds", rendered_entity->animation_time_seconds},
+        }}
+    };
+}
+
+void EditorScene::CrowdElement::add_imgui_edit_section(MasterRenderScene& render_scene, const SceneContext& scene_context) {
+    ImGui::Text("Animated Crowd");
+    SceneElement::add_imgui_edit_section(render_scene, scene_context);
+
+    add_local_transform_imgui_edit_section(render_scene, scene_context);
+
+    ImGui::Text("Layout");
+    bool layout_changed = false;
+    int grid[2] = {(int) rows, (int) columns};
+    if (ImGui::DragInt2("Rows, Columns", grid, 1.0f, 1, 256)) {
+        rows = (uint) std::max(1, grid[0]);
+        columns = (uint) std::max(1, grid[1]);
+        layout_changed = true;
+    }
+    layout_changed |= ImGui::DragFloat("Spacing", &spacing, 0.01f, 0.0f, 100.0f);
+    layout_changed |= ImGui::SliderFloat("Phase Spread", &phase_spread, 0.0f, 1.0f);
+    int int_seed = (int) seed;
+    if (ImGui::InputInt("Seed", &int_seed)) {
+        seed = (uint) int_seed;
+        layout_changed = true;
+    }
+    ImGui::DragDisableCursor(scene_context.window);
+    ImGui::Text("Members: %zu", rendered_entity->members.size());
+    ImGui::Spacing();
+
+    ImGui::Text("Material Properties");
+    auto& material = this->material();
+    bool material_changed = false;
+    material_changed |= ImGui::ColorEdit3("Diffuse Color", &material.diffuse_tint[0]);
+    material_changed |= ImGui::DragFloat("Diffuse Intensity", &material.diffuse_tint.a, 0.01f, 0.0f, 1.0f);
+    material_changed |= ImGui::ColorEdit3("Specular Color", &material.specular_tint[0]);
+    material_changed |= ImGui::DragFloat("Specular Intensity", &material.specular_tint.a, 0.01f, 0.0f, 1.0f);
+    material_changed |= ImGui::DragFloat("Shininess", &material.shininess, 1.0f, 0.0f, 150.0f);
+    material_changed |= ImGui::ColorEdit3("Ambient Color", &material.ambient_tint[0]);
+    material_changed |= ImGui::DragFloat("Ambient Intensity", &material.ambient_tint.a, 0.01f, 0.0f, 1.0f);
+    material_changed |= ImGui::DragFloat("Texture Scale", &material.texture_scale, 0.1f, 1.0f, 25.0f);
+    ImGui::DragDisableCursor(scene_context.window);
+    ImGui::Spacing();
+
+    ImGui::Text("Model & Textures");
+    if (scene_context.model_loader.add_imgui_hierarchy_selector("Model Selection", rendered_entity->mesh_hierarchy, true)) {
+        render_scene.animator.stop(rendered_entity);
+        animation_parameters.animation_id = NONE_ANIMATION;
+    }
+    scene_context.texture_loader.add_imgui_texture_selector("Diffuse Texture", rendered_entity->render_data.diffuse_texture);
+    scene_context.texture_loader.add_imgui_texture_selector("Specular Map", rendered_entity->render_data.specular_map_texture, false);
+
+    const auto& vertex_animation = rendered_entity->mesh_hierarchy->vertex_animation;
+    if (vertex_animation != nullptr) {
+        ImGui::Text("Baked: %u frames of %u vertices, %.1f MiB", vertex_animation->frame_count, vertex_animation->vertex_count,
+                    (float) vertex_animation->memory_size() / (1024.0f * 1024.0f));
+    }
+
+    if (layout_changed || material_changed) {
+        mark_dirty();
+    }
+}
+
+void EditorScene::CrowdElement::update_instance_data() {
+    // The material is linked to the rendered entity, see the constructor
+    const glm::mat4& transform = this->transform();
+
+    // Centre the grid on the element
+    glm::vec2 grid_offset = glm::vec2{(float) columns - 1.0f, (float) rows - 1.0f} * spacing * 0.5f;
+    std::mt19937 phase_generator{seed};
+    std::uniform_real_distribution<float> phase_distribution{0.0f, 1.0f};
+
+    auto& members = rendered_entity->members;
+    members.clear();
+    members.reserve((size_t) rows * columns);
+    for (auto row = 0u; row < rows; ++row) {
+        for (auto column = 0u; column < columns; ++column) {
+            glm::vec3 grid_position{(float) column * spacing - grid_offset.x, 0.0f, (float) row * spacing - grid_offset.y};
+            members.push_back({transform * glm::translate(grid_position), phase_distribution(phase_generator) * phase_spread});
+        }
+    }
+}
+
+const char* EditorScene::CrowdElement::element_type_name() const {
+    return ELEMENT_TYPE_NAME;
+}
+
+std::shared_ptr<AnimatedEntityInterface> EditorScene::CrowdElement::get_entity() {
+    return std::dynamic_pointer_cast<AnimatedEntityInterface>(rendered_entity);
+}
+
+AnimationParameters& EditorScene::CrowdElement::get_animation_parameters() {
+    return animation_parameters;
+}
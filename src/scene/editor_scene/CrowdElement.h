@@ -0,0 +1,57 @@
+#ifndef CROWD_ELEMENT_H
+#define CROWD_ELEMENT_H
+
+#include "SceneElement.h"
+#include "scene/SceneContext.h"
+
+namespace EditorScene {
+    /// A grid of instances of one animated model, played back from a baked vertex animation, for cheap background crowds.
+    class CrowdElement : virtual public SceneElement, public LocalTransformComponent, public LitMaterialComponent, public AnimationComponent {
+    public:
+        /// NOTE: Must be unique per element type, as it is used to select generators,
+        ///       so if you are creating a new element type make sure to change this to a new unique name.
+        static constexpr const char* ELEMENT_TYPE_NAME = "Animated Crowd";
+
+        std::shared_ptr<CrowdRenderer::Entity> rendered_entity;
+
+        AnimationParameters animation_parameters{NONE_ANIMATION, true};
+
+        // Layout of the members, in the element's local space
+        uint rows = 8;
+        uint columns = 8;
+        float spacing = 2.0f;
+        // How much the members' phases are spread over the clip, 0 keeps them all in step
+        float phase_spread = 1.0f;
+        // Seeds the phases, so a saved crowd comes back the same
+        uint seed = 0;
+
+        CrowdElement(const ElementRef& parent, std::string name, const glm::vec3& position, const glm::vec3& euler_rotation, const glm::vec3& scale, std::shared_ptr<CrowdRenderer::Entity> rendered_entity) :
+            SceneElement(parent, std::move(name)), LocalTransformComponent(position, euler_rotation, scale), LitMaterialComponent(rendered_entity->material), AnimationComponent(), rendered_entity(std::move(rendered_entity)) {
+            components().link_lit_material(id, &this->rendered_entity->material);
+            components().watch_world_transform(id, this);
+        }
+
+        static std::unique_ptr<CrowdElement> new_default(const SceneContext& scene_context, ElementRef parent);
+        static std::unique_ptr<CrowdElement> from_json(const SceneContext& scene_context, ElementRef parent, const json& j);
+        [[nodiscard]] json into_json() const override;
+
+        void add_imgui_edit_section(MasterRenderScene& render_scene, const SceneContext& scene_context) override;
+
+        void update_instance_data() override;
+
+        void add_to_render_scene(MasterRenderScene& target_render_scene) override {
+            target_render_scene.insert_entity(rendered_entity);
+        }
+
+        void remove_from_render_scene(MasterRenderScene& target_render_scene) override {
+            target_render_scene.remove_entity(rendered_entity);
+        }
+
+        [[nodiscard]] std::shared_ptr<AnimatedEntityInterface> get_entity() override;
+        [[nodiscard]] AnimationParameters& get_animation_parameters() override;
+
+        [[nodiscard]] const char* element_type_name() const override;
+    };
+}
+
+#endif //CROWD_ELEMENT_H
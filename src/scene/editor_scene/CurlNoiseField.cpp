@@ -0,0 +1,97 @@
+#include "CurlNoiseField.h"
+
+#include <array>
+#include <cmath>
+
+#include "utility/Random.h"
+
+namespace EditorScene {
+
+namespace {
+    constexpr int RESOLUTION = CurlNoiseField::RESOLUTION;
+    constexpr int LATTICE = CurlNoiseField::LATTICE;
+
+    size_t cell_index(int x, int y, int z) {
+        auto wrap = [](int i) { return (i + RESOLUTION) % RESOLUTION; };
+        return (size_t) ((wrap(z) * RESOLUTION + wrap(y)) * RESOLUTION + wrap(x));
+    }
+
+    float quintic(float t) {
+        return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+    }
+
+    /// Value noise that repeats every LATTICE features, sampled at every grid cell
+    std::vector<float> periodic_value_noise(RandomStream& rng) {
+        std::vector<float> lattice((size_t) LATTICE * LATTICE * LATTICE);
+        rng.fill_range(lattice.data(), lattice.size(), -1.0f, 1.0f);
+        auto at = [&](int x, int y, int z) {
+            return lattice[(size_t) (((z % LATTICE) * LATTICE + (y % LATTICE)) * LATTICE + (x % LATTICE))];
+        };
+
+        std::vector<float> noise((size_t) RESOLUTION * RESOLUTION * RESOLUTION);
+        for (int z = 0; z < RESOLUTION; ++z) {
+            for (int y = 0; y < RESOLUTION; ++y) {
+                for (int x = 0; x < RESOLUTION; ++x) {
+                    glm::vec3 position = glm::vec3(x, y, z) / CurlNoiseField::CELLS_PER_UNIT;
+                    glm::ivec3 l = glm::ivec3(glm::floor(position));
+                    glm::vec3 f = position - glm::vec3(l);
+                    glm::vec3 t{quintic(f.x), quintic(f.y), quintic(f.z)};
+
+                    float x00 = glm::mix(at(l.x, l.y, l.z), at(l.x + 1, l.y, l.z), t.x);
+                    float x10 = glm::mix(at(l.x, l.y + 1, l.z), at(l.x + 1, l.y + 1, l.z), t.x);
+                    float x01 = glm::mix(at(l.x, l.y, l.z + 1), at(l.x + 1, l.y, l.z + 1), t.x);
+                    float x11 = glm::mix(at(l.x, l.y + 1, l.z + 1), at(l.x + 1, l.y + 1, l.z + 1), t.x);
+                    noise[cell_index(x, y, z)] = glm::mix(glm::mix(x00, x10, t.y), glm::mix(x01, x11, t.y), t.z);
+                }
+            }
+        }
+        return noise;
+    }
+}
+
+CurlNoiseField::CurlNoiseField(uint64_t seed) {
+    // The vector potential, one independent noise per component
+    std::array<std::vector<float>, 3> potential;
+    for (uint64_t component = 0; component < 3; ++component) {
+        RandomStream rng{seed, component};
+        potential[component] = periodic_value_noise(rng);
+    }
+
+    // curl = (dPz/dy - dPy/dz, dPx/dz - dPz/dx, dPy/dx - dPx/dy), with central differences that wrap around,
+    // left unscaled by the cell size since the result is normalised below anyway
+    std::vector<glm::vec3> velocities((size_t) RESOLUTION * RESOLUTION * RESOLUTION);
+    double sum_squared = 0.0;
+    for (int z = 0; z < RESOLUTION; ++z) {
+        for (int y = 0; y < RESOLUTION; ++y) {
+            for (int x = 0; x < RESOLUTION; ++x) {
+                auto derivative = [&](int component, int dx, int dy, int dz) {
+                    const auto& p = potential[(size_t) component];
+                    return p[cell_index(x + dx, y + dy, z + dz)] - p[cell_index(x - dx, y - dy, z - dz)];
+                };
+                glm::vec3 curl{
+                    derivative(2, 0, 1, 0) - derivative(1, 0, 0, 1),
+                    derivative(0, 0, 0, 1) - derivative(2, 1, 0, 0),
+                    derivative(1, 1, 0, 0) - derivative(0, 0, 1, 0)
+                };
+                velocities[cell_index(x, y, z)] = curl;
+                sum_squared += glm::dot(curl, curl);
+            }
+        }
+    }
+
+    auto rms = (float) std::sqrt(sum_squared / (double) velocities.size());
+    float scale = rms > 0.0f ? 1.0f / rms : 0.0f;
+    for (const auto& velocity: velocities) {
+        velocityX.push_back(velocity.x * scale);
+        velocityY.push_back(velocity.y * scale);
+        velocityZ.push_back(velocity.z * scale);
+    }
+}
+
+const CurlNoiseField& CurlNoiseField::shared() {
+    // A fixed seed, so turbulence looks the same from run to run
+    static const CurlNoiseField field{0x5EED};
+    return field;
+}
+
+} // namespace EditorScene
@@ -0,0 +1,62 @@
+#ifndef CURL_NOISE_FIELD_H
+#define CURL_NOISE_FIELD_H
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+namespace EditorScene {
+
+    /// A tileable 3D grid of curl noise velocities (Bridson et al. 2007), precomputed once and sampled with trilinear interpolation.
+    /// Being the curl of a smooth noise potential the field has (close to, once interpolated) no divergence,
+    /// so particles following it swirl around each other rather than bunching up or spreading out.
+    ///
+    /// Sampled in feature units, one eddy per unit, repeating every LATTICE units on each axis.
+    /// The velocities are scaled to have an RMS length of 1.
+    ///
+    /// Stored as a structure of arrays, so that ParticlePool::turbulence can sample four particles at a time.
+    class CurlNoiseField {
+    public:
+        // Noise features per period of the field
+        static constexpr int LATTICE = 8;
+        // Grid cells per period, a power of two so that wrapping is a mask and the strides are shifts
+        static constexpr int RESOLUTION_SHIFT = 5;
+        static constexpr int RESOLUTION = 1 << RESOLUTION_SHIFT;
+        static constexpr int MASK = RESOLUTION - 1;
+        static constexpr float CELLS_PER_UNIT = (float) RESOLUTION / (float) LATTICE;
+
+        // [z][y][x] -> velocity
+        std::vector<float> velocityX, velocityY, velocityZ;
+
+        explicit CurlNoiseField(uint64_t seed);
+
+        /// The field shared by every particle emitter, built on first use
+        static const CurlNoiseField& shared();
+
+        [[nodiscard]] glm::vec3 sample(const glm::vec3& position) const {
+            glm::vec3 grid = position * CELLS_PER_UNIT;
+            glm::vec3 floored = glm::floor(grid);
+            glm::vec3 t = grid - floored;
+
+            // Offsets of the two cells on each axis, wrapped, with the strides already applied
+            auto x = (int) floored.x, y = (int) floored.y, z = (int) floored.z;
+            int x0 = x & MASK, x1 = (x + 1) & MASK;
+            int y0 = (y & MASK) * RESOLUTION, y1 = ((y + 1) & MASK) * RESOLUTION;
+            int z0 = (z & MASK) * RESOLUTION * RESOLUTION, z1 = ((z + 1) & MASK) * RESOLUTION * RESOLUTION;
+
+            // The eight corner weights, so each corner is a single multiply add
+            float w000 = (1.0f - t.x) * (1.0f - t.y) * (1.0f - t.z), w100 = t.x * (1.0f - t.y) * (1.0f - t.z);
+            float w010 = (1.0f - t.x) * t.y * (1.0f - t.z), w110 = t.x * t.y * (1.0f - t.z);
+            float w001 = (1.0f - t.x) * (1.0f - t.y) * t.z, w101 = t.x * (1.0f - t.y) * t.z;
+            float w011 = (1.0f - t.x) * t.y * t.z, w111 = t.x * t.y * t.z;
+
+            auto at = [&](int i) { return glm::vec3(velocityX[(size_t) i], velocityY[(size_t) i], velocityZ[(size_t) i]); };
+            return at(z0 + y0 + x0) * w000 + at(z0 + y0 + x1) * w100 + at(z0 + y1 + x0) * w010 + at(z0 + y1 + x1) * w110
+                 + at(z1 + y0 + x0) * w001 + at(z1 + y0 + x1) * w101 + at(z1 + y1 + x0) * w011 + at(z1 + y1 + x1) * w111;
+        }
+    };
+
+} // namespace EditorScene
+
+#endif // CURL_NOISE_FIELD_H
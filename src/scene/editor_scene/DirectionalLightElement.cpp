@@ -35,7 +35,7 @@ std::unique_ptr<EditorScene::DirectionalLightElement> EditorScene::DirectionalLi
         )
     );
 
-    light_element->update_instance_data();
+    light_element->update_local_transform();
     return light_element;
 }
 
@@ -48,7 +48,7 @@ std::unique_ptr<EditorScene::DirectionalLightElement> EditorScene::DirectionalLi
     light_element->visible = j["visible"];
     light_element->visual_scale = j["visual_scale"];
 
-    light_element->update_instance_data();
+    light_element->update_local_transform();
     return light_element;
 }
 
@@ -91,17 +91,12 @@ void EditorScene::DirectionalLightElement::add_imgui_edit_section(MasterRenderSc
     ImGui::DragDisableCursor(scene_context.window);
 
     if (transformUpdated) {
-        update_instance_data();
+        update_local_transform();
     }
 }
 
-void EditorScene::DirectionalLightElement::update_instance_data() {
-    if (!EditorScene::is_null(parent)) {
-        transform = (*parent)->transform;
-    } else {
-        transform = glm::mat4(1.0f);
-    }
-    
+void EditorScene::DirectionalLightElement::update_local_transform() {
+    // Also marks the element dirty, which brings the light and its arrow along
     glm::vec3 normalizedDirection = glm::normalize(direction);
     
     glm::vec3 defaultDirection = glm::vec3(0.0f, -1.0f, 0.0f);
@@ -109,20 +104,22 @@ void EditorScene::DirectionalLightElement::update_instance_data() {
     
     if (glm::length(rotationAxis) < 0.001f) {
         if (glm::dot(defaultDirection, normalizedDirection) < 0) {
-            transform = transform * glm::translate(position) * glm::rotate(glm::pi<float>(), glm::vec3(1.0f, 0.0f, 0.0f)) * glm::scale(glm::vec3(visual_scale));
+            components().set_local_transform(id, glm::translate(position) * glm::rotate(glm::pi<float>(), glm::vec3(1.0f, 0.0f, 0.0f)) * glm::scale(glm::vec3(visual_scale)));
         } else {
-            transform = transform * glm::translate(position) * glm::scale(glm::vec3(visual_scale));
+            components().set_local_transform(id, glm::translate(position) * glm::scale(glm::vec3(visual_scale)));
         }
     } else {
         float angle = glm::angle(defaultDirection, normalizedDirection);
         rotationAxis = glm::normalize(rotationAxis);
-        transform = transform * glm::translate(position) * glm::rotate(-angle, rotationAxis) * glm::scale(glm::vec3(visual_scale));
+        components().set_local_transform(id, glm::translate(position) * glm::rotate(-angle, rotationAxis) * glm::scale(glm::vec3(visual_scale)));
     }
+}
 
-    light->direction = normalizedDirection;
+void EditorScene::DirectionalLightElement::update_instance_data() {
+    light->direction = glm::normalize(direction);
     
     if (visible) {
-        light_arrow->instance_data.model_matrix = transform;
+        light_arrow->instance_data.model_matrix = transform();
     } else {
         light_arrow->instance_data.model_matrix = glm::scale(glm::vec3{std::numeric_limits<float>::infinity()}) * glm::translate(glm::vec3{std::numeric_limits<float>::infinity()});
     }
@@ -24,6 +24,7 @@ namespace EditorScene {
         DirectionalLightElement(const ElementRef& parent, std::string name, glm::vec3 direction, std::shared_ptr<DirectionalLight> light, std::shared_ptr<EmissiveEntityRenderer::Entity> light_arrow) :
             SceneElement(parent, std::move(name)), direction(direction), light(std::move(light)), light_arrow(std::move(light_arrow)) {
             position = glm::vec3(0.0f, 2.0f, 0.0f);  // Default position
+            components().watch_world_transform(id, this);
         }
 
         static std::unique_ptr<DirectionalLightElement> new_default(const SceneContext& scene_context, ElementRef parent);
@@ -33,6 +34,9 @@ namespace EditorScene {
 
         void add_imgui_edit_section(MasterRenderScene& render_scene, const SceneContext& scene_context) override;
 
+        /// Set the local transform from position, direction and visual_scale, to be called whenever they change
+        void update_local_transform();
+
         void update_instance_data() override;
 
         void add_to_render_scene(MasterRenderScene& target_render_scene) override {
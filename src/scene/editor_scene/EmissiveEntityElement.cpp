@@ -9,7 +9,7 @@ std::unique_ptr<EditorScene::EmissiveEntityElement> EditorScene::EmissiveEntityE
     auto rendered_entity = EmissiveEntityRenderer::Entity::create(
         scene_context.model_loader.load_from_file<EmissiveEntityRenderer::VertexData>("cube.obj"),
         EmissiveEntityRenderer::InstanceData{
-            glm::mat4{}, // Set via update_instance_data()
+            glm::mat4{}, // Set through the ComponentStore's links
             EmissiveEntityRenderer::EmissiveEntityMaterial{
                 glm::vec4{1.0f, 1.0f, 1.0f, 1.0f}
             }
@@ -28,7 +28,7 @@ std::unique_ptr<EditorScene::EmissiveEntityElement> EditorScene::EmissiveEntityE
         rendered_entity
     );
 
-    new_entity->update_instance_data();
+    new_entity->mark_dirty();
     return new_entity;
 }
 
@@ -41,7 +41,7 @@ std::unique_ptr<EditorScene::EmissiveEntityElement> EditorScene::EmissiveEntityE
     new_entity->rendered_entity->model = scene_context.model_loader.load_from_file<EmissiveEntityRenderer::VertexData>(j["model"]);
     new_entity->rendered_entity->render_data.emission_texture = texture_from_json(scene_context, j["emission_texture"]);
 
-    new_entity->update_instance_data();
+    new_entity->mark_dirty();
     return new_entity;
 }
 
@@ -84,14 +84,7 @@ void EditorScene::EmissiveEntityElement::add_imgui_edit_section(MasterRenderScen
 }
 
 void EditorScene::EmissiveEntityElement::update_instance_data() {
-    transform = calc_model_matrix();
-
-    if (!EditorScene::is_null(parent)) {
-        // Post multiply by transform so that local transformations are applied first
-        transform = (*parent)->transform * transform;
-    }
-
-    rendered_entity->instance_data.model_matrix = transform;
+    // The model matrix is linked to the rendered entity, see the constructor
     rendered_entity->instance_data.material = material;
 }
 
@@ -14,7 +14,10 @@ namespace EditorScene {
         std::shared_ptr<EmissiveEntityRenderer::Entity> rendered_entity;
 
         EmissiveEntityElement(const ElementRef& parent, std::string name, const glm::vec3& position, const glm::vec3& euler_rotation, const glm::vec3& scale, std::shared_ptr<EmissiveEntityRenderer::Entity> rendered_entity) :
-            SceneElement(parent, std::move(name)), LocalTransformComponent(position, euler_rotation, scale), EmissiveMaterialComponent(rendered_entity->instance_data.material), rendered_entity(std::move(rendered_entity)) {}
+            SceneElement(parent, std::move(name)), LocalTransformComponent(position, euler_rotation, scale), EmissiveMaterialComponent(rendered_entity->instance_data.material), rendered_entity(std::move(rendered_entity)) {
+            components().link_model_matrix(id, &this->rendered_entity->instance_data.model_matrix);
+            components().watch_world_transform(id, this);
+        }
 
         static std::unique_ptr<EmissiveEntityElement> new_default(const SceneContext& scene_context, ElementRef parent);
         static std::unique_ptr<EmissiveEntityElement> from_json(const SceneContext& scene_context, ElementRef parent, const json& j);
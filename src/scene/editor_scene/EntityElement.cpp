@@ -12,7 +12,7 @@ std::unique_ptr<EditorScene::EntityElement> EditorScene::EntityElement::new_defa
     auto rendered_entity = EntityRenderer::Entity::create(
         scene_context.model_loader.load_from_file<EntityRenderer::VertexData>("cube.obj"),
         EntityRenderer::InstanceData{
-            glm::mat4{}, // Set via update_instance_data()
+            glm::mat4{}, // Set through the ComponentStore's links
             EntityRenderer::EntityMaterial{
                 {1.0f, 1.0f, 1.0f, 1.0f},
                 {1.0f, 1.0f, 1.0f, 1.0f},
@@ -42,7 +42,7 @@ std::unique_ptr<EditorScene::EntityElement> EditorScene::EntityElement::new_defa
         rendered_entity
     );
 
-    new_entity->update_instance_data();
+    new_entity->mark_dirty();
 
     return new_entity;
 
@@ -59,10 +59,9 @@ std::unique_ptr<EditorScene::EntityElement> EditorScene::EntityElement::from_jso
     new_entity->rendered_entity->render_data.diffuse_texture = texture_from_json(scene_context, j["diffuse_texture"]);
     new_entity->rendered_entity->render_data.specular_map_texture = texture_from_json(scene_context, j["specular_map_texture"]);
     
-    new_entity->material.texture_scale = j["texture_scale"];
-    new_entity->rendered_entity->instance_data.material.texture_scale = new_entity->material.texture_scale;
+    new_entity->material().texture_scale = j["texture_scale"];
 
-    new_entity->update_instance_data();
+    new_entity->mark_dirty();
     return new_entity;
 }
 
@@ -85,7 +84,7 @@ json EditorScene::EntityElement::into_json() const {
         {"model", rendered_entity->model->get_filename().value()},
         {"diffuse_texture", texture_to_json(rendered_entity->render_data.diffuse_texture)},
         {"specular_map_texture", texture_to_json(rendered_entity->render_data.specular_map_texture)},
-        {"texture_scale", rendered_entity->instance_data.material.texture_scale}
+        {"texture_scale", material().texture_scale}
 
     };
 
@@ -100,27 +99,29 @@ void EditorScene::EntityElement::add_imgui_edit_section(MasterRenderScene& rende
     add_material_imgui_edit_section(render_scene, scene_context);
 
     // Task D - Material Properties
+    auto& material = this->material();
+    bool material_changed = false;
 
     // Diffuse properties
     ImGui::Text("Diffuse");
-    ImGui::ColorEdit3("Diffuse Tint", &rendered_entity->instance_data.material.diffuse_tint[0]);
-    ImGui::DragFloat("Diffuse Factor", &rendered_entity->instance_data.material.diffuse_tint.a, 0.01f, 0.0f, 10.0f);
+    material_changed |= ImGui::ColorEdit3("Diffuse Tint", &material.diffuse_tint[0]);
+    material_changed |= ImGui::DragFloat("Diffuse Factor", &material.diffuse_tint.a, 0.01f, 0.0f, 10.0f);
     ImGui::Spacing();
 
     // Specular properties
     ImGui::Text("Specular");
-    ImGui::ColorEdit3("Specular Tint", &rendered_entity->instance_data.material.specular_tint[0]);
-    ImGui::DragFloat("Specular Factor", &rendered_entity->instance_data.material.specular_tint.a, 0.01f, 0.0f, 10.0f);
+    material_changed |= ImGui::ColorEdit3("Specular Tint", &material.specular_tint[0]);
+    material_changed |= ImGui::DragFloat("Specular Factor", &material.specular_tint.a, 0.01f, 0.0f, 10.0f);
     ImGui::Spacing();
 
     // Ambient properties
     ImGui::Text("Ambient");
-    ImGui::ColorEdit3("Ambient Tint", &rendered_entity->instance_data.material.ambient_tint[0]);
-    ImGui::DragFloat("Ambient Factor", &rendered_entity->instance_data.material.ambient_tint.a, 0.01f, 0.0f, 10.0f);
+    material_changed |= ImGui::ColorEdit3("Ambient Tint", &material.ambient_tint[0]);
+    material_changed |= ImGui::DragFloat("Ambient Factor", &material.ambient_tint.a, 0.01f, 0.0f, 10.0f);
     ImGui::Spacing();
 
     // Shininess properties
-    ImGui::DragFloat("Shininess", &rendered_entity->instance_data.material.shininess, 1.0f, 0.0f, 150.0f);
+    material_changed |= ImGui::DragFloat("Shininess", &material.shininess, 1.0f, 0.0f, 150.0f);
     ImGui::Spacing();
 
     ImGui::DragDisableCursor(scene_context.window);
@@ -132,26 +133,11 @@ void EditorScene::EntityElement::add_imgui_edit_section(MasterRenderScene& rende
     scene_context.texture_loader.add_imgui_texture_selector("Specular Map", rendered_entity->render_data.specular_map_texture, false);
 
     // Task E
-    ImGui::DragFloat("Texture Scale", &rendered_entity->instance_data.material.texture_scale, 0.1f, 1.0f, 25.0f);
-}
-
-
-
-void EditorScene::EntityElement::update_instance_data() {
-    transform = calc_model_matrix();
+    material_changed |= ImGui::DragFloat("Texture Scale", &material.texture_scale, 0.1f, 1.0f, 25.0f);
 
-    if (!EditorScene::is_null(parent)) {
-        // Post multiply by transform so that local transformations are applied first
-        transform = (*parent)->transform * transform;
+    if (material_changed) {
+        mark_dirty();
     }
-
-    float temp_texture_scale = rendered_entity->instance_data.material.texture_scale;
-    rendered_entity->instance_data.material.texture_scale = temp_texture_scale;
-
-
-    rendered_entity->instance_data.model_matrix = transform;
-    rendered_entity->instance_data.material = material;
-    
 }
 
 
@@ -14,7 +14,10 @@ namespace EditorScene {
         std::shared_ptr<EntityRenderer::Entity> rendered_entity;
 
         EntityElement(const ElementRef& parent, std::string name, const glm::vec3& position, const glm::vec3& euler_rotation, const glm::vec3& scale, std::shared_ptr<EntityRenderer::Entity> rendered_entity) :
-            SceneElement(parent, std::move(name)), LocalTransformComponent(position, euler_rotation, scale), LitMaterialComponent(rendered_entity->instance_data.material), rendered_entity(std::move(rendered_entity)) {}
+            SceneElement(parent, std::move(name)), LocalTransformComponent(position, euler_rotation, scale), LitMaterialComponent(rendered_entity->instance_data.material), rendered_entity(std::move(rendered_entity)) {
+            components().link_model_matrix(id, &this->rendered_entity->instance_data.model_matrix);
+            components().link_lit_material(id, &this->rendered_entity->instance_data.material);
+        }
 
         static std::unique_ptr<EntityElement> new_default(const SceneContext& scene_context, ElementRef parent);
         static std::unique_ptr<EntityElement> from_json(const SceneContext& scene_context, ElementRef parent, const json& j);
@@ -22,8 +25,6 @@ namespace EditorScene {
 
         void add_imgui_edit_section(MasterRenderScene& render_scene, const SceneContext& scene_context) override;
 
-        void update_instance_data() override;
-
         void add_to_render_scene(MasterRenderScene& target_render_scene) override {
             target_render_scene.insert_entity(rendered_entity);
         }
@@ -66,7 +66,7 @@ std::unique_ptr<EditorScene::GroupElement> EditorScene::GroupElement::from_json(
 
     new_group->update_local_transform_from_json(j);
 
-    new_group->update_instance_data();
+    new_group->mark_dirty();
     return new_group;
 }
 
@@ -76,19 +76,6 @@ json EditorScene::GroupElement::into_json() const {
     };
 }
 
-void EditorScene::GroupElement::update_instance_data() {
-    transform = calc_model_matrix();
-
-    if (!EditorScene::is_null(parent)) {
-        // Post multiply by transform so that local transformations are applied first
-        transform = (*parent)->transform * transform;
-    }
-
-    for (const auto& item: (*children)) {
-        item->update_instance_data();
-    }
-}
-
 void EditorScene::GroupElement::add_child(std::unique_ptr<SceneElement> scene_element) {
     children->push_back(std::move(scene_element));
 }
@@ -24,8 +24,6 @@ namespace EditorScene {
 
         void add_imgui_edit_section(MasterRenderScene& render_scene, const SceneContext& scene_context) override;
 
-        void update_instance_data() override;
-
         void add_to_render_scene(MasterRenderScene& /*target_render_scene*/) override {}
 
         void remove_from_render_scene(MasterRenderScene& /*target_render_scene*/) override {}
@@ -1,6 +1,6 @@
 #include "ParticleEmitterElement.h"
+#include "CurlNoiseField.h"
 #include "rendering/imgui/ImGuiManager.h"
-#include "utility/Random.h"
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
 
@@ -15,7 +15,7 @@ ParticleEmitterElement::ParticleEmitterElement(const ElementRef& parent, std::st
 
 std::unique_ptr<ParticleEmitterElement> ParticleEmitterElement::new_default(const SceneContext& scene_context, ElementRef parent) {
     auto element = std::make_unique<ParticleEmitterElement>(parent, "New Particle Emitter");
-    element->update_instance_data();
+    element->mark_dirty();
     return element;
 }
 
@@ -38,8 +38,27 @@ std::unique_ptr<ParticleEmitterElement> ParticleEmitterElement::from_json(const
     element->endColor = j.value("endColor", element->endColor);
     element->gravity = j.value("gravity", element->gravity);
     element->worldSpaceParticles = j.value("worldSpaceParticles", element->worldSpaceParticles);
+    element->gpuSimulation = j.value("gpuSimulation", element->gpuSimulation);
+    element->depthSorted = j.value("depthSorted", element->depthSorted);
+    element->seed = j.value("seed", element->seed);
+    element->rng = RandomStream(element->seed);
+    element->fixedTimestep = j.value("fixedTimestep", element->fixedTimestep);
+    element->fixedStepRate = j.value("fixedStepRate", element->fixedStepRate);
+    element->maxSubSteps = j.value("maxSubSteps", element->maxSubSteps);
+    if (j.contains("interaction")) {
+        const json& interaction = j["interaction"];
+        element->interaction.radius = interaction.value("radius", element->interaction.radius);
+        element->interaction.separation = interaction.value("separation", element->interaction.separation);
+        element->interaction.cohesion = interaction.value("cohesion", element->interaction.cohesion);
+        element->interaction.alignment = interaction.value("alignment", element->interaction.alignment);
+        element->interaction.viscosity = interaction.value("viscosity", element->interaction.viscosity);
+    }
+    element->collideWithScene = j.value("collideWithScene", element->collideWithScene);
+    element->collisionRadius = j.value("collisionRadius", element->collisionRadius);
+    element->collisionBounce = j.value("collisionBounce", element->collisionBounce);
+    element->collisionFriction = j.value("collisionFriction", element->collisionFriction);
 
-    element->update_instance_data();
+    element->mark_dirty();
     return element;
 }
         
@@ -59,7 +78,24 @@ json ParticleEmitterElement::into_json() const {
         {"initialColorEnd", initialColorEnd},
         {"endColor", endColor},
         {"gravity", gravity},
-        {"worldSpaceParticles", worldSpaceParticles}
+        {"worldSpaceParticles", worldSpaceParticles},
+        {"gpuSimulation", gpuSimulation},
+        {"depthSorted", depthSorted},
+        {"seed", seed},
+        {"fixedTimestep", fixedTimestep},
+        {"fixedStepRate", fixedStepRate},
+        {"maxSubSteps", maxSubSteps},
+        {"interaction", {
+            {"radius", interaction.radius},
+            {"separation", interaction.separation},
+            {"cohesion", interaction.cohesion},
+            {"alignment", interaction.alignment},
+            {"viscosity", interaction.viscosity},
+        }},
+        {"collideWithScene", collideWithScene},
+        {"collisionRadius", collisionRadius},
+        {"collisionBounce", collisionBounce},
+        {"collisionFriction", collisionFriction}
     };
 }
 
@@ -72,8 +108,32 @@ void ParticleEmitterElement::add_imgui_edit_section(MasterRenderScene& render_sc
 
     ImGui::Checkbox("Enabled", &enabled);
     ImGui::Checkbox("World Space Particles", &worldSpaceParticles);
-    ImGui::DragFloat("Emission Rate", &emissionRate, 0.1f, 0.0f, 1000.0f);
-    ImGui::DragInt("Max Particles", &maxParticles, 1, 0, 10000);
+    ImGui::Checkbox("Simulate on GPU", &gpuSimulation);
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Simulate with transform feedback, for very large emitters");
+    }
+    ImGui::Checkbox("Depth Sorted", &depthSorted);
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Sort with other emitters' particles when particle depth sorting is on.\nTurn off for additive effects, which blend the same in any order.\nGPU simulated emitters are never sorted");
+    }
+    int intSeed = (int) seed;
+    if (ImGui::InputInt("Seed", &intSeed)) {
+        seed = (uint) intSeed;
+        rng = RandomStream(seed);
+    }
+    ImGui::Checkbox("Fixed Timestep", &fixedTimestep);
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Step at a fixed rate whatever the frame rate, drawing in between steps,\nso that the emitter plays out the same every time from a restart");
+    }
+    if (fixedTimestep) {
+        ImGui::DragFloat("Step Rate (Hz)", &fixedStepRate, 1.0f, 1.0f, 480.0f);
+        ImGui::SliderInt("Max Sub Steps", &maxSubSteps, 1, 16);
+    }
+    if (ImGui::Button("Restart")) {
+        restart();
+    }
+    ImGui::DragFloat("Emission Rate", &emissionRate, 0.1f, 0.0f, 100000.0f);
+    ImGui::DragInt("Max Particles", &maxParticles, 1, 0, 100000);
     ImGui::DragFloatRange2("Lifespan (s)", &particleLifespanMin, &particleLifespanMax, 0.01f, 0.0f, 60.0f);
     
     ImGui::Text("Initial Velocity Min"); ImGui::DragFloat3("##IVelMin", &initialVelocityMin[0], 0.01f);
@@ -105,19 +165,41 @@ void ParticleEmitterElement::add_imgui_edit_section(MasterRenderScene& render_sc
             ImGui::DragFloat("Strength", &turbulenceStrength, 0.1f, 0.0f, 10.0f);
             ImGui::DragFloat("Frequency", &turbulenceFrequency, 0.1f, 0.1f, 10.0f);
             if (ImGui::IsItemHovered()) {
-                ImGui::SetTooltip("How often the turbulence force updates");
+                ImGui::SetTooltip("Eddies per unit, higher values give smaller, tighter swirls");
             }
         }
-    }
 
-    ImGui::DragDisableCursor(scene_context.window);
-}
+        if (ImGui::CollapsingHeader("Interaction")) {
+            ImGui::DragFloat("Radius##Interaction", &interaction.radius, 0.01f, 0.01f, 10.0f);
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("How close particles have to be to steer by each other, the cost grows with how many are this close");
+            }
+            ImGui::DragFloat("Separation", &interaction.separation, 0.1f, 0.0f, 100.0f);
+            ImGui::DragFloat("Cohesion", &interaction.cohesion, 0.1f, 0.0f, 100.0f);
+            ImGui::DragFloat("Alignment", &interaction.alignment, 0.1f, 0.0f, 100.0f);
+            ImGui::DragFloat("Viscosity", &interaction.viscosity, 0.1f, 0.0f, 100.0f);
+            if (gpuSimulation && interaction.any()) {
+                ImGui::TextDisabled("Not applied to GPU simulated emitters");
+            }
+        }
+    }
 
-void ParticleEmitterElement::update_instance_data() {
-    transform = calc_model_matrix();
-    if (!EditorScene::is_null(parent)) {
-        transform = (*parent)->transform * transform;
+    if (ImGui::CollapsingHeader("Collision")) {
+        ImGui::Checkbox("Collide With Scene", &collideWithScene);
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Bounce off the static entities' models, through a coarse distance field\nthat is baked when they change");
+        }
+        if (collideWithScene) {
+            ImGui::DragFloat("Radius##Collision", &collisionRadius, 0.005f, 0.0f, 1.0f);
+            ImGui::SliderFloat("Bounce", &collisionBounce, 0.0f, 1.0f);
+            ImGui::SliderFloat("Friction", &collisionFriction, 0.0f, 1.0f);
+            if (gpuSimulation) {
+                ImGui::TextDisabled("Not applied to GPU simulated emitters");
+            }
+        }
     }
+
+    ImGui::DragDisableCursor(scene_context.window);
 }
 
 void ParticleEmitterElement::add_to_render_scene(MasterRenderScene& target_render_scene) {
@@ -132,124 +214,189 @@ const char* ParticleEmitterElement::element_type_name() const {
     return ELEMENT_TYPE_NAME;
 }
 
-void ParticleEmitterElement::tick_particles(float deltaTime, const SceneContext&) {
+void ParticleEmitterElement::tick_particles(float deltaTime, JobSystem& job_system, const SignedDistanceField* collision_field) {
+    instanceCount = 0;
     if (!enabled) {
         return;
     }
 
-    emissionTimer += deltaTime;
-    turbulenceTimer += deltaTime;
+    // The renderer does the rest on the GPU, starting from the slots the spawn window covers
+    if (gpuSimulation) {
+        particles.clear();
+        emissionTimer += deltaTime;
+        gpuPendingDeltaTime += deltaTime;
+        gpuPendingEmission = std::min(gpuPendingEmission + take_emission(emissionRate), std::max(maxParticles, 0));
+        return;
+    }
 
-    if (turbulenceTimer >= 1.0f / turbulenceFrequency) {
-        turbulenceTimer = 0.0f;
+    // Allocated once for the maximum, so emitting and dying never reallocate
+    size_t capacity = static_cast<size_t>(std::max(maxParticles, 0));
+    if (particles.capacity() != capacity) {
+        particles.set_capacity(capacity);
     }
 
-    int particlesToEmit = static_cast<int>(emissionTimer * emissionRate);
-    if (particlesToEmit > 0) {
-        emissionTimer -= static_cast<float>(particlesToEmit) / emissionRate;
+    // Out of view, only keep the particles' lives counting down, so none outlive their lifespan while nobody is looking.
+    // The emission timer still runs, but nothing is spawned, so the emitter doesn't burst when it comes back into view.
+    // Fixed timestep emitters keep stepping in full, just without being written out, so they play out the same wherever the camera is
+    if (!lodVisible && !fixedTimestep) {
+        emissionTimer += deltaTime;
+        take_emission(emissionRate);
+        particles.age(deltaTime);
+        // Still following the emitter, so that it's seen again when it's moved into view
+        update_world_bounds();
+        lodPendingDeltaTime = 0.0f;
+        lodTicksSinceStep = 0;
+        return;
     }
 
-    glm::vec3 emitter_position = glm::vec3(transform[3]);
+    lodPendingDeltaTime += deltaTime;
+    // How far the drawn positions are from the last step's to the latest's
+    float interpolation = 1.0f;
+    if (fixedTimestep) {
+        // Whole steps out of the time built up, always the same length whatever the LOD, since the steps are what is reproduced,
+        // and the remainder is carried over to the next tick, and drawn as how far the next step is through
+        float stepDeltaTime = 1.0f / std::max(fixedStepRate, 1.0f);
+        int steps = static_cast<int>(lodPendingDeltaTime / stepDeltaTime);
+        if (steps > std::max(maxSubSteps, 1)) {
+            steps = std::max(maxSubSteps, 1);
+            lodPendingDeltaTime = steps * stepDeltaTime;
+        }
+        for (int step = 0; step < steps; ++step) {
+            // Only the last step is drawn from, so the positions before it are the only ones worth keeping
+            if (step == steps - 1) {
+                particles.store_previous_positions();
+            }
+            step_simulation(stepDeltaTime, job_system, collision_field);
+            lodPendingDeltaTime -= stepDeltaTime;
+        }
+        lodPendingDeltaTime = std::max(lodPendingDeltaTime, 0.0f);
+        interpolation = std::min(lodPendingDeltaTime / stepDeltaTime, 1.0f);
+        lodTicksSinceStep = 0;
+    } else if (++lodTicksSinceStep >= lodStepInterval) {
+        // Far away, step less often by the time built up since the last step, and draw the last step's particles in between
+        step_simulation(lodPendingDeltaTime, job_system, collision_field);
+        lodPendingDeltaTime = 0.0f;
+        lodTicksSinceStep = 0;
+    }
+    // Every tick, since a local space emitter's particles follow it as it moves even when they aren't stepped
+    update_world_bounds();
 
-    for (int i = 0; i < particlesToEmit && particles.size() < static_cast<size_t>(maxParticles); ++i) {
-        Particle p;
-        p.totalLife = Random::range(particleLifespanMin, particleLifespanMax);
-        p.lifeRemaining = p.totalLife;
+    if (instanceOutput != nullptr) {
+        instanceCount = particles.write_instances(worldSpaceParticles ? nullptr : &transform(), instanceOrigin, instanceOutput, instanceCapacity, interpolation);
+    }
+}
+
+void ParticleEmitterElement::step_simulation(float stepDeltaTime, JobSystem& job_system, const SignedDistanceField* collision_field) {
+    emissionTimer += stepDeltaTime;
+
+    // Drift through the field at a slant, so that no axis of it repeats sooner than the others, wrapped so the offset stays precise
+    constexpr glm::vec3 TURBULENCE_DRIFT{0.31f, 0.23f, 0.17f};
+    turbulenceOffset = glm::mod(turbulenceOffset + TURBULENCE_DRIFT * stepDeltaTime, glm::vec3((float) CurlNoiseField::LATTICE));
+
+    glm::vec3 emitter_position = glm::vec3(transform()[3]);
+
+    int particlesToEmit = take_emission(fixedTimestep ? emissionRate : emissionRate * lodEmissionScale);
+    for (int i = 0; i < particlesToEmit && !particles.full(); ++i) {
+        float life = rng.range(particleLifespanMin, particleLifespanMax);
 
         float spread = 0.5f;
         glm::vec3 randomOffset(
-            Random::range(-spread, spread),
-            Random::range(-spread, spread),
-            Random::range(-spread, spread)
+            rng.range(-spread, spread),
+            rng.range(-spread, spread),
+            rng.range(-spread, spread)
         );
-        
-        if (worldSpaceParticles) {
-            p.position = emitter_position + randomOffset;
-        } else {
-            p.position = randomOffset;
-        }
-        
+
+        glm::vec3 position = worldSpaceParticles ? emitter_position + randomOffset : randomOffset;
+
         // Initial particle velocity
         glm::vec3 randomVelocity;
-        randomVelocity.x = Random::range(initialVelocityMin.x, initialVelocityMax.x);
-        randomVelocity.y = Random::range(initialVelocityMin.y, initialVelocityMax.y);
-        randomVelocity.z = Random::range(initialVelocityMin.z, initialVelocityMax.z);
- 
-        p.velocity = randomVelocity;
+        randomVelocity.x = rng.range(initialVelocityMin.x, initialVelocityMax.x);
+        randomVelocity.y = rng.range(initialVelocityMin.y, initialVelocityMax.y);
+        randomVelocity.z = rng.range(initialVelocityMin.z, initialVelocityMax.z);
 
         // Size from UI parameters
-        p.size = Random::range(initialSizeMin, initialSizeMax);
-        
+        float size = rng.range(initialSizeMin, initialSizeMax);
+
         // Rotation from UI parameters
-        p.rotation = Random::range(initialRotationMin, initialRotationMax);
-        p.angularVelocity = Random::range(angularVelocityMin, angularVelocityMax);
-        
+        float rotation = rng.range(initialRotationMin, initialRotationMax);
+        float angularVelocity = rng.range(angularVelocityMin, angularVelocityMax);
+
         // Colour from UI parameters
-        float colorLerpFactor = Random::range(0.0f, 1.0f);
-        p.color = glm::mix(initialColorStart, initialColorEnd, colorLerpFactor);
+        float colorLerpFactor = rng.range(0.0f, 1.0f);
+        glm::vec4 color = glm::mix(initialColorStart, initialColorEnd, colorLerpFactor);
 
-        particles.push_back(p);
+        particles.emit(position, randomVelocity, color, size, life, rotation, angularVelocity);
     }
 
-    bool first_updated = true;
+    particles.age(stepDeltaTime);
+
+    // Particles steering by each other, after ageing so that the grid only holds the live ones.
+    // Emitters are already ticked in parallel, so the grid only spreads across threads when this emitter is ticked alone
+    if (interaction.any()) {
+        neighbourGrid.build(particles, interaction.radius, job_system);
+        particles.interact(neighbourGrid, interaction, stepDeltaTime, job_system);
+    }
 
-    for (size_t i = 0; i < particles.size();) {
-        Particle& p = particles[i];
-        p.lifeRemaining -= deltaTime;
+    // Gravity and wind are the same for every particle, so apply them together
+    particles.accelerate(gravity + windForce, stepDeltaTime);
 
-        if (p.lifeRemaining <= 0.0f) {
-            particles.erase(particles.begin() + i);
-        } else {
-            if (first_updated) {
-                first_updated = false;
-            }
+    // Apply attractor/repulsor force
+    particles.attract(attractorPosition, attractorStrength, attractorRadius, stepDeltaTime);
 
-            // Apply gravity
-            p.velocity += gravity * deltaTime;
+    // Apply turbulence, from the shared curl noise field so that nearby particles swirl together
+    particles.turbulence(CurlNoiseField::shared(), turbulenceOffset, turbulenceFrequency, turbulenceStrength, stepDeltaTime);
 
-            // Apply "wind" force
-            p.velocity += windForce * deltaTime;
+    particles.integrate(stepDeltaTime);
+    // After moving, so that no particle is left drawn inside a surface
+    if (collideWithScene && collision_field != nullptr) {
+        particles.collide(*collision_field, worldSpaceParticles ? nullptr : &transform(), collisionRadius, collisionBounce, collisionFriction, job_system);
+    }
+    particles.fade(endColor, endSizeFactor);
+}
 
-            // Apply attractor/repulsor force
-            if (attractorStrength != 0.0f) {
-                glm::vec3 toAttractor = attractorPosition - p.position;
-                float distance = glm::length(toAttractor);
-                if (distance < attractorRadius) {
-                    float force = attractorStrength * (1.0f - distance / attractorRadius);
-                    p.velocity += glm::normalize(toAttractor) * force * deltaTime;
-                }
-            }
+void ParticleEmitterElement::restart() {
+    particles.clear();
+    rng = RandomStream(seed);
+    emissionTimer = 0.0f;
+    turbulenceOffset = glm::vec3{0.0f};
+    lodPendingDeltaTime = 0.0f;
+    lodTicksSinceStep = 0;
+    gpuPendingDeltaTime = 0.0f;
+    gpuPendingEmission = 0;
+    gpuParticles = nullptr;
+}
 
-            // Apply turbulence
-            if (turbulenceStrength > 0.0f) {
-                glm::vec3 turbulence(
-                    Random::range(-1.0f, 1.0f),
-                    Random::range(-1.0f, 1.0f),
-                    Random::range(-1.0f, 1.0f)
-                );
-                p.velocity += glm::normalize(turbulence) * turbulenceStrength * deltaTime;
-            }
+int ParticleEmitterElement::take_emission(float rate) {
+    int due = static_cast<int>(emissionTimer * rate);
+    if (due > 0) {
+        emissionTimer -= static_cast<float>(due) / rate;
+    }
+    return due;
+}
 
-            // Update position
-            p.position += p.velocity * deltaTime;
-            p.rotation += p.angularVelocity * deltaTime;
-            
-            float lifeRatio = 1.0f - (p.lifeRemaining / p.totalLife);
-            
-            glm::vec4 initialColor = p.color;
-            p.color = glm::mix(initialColor, endColor, lifeRatio);
-            
-            float sizeAtEmission = p.size;
-            p.size = glm::mix(sizeAtEmission, sizeAtEmission * endSizeFactor, lifeRatio);
-            
-            i++;
-        }
+void ParticleEmitterElement::update_world_bounds() {
+    // Particles spawn within half a unit of the emitter on each axis, see tick_particles
+    BoundingBox spawn_area{glm::vec3{-0.5f}, glm::vec3{0.5f}};
+
+    if (worldSpaceParticles) {
+        worldBounds = particles.bounds();
+        glm::vec3 emitter_position = glm::vec3(transform()[3]);
+        worldBounds.expand(BoundingBox{emitter_position + spawn_area.min, emitter_position + spawn_area.max});
+    } else {
+        BoundingBox local_bounds = particles.bounds();
+        local_bounds.expand(spawn_area);
+        worldBounds = local_bounds.transformed(transform());
     }
 }
 
 void ParticleEmitterElement::draw_properties() {
     ImGui::Checkbox("Enabled", &enabled);
     ImGui::Checkbox("World Space Particles", &worldSpaceParticles);
+    ImGui::Checkbox("Simulate on GPU", &gpuSimulation);
+    ImGui::Checkbox("Depth Sorted", &depthSorted);
+    ImGui::Checkbox("Fixed Timestep", &fixedTimestep);
+    ImGui::InputFloat("Fixed Step Rate", &fixedStepRate, 1.0f, 10.0f);
+    ImGui::InputInt("Max Sub Steps", &maxSubSteps, 1, 4);
     ImGui::InputFloat("Emission Rate", &emissionRate, 0.1f, 1.0f);
     ImGui::InputInt("Max Particles", &maxParticles, 1, 10);
     ImGui::InputFloat("Particle Lifespan Min", &particleLifespanMin, 0.1f, 1.0f);
@@ -285,9 +432,24 @@ void ParticleEmitterElement::draw_properties() {
             ImGui::InputFloat("Strength", &turbulenceStrength, 0.1f, 1.0f);
             ImGui::InputFloat("Frequency", &turbulenceFrequency, 0.1f, 1.0f);
             if (ImGui::IsItemHovered()) {
-                ImGui::SetTooltip("How often the turbulence force updates");
+                ImGui::SetTooltip("Eddies per unit, higher values give smaller, tighter swirls");
             }
         }
+
+        if (ImGui::CollapsingHeader("Interaction")) {
+            ImGui::InputFloat("Radius##Interaction", &interaction.radius, 0.01f, 0.1f);
+            ImGui::InputFloat("Separation", &interaction.separation, 0.1f, 1.0f);
+            ImGui::InputFloat("Cohesion", &interaction.cohesion, 0.1f, 1.0f);
+            ImGui::InputFloat("Alignment", &interaction.alignment, 0.1f, 1.0f);
+            ImGui::InputFloat("Viscosity", &interaction.viscosity, 0.1f, 1.0f);
+        }
+    }
+
+    if (ImGui::CollapsingHeader("Collision")) {
+        ImGui::Checkbox("Collide With Scene", &collideWithScene);
+        ImGui::InputFloat("Radius##Collision", &collisionRadius, 0.01f, 0.1f);
+        ImGui::InputFloat("Bounce", &collisionBounce, 0.1f, 0.5f);
+        ImGui::InputFloat("Friction", &collisionFriction, 0.1f, 0.5f);
     }
 }
 
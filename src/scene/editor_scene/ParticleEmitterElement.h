@@ -2,7 +2,10 @@
 #define PARTICLE_EMITTER_ELEMENT_H
 
 #include "SceneElement.h"
+#include "ParticlePool.h"
+#include "SpatialHashGrid.h"
 #include "scene/SceneContext.h"
+#include "utility/Random.h"
 #include <vector>
 #include <string>
 #include <glm/glm.hpp>
@@ -10,19 +13,10 @@
 
 using json = nlohmann::json;
 
-namespace EditorScene {
+// Forward declaration
+namespace ParticleRenderer { class GpuParticleBuffers; }
 
-    // Represents a single particle
-    struct Particle {
-        glm::vec3 position{0.0f};
-        glm::vec3 velocity{0.0f};
-        glm::vec4 color{1.0f};
-        float size = 1.0f;
-        float lifeRemaining = 0.0f;
-        float totalLife = 1.0f;
-        float rotation = 0.0f;
-        float angularVelocity = 0.0f;
-    };
+namespace EditorScene {
 
     class ParticleEmitterElement : virtual public SceneElement, public LocalTransformComponent {
     public:
@@ -47,22 +41,73 @@ namespace EditorScene {
         glm::vec4 endColor{ 1.0f, 1.0f, 1.0f, 0.0f }; // Fades out by default
         glm::vec3 gravity{ 0.0f, -0.98f, 0.0f };
         bool worldSpaceParticles = false; // If true, particles are not affected by emitter's transform after emission
+        bool gpuSimulation = false; // If true, particles are simulated and drawn entirely on the GPU, and never read back
+        bool depthSorted = true; // If false, skipped by the renderer's depth sort, e.g. for additive effects where order doesn't matter
+        uint seed = Random::next_seed(); // Seeds the emitter's generator, so a saved emitter comes back with the same random sequence
+        bool fixedTimestep = false; // If true, stepped at fixedStepRate whatever the frame rate, so that the same seed always plays out the same
+        float fixedStepRate = 60.0f; // Steps per second
+        int maxSubSteps = 4; // The most fixed steps in one tick, the time past them is dropped so that a long frame can't snowball
 
         // Force Properties
         glm::vec3 windForce{ 0.0f, 0.0f, 0.0f };
         glm::vec3 attractorPosition{ 0.0f, 0.0f, 0.0f };
         float attractorStrength = 0.0f;
         float attractorRadius = 5.0f;
-        float turbulenceStrength = 0.0f;
-        float turbulenceFrequency = 1.0f;
+        float turbulenceStrength = 0.0f; // Speed added per second where the curl noise field is average
+        float turbulenceFrequency = 1.0f; // Eddies per unit
+        ParticleInteraction interaction{}; // Between the emitter's own particles, found through neighbourGrid when any are on
+
+        // Collision Properties
+        bool collideWithScene = false; // If true, particles bounce off the static entities, through the render scene's static collision field
+        float collisionRadius = 0.05f; // How far from surfaces particles are kept
+        float collisionBounce = 0.3f; // How much of the speed into a surface is kept, bouncing back out
+        float collisionFriction = 0.1f; // How much of the speed along a surface is lost each step touching it
 
         // Internal State
-        std::vector<Particle> particles;
+        ParticlePool particles;
         std::shared_ptr<TextureHandle> textureHandle;
-        
+
+        // GPU simulation state, created by the ParticleRenderer, which also consumes the pending time and emission each frame
+        std::shared_ptr<ParticleRenderer::GpuParticleBuffers> gpuParticles;
+        float gpuPendingDeltaTime = 0.0f;
+        int gpuPendingEmission = 0;
+
+        // This emitter's range of the ParticleRenderer's instance stream, or of its depth sort staging if instanceDepthSorted,
+        // assigned before ticking, so that emitters can write out their particles in parallel. instanceCount are written each tick.
+        ParticleInstance* instanceOutput = nullptr;
+        size_t instanceOffset = 0;
+        size_t instanceCapacity = 0;
+        size_t instanceCount = 0;
+        bool instanceDepthSorted = false;
+        // What the instance positions are written relative to, see ParticleInstance
+        glm::vec3 instanceOrigin{0.0f};
+
+        // Level of detail, picked by the ParticleRenderer before ticking from the last frame's camera, see ParticleLodSettings.
+        // Fixed timestep emitters ignore all but lodVisible's not writing out, so that they play out the same wherever the camera is
+        bool lodVisible = true; // If false, nothing is written out, and the particles only age and nothing is emitted
+        uint lodStepInterval = 1; // Simulate every this many ticks, by the time built up since the last step
+        float lodEmissionScale = 1.0f;
+        // A conservative world space box around the live particles and where new ones spawn, updated as the emitter steps
+        BoundingBox worldBounds{};
+
     private:
         float emissionTimer = 0.0f;
-        float turbulenceTimer = 0.0f;
+        float lodPendingDeltaTime = 0.0f;
+        uint lodTicksSinceStep = 0;
+        // How far the curl noise field has drifted, so the turbulence changes over time
+        glm::vec3 turbulenceOffset{0.0f};
+        // Each emitter draws from its own generator, so that emitters can be ticked in parallel
+        RandomStream rng{seed};
+        // Rebuilt each step that has interaction forces on
+        SpatialHashGrid neighbourGrid{};
+
+        /// How many particles are due at rate particles per second, taking them off the emission timer
+        int take_emission(float rate);
+        /// Advance the simulation by stepDeltaTime, emitting at lodEmissionScale of the emission rate unless fixedTimestep,
+        /// colliding with collision_field if it isn't null and collideWithScene is on
+        void step_simulation(float stepDeltaTime, JobSystem& job_system, const SignedDistanceField* collision_field);
+        /// Set worldBounds from the live particles and the spawn area, in world space
+        void update_world_bounds();
 
     public:
         ParticleEmitterElement(const ElementRef& parent, std::string name);
@@ -72,13 +117,14 @@ namespace EditorScene {
 
         [[nodiscard]] json into_json() const override;
         void add_imgui_edit_section(MasterRenderScene& render_scene, const SceneContext& scene_context) override;
-        void update_instance_data() override;
         void add_to_render_scene(MasterRenderScene& target_render_scene) override;
         void remove_from_render_scene(MasterRenderScene& target_render_scene) override;
         [[nodiscard]] const char* element_type_name() const override;
         
-        // Particle simulation logic
-        void tick_particles(float deltaTime, const SceneContext& scene_context);
+        // Particle simulation logic, only touches this emitter, so different emitters can be ticked on different threads
+        void tick_particles(float deltaTime, JobSystem& job_system, const SignedDistanceField* collision_field);
+        /// Start over with no particles and the generator reseeded, so that a fixed timestep emitter plays out exactly as it did from the last restart
+        void restart();
         void draw_properties();
     };
 
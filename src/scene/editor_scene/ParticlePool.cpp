@@ -0,0 +1,448 @@
+#include "ParticlePool.h"
+#include "CurlNoiseField.h"
+#include "SpatialHashGrid.h"
+
+#include <cmath>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define PARTICLE_POOL_SSE
+#include <emmintrin.h>
+#endif
+
+namespace EditorScene {
+
+namespace {
+    constexpr size_t LANES = 4;
+
+    /// How many particles at the front of the pool can be processed four at a time, the rest are done one by one
+    size_t simd_count(size_t count) {
+#ifdef PARTICLE_POOL_SSE
+        return count - count % LANES;
+#else
+        return 0;
+#endif
+    }
+}
+
+void ParticlePool::set_capacity(size_t new_capacity) {
+    for (auto* array: arrays()) {
+        array->resize(new_capacity);
+    }
+    count = std::min(count, new_capacity);
+}
+
+size_t ParticlePool::emit(const glm::vec3& position, const glm::vec3& velocity, const glm::vec4& color, float particleSize, float life, float particleRotation, float particleAngularVelocity) {
+    size_t i = count++;
+    positionX[i] = position.x;
+    positionY[i] = position.y;
+    positionZ[i] = position.z;
+    previousPositionX[i] = position.x;
+    previousPositionY[i] = position.y;
+    previousPositionZ[i] = position.z;
+    set_velocity(i, velocity);
+    colorR[i] = color.r;
+    colorG[i] = color.g;
+    colorB[i] = color.b;
+    colorA[i] = color.a;
+    size[i] = particleSize;
+    lifeRemaining[i] = life;
+    totalLife[i] = life;
+    rotation[i] = particleRotation;
+    angularVelocity[i] = particleAngularVelocity;
+    return i;
+}
+
+void ParticlePool::kill(size_t i) {
+    size_t last = --count;
+    if (i == last) {
+        return;
+    }
+    for (auto* array: arrays()) {
+        (*array)[i] = (*array)[last];
+    }
+}
+
+void ParticlePool::store_previous_positions() {
+    std::copy_n(positionX.begin(), count, previousPositionX.begin());
+    std::copy_n(positionY.begin(), count, previousPositionY.begin());
+    std::copy_n(positionZ.begin(), count, previousPositionZ.begin());
+}
+
+void ParticlePool::age(float deltaTime) {
+    size_t i = 0;
+#ifdef PARTICLE_POOL_SSE
+    __m128 dt = _mm_set1_ps(deltaTime);
+    for (; i < simd_count(count); i += LANES) {
+        _mm_storeu_ps(&lifeRemaining[i], _mm_sub_ps(_mm_loadu_ps(&lifeRemaining[i]), dt));
+    }
+#endif
+    for (; i < count; ++i) {
+        lifeRemaining[i] -= deltaTime;
+    }
+
+    // Walk backwards, so the particle swapped into a dead one's place has already been checked
+    for (size_t j = count; j > 0; --j) {
+        if (lifeRemaining[j - 1] <= 0.0f) {
+            kill(j - 1);
+        }
+    }
+}
+
+void ParticlePool::accelerate(const glm::vec3& acceleration, float deltaTime) {
+    glm::vec3 dv = acceleration * deltaTime;
+    size_t i = 0;
+#ifdef PARTICLE_POOL_SSE
+    __m128 dvx = _mm_set1_ps(dv.x), dvy = _mm_set1_ps(dv.y), dvz = _mm_set1_ps(dv.z);
+    for (; i < simd_count(count); i += LANES) {
+        _mm_storeu_ps(&velocityX[i], _mm_add_ps(_mm_loadu_ps(&velocityX[i]), dvx));
+        _mm_storeu_ps(&velocityY[i], _mm_add_ps(_mm_loadu_ps(&velocityY[i]), dvy));
+        _mm_storeu_ps(&velocityZ[i], _mm_add_ps(_mm_loadu_ps(&velocityZ[i]), dvz));
+    }
+#endif
+    for (; i < count; ++i) {
+        velocityX[i] += dv.x;
+        velocityY[i] += dv.y;
+        velocityZ[i] += dv.z;
+    }
+}
+
+void ParticlePool::attract(const glm::vec3& point, float strength, float radius, float deltaTime) {
+    if (strength == 0.0f || radius <= 0.0f) {
+        return;
+    }
+
+    size_t i = 0;
+#ifdef PARTICLE_POOL_SSE
+    __m128 px = _mm_set1_ps(point.x), py = _mm_set1_ps(point.y), pz = _mm_set1_ps(point.z);
+    __m128 strength_dt = _mm_set1_ps(strength * deltaTime);
+    __m128 r = _mm_set1_ps(radius);
+    __m128 inverse_r = _mm_set1_ps(1.0f / radius);
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128 zero = _mm_setzero_ps();
+    for (; i < simd_count(count); i += LANES) {
+        __m128 dx = _mm_sub_ps(px, _mm_loadu_ps(&positionX[i]));
+        __m128 dy = _mm_sub_ps(py, _mm_loadu_ps(&positionY[i]));
+        __m128 dz = _mm_sub_ps(pz, _mm_loadu_ps(&positionZ[i]));
+        __m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+
+        // Only particles inside the radius, and not exactly on the point where there's no direction to pull in
+        __m128 in_range = _mm_and_ps(_mm_cmplt_ps(distance, r), _mm_cmpgt_ps(distance, zero));
+        __m128 falloff = _mm_sub_ps(one, _mm_mul_ps(distance, inverse_r));
+        // Normalising the offset folds into the scale, and the masked lanes divide by zero but are then discarded
+        __m128 scale = _mm_and_ps(in_range, _mm_div_ps(_mm_mul_ps(falloff, strength_dt), distance));
+
+        _mm_storeu_ps(&velocityX[i], _mm_add_ps(_mm_loadu_ps(&velocityX[i]), _mm_mul_ps(dx, scale)));
+        _mm_storeu_ps(&velocityY[i], _mm_add_ps(_mm_loadu_ps(&velocityY[i]), _mm_mul_ps(dy, scale)));
+        _mm_storeu_ps(&velocityZ[i], _mm_add_ps(_mm_loadu_ps(&velocityZ[i]), _mm_mul_ps(dz, scale)));
+    }
+#endif
+    for (; i < count; ++i) {
+        glm::vec3 toPoint = point - get_position(i);
+        float distance = glm::length(toPoint);
+        if (distance < radius && distance > 0.0f) {
+            float force = strength * (1.0f - distance / radius);
+            set_velocity(i, get_velocity(i) + toPoint / distance * force * deltaTime);
+        }
+    }
+}
+
+void ParticlePool::turbulence(const CurlNoiseField& field, const glm::vec3& offset, float frequency, float strength, float deltaTime) {
+    if (strength == 0.0f) {
+        return;
+    }
+
+    float scale = strength * deltaTime;
+    size_t i = 0;
+#ifdef PARTICLE_POOL_SSE
+    __m128 cells_per_unit = _mm_set1_ps(frequency * CurlNoiseField::CELLS_PER_UNIT);
+    __m128 offset_x = _mm_set1_ps(offset.x * CurlNoiseField::CELLS_PER_UNIT);
+    __m128 offset_y = _mm_set1_ps(offset.y * CurlNoiseField::CELLS_PER_UNIT);
+    __m128 offset_z = _mm_set1_ps(offset.z * CurlNoiseField::CELLS_PER_UNIT);
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128 scale4 = _mm_set1_ps(scale);
+    __m128i one_i = _mm_set1_epi32(1);
+    __m128i mask = _mm_set1_epi32(CurlNoiseField::MASK);
+
+    // Splits a grid coordinate into its cell, wrapped into the field, and how far along the cell it is
+    auto split = [&](__m128 grid, __m128i& cell0, __m128i& cell1) {
+        // Truncation rounds towards zero, so step the negative ones down to floor them
+        __m128 floored = _mm_cvtepi32_ps(_mm_cvttps_epi32(grid));
+        floored = _mm_sub_ps(floored, _mm_and_ps(_mm_cmplt_ps(grid, floored), one));
+        __m128i cell = _mm_cvttps_epi32(floored);
+        cell0 = _mm_and_si128(cell, mask);
+        cell1 = _mm_and_si128(_mm_add_epi32(cell, one_i), mask);
+        return _mm_sub_ps(grid, floored);
+    };
+
+    for (; i < simd_count(count); i += LANES) {
+        __m128i x0, x1, y0, y1, z0, z1;
+        __m128 tx = split(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&positionX[i]), cells_per_unit), offset_x), x0, x1);
+        __m128 ty = split(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&positionY[i]), cells_per_unit), offset_y), y0, y1);
+        __m128 tz = split(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&positionZ[i]), cells_per_unit), offset_z), z0, z1);
+        __m128 sx = _mm_sub_ps(one, tx), sy = _mm_sub_ps(one, ty), sz = _mm_sub_ps(one, tz);
+
+        constexpr int ROW_SHIFT = CurlNoiseField::RESOLUTION_SHIFT;
+        __m128i zy00 = _mm_add_epi32(_mm_slli_epi32(z0, 2 * ROW_SHIFT), _mm_slli_epi32(y0, ROW_SHIFT));
+        __m128i zy01 = _mm_add_epi32(_mm_slli_epi32(z0, 2 * ROW_SHIFT), _mm_slli_epi32(y1, ROW_SHIFT));
+        __m128i zy10 = _mm_add_epi32(_mm_slli_epi32(z1, 2 * ROW_SHIFT), _mm_slli_epi32(y0, ROW_SHIFT));
+        __m128i zy11 = _mm_add_epi32(_mm_slli_epi32(z1, 2 * ROW_SHIFT), _mm_slli_epi32(y1, ROW_SHIFT));
+        __m128 w00 = _mm_mul_ps(sy, sz), w01 = _mm_mul_ps(ty, sz), w10 = _mm_mul_ps(sy, tz), w11 = _mm_mul_ps(ty, tz);
+
+        // SSE2 has no gather, so each corner is loaded one lane at a time, but everything around the loads is four wide
+        __m128 push_x = _mm_setzero_ps(), push_y = _mm_setzero_ps(), push_z = _mm_setzero_ps();
+        auto add_corner = [&](__m128i index, __m128 weight) {
+            alignas(16) int lanes[LANES];
+            _mm_store_si128((__m128i*) lanes, index);
+            push_x = _mm_add_ps(push_x, _mm_mul_ps(weight, _mm_setr_ps(field.velocityX[lanes[0]], field.velocityX[lanes[1]], field.velocityX[lanes[2]], field.velocityX[lanes[3]])));
+            push_y = _mm_add_ps(push_y, _mm_mul_ps(weight, _mm_setr_ps(field.velocityY[lanes[0]], field.velocityY[lanes[1]], field.velocityY[lanes[2]], field.velocityY[lanes[3]])));
+            push_z = _mm_add_ps(push_z, _mm_mul_ps(weight, _mm_setr_ps(field.velocityZ[lanes[0]], field.velocityZ[lanes[1]], field.velocityZ[lanes[2]], field.velocityZ[lanes[3]])));
+        };
+        add_corner(_mm_add_epi32(zy00, x0), _mm_mul_ps(w00, sx));
+        add_corner(_mm_add_epi32(zy00, x1), _mm_mul_ps(w00, tx));
+        add_corner(_mm_add_epi32(zy01, x0), _mm_mul_ps(w01, sx));
+        add_corner(_mm_add_epi32(zy01, x1), _mm_mul_ps(w01, tx));
+        add_corner(_mm_add_epi32(zy10, x0), _mm_mul_ps(w10, sx));
+        add_corner(_mm_add_epi32(zy10, x1), _mm_mul_ps(w10, tx));
+        add_corner(_mm_add_epi32(zy11, x0), _mm_mul_ps(w11, sx));
+        add_corner(_mm_add_epi32(zy11, x1), _mm_mul_ps(w11, tx));
+
+        _mm_storeu_ps(&velocityX[i], _mm_add_ps(_mm_loadu_ps(&velocityX[i]), _mm_mul_ps(push_x, scale4)));
+        _mm_storeu_ps(&velocityY[i], _mm_add_ps(_mm_loadu_ps(&velocityY[i]), _mm_mul_ps(push_y, scale4)));
+        _mm_storeu_ps(&velocityZ[i], _mm_add_ps(_mm_loadu_ps(&velocityZ[i]), _mm_mul_ps(push_z, scale4)));
+    }
+#endif
+    for (; i < count; ++i) {
+        glm::vec3 push = field.sample(get_position(i) * frequency + offset) * scale;
+        velocityX[i] += push.x;
+        velocityY[i] += push.y;
+        velocityZ[i] += push.z;
+    }
+}
+
+void ParticlePool::interact(const SpatialHashGrid& grid, const ParticleInteraction& interaction, float deltaTime, JobSystem& job_system) {
+    // Interacting splits into chunks of at least this many particles
+    constexpr uint MIN_CHUNK = 1024;
+
+    auto grid_count = grid.get_count();
+    if (grid_count == 0 || interaction.radius <= 0.0f) return;
+    for (auto* array: {&interactionVelocityX, &interactionVelocityY, &interactionVelocityZ, &interactionDeltaX, &interactionDeltaY, &interactionDeltaZ}) {
+        array->resize(grid_count);
+    }
+
+    float radius = std::min(interaction.radius, grid.get_cell_size());
+    float inverse_radius = 1.0f / radius;
+    const auto& order = grid.get_sorted_particles();
+
+    // Everything is done in the grid's order, so that the neighbours' velocities are read in order like their positions,
+    // and consecutive particles look through mostly the same cells
+    job_system.parallel_for(grid_count, MIN_CHUNK, [&](uint begin, uint end) {
+        for (auto slot = begin; slot < end; ++slot) {
+            uint i = order[slot];
+            interactionVelocityX[slot] = velocityX[i];
+            interactionVelocityY[slot] = velocityY[i];
+            interactionVelocityZ[slot] = velocityZ[i];
+        }
+    });
+
+    job_system.parallel_for(grid_count, MIN_CHUNK, [&](uint begin, uint end) {
+        for (auto slot = begin; slot < end; ++slot) {
+            glm::vec3 velocity{interactionVelocityX[slot], interactionVelocityY[slot], interactionVelocityZ[slot]};
+
+            glm::vec3 separation{0.0f};
+            glm::vec3 offset_sum{0.0f};
+            glm::vec3 velocity_sum{0.0f};
+            glm::vec3 viscosity{0.0f};
+            uint neighbours = 0;
+            grid.for_each_neighbour(grid.get_sorted_position(slot), radius, [&](uint neighbour, const glm::vec3& offset, float distance_squared) {
+                if (neighbour == slot) return;
+                glm::vec3 neighbour_velocity{interactionVelocityX[neighbour], interactionVelocityY[neighbour], interactionVelocityZ[neighbour]};
+                float distance = std::sqrt(distance_squared);
+                float weight = 1.0f - distance * inverse_radius;
+                // Particles exactly on top of each other have no direction to separate in, so are left for the other forces to pull apart
+                if (distance > 0.0f) {
+                    separation -= offset * (weight / distance);
+                }
+                offset_sum += offset;
+                velocity_sum += neighbour_velocity;
+                viscosity += (neighbour_velocity - velocity) * weight;
+                ++neighbours;
+            });
+
+            glm::vec3 delta{0.0f};
+            if (neighbours > 0) {
+                float inverse_neighbours = 1.0f / (float) neighbours;
+                delta = separation * interaction.separation
+                      + offset_sum * (inverse_neighbours * inverse_radius * interaction.cohesion)
+                      + (velocity_sum * inverse_neighbours - velocity) * interaction.alignment
+                      + viscosity * interaction.viscosity;
+            }
+            delta *= deltaTime;
+            interactionDeltaX[slot] = delta.x;
+            interactionDeltaY[slot] = delta.y;
+            interactionDeltaZ[slot] = delta.z;
+        }
+    });
+
+    for (uint slot = 0; slot < grid_count; ++slot) {
+        uint i = order[slot];
+        velocityX[i] += interactionDeltaX[slot];
+        velocityY[i] += interactionDeltaY[slot];
+        velocityZ[i] += interactionDeltaZ[slot];
+    }
+}
+
+void ParticlePool::integrate(float deltaTime) {
+    size_t i = 0;
+#ifdef PARTICLE_POOL_SSE
+    __m128 dt = _mm_set1_ps(deltaTime);
+    for (; i < simd_count(count); i += LANES) {
+        _mm_storeu_ps(&positionX[i], _mm_add_ps(_mm_loadu_ps(&positionX[i]), _mm_mul_ps(_mm_loadu_ps(&velocityX[i]), dt)));
+        _mm_storeu_ps(&positionY[i], _mm_add_ps(_mm_loadu_ps(&positionY[i]), _mm_mul_ps(_mm_loadu_ps(&velocityY[i]), dt)));
+        _mm_storeu_ps(&positionZ[i], _mm_add_ps(_mm_loadu_ps(&positionZ[i]), _mm_mul_ps(_mm_loadu_ps(&velocityZ[i]), dt)));
+        _mm_storeu_ps(&rotation[i], _mm_add_ps(_mm_loadu_ps(&rotation[i]), _mm_mul_ps(_mm_loadu_ps(&angularVelocity[i]), dt)));
+    }
+#endif
+    for (; i < count; ++i) {
+        positionX[i] += velocityX[i] * deltaTime;
+        positionY[i] += velocityY[i] * deltaTime;
+        positionZ[i] += velocityZ[i] * deltaTime;
+        rotation[i] += angularVelocity[i] * deltaTime;
+    }
+}
+
+void ParticlePool::collide(const SignedDistanceField& field, const glm::mat4* transform, float radius, float bounce, float friction, JobSystem& job_system) {
+    // Colliding splits into chunks of at least this many particles
+    constexpr uint MIN_CHUNK = 4096;
+
+    if (field.empty() || count == 0) return;
+    glm::mat4 to_world = transform ? *transform : glm::mat4{1.0f};
+    glm::mat4 from_world = glm::inverse(to_world);
+
+    job_system.parallel_for((uint) count, MIN_CHUNK, [&](uint begin, uint end) {
+        for (auto i = begin; i < end; ++i) {
+            glm::vec3 position = to_world * glm::vec4{get_position(i), 1.0f};
+            float distance;
+            glm::vec3 gradient;
+            // Most particles are out in open space where nothing is stored, which is the cheap case
+            if (!field.sample(position, distance, gradient) || distance >= radius) continue;
+
+            float gradient_length = glm::length(gradient);
+            if (gradient_length < 1e-6f) continue;
+            glm::vec3 normal = gradient / gradient_length;
+
+            position += normal * (radius - distance);
+            glm::vec3 velocity = glm::mat3{to_world} * get_velocity(i);
+            float normal_speed = glm::dot(velocity, normal);
+            // Only particles heading into the surface respond, ones already leaving it are left to go
+            if (normal_speed < 0.0f) {
+                glm::vec3 tangent_velocity = velocity - normal * normal_speed;
+                velocity = tangent_velocity * (1.0f - friction) - normal * (normal_speed * bounce);
+            }
+
+            position = from_world * glm::vec4{position, 1.0f};
+            velocity = glm::mat3{from_world} * velocity;
+            positionX[i] = position.x;
+            positionY[i] = position.y;
+            positionZ[i] = position.z;
+            set_velocity(i, velocity);
+        }
+    });
+}
+
+void ParticlePool::fade(const glm::vec4& endColor, float endSizeFactor) {
+    size_t i = 0;
+#ifdef PARTICLE_POOL_SSE
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128 end_r = _mm_set1_ps(endColor.r), end_g = _mm_set1_ps(endColor.g), end_b = _mm_set1_ps(endColor.b), end_a = _mm_set1_ps(endColor.a);
+    __m128 size_change = _mm_set1_ps(endSizeFactor - 1.0f);
+    auto mix = [](__m128 a, __m128 b, __m128 t) {
+        return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t));
+    };
+    for (; i < simd_count(count); i += LANES) {
+        __m128 life_ratio = _mm_sub_ps(one, _mm_div_ps(_mm_loadu_ps(&lifeRemaining[i]), _mm_loadu_ps(&totalLife[i])));
+        _mm_storeu_ps(&colorR[i], mix(_mm_loadu_ps(&colorR[i]), end_r, life_ratio));
+        _mm_storeu_ps(&colorG[i], mix(_mm_loadu_ps(&colorG[i]), end_g, life_ratio));
+        _mm_storeu_ps(&colorB[i], mix(_mm_loadu_ps(&colorB[i]), end_b, life_ratio));
+        _mm_storeu_ps(&colorA[i], mix(_mm_loadu_ps(&colorA[i]), end_a, life_ratio));
+        // mix(size, size * endSizeFactor, t) = size * (1 + t * (endSizeFactor - 1))
+        _mm_storeu_ps(&size[i], _mm_mul_ps(_mm_loadu_ps(&size[i]), _mm_add_ps(one, _mm_mul_ps(life_ratio, size_change))));
+    }
+#endif
+    for (; i < count; ++i) {
+        float lifeRatio = 1.0f - (lifeRemaining[i] / totalLife[i]);
+        colorR[i] += (endColor.r - colorR[i]) * lifeRatio;
+        colorG[i] += (endColor.g - colorG[i]) * lifeRatio;
+        colorB[i] += (endColor.b - colorB[i]) * lifeRatio;
+        colorA[i] += (endColor.a - colorA[i]) * lifeRatio;
+        size[i] *= 1.0f + lifeRatio * (endSizeFactor - 1.0f);
+    }
+}
+
+BoundingBox ParticlePool::bounds() const {
+    BoundingBox box{};
+    size_t i = 0;
+#ifdef PARTICLE_POOL_SSE
+    if (count >= LANES) {
+        __m128 min_x = _mm_loadu_ps(&positionX[0]), max_x = min_x;
+        __m128 min_y = _mm_loadu_ps(&positionY[0]), max_y = min_y;
+        __m128 min_z = _mm_loadu_ps(&positionZ[0]), max_z = min_z;
+        for (i = LANES; i < simd_count(count); i += LANES) {
+            __m128 x = _mm_loadu_ps(&positionX[i]);
+            __m128 y = _mm_loadu_ps(&positionY[i]);
+            __m128 z = _mm_loadu_ps(&positionZ[i]);
+            min_x = _mm_min_ps(min_x, x);
+            max_x = _mm_max_ps(max_x, x);
+            min_y = _mm_min_ps(min_y, y);
+            max_y = _mm_max_ps(max_y, y);
+            min_z = _mm_min_ps(min_z, z);
+            max_z = _mm_max_ps(max_z, z);
+        }
+
+        alignas(16) float lanes[6][LANES];
+        _mm_store_ps(lanes[0], min_x);
+        _mm_store_ps(lanes[1], min_y);
+        _mm_store_ps(lanes[2], min_z);
+        _mm_store_ps(lanes[3], max_x);
+        _mm_store_ps(lanes[4], max_y);
+        _mm_store_ps(lanes[5], max_z);
+        for (size_t lane = 0; lane < LANES; ++lane) {
+            box.expand(glm::vec3{lanes[0][lane], lanes[1][lane], lanes[2][lane]});
+            box.expand(glm::vec3{lanes[3][lane], lanes[4][lane], lanes[5][lane]});
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        box.expand(get_position(i));
+    }
+    return box;
+}
+
+size_t ParticlePool::write_instances(const glm::mat4* transform, const glm::vec3& origin, ParticleInstance* out, size_t max_count, float interpolation) const {
+    size_t written = std::min(count, max_count);
+    bool interpolate = interpolation < 1.0f;
+    for (size_t i = 0; i < written; ++i) {
+        glm::vec3 position = get_position(i);
+        if (interpolate) {
+            glm::vec3 previous{previousPositionX[i], previousPositionY[i], previousPositionZ[i]};
+            position = previous + (position - previous) * interpolation;
+        }
+        if (transform != nullptr) {
+            position = glm::vec3(*transform * glm::vec4(position, 1.0f));
+        }
+        position -= origin;
+
+        // Written a field at a time, since out may be write combined memory mapped from the GPU
+        ParticleInstance& instance = out[i];
+        instance.position = {glm::packHalf1x16(position.x), glm::packHalf1x16(position.y), glm::packHalf1x16(position.z)};
+        instance.size = glm::packHalf1x16(size[i]);
+        instance.color = glm::packUnorm4x8(get_color(i));
+        // Unwrapped, a fast spinning particle would soon be past what a half float can hold to a degree
+        float wrapped_rotation = std::fmod(rotation[i], 360.0f);
+        instance.rotation = glm::packHalf1x16(wrapped_rotation < 0.0f ? wrapped_rotation + 360.0f : wrapped_rotation);
+        instance.padding = 0;
+    }
+    return written;
+}
+
+} // namespace EditorScene
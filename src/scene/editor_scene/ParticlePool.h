@@ -0,0 +1,147 @@
+#ifndef PARTICLE_POOL_H
+#define PARTICLE_POOL_H
+
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include "utility/Math.h"
+#include "utility/JobSystem.h"
+#include "utility/SignedDistanceField.h"
+
+namespace EditorScene {
+
+    class CurlNoiseField;
+    class SpatialHashGrid;
+
+    /// How strongly particles within radius of each other steer by each other, see ParticlePool::interact.
+    /// Separation and cohesion are in speed added per second at their strongest,
+    /// alignment and viscosity in how much of the difference in velocity is made up per second
+    struct ParticleInteraction {
+        float radius = 0.5f;
+        // Away from each neighbour, strongest when touching and fading to nothing at the radius
+        float separation = 0.0f;
+        // Towards the middle of the neighbours
+        float cohesion = 0.0f;
+        // Towards the neighbours' average velocity
+        float alignment = 0.0f;
+        // Towards each neighbour's velocity, weighted like separation, which damps the relative motion of nearby particles
+        float viscosity = 0.0f;
+
+        [[nodiscard]] bool any() const { return separation != 0.0f || cohesion != 0.0f || alignment != 0.0f || viscosity != 0.0f; }
+    };
+
+    /// A particle as it is drawn, packed into 16 bytes. See ParticleRenderer for how the attributes are read.
+    struct ParticleInstance {
+        // Half floats, in world space relative to the origin the renderer handed out for the frame,
+        // which is near the camera, so precision falls off with distance along with the particle's size on screen
+        std::array<uint16_t, 3> position;
+        uint16_t size; // Half float
+        uint32_t color; // RGBA8, from glm::packUnorm4x8
+        uint16_t rotation; // Half float, in degrees wrapped into [0, 360)
+        uint16_t padding;
+
+        [[nodiscard]] glm::vec3 get_position() const {
+            return {glm::unpackHalf1x16(position[0]), glm::unpackHalf1x16(position[1]), glm::unpackHalf1x16(position[2])};
+        }
+    };
+    static_assert(sizeof(ParticleInstance) == 16, "ParticleInstance must match the attribute layout in ParticleRenderer");
+
+    /// The live particles of one emitter, stored as a structure of arrays so that the update passes below
+    /// can work through four particles at a time with SSE.
+    ///
+    /// The arrays are allocated once up front for the emitter's maximum, and particles are removed
+    /// by swapping the last live particle into their place, so particles don't keep their order.
+    struct ParticlePool {
+        std::vector<float> positionX, positionY, positionZ;
+        std::vector<float> velocityX, velocityY, velocityZ;
+        std::vector<float> colorR, colorG, colorB, colorA;
+        std::vector<float> size;
+        std::vector<float> lifeRemaining;
+        std::vector<float> totalLife;
+        std::vector<float> rotation;
+        std::vector<float> angularVelocity;
+        // Where each particle was before the last step, for drawing in between steps, see store_previous_positions
+        std::vector<float> previousPositionX, previousPositionY, previousPositionZ;
+
+        // The particles in [0, count) are alive
+        size_t count = 0;
+
+        [[nodiscard]] size_t capacity() const { return lifeRemaining.size(); }
+        [[nodiscard]] bool empty() const { return count == 0; }
+        [[nodiscard]] bool full() const { return count == capacity(); }
+
+        /// Reallocate for a new maximum, dropping any particles past it
+        void set_capacity(size_t new_capacity);
+
+        /// Add a particle at the end, the caller must check that the pool isn't full first
+        size_t emit(const glm::vec3& position, const glm::vec3& velocity, const glm::vec4& color, float particleSize, float life, float particleRotation, float particleAngularVelocity);
+        /// Remove a particle by moving the last particle into its place
+        void kill(size_t i);
+        void clear() { count = 0; }
+
+        [[nodiscard]] glm::vec3 get_position(size_t i) const { return {positionX[i], positionY[i], positionZ[i]}; }
+        [[nodiscard]] glm::vec3 get_velocity(size_t i) const { return {velocityX[i], velocityY[i], velocityZ[i]}; }
+        [[nodiscard]] glm::vec4 get_color(size_t i) const { return {colorR[i], colorG[i], colorB[i], colorA[i]}; }
+
+        void set_velocity(size_t i, const glm::vec3& velocity) {
+            velocityX[i] = velocity.x;
+            velocityY[i] = velocity.y;
+            velocityZ[i] = velocity.z;
+        }
+
+        /// Keep the current positions as the previous ones, before a step whose result will be drawn blended with them.
+        /// Particles emitted afterwards start with their previous position where they spawn
+        void store_previous_positions();
+
+        // Update passes, in the order an emitter runs them each tick
+
+        /// Count down every particle's life, and remove the ones that have run out
+        void age(float deltaTime);
+        /// v += acceleration * dt, for forces that are the same everywhere, like gravity and wind
+        void accelerate(const glm::vec3& acceleration, float deltaTime);
+        /// Pull particles within radius of a point towards it, strongest at the point and fading to nothing at the radius.
+        /// Negative strengths push particles away instead.
+        void attract(const glm::vec3& point, float strength, float radius, float deltaTime);
+        /// Push particles along field, sampled at position * frequency + offset, scaled by strength
+        void turbulence(const CurlNoiseField& field, const glm::vec3& offset, float frequency, float strength, float deltaTime);
+        /// Steer particles by their neighbours within interaction.radius, found through grid, which must have been built from this pool
+        /// since it last changed, with cells at least the radius. Every particle reads the velocities from before the pass, so the order doesn't matter
+        void interact(const SpatialHashGrid& grid, const ParticleInteraction& interaction, float deltaTime, JobSystem& job_system);
+        /// Move and spin every particle by its velocities
+        void integrate(float deltaTime);
+        /// Push particles that have come within radius of the surfaces in field back out, bouncing off them
+        /// with bounce of the speed they hit at and losing friction of their speed along the surface.
+        /// field is in world space, so positions are moved into it by transform, unless it is null
+        void collide(const SignedDistanceField& field, const glm::mat4* transform, float radius, float bounce, float friction, JobSystem& job_system);
+        /// Blend each particle's colour towards endColor and its size towards endSizeFactor times its size, by how far through its life it is
+        void fade(const glm::vec4& endColor, float endSizeFactor);
+
+        /// The box around every live particle's position, empty if there are none
+        [[nodiscard]] BoundingBox bounds() const;
+
+        /// Write up to max_count particles out for drawing, moving them into world space by transform unless it is null,
+        /// then relative to origin. Returns the number written.
+        /// Below an interpolation of 1, positions are blended that far from the previous positions to the current ones
+        size_t write_instances(const glm::mat4* transform, const glm::vec3& origin, ParticleInstance* out, size_t max_count, float interpolation = 1.0f) const;
+
+    private:
+        // The velocities from before interact, then the changes to them, both in the grid's order
+        std::vector<float> interactionVelocityX, interactionVelocityY, interactionVelocityZ;
+        std::vector<float> interactionDeltaX, interactionDeltaY, interactionDeltaZ;
+
+        /// Every per particle array, for operations that treat them all the same
+        std::array<std::vector<float>*, 18> arrays() {
+            return {&positionX, &positionY, &positionZ, &velocityX, &velocityY, &velocityZ,
+                    &colorR, &colorG, &colorB, &colorA, &size, &lifeRemaining, &totalLife, &rotation, &angularVelocity,
+                    &previousPositionX, &previousPositionY, &previousPositionZ};
+        }
+    };
+
+} // namespace EditorScene
+
+#endif // PARTICLE_POOL_H
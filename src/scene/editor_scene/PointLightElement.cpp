@@ -29,7 +29,7 @@ std::unique_ptr<EditorScene::PointLightElement> EditorScene::PointLightElement::
         )
     );
 
-    light_element->update_instance_data();
+    light_element->update_local_transform();
     return light_element;
 }
 
@@ -41,7 +41,7 @@ std::unique_ptr<EditorScene::PointLightElement> EditorScene::PointLightElement::
     light_element->visible = j["visible"];
     light_element->visual_scale = j["visual_scale"];
 
-    light_element->update_instance_data();
+    light_element->update_local_transform();
     return light_element;
 }
 
@@ -78,17 +78,17 @@ void EditorScene::PointLightElement::add_imgui_edit_section(MasterRenderScene& r
     ImGui::DragDisableCursor(scene_context.window);
 
     if (transformUpdated) {
-        update_instance_data();
+        update_local_transform();
     }
 }
 
-void EditorScene::PointLightElement::update_instance_data() {
-    transform = glm::translate(position);
+void EditorScene::PointLightElement::update_local_transform() {
+    // Also marks the element dirty, which brings the light and its sphere along
+    components().set_local_transform(id, glm::translate(position));
+}
 
-    if (!EditorScene::is_null(parent)) {
-        // Post multiply by transform so that local transformations are applied first
-        transform = (*parent)->transform * transform;
-    }
+void EditorScene::PointLightElement::update_instance_data() {
+    const glm::mat4& transform = this->transform();
 
     light->position = glm::vec3(transform[3]); // Extract translation from matrix
     if (visible) {
@@ -20,7 +20,9 @@ namespace EditorScene {
         std::shared_ptr<EmissiveEntityRenderer::Entity> light_sphere;
 
         PointLightElement(const ElementRef& parent, std::string name, glm::vec3 position, std::shared_ptr<PointLight> light, std::shared_ptr<EmissiveEntityRenderer::Entity> light_sphere) :
-            SceneElement(parent, std::move(name)), position(position), light(std::move(light)), light_sphere(std::move(light_sphere)) {}
+            SceneElement(parent, std::move(name)), position(position), light(std::move(light)), light_sphere(std::move(light_sphere)) {
+            components().watch_world_transform(id, this);
+        }
 
         static std::unique_ptr<PointLightElement> new_default(const SceneContext& scene_context, ElementRef parent);
         static std::unique_ptr<PointLightElement> from_json(const SceneContext& scene_context, ElementRef parent, const json& j);
@@ -29,6 +31,9 @@ namespace EditorScene {
 
         void add_imgui_edit_section(MasterRenderScene& render_scene, const SceneContext& scene_context) override;
 
+        /// Set the local transform from position, to be called whenever it changes
+        void update_local_transform();
+
         void update_instance_data() override;
 
         void add_to_render_scene(MasterRenderScene& target_render_scene) override {
@@ -0,0 +1,510 @@
+#include "SceneBinary.h"
+
+#include <cstring>
+#include <cstddef>
+#include <optional>
+#include <fstream>
+#include <stdexcept>
+#include <initializer_list>
+
+#include "utility/HelperTypes.h"
+
+namespace EditorScene::SceneBinary {
+
+static_assert(sizeof(FileHeader) == 32, "FileHeader is written as is, so must not pick up padding");
+static_assert(sizeof(ElementHeader) == 32, "ElementHeader is written as is, so must not pick up padding");
+static_assert(sizeof(TransformBlock) == 9 * sizeof(float), "The blocks are written as is, so must be tightly packed floats");
+static_assert(sizeof(LitMaterialBlock) == 14 * sizeof(float), "The blocks are written as is, so must be tightly packed floats");
+static_assert(sizeof(EmissiveMaterialBlock) == 4 * sizeof(float), "The blocks are written as is, so must be tightly packed floats");
+
+namespace {
+    /// If the number is stored by json as a float, and survives the trip through a 32 bit float, so can go into a block
+    bool is_exact_float(const json& value) {
+        if (!value.is_number_float()) return false;
+        auto d = value.get<double>();
+        return (double) (float) d == d;
+    }
+
+    bool is_float_array(const json& value, size_t size) {
+        if (!value.is_array() || value.size() != size) return false;
+        for (const auto& item: value) {
+            if (!is_exact_float(item)) return false;
+        }
+        return true;
+    }
+
+    /// If j is an object with exactly these keys, so that taking them out into a block loses nothing
+    bool has_exactly(const json& j, std::initializer_list<const char*> keys) {
+        if (!j.is_object() || j.size() != keys.size()) return false;
+        for (const char* key: keys) {
+            if (!j.contains(key)) return false;
+        }
+        return true;
+    }
+
+    bool is_transform(const json& j) {
+        return has_exactly(j, {"position", "euler_rotation", "scale"}) &&
+               is_float_array(j["position"], 3) && is_float_array(j["euler_rotation"], 3) && is_float_array(j["scale"], 3);
+    }
+
+    bool is_lit_material(const json& j) {
+        return has_exactly(j, {"diffuse_tint", "specular_tint", "ambient_tint", "shininess", "texture_scale"}) &&
+               is_float_array(j["diffuse_tint"], 4) && is_float_array(j["specular_tint"], 4) && is_float_array(j["ambient_tint"], 4) &&
+               is_exact_float(j["shininess"]) && is_exact_float(j["texture_scale"]);
+    }
+
+    bool is_emissive_material(const json& j) {
+        return has_exactly(j, {"emission_tint"}) && is_float_array(j["emission_tint"], 4);
+    }
+
+    void add_json_element(Writer& writer, const json& j) {
+        json element = j;
+        element.erase("children");
+        writer.begin_element(element, j.contains("children"));
+        if (j.contains("children")) {
+            for (const auto& child: j["children"]) {
+                add_json_element(writer, child);
+            }
+        }
+        writer.end_element();
+    }
+
+    json element_tree_json(const Reader& reader, size_t offset) {
+        json j = reader.element_json(offset);
+        auto header = reader.element_header(offset);
+        if (header.flags & HAS_CHILDREN) {
+            json children = json::array();
+            size_t child = reader.first_child(offset);
+            for (auto i = 0u; i < header.child_count; ++i) {
+                children.push_back(element_tree_json(reader, child));
+                child += reader.element_header(child).subtree_size;
+            }
+            j["children"] = children;
+        }
+        return j;
+    }
+}
+
+uint32_t Writer::add_string(const std::string& string) {
+    auto existing = string_indices.find(string);
+    if (existing != string_indices.end()) return existing->second;
+
+    auto index = (uint32_t) strings.size();
+    strings.push_back(string);
+    string_indices.emplace(string, index);
+    return index;
+}
+
+template<typename T>
+void Writer::write_raw(const T& value) {
+    const auto* bytes = reinterpret_cast<const char*>(&value);
+    elements.insert(elements.end(), bytes, bytes + sizeof(T));
+}
+
+void Writer::write_value(const json& value) {
+    switch (value.type()) {
+        case json::value_t::null:
+        case json::value_t::discarded:
+            write_raw(Tag::Null);
+            break;
+        case json::value_t::boolean:
+            write_raw(value.get<bool>() ? Tag::True : Tag::False);
+            break;
+        case json::value_t::number_integer:
+            write_raw(Tag::Int);
+            write_raw(value.get<int64_t>());
+            break;
+        case json::value_t::number_unsigned:
+            write_raw(Tag::Uint);
+            write_raw(value.get<uint64_t>());
+            break;
+        case json::value_t::number_float:
+            if (is_exact_float(value)) {
+                write_raw(Tag::Float);
+                write_raw(value.get<float>());
+            } else {
+                write_raw(Tag::Double);
+                write_raw(value.get<double>());
+            }
+            break;
+        case json::value_t::string:
+            write_raw(Tag::String);
+            write_raw(add_string(value.get<std::string>()));
+            break;
+        case json::value_t::array:
+            if (!value.empty() && is_float_array(value, value.size())) {
+                write_raw(Tag::FloatArray);
+                write_raw((uint32_t) value.size());
+                for (const auto& item: value) {
+                    write_raw(item.get<float>());
+                }
+            } else {
+                write_raw(Tag::Array);
+                write_raw((uint32_t) value.size());
+                for (const auto& item: value) {
+                    write_value(item);
+                }
+            }
+            break;
+        case json::value_t::object:
+            write_raw(Tag::Object);
+            write_raw((uint32_t) value.size());
+            for (const auto& [key, item]: value.items()) {
+                write_raw(add_string(key));
+                write_value(item);
+            }
+            break;
+        case json::value_t::binary:
+            throw std::runtime_error("Binary json values can not be saved to a binary scene");
+    }
+}
+
+void Writer::begin_element(const json& j, bool can_have_children) {
+    json properties = j;
+    ElementHeader header{};
+    header.label = add_string(properties.value("label", ""));
+    header.name = add_string(properties.value("name", ""));
+    header.flags = properties.value("enabled", true) ? (uint32_t) ENABLED : 0u;
+    if (can_have_children) header.flags |= HAS_CHILDREN;
+    properties.erase("label");
+    properties.erase("name");
+    properties.erase("enabled");
+
+    std::optional<TransformBlock> transform{};
+    if (properties.contains("local_transform") && is_transform(properties["local_transform"])) {
+        const auto& t = properties["local_transform"];
+        transform = TransformBlock{t["position"].get<glm::vec3>(), t["euler_rotation"].get<glm::vec3>(), t["scale"].get<glm::vec3>()};
+        header.flags |= HAS_TRANSFORM;
+        properties.erase("local_transform");
+    }
+
+    std::optional<LitMaterialBlock> lit_material{};
+    std::optional<EmissiveMaterialBlock> emissive_material{};
+    if (properties.contains("material")) {
+        const auto& m = properties["material"];
+        // Entities also save the texture scale outside their material, which from_json applies last, so where the two differ,
+        // as only in a hand edited file, the material stays with the properties to be loaded in the same order
+        bool texture_scale_agrees = !properties.contains("texture_scale") || !m.contains("texture_scale") || properties["texture_scale"] == m["texture_scale"];
+        if (is_lit_material(m) && texture_scale_agrees) {
+            lit_material = LitMaterialBlock{
+                m["diffuse_tint"].get<glm::vec4>(), m["specular_tint"].get<glm::vec4>(), m["ambient_tint"].get<glm::vec4>(),
+                m["shininess"].get<float>(), m["texture_scale"].get<float>()
+            };
+            header.flags |= HAS_LIT_MATERIAL;
+            properties.erase("material");
+        } else if (is_emissive_material(m)) {
+            emissive_material = EmissiveMaterialBlock{m["emission_tint"].get<glm::vec4>()};
+            header.flags |= HAS_EMISSIVE_MATERIAL;
+            properties.erase("material");
+        }
+    }
+
+    if (open_elements.empty()) {
+        ++root_count;
+    } else {
+        // Count this element as one of its parent's children
+        ElementHeader parent{};
+        std::memcpy(&parent, &elements[open_elements.back()], sizeof(ElementHeader));
+        ++parent.child_count;
+        std::memcpy(&elements[open_elements.back()], &parent, sizeof(ElementHeader));
+    }
+
+    size_t offset = elements.size();
+    open_elements.push_back(offset);
+    write_raw(header);
+    if (transform.has_value()) write_raw(transform.value());
+    if (lit_material.has_value()) write_raw(lit_material.value());
+    if (emissive_material.has_value()) write_raw(emissive_material.value());
+
+    size_t properties_start = elements.size();
+    if (!properties.empty()) {
+        write_value(properties);
+    }
+    header.properties_size = (uint32_t) (elements.size() - properties_start);
+    std::memcpy(&elements[offset], &header, sizeof(ElementHeader));
+}
+
+void Writer::end_element() {
+    if (open_elements.empty()) {
+        throw std::logic_error("end_element without a matching begin_element");
+    }
+
+    size_t offset = open_elements.back();
+    open_elements.pop_back();
+    ElementHeader header{};
+    std::memcpy(&header, &elements[offset], sizeof(ElementHeader));
+    header.subtree_size = elements.size() - offset;
+    std::memcpy(&elements[offset], &header, sizeof(ElementHeader));
+}
+
+void Writer::write_to(std::ostream& stream) const {
+    if (!open_elements.empty()) {
+        throw std::logic_error("Writing a binary scene with elements still open");
+    }
+
+    // The string table, as an (offset, length) pair per string, then all of their characters
+    std::vector<uint32_t> string_entries{};
+    string_entries.reserve(strings.size() * 2);
+    uint32_t characters = 0;
+    for (const auto& string: strings) {
+        string_entries.push_back(characters);
+        string_entries.push_back((uint32_t) string.size());
+        characters += (uint32_t) string.size();
+    }
+
+    FileHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.string_count = (uint32_t) strings.size();
+    header.root_count = root_count;
+    header.strings_offset = sizeof(FileHeader);
+    header.elements_offset = header.strings_offset + string_entries.size() * sizeof(uint32_t) + characters;
+
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+    stream.write(reinterpret_cast<const char*>(string_entries.data()), (std::streamsize) (string_entries.size() * sizeof(uint32_t)));
+    for (const auto& string: strings) {
+        stream.write(string.data(), (std::streamsize) string.size());
+    }
+    stream.write(elements.data(), (std::streamsize) elements.size());
+}
+
+Reader::Reader(std::vector<char> file_data) : data(std::move(file_data)) {
+    header = read_raw<FileHeader>(0);
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        throw std::runtime_error("Not a binary scene file");
+    }
+    if (header.version != VERSION) {
+        throw std::runtime_error(Formatter() << "Unsupported binary scene version: " << header.version);
+    }
+
+    size_t characters = header.strings_offset + (size_t) header.string_count * 2 * sizeof(uint32_t);
+    if (characters > data.size() || header.elements_offset > data.size()) {
+        throw std::runtime_error("Binary scene file is truncated");
+    }
+    strings.reserve(header.string_count);
+    for (auto i = 0u; i < header.string_count; ++i) {
+        auto offset = read_raw<uint32_t>(header.strings_offset + i * 2 * sizeof(uint32_t));
+        auto length = read_raw<uint32_t>(header.strings_offset + (i * 2 + 1) * sizeof(uint32_t));
+        if (characters + offset + length > header.elements_offset) {
+            throw std::runtime_error("Binary scene string table is malformed");
+        }
+        strings.emplace_back(data.data() + characters + offset, length);
+    }
+}
+
+Reader Reader::from_file(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        throw std::runtime_error(Formatter() << "Unable to open binary scene file: " << path.string());
+    }
+
+    std::vector<char> file_data((size_t) file.tellg());
+    file.seekg(0);
+    file.read(file_data.data(), (std::streamsize) file_data.size());
+    return Reader(std::move(file_data));
+}
+
+bool Reader::is_binary_file(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    char magic[sizeof(MAGIC)]{};
+    file.read(magic, sizeof(MAGIC));
+    return file && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+template<typename T>
+T Reader::read_raw(size_t offset) const {
+    if (offset + sizeof(T) > data.size()) {
+        throw std::runtime_error("Binary scene file is truncated");
+    }
+    T value;
+    std::memcpy(&value, data.data() + offset, sizeof(T));
+    return value;
+}
+
+std::string Reader::string_at(size_t offset) const {
+    auto index = read_raw<uint32_t>(offset);
+    if (index >= strings.size()) {
+        throw std::runtime_error("Binary scene string index out of range");
+    }
+    return std::string(strings[index]);
+}
+
+json Reader::read_value(size_t& offset) const {
+    auto tag = read_raw<Tag>(offset);
+    offset += sizeof(Tag);
+
+    switch (tag) {
+        case Tag::Null:
+            return nullptr;
+        case Tag::False:
+            return false;
+        case Tag::True:
+            return true;
+        case Tag::Int:
+            offset += sizeof(int64_t);
+            return read_raw<int64_t>(offset - sizeof(int64_t));
+        case Tag::Uint:
+            offset += sizeof(uint64_t);
+            return read_raw<uint64_t>(offset - sizeof(uint64_t));
+        case Tag::Float:
+            offset += sizeof(float);
+            return read_raw<float>(offset - sizeof(float));
+        case Tag::Double:
+            offset += sizeof(double);
+            return read_raw<double>(offset - sizeof(double));
+        case Tag::String:
+            offset += sizeof(uint32_t);
+            return string_at(offset - sizeof(uint32_t));
+        case Tag::FloatArray: {
+            auto count = read_raw<uint32_t>(offset);
+            offset += sizeof(uint32_t);
+            json array = json::array();
+            for (auto i = 0u; i < count; ++i) {
+                array.push_back(read_raw<float>(offset));
+                offset += sizeof(float);
+            }
+            return array;
+        }
+        case Tag::Array: {
+            auto count = read_raw<uint32_t>(offset);
+            offset += sizeof(uint32_t);
+            json array = json::array();
+            for (auto i = 0u; i < count; ++i) {
+                array.push_back(read_value(offset));
+            }
+            return array;
+        }
+        case Tag::Object: {
+            auto count = read_raw<uint32_t>(offset);
+            offset += sizeof(uint32_t);
+            json object = json::object();
+            for (auto i = 0u; i < count; ++i) {
+                std::string key = string_at(offset);
+                offset += sizeof(uint32_t);
+                object[key] = read_value(offset);
+            }
+            return object;
+        }
+    }
+    throw std::runtime_error(Formatter() << "Unknown binary scene value tag: " << (uint) tag);
+}
+
+ElementHeader Reader::element_header(size_t offset) const {
+    auto element = read_raw<ElementHeader>(offset);
+    if (element.subtree_size < sizeof(ElementHeader) || offset + element.subtree_size > data.size()) {
+        throw std::runtime_error("Binary scene element is malformed");
+    }
+    return element;
+}
+
+size_t Reader::first_child(size_t offset) const {
+    auto element = element_header(offset);
+    size_t position = offset + sizeof(ElementHeader);
+    if (element.flags & HAS_TRANSFORM) position += sizeof(TransformBlock);
+    if (element.flags & HAS_LIT_MATERIAL) position += sizeof(LitMaterialBlock);
+    if (element.flags & HAS_EMISSIVE_MATERIAL) position += sizeof(EmissiveMaterialBlock);
+    return position + element.properties_size;
+}
+
+ElementBlocks Reader::element_blocks(size_t offset) const {
+    auto element = element_header(offset);
+    size_t position = offset + sizeof(ElementHeader);
+
+    ElementBlocks blocks{};
+    if (element.flags & HAS_TRANSFORM) {
+        blocks.transform = read_raw<TransformBlock>(position);
+        position += sizeof(TransformBlock);
+    }
+    if (element.flags & HAS_LIT_MATERIAL) {
+        blocks.lit_material = read_raw<LitMaterialBlock>(position);
+        position += sizeof(LitMaterialBlock);
+    }
+    if (element.flags & HAS_EMISSIVE_MATERIAL) {
+        blocks.emissive_material = read_raw<EmissiveMaterialBlock>(position);
+    }
+    return blocks;
+}
+
+json Reader::element_properties_json(size_t offset) const {
+    auto element = element_header(offset);
+
+    json j = json::object();
+    if (element.properties_size > 0) {
+        size_t end = first_child(offset);
+        size_t position = end - element.properties_size;
+        j = read_value(position);
+        if (!j.is_object() || position != end) {
+            throw std::runtime_error("Binary scene element properties are malformed");
+        }
+    }
+
+    // A material left in the properties takes the place of the block
+    if ((element.flags & HAS_EMISSIVE_MATERIAL) && !j.contains("material")) {
+        auto block = element_blocks(offset).emissive_material.value();
+        j["material"] = {
+            {"emission_tint", block.emission_tint},
+        };
+    }
+
+    j["label"] = string_at(offset + offsetof(ElementHeader, label));
+    j["name"] = string_at(offset + offsetof(ElementHeader, name));
+    j["enabled"] = (element.flags & ENABLED) != 0;
+    return j;
+}
+
+json Reader::element_json(size_t offset) const {
+    json j = element_properties_json(offset);
+    auto blocks = element_blocks(offset);
+    if (blocks.transform.has_value()) {
+        const auto& block = blocks.transform.value();
+        j["local_transform"] = {
+            {"position", block.position},
+            {"euler_rotation", block.euler_rotation},
+            {"scale", block.scale},
+        };
+    }
+    if (blocks.lit_material.has_value() && !j.contains("material")) {
+        const auto& block = blocks.lit_material.value();
+        j["material"] = {
+            {"diffuse_tint", block.diffuse_tint},
+            {"specular_tint", block.specular_tint},
+            {"ambient_tint", block.ambient_tint},
+            {"shininess", block.shininess},
+            {"texture_scale", block.texture_scale},
+        };
+    }
+    return j;
+}
+
+void json_to_binary(const json& scene, std::ostream& stream) {
+    Writer writer{};
+    for (const auto& element: scene) {
+        add_json_element(writer, element);
+    }
+    writer.write_to(stream);
+}
+
+json binary_to_json(const Reader& reader) {
+    json scene = json::array();
+    size_t offset = reader.first_root();
+    for (auto i = 0u; i < reader.get_root_count(); ++i) {
+        scene.push_back(element_tree_json(reader, offset));
+        offset += reader.element_header(offset).subtree_size;
+    }
+    return scene;
+}
+
+void convert_file(const std::filesystem::path& from, const std::filesystem::path& to) {
+    if (Reader::is_binary_file(from)) {
+        json scene = binary_to_json(Reader::from_file(from));
+        std::ofstream file(to);
+        file << scene.dump(4);
+    } else {
+        std::ifstream file(from);
+        json scene = json::parse(file);
+        std::ofstream out(to, std::ios::binary);
+        json_to_binary(scene, out);
+    }
+}
+
+} // namespace EditorScene::SceneBinary
@@ -0,0 +1,173 @@
+#ifndef SCENE_BINARY_H
+#define SCENE_BINARY_H
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <filesystem>
+#include <unordered_map>
+
+#include <glm/glm.hpp>
+
+#include "utility/JsonHelper.h"
+
+namespace EditorScene {
+    /// A binary form of the editor's scene files, holding the same elements as the json files, so that large scenes load without
+    /// parsing text or building the whole scene as a json tree first.
+    ///
+    /// The layout is a FileHeader, then the string table, then the elements, depth first, each as an ElementHeader followed by
+    /// whichever of the fixed layout blocks it has, its remaining properties, and then its children.
+    /// Every string (labels, names, asset paths and property keys) is stored once in the string table and referred to by index,
+    /// and every element records the size of its whole subtree, so it can be skipped over without reading it.
+    ///
+    /// Loading reads the transform and lit material blocks straight into the ComponentStore, and each element's remaining properties
+    /// still go through from_json, so there is still only one place each element type's fields are listed,
+    /// but one element at a time, so the json for the whole scene never exists at once.
+    /// Numbers are stored in the machine's byte order, so files only move between little endian machines, which is all this runs on.
+    namespace SceneBinary {
+        constexpr char MAGIC[4] = {'E', 'S', 'C', 'B'};
+        constexpr uint32_t VERSION = 1;
+        constexpr const char* FILE_EXTENSION = ".scene";
+
+        struct FileHeader {
+            char magic[4];
+            uint32_t version;
+            uint32_t string_count;
+            uint32_t root_count;
+            // Both from the start of the file
+            uint64_t strings_offset;
+            uint64_t elements_offset;
+        };
+
+        enum ElementFlags : uint32_t {
+            ENABLED = 1,
+            HAS_TRANSFORM = 2,
+            HAS_LIT_MATERIAL = 4,
+            HAS_EMISSIVE_MATERIAL = 8,
+            // The element can have children, even if it has none, as groups are saved with an empty "children"
+            HAS_CHILDREN = 16,
+        };
+
+        struct ElementHeader {
+            // Indices into the string table
+            uint32_t label;
+            uint32_t name;
+            uint32_t flags;
+            uint32_t child_count;
+            // From the start of this header to the end of the element's last descendant, so where its next sibling starts
+            uint64_t subtree_size;
+            // The size of the properties, which follow the blocks
+            uint32_t properties_size;
+            uint32_t reserved;
+        };
+
+        /// "local_transform", see LocalTransformComponent
+        struct TransformBlock {
+            glm::vec3 position;
+            glm::vec3 euler_rotation;
+            glm::vec3 scale;
+        };
+
+        /// "material", see LitMaterialComponent
+        struct LitMaterialBlock {
+            glm::vec4 diffuse_tint;
+            glm::vec4 specular_tint;
+            glm::vec4 ambient_tint;
+            float shininess;
+            float texture_scale;
+        };
+
+        /// "material", see EmissiveMaterialComponent
+        struct EmissiveMaterialBlock {
+            glm::vec4 emission_tint;
+        };
+
+        /// Whichever of the fixed layout blocks an element has
+        struct ElementBlocks {
+            std::optional<TransformBlock> transform;
+            std::optional<LitMaterialBlock> lit_material;
+            std::optional<EmissiveMaterialBlock> emissive_material;
+        };
+
+        /// What follows each tag in the properties, which hold whatever is left of an element's json once the blocks are taken out
+        enum class Tag : uint8_t {
+            Null,
+            False,
+            True,
+            Int,        // int64
+            Uint,       // uint64
+            Float,      // float, for the numbers that are exactly a float, which is all of them when saved by the editor
+            Double,     // double, for the rest
+            String,     // uint32 string index
+            FloatArray, // uint32 count, then floats, for the glm vectors
+            Array,      // uint32 count, then tagged values
+            Object,     // uint32 count, then pairs of uint32 key string index and tagged value
+        };
+
+        /// Builds a file up one element at a time, then writes it all out at once
+        class Writer {
+            std::vector<std::string> strings{};
+            std::unordered_map<std::string, uint32_t> string_indices{};
+            std::vector<char> elements{};
+            // Where each element that is still having children added starts in elements
+            std::vector<size_t> open_elements{};
+            uint32_t root_count = 0;
+
+            uint32_t add_string(const std::string& string);
+            void write_value(const json& value);
+            template<typename T>
+            void write_raw(const T& value);
+        public:
+            /// Start an element, from the labelled json of just the element, without its children, which are added before the matching end_element
+            void begin_element(const json& j, bool can_have_children);
+            void end_element();
+
+            void write_to(std::ostream& stream) const;
+        };
+
+        /// A whole file, read into memory in one go, and read from in place. Throws std::runtime_error on anything malformed
+        class Reader {
+            std::vector<char> data{};
+            FileHeader header{};
+            std::vector<std::string_view> strings{};
+
+            template<typename T>
+            [[nodiscard]] T read_raw(size_t offset) const;
+            [[nodiscard]] std::string string_at(size_t offset) const;
+            [[nodiscard]] json read_value(size_t& offset) const;
+        public:
+            explicit Reader(std::vector<char> file_data);
+            static Reader from_file(const std::filesystem::path& path);
+
+            /// If the file starts like a binary scene file, so can be told apart from json without reading all of it
+            static bool is_binary_file(const std::filesystem::path& path);
+
+            [[nodiscard]] uint32_t get_root_count() const { return header.root_count; }
+            /// Where the first root element starts, each element's next sibling starts at its offset + subtree_size
+            [[nodiscard]] size_t first_root() const { return header.elements_offset; }
+
+            [[nodiscard]] ElementHeader element_header(size_t offset) const;
+            /// Where the element's first child starts, after its blocks and properties
+            [[nodiscard]] size_t first_child(size_t offset) const;
+            [[nodiscard]] ElementBlocks element_blocks(size_t offset) const;
+            /// The element's properties, with "label", "name" and "enabled", and the emissive material, but without the transform
+            /// and lit material blocks, which are read from element_blocks instead, and without its children
+            [[nodiscard]] json element_properties_json(size_t offset) const;
+            /// The element as element_to_labelled_json gives it, with "label", "name" and "enabled", but without its children
+            [[nodiscard]] json element_json(size_t offset) const;
+        };
+
+        /// Convert a whole scene, as the json file's array of root elements, to the binary form
+        void json_to_binary(const json& scene, std::ostream& stream);
+        /// Convert a whole binary scene back to the json file's form, for diffing and hand editing
+        json binary_to_json(const Reader& reader);
+
+        /// Convert a file between the two forms, in whichever direction it isn't already
+        void convert_file(const std::filesystem::path& from, const std::filesystem::path& to);
+    }
+}
+
+#endif //SCENE_BINARY_H
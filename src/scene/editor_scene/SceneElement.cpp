@@ -40,6 +40,9 @@ std::shared_ptr<TextureHandle> EditorScene::SceneElement::texture_from_json(cons
 
 void EditorScene::LocalTransformComponent::add_local_transform_imgui_edit_section(MasterRenderScene& /*render_scene*/, const SceneContext& scene_context) {
     ImGui::Text("Local Transformation");
+    glm::vec3& position = this->position();
+    glm::vec3& euler_rotation = this->euler_rotation();
+    glm::vec3& scale = this->scale();
     bool transformUpdated = false;
     transformUpdated |= ImGui::DragFloat3("Translation", &position[0], 0.01f);
     ImGui::DragDisableCursor(scene_context.window);
@@ -89,32 +92,24 @@ void EditorScene::LocalTransformComponent::add_local_transform_imgui_edit_sectio
     ImGui::Spacing();
 
     if (transformUpdated) {
-        update_instance_data();
+        mark_dirty();
     }
 }
 
-
-// Task B: Entity Rotation
-glm::mat4 EditorScene::LocalTransformComponent::calc_model_matrix() const {
-    glm::mat4 rotation_matrix = glm::rotate(euler_rotation.x, glm::vec3{1.0f, 0.0f, 0.0f}) * 
-                                glm::rotate(euler_rotation.y, glm::vec3{0.0f, 1.0f, 0.0f}) * 
-                                glm::rotate(euler_rotation.z, glm::vec3{0.0f, 0.0f, 1.0f});
-
-    return glm::translate(position) * rotation_matrix * glm::scale(scale);
-}
-
 void EditorScene::LocalTransformComponent::update_local_transform_from_json(const json& json) {
+    if (!json.contains("local_transform")) return;
     auto t = json["local_transform"];
-    position = t["position"];
-    euler_rotation = t["euler_rotation"];
-    scale = t["scale"];
+    position() = t["position"];
+    euler_rotation() = t["euler_rotation"];
+    scale() = t["scale"];
+    mark_dirty();
 }
 
 json EditorScene::LocalTransformComponent::local_transform_into_json() const {
     return {"local_transform", {
-        {"position", position},
-        {"euler_rotation", euler_rotation},
-        {"scale", scale},
+        {"position", position()},
+        {"euler_rotation", euler_rotation()},
+        {"scale", scale()},
     }};
 }
 
@@ -127,20 +122,24 @@ void EditorScene::LitMaterialComponent::add_material_imgui_edit_section(MasterRe
 
     ImGui::Spacing();
     if (material_changed) {
-        update_instance_data();
+        mark_dirty();
     }
 }
 
 void EditorScene::LitMaterialComponent::update_material_from_json(const json& json) {
+    if (!json.contains("material")) return;
     auto m = json["material"];
+    auto& material = this->material();
     material.diffuse_tint = m["diffuse_tint"];
     material.specular_tint = m["specular_tint"];
     material.ambient_tint = m["ambient_tint"];
     material.shininess = m["shininess"];
     material.texture_scale = m["texture_scale"];
+    mark_dirty();
 }
 
 json EditorScene::LitMaterialComponent::material_into_json() const {
+    const auto& material = this->material();
     return {"material", {
         {"diffuse_tint", material.diffuse_tint},
         {"specular_tint", material.specular_tint},
@@ -159,13 +158,14 @@ void EditorScene::EmissiveMaterialComponent::add_emissive_material_imgui_edit_se
 
     ImGui::Spacing();
     if (material_changed) {
-        update_instance_data();
+        mark_dirty();
     }
 }
 
 void EditorScene::EmissiveMaterialComponent::update_emissive_material_from_json(const json& json) {
     auto m = json["material"];
     material.emission_tint = m["emission_tint"];
+    mark_dirty();
 }
 
 json EditorScene::EmissiveMaterialComponent::emissive_material_into_json() const {
@@ -221,6 +221,12 @@ void EditorScene::AnimationComponent::add_animation_imgui_edit_section(MasterRen
             entity->get_animation_time_seconds() = float_time;
         }
 
+        const auto& stats = entity->get_animation_stats(get_animation_parameters().animation_id);
+        ImGui::Text("Keys: %u -> %u, Memory: %.1f KiB -> %.1f KiB", stats.raw_keys, stats.compressed_keys,
+                    (float) stats.raw_bytes / 1024.0f, (float) stats.compressed_bytes / 1024.0f);
+        ImGui::Text("Max Error: %.5f (position), %.4f deg (rotation), %.5f (scaling)",
+                    stats.max_position_error, glm::degrees(stats.max_rotation_error), stats.max_scaling_error);
+
         bool is_playing = render_scene.animator.is_animating(entity).has_value();
 
         if (ImGui::Button("Start")) {
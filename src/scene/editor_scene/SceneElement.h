@@ -9,6 +9,7 @@
 #include "utility/JsonHelper.h"
 #include "../SceneInterface.h"
 #include "scene/SceneContext.h"
+#include "ComponentStore.h"
 
 class MasterRenderScene;
 
@@ -19,6 +20,13 @@ namespace EditorScene {
     using ElementRef = ElementList::element_type::iterator;
     static const ElementRef NullElementRef{};
 
+    /// Helper to checking if an ElementRef is equal to NullElementRef, needed since `ref == NullElementRef` will
+    /// crash with the MSVC compiler in debug mode due to its strictness.
+    bool is_null(const ElementRef& ref);
+    /// Helper to checking if two ElementRef are equal, needed since `e1 == e2` may
+    /// crash with the MSVC compiler in debug mode due to its strictness.
+    bool eq(const ElementRef& e1, const ElementRef& e2);
+
     /// An interface that represents a element in the scene tree the scene editor uses to control all the entities
     class SceneElement {
     public:
@@ -26,12 +34,26 @@ namespace EditorScene {
         ElementRef parent;
         /// The name of the element, to be displayed in the UI
         std::string name;
-        /// The total transformation of the element, including parent transformations
-        glm::mat4 transform{1.0f};
         /// Tracks if the element is enabled or not
         bool enabled = true;
+        /// Where the element's transforms, and its material and render links if it has them, are kept in the ComponentStore
+        const ElementId id;
+
+        explicit SceneElement(const ElementRef& parent, std::string name)
+            : parent(parent), name(std::move(name)), id(components().create(is_null(parent) ? ElementId{} : (*parent)->id)) {}
+
+        // The id belongs to this element alone
+        SceneElement(const SceneElement&) = delete;
+        SceneElement& operator=(const SceneElement&) = delete;
+
+        [[nodiscard]] static ComponentStore& components() { return ComponentStore::shared(); }
+
+        /// The total transformation of the element, including parent transformations
+        [[nodiscard]] const glm::mat4& transform() const { return components().world_transform(id); }
 
-        explicit SceneElement(const ElementRef& parent, std::string name) : parent(parent), name(std::move(name)) {}
+        /// Queue the element, and everything under it, to have its transform and instance data brought up to date by the next
+        /// ComponentStore::propagate, which EditorScene runs once a frame. Cheap, so just call it on every edit
+        void mark_dirty() { components().mark_dirty(id); }
 
         /// Create a json element representing the element
         [[nodiscard]] virtual json into_json() const = 0;
@@ -51,8 +73,9 @@ namespace EditorScene {
         /// Adds the editor fields for the current element, to be specialised to the specific entity
         virtual void add_imgui_edit_section(MasterRenderScene& render_scene, const SceneContext& scene_context);
 
-        /// Update this entities instance data, and also transform which uses the parents transform
-        virtual void update_instance_data() = 0;
+        /// Update whatever instance data the element derives from its transform, beyond what the ComponentStore writes through its links.
+        /// Called by ComponentStore::propagate once transform() is up to date, for elements that asked with watch_world_transform
+        virtual void update_instance_data() {}
 
         /// Simple add and remove self from the render scene
         virtual void add_to_render_scene(MasterRenderScene& target_render_scene) = 0;
@@ -79,37 +102,51 @@ namespace EditorScene {
         static json texture_to_json(const std::shared_ptr<TextureHandle>& texture);
         static std::shared_ptr<TextureHandle> texture_from_json(const SceneContext& scene_context, const json& json);
 
-        virtual ~SceneElement() = default;
+        virtual ~SceneElement() {
+            components().destroy(id);
+        }
     };
 
-    /// A component for a SceneElement to add default local transform behaviour
+    /// A component for a SceneElement to add default local transform behaviour, building its local transform
+    /// from a position, rotation and scale, which are kept in the ComponentStore.
+    /// The references are only good until the next element is created or destroyed, so shouldn't be held on to,
+    /// and edits through them need a mark_dirty after
     class LocalTransformComponent : virtual public SceneElement {
     public:
         // Local transformation
-        glm::vec3 position;
-        glm::vec3 euler_rotation;
-        glm::vec3 scale;
+        [[nodiscard]] glm::vec3& position() { return components().position(id); }
+        [[nodiscard]] glm::vec3& euler_rotation() { return components().euler_rotation(id); }
+        [[nodiscard]] glm::vec3& scale() { return components().scale(id); }
+        [[nodiscard]] const glm::vec3& position() const { return components().position(id); }
+        [[nodiscard]] const glm::vec3& euler_rotation() const { return components().euler_rotation(id); }
+        [[nodiscard]] const glm::vec3& scale() const { return components().scale(id); }
 
     protected:
-        LocalTransformComponent(const glm::vec3& position, const glm::vec3& euler_rotation, const glm::vec3& scale) : position(position), euler_rotation(euler_rotation), scale(scale) {}
+        LocalTransformComponent(const glm::vec3& position, const glm::vec3& euler_rotation, const glm::vec3& scale) {
+            components().use_trs(id, position, euler_rotation, scale);
+        }
 
         void add_local_transform_imgui_edit_section(MasterRenderScene& render_scene, const SceneContext& scene_context);
 
+        /// Left as it is if json has no "local_transform", as for binary scenes, which set it from their TransformBlock instead
         void update_local_transform_from_json(const json& json);
         [[nodiscard]] json local_transform_into_json() const;
-
-        [[nodiscard]] glm::mat4 calc_model_matrix() const;
     };
 
+    /// A component for a SceneElement with a lit material, which is kept in the ComponentStore, see LocalTransformComponent for how long the references last
     class LitMaterialComponent : virtual public SceneElement {
     public:
-        BaseLitEntityMaterial material;
+        [[nodiscard]] BaseLitEntityMaterial& material() { return components().lit_material(id); }
+        [[nodiscard]] const BaseLitEntityMaterial& material() const { return components().lit_material(id); }
 
     protected:
-        explicit LitMaterialComponent(const BaseLitEntityMaterial& material) : material(material) {}
+        explicit LitMaterialComponent(const BaseLitEntityMaterial& material) {
+            components().add_lit_material(id, material);
+        }
 
         void add_material_imgui_edit_section(MasterRenderScene& render_scene, const SceneContext& scene_context);
 
+        /// Left as it is if json has no "material", as for binary scenes, which set it from their LitMaterialBlock instead
         void update_material_from_json(const json& json);
         [[nodiscard]] json material_into_json() const;
     };
@@ -139,13 +176,6 @@ namespace EditorScene {
         [[nodiscard]] virtual std::shared_ptr<AnimatedEntityInterface> get_entity() = 0;
         [[nodiscard]] virtual AnimationParameters& get_animation_parameters() = 0;
     };
-
-    /// Helper to checking if an ElementRef is equal to NullElementRef, needed since `ref == NullElementRef` will
-    /// crash with the MSVC compiler in debug mode due to its strictness.
-    bool is_null(const ElementRef& ref);
-    /// Helper to checking if two ElementRef are equal, needed since `e1 == e2` may
-    /// crash with the MSVC compiler in debug mode due to its strictness.
-    bool eq(const ElementRef& e1, const ElementRef& e2);
 }
 
 #endif //SCENE_ELEMENT_H
@@ -0,0 +1,86 @@
+#include "SpatialHashGrid.h"
+#include "ParticlePool.h"
+
+#include <algorithm>
+
+namespace EditorScene {
+
+namespace {
+    // Below this many particles per chunk, handing the work out costs more than the threads save
+    constexpr uint MIN_PARTICLES_PER_CHUNK = 2048;
+    constexpr uint MIN_CELLS_PER_CHUNK = 16384;
+}
+
+void SpatialHashGrid::build(const ParticlePool& pool, float new_cell_size, JobSystem& job_system) {
+    cell_size = std::max(new_cell_size, 1e-4f);
+    inverse_cell_size = 1.0f / cell_size;
+
+    auto count = (uint) pool.count;
+    // A power of two at least twice the particle count, so that most particles get a slot to their cell alone
+    uint table_size = 64;
+    while (table_size < count * 2) {
+        table_size *= 2;
+    }
+    table_mask = table_size - 1;
+
+    particle_cells.resize(count);
+    sorted_particles.resize(count);
+    sorted_x.resize(count);
+    sorted_y.resize(count);
+    sorted_z.resize(count);
+    cell_starts.resize(table_size + 1);
+    if (cell_cursors.size() != table_size) {
+        // Atomics can't be moved, so the table is replaced rather than resized
+        cell_cursors = std::vector<std::atomic<uint>>(table_size);
+    }
+
+    job_system.parallel_for(table_size, MIN_CELLS_PER_CHUNK, [&](uint begin, uint end) {
+        for (auto c = begin; c < end; ++c) {
+            cell_cursors[c].store(0, std::memory_order_relaxed);
+        }
+    });
+
+    // Count the particles in each cell
+    job_system.parallel_for(count, MIN_PARTICLES_PER_CHUNK, [&](uint begin, uint end) {
+        for (auto i = begin; i < end; ++i) {
+            uint cell = hash_cell(cell_of(pool.get_position(i)));
+            particle_cells[i] = cell;
+            cell_cursors[cell].fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+
+    // The prefix sum gives each cell its range, it's a single pass over the table so isn't worth splitting
+    uint running_total = 0;
+    for (uint c = 0; c < table_size; ++c) {
+        cell_starts[c] = running_total;
+        running_total += cell_cursors[c].load(std::memory_order_relaxed);
+        cell_cursors[c].store(cell_starts[c], std::memory_order_relaxed);
+    }
+    cell_starts[table_size] = running_total;
+
+    // Scatter each particle into its cell's range. The threads race for places within a cell,
+    // so the cells are put back in index order after, to keep the neighbour order, and so the forces summed over it, the same every time
+    job_system.parallel_for(count, MIN_PARTICLES_PER_CHUNK, [&](uint begin, uint end) {
+        for (auto i = begin; i < end; ++i) {
+            sorted_particles[cell_cursors[particle_cells[i]].fetch_add(1, std::memory_order_relaxed)] = i;
+        }
+    });
+    job_system.parallel_for(table_size, MIN_CELLS_PER_CHUNK, [&](uint begin, uint end) {
+        for (auto c = begin; c < end; ++c) {
+            if (cell_starts[c + 1] - cell_starts[c] > 1) {
+                std::sort(sorted_particles.begin() + cell_starts[c], sorted_particles.begin() + cell_starts[c + 1]);
+            }
+        }
+    });
+
+    job_system.parallel_for(count, MIN_PARTICLES_PER_CHUNK, [&](uint begin, uint end) {
+        for (auto s = begin; s < end; ++s) {
+            uint i = sorted_particles[s];
+            sorted_x[s] = pool.positionX[i];
+            sorted_y[s] = pool.positionY[i];
+            sorted_z[s] = pool.positionZ[i];
+        }
+    });
+}
+
+} // namespace EditorScene
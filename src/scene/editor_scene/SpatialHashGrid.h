@@ -0,0 +1,112 @@
+#ifndef SPATIAL_HASH_GRID_H
+#define SPATIAL_HASH_GRID_H
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "utility/HelperTypes.h"
+#include "utility/JobSystem.h"
+
+namespace EditorScene {
+
+    struct ParticlePool;
+
+    /// A uniform grid over the particles of one pool, with the cells hashed into a table twice the size of the pool
+    /// so that it covers any extent without being allocated for it. Rebuilt from scratch each step.
+    ///
+    /// The build counting sorts the particles by cell, so that the particles of each cell sit together,
+    /// and a neighbour query only has to look through the 27 cells around a point rather than every particle.
+    /// Cells that hash to the same slot share it, which queries filter out by distance.
+    class SpatialHashGrid {
+        float cell_size = 1.0f;
+        float inverse_cell_size = 1.0f;
+        uint table_mask = 0;
+
+        // [particle] -> hashed cell
+        std::vector<uint> particle_cells{};
+        // [hashed cell] -> particle count, then where the next of the cell's particles goes while scattering
+        std::vector<std::atomic<uint>> cell_cursors{};
+        // [hashed cell] -> where its particles start in sorted_particles, with one past the end at the back
+        std::vector<uint> cell_starts{};
+        // Particle indices, grouped by hashed cell, in index order within each cell so that the build is deterministic
+        std::vector<uint> sorted_particles{};
+        // Positions in the same order as sorted_particles, so that a query reads through them in order
+        std::vector<float> sorted_x{}, sorted_y{}, sorted_z{};
+
+        [[nodiscard]] glm::ivec3 cell_of(const glm::vec3& position) const {
+            return glm::ivec3(glm::floor(position * inverse_cell_size));
+        }
+
+        [[nodiscard]] uint hash_cell(const glm::ivec3& cell) const {
+            // From Teschner et al., Optimized Spatial Hashing for Collision Detection of Deformable Objects
+            return ((uint) cell.x * 73856093u ^ (uint) cell.y * 19349663u ^ (uint) cell.z * 83492791u) & table_mask;
+        }
+
+    public:
+        /// Rebuild around the live particles of pool, in cells of cell_size, which must be at least the largest radius that will be queried
+        void build(const ParticlePool& pool, float new_cell_size, JobSystem& job_system);
+
+        [[nodiscard]] float get_cell_size() const { return cell_size; }
+        /// The number of particles at the last build
+        [[nodiscard]] uint get_count() const { return (uint) sorted_particles.size(); }
+        /// The particles of the last build, grouped by cell. Walking through them in this order keeps queries for nearby points together
+        [[nodiscard]] const std::vector<uint>& get_sorted_particles() const { return sorted_particles; }
+        [[nodiscard]] glm::vec3 get_sorted_position(uint slot) const { return {sorted_x[slot], sorted_y[slot], sorted_z[slot]}; }
+
+        /// Call fn(slot, offset, distance_squared) for every particle within radius of position, as of the last build,
+        /// where slot is the particle's place in get_sorted_particles, and offset is from position to the particle.
+        /// That includes a particle at position itself, at a distance of 0. radius must be no more than the cell size.
+        /// Data gathered into the sorted order reads through memory in order, where the pool's own order would jump around
+        template<typename Fn>
+        void for_each_neighbour(const glm::vec3& position, float radius, Fn&& fn) const {
+            if (sorted_particles.empty()) return;
+
+            float radius_squared = radius * radius;
+            glm::vec3 scaled = position * inverse_cell_size;
+            glm::vec3 floored = glm::floor(scaled);
+            glm::ivec3 centre{floored};
+            // [axis][-1, 0, +1] -> squared distance along the axis from the point to that layer of cells,
+            // so that the cells around the corners and edges which are out of reach are skipped without looking inside
+            glm::vec3 to_lower = (scaled - floored) * cell_size;
+            glm::vec3 to_upper = glm::vec3{cell_size} - to_lower;
+            float layer_distances[3][3];
+            for (int axis = 0; axis < 3; ++axis) {
+                layer_distances[axis][0] = to_lower[axis] * to_lower[axis];
+                layer_distances[axis][1] = 0.0f;
+                layer_distances[axis][2] = to_upper[axis] * to_upper[axis];
+            }
+
+            // Two of the cells around the point can hash to the same slot, which mustn't be visited twice
+            uint visited[27];
+            uint visited_count = 0;
+            for (int dz = -1; dz <= 1; ++dz) {
+                for (int dy = -1; dy <= 1; ++dy) {
+                    for (int dx = -1; dx <= 1; ++dx) {
+                        if (layer_distances[0][dx + 1] + layer_distances[1][dy + 1] + layer_distances[2][dz + 1] > radius_squared) continue;
+                        uint slot = hash_cell(centre + glm::ivec3{dx, dy, dz});
+                        bool seen = false;
+                        for (uint v = 0; v < visited_count && !seen; ++v) {
+                            seen = visited[v] == slot;
+                        }
+                        if (seen) continue;
+                        visited[visited_count++] = slot;
+
+                        for (uint s = cell_starts[slot]; s < cell_starts[slot + 1]; ++s) {
+                            glm::vec3 offset{sorted_x[s] - position.x, sorted_y[s] - position.y, sorted_z[s] - position.z};
+                            float distance_squared = glm::dot(offset, offset);
+                            if (distance_squared <= radius_squared) {
+                                fn(s, offset, distance_squared);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    };
+
+} // namespace EditorScene
+
+#endif // SPATIAL_HASH_GRID_H
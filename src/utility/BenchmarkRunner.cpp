@@ -0,0 +1,35 @@
+#include "BenchmarkRunner.h"
+
+#include <iostream>
+
+#include "rendering/imgui/ImGuiManager.h"
+#include "utility/HelperTypes.h"
+
+void BenchmarkRunner::register_benchmark(std::string name, std::function<std::string()> run) {
+    benchmarks.push_back({std::move(name), std::move(run), {}});
+}
+
+void BenchmarkRunner::add_imgui_options_section() {
+    if (ImGui::CollapsingHeader("Benchmarks")) {
+        ImGui::TextWrapped("Note: Benchmarks block the render loop while running, and are best run from a release build.");
+        for (auto& benchmark: benchmarks) {
+            ImGui::PushID(&benchmark);
+            if (ImGui::Button("Run")) {
+                try {
+                    benchmark.last_result = benchmark.run();
+                } catch (const std::exception& e) {
+                    benchmark.last_result = Formatter() << "Failed: " << e.what();
+                }
+                std::cout << "Benchmark [" << benchmark.name << "]:\n" << benchmark.last_result << std::endl;
+            }
+            ImGui::SameLine();
+            ImGui::Text("%s", benchmark.name.c_str());
+            if (!benchmark.last_result.empty()) {
+                ImGui::Indent();
+                ImGui::TextUnformatted(benchmark.last_result.c_str());
+                ImGui::Unindent();
+            }
+            ImGui::PopID();
+        }
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef BENCHMARK_RUNNER_H
+#define BENCHMARK_RUNNER_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <functional>
+
+/// A small harness for in-app micro benchmarks, so that performance sensitive code paths can be compared
+/// on the machine that is actually running the program.
+/// Results are shown in the ImGUI options window, and also printed to the console.
+class BenchmarkRunner {
+    struct Benchmark {
+        std::string name;
+        std::function<std::string()> run;
+        std::string last_result;
+    };
+
+    std::vector<Benchmark> benchmarks{};
+public:
+    /// Register a benchmark, which when run returns a (possibly multi-line) human readable summary.
+    void register_benchmark(std::string name, std::function<std::string()> run);
+
+    /// Adds the ImGUI control to the current ImGUI window
+    void add_imgui_options_section();
+
+    /// Runs fn `iterations` times, returning the average wall clock time of a single iteration in nanoseconds.
+    template<typename Fn>
+    static double time_ns(unsigned int iterations, Fn&& fn);
+};
+
+template<typename Fn>
+double BenchmarkRunner::time_ns(unsigned int iterations, Fn&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (auto i = 0u; i < iterations; ++i) {
+        fn();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / (double) iterations;
+}
+
+#endif //BENCHMARK_RUNNER_H
@@ -0,0 +1,121 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+// Set on worker threads, so that nested parallel_for calls can be detected
+static thread_local bool is_worker_thread = false;
+// Set while the submitting thread helps with its own batch, since a nested call from there would wait on the batch it is part of
+static thread_local bool is_running_chunks = false;
+
+JobSystem::JobSystem(uint worker_count) {
+    workers.reserve(worker_count);
+    for (auto i = 0u; i < worker_count; ++i) {
+        workers.emplace_back([this]() { worker_loop(); });
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard lock{mutex};
+        stopping = true;
+    }
+    work_available.notify_all();
+    for (auto& worker: workers) {
+        worker.join();
+    }
+}
+
+uint JobSystem::default_worker_count() {
+    auto hardware_threads = std::thread::hardware_concurrency();
+    return hardware_threads > 1 ? hardware_threads - 1 : 0;
+}
+
+uint JobSystem::get_thread_count() const {
+    return (uint) workers.size() + 1;
+}
+
+void JobSystem::parallel_for(uint count, uint min_chunk_size, const std::function<void(uint begin, uint end)>& new_job) {
+    if (count == 0) return;
+
+    // Aim for a few chunks per thread, so that uneven chunks still balance out
+    uint target_chunks = get_thread_count() * 4;
+    uint new_chunk_size = std::max({1u, min_chunk_size, (count + target_chunks - 1) / target_chunks});
+
+    if (workers.empty() || is_worker_thread || is_running_chunks || new_chunk_size >= count) {
+        new_job(0, count);
+        return;
+    }
+
+    std::lock_guard submit_lock{submit_mutex};
+    {
+        std::unique_lock lock{mutex};
+        // A worker that woke up late for the previous batch may still be on its way out of it
+        work_finished.wait(lock, [this]() { return active_workers == 0; });
+
+        job = &new_job;
+        job_count = count;
+        chunk_size = new_chunk_size;
+        chunk_count = (count + new_chunk_size - 1) / new_chunk_size;
+        next_chunk = 0;
+        finished_chunks = 0;
+        first_exception = nullptr;
+        ++generation;
+    }
+    work_available.notify_all();
+
+    uint finished = run_chunks();
+
+    std::unique_lock lock{mutex};
+    finished_chunks += finished;
+    // Wait for the workers to leave the batch too, not just finish it, before the job can be replaced
+    work_finished.wait(lock, [this]() { return finished_chunks == chunk_count && active_workers == 0; });
+
+    job = nullptr;
+    if (first_exception) {
+        auto exception = first_exception;
+        first_exception = nullptr;
+        std::rethrow_exception(exception);
+    }
+}
+
+uint JobSystem::run_chunks() {
+    is_running_chunks = true;
+    uint finished = 0;
+    for (uint chunk = next_chunk++; chunk < chunk_count; chunk = next_chunk++) {
+        uint begin = chunk * chunk_size;
+        uint end = std::min(begin + chunk_size, job_count);
+        try {
+            (*job)(begin, end);
+        } catch (...) {
+            std::lock_guard lock{mutex};
+            if (!first_exception) first_exception = std::current_exception();
+        }
+        ++finished;
+    }
+    is_running_chunks = false;
+    return finished;
+}
+
+void JobSystem::worker_loop() {
+    is_worker_thread = true;
+
+    uint seen_generation = 0;
+    std::unique_lock lock{mutex};
+    while (true) {
+        work_available.wait(lock, [this, seen_generation]() { return stopping || generation != seen_generation; });
+        if (stopping) return;
+
+        seen_generation = generation;
+        ++active_workers;
+        lock.unlock();
+
+        uint finished = run_chunks();
+
+        lock.lock();
+        finished_chunks += finished;
+        --active_workers;
+        if (finished_chunks == chunk_count && active_workers == 0) {
+            work_finished.notify_all();
+        }
+    }
+}
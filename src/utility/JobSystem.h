@@ -0,0 +1,62 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <vector>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+#include "HelperTypes.h"
+
+/// A small pool of worker threads, for splitting independent per-frame work (e.g. posing every animated entity)
+/// across all the cores of the machine.
+///
+/// The only primitive is a blocking parallel_for, the calling thread helps with the work and returns once all of it is done.
+/// So any data that the job reads or writes just needs to stay alive and not be touched by anything else for the duration of the call.
+class JobSystem : private NonCopyable {
+    std::vector<std::thread> workers{};
+
+    std::mutex mutex{};
+    std::condition_variable work_available{};
+    std::condition_variable work_finished{};
+
+    // The current batch of work, only changed while no workers are active
+    const std::function<void(uint begin, uint end)>* job = nullptr;
+    uint job_count = 0;
+    uint chunk_size = 1;
+    uint chunk_count = 0;
+    std::atomic<uint> next_chunk{0};
+    uint finished_chunks = 0;
+    uint active_workers = 0;
+    // Incremented for each batch, so that workers can tell when new work has been submitted
+    uint generation = 0;
+    bool stopping = false;
+    std::exception_ptr first_exception{};
+
+    // Only one thread may submit a batch at a time
+    std::mutex submit_mutex{};
+
+    void worker_loop();
+    /// Claim and run chunks of the current batch until there are none left, returns the number run
+    uint run_chunks();
+public:
+    /// Creates a JobSystem with the given number of worker threads,
+    /// by default one less than the number of hardware threads, since the calling thread also does work.
+    explicit JobSystem(uint worker_count = default_worker_count());
+    ~JobSystem();
+
+    /// Calls job(begin, end) over [0, count) split into chunks of at least min_chunk_size, spread across the workers and the calling thread.
+    /// Blocks until every chunk is complete. If any chunk throws, the first exception is rethrown here once all of them are done.
+    /// Calls from within a job run serially on the calling worker, rather than deadlocking.
+    void parallel_for(uint count, uint min_chunk_size, const std::function<void(uint begin, uint end)>& job);
+
+    /// The number of threads that will work on a parallel_for, including the caller
+    [[nodiscard]] uint get_thread_count() const;
+
+    static uint default_worker_count();
+};
+
+#endif //JOB_SYSTEM_H
@@ -2,8 +2,11 @@
 #define MATH_H
 
 #include <cmath>
+#include <limits>
 #include <algorithm>
 
+#include <glm/glm.hpp>
+
 /// Simple clamp function
 /// It will clamp value between min and max, such that
 /// a <= clamp(v, a, b) <= b
@@ -12,4 +15,82 @@ T clamp(T value, T min, T max) {
     return std::max(std::min(value, max), min);
 }
 
+/// An axis aligned bounding box, which starts empty
+struct BoundingBox {
+    glm::vec3 min{std::numeric_limits<float>::max()};
+    glm::vec3 max{std::numeric_limits<float>::lowest()};
+
+    [[nodiscard]] bool is_empty() const {
+        return min.x > max.x;
+    }
+
+    [[nodiscard]] glm::vec3 centre() const {
+        return (min + max) * 0.5f;
+    }
+
+    /// The radius of a sphere around the box, centred on the box's centre
+    [[nodiscard]] float radius() const {
+        return is_empty() ? 0.0f : glm::length(max - min) * 0.5f;
+    }
+
+    void expand(const glm::vec3& point) {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void expand(const BoundingBox& other) {
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+
+    /// Grow each side outwards by a fraction of the box's size
+    void pad(float fraction) {
+        if (is_empty()) return;
+        glm::vec3 padding = (max - min) * fraction;
+        min -= padding;
+        max += padding;
+    }
+
+    /// The box around this box's corners after transforming them, so it can be bigger than the transformed box
+    [[nodiscard]] BoundingBox transformed(const glm::mat4& transform) const {
+        if (is_empty()) return *this;
+        BoundingBox result{};
+        for (auto corner = 0; corner < 8; ++corner) {
+            glm::vec3 point{(corner & 1) ? max.x : min.x, (corner & 2) ? max.y : min.y, (corner & 4) ? max.z : min.z};
+            result.expand(glm::vec3{transform * glm::vec4{point, 1.0f}});
+        }
+        return result;
+    }
+};
+
+/// Whether a sphere is at least partly inside the view frustum of a projection * view matrix.
+/// Uses the planes of the frustum, extracted from the rows of the matrix (Gribb & Hartmann).
+inline bool sphere_in_frustum(const glm::mat4& projection_view, const glm::vec3& centre, float radius) {
+    glm::mat4 rows = glm::transpose(projection_view);
+    const glm::vec4 planes[6] = {
+        rows[3] + rows[0], rows[3] - rows[0],
+        rows[3] + rows[1], rows[3] - rows[1],
+        rows[3] + rows[2], rows[3] - rows[2]
+    };
+    for (const auto& plane: planes) {
+        if (glm::dot(glm::vec3{plane}, centre) + plane.w < -radius * glm::length(glm::vec3{plane})) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// The diameter of a sphere on screen, as a fraction of the screen height, for a perspective projection * view matrix.
+/// Returns a huge value if the camera is inside the sphere.
+inline float projected_sphere_size(const glm::mat4& projection_view, const glm::vec3& centre, float radius) {
+    // The y row of the matrix is the view's y axis scaled by the projection's y scale, and the w row is the view depth
+    glm::vec3 y_row{projection_view[0][1], projection_view[1][1], projection_view[2][1]};
+    float depth = projection_view[0][3] * centre.x + projection_view[1][3] * centre.y + projection_view[2][3] * centre.z + projection_view[3][3];
+    if (depth <= radius) {
+        return std::numeric_limits<float>::max();
+    }
+    // Normalised device coordinates span 2 units of height, so the projected radius is also the diameter as a fraction of the screen
+    return radius * glm::length(y_row) / depth;
+}
+
 #endif //MATH_H
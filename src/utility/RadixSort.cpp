@@ -0,0 +1,62 @@
+#include "RadixSort.h"
+
+#include <array>
+#include <algorithm>
+
+namespace {
+    constexpr uint DIGIT_BITS = 8;
+    constexpr uint BUCKETS = 1u << DIGIT_BITS;
+    // Below this many items per chunk, the histograms cost more than the threads save
+    constexpr uint MIN_ITEMS_PER_CHUNK = 8192;
+}
+
+void RadixSort::sort(std::vector<uint64_t>& items, std::vector<uint64_t>& scratch, uint key_shift, uint key_bits, JobSystem& job_system) {
+    auto count = (uint) items.size();
+    scratch.resize(count);
+    if (count < 2) return;
+
+    // The items are split into a fixed set of chunks, each one counts then scatters its own items,
+    // into the space the prefix sum reserves for it, so that every pass is stable
+    uint chunk_count = std::clamp(count / MIN_ITEMS_PER_CHUNK, 1u, job_system.get_thread_count() * 4);
+    uint chunk_size = (count + chunk_count - 1) / chunk_count;
+    // [chunk] -> [digit] -> count, then where that chunk's items with that digit start
+    std::vector<std::array<uint, BUCKETS>> offsets(chunk_count);
+
+    for (auto shift = key_shift; shift < key_shift + key_bits; shift += DIGIT_BITS) {
+        // The last digit may be narrower, so that bits above the key never take part
+        uint64_t digit_mask = (1u << std::min(DIGIT_BITS, key_shift + key_bits - shift)) - 1;
+        job_system.parallel_for(chunk_count, 1, [&](uint begin, uint end) {
+            for (auto chunk = begin; chunk < end; ++chunk) {
+                auto& histogram = offsets[chunk];
+                histogram.fill(0);
+                for (auto i = chunk * chunk_size; i < std::min(count, (chunk + 1) * chunk_size); ++i) {
+                    ++histogram[(items[i] >> shift) & digit_mask];
+                }
+            }
+        });
+
+        uint running_total = 0;
+        bool all_one_digit = false;
+        for (auto digit = 0u; digit < BUCKETS; ++digit) {
+            uint digit_start = running_total;
+            for (auto& histogram: offsets) {
+                uint digit_count = histogram[digit];
+                histogram[digit] = running_total;
+                running_total += digit_count;
+            }
+            all_one_digit |= running_total - digit_start == count;
+        }
+        // Nothing would move, which is common for the high bytes of a key
+        if (all_one_digit) continue;
+
+        job_system.parallel_for(chunk_count, 1, [&](uint begin, uint end) {
+            for (auto chunk = begin; chunk < end; ++chunk) {
+                auto& next = offsets[chunk];
+                for (auto i = chunk * chunk_size; i < std::min(count, (chunk + 1) * chunk_size); ++i) {
+                    scratch[next[(items[i] >> shift) & digit_mask]++] = items[i];
+                }
+            }
+        });
+        items.swap(scratch);
+    }
+}
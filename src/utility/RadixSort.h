@@ -0,0 +1,20 @@
+#ifndef RADIX_SORT_H
+#define RADIX_SORT_H
+
+#include <vector>
+#include <cstdint>
+
+#include "HelperTypes.h"
+#include "JobSystem.h"
+
+/// A least significant digit radix sort, a byte at a time, with each pass split across the job system.
+///
+/// Items are 64 bit so that a key and a payload (e.g. an index) can be packed together,
+/// only the key bits take part in the sort, and items with equal keys keep their order.
+namespace RadixSort {
+    /// Sort items by the key_bits bits starting at bit key_shift, ascending.
+    /// scratch is resized to match items, and can be kept between calls to avoid reallocating.
+    void sort(std::vector<uint64_t>& items, std::vector<uint64_t>& scratch, uint key_shift, uint key_bits, JobSystem& job_system);
+}
+
+#endif //RADIX_SORT_H
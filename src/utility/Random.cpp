@@ -1,27 +1,101 @@
 #include "Random.h"
 
+#include <cmath>
+#include <random>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define RANDOM_SSE
+#include <emmintrin.h>
+#endif
+
+namespace {
+    constexpr uint64_t PCG_MULTIPLIER = 6364136223846793005ull;
+    // 2^-24, maps the top 24 bits of a uint32_t onto [0, 1)
+    constexpr float UNIT_SCALE = 1.0f / 16777216.0f;
+}
+
 // Define and initialize the static member gen
-// It's default-initialized here. init() will seed it.
-std::mt19937 Random::gen;
+// It's seeded with a fixed seed here. init() will reseed it.
+RandomStream Random::gen{0};
 
 void Random::init() {
     // Seed the static member gen
-    Random::gen.seed(std::random_device()());
+    std::random_device device;
+    Random::gen = RandomStream(((uint64_t) device() << 32) | device());
 }
 
 float Random::range(float min, float max) {
-    if (min >= max) return min;
-    std::uniform_real_distribution<float> dist(min, max);
-    return dist(Random::gen);
+    return Random::gen.range(min, max);
 }
 
 int Random::range(int min, int max) {
-    if (min >= max) return min; 
-    std::uniform_int_distribution<int> dist(min, max);
-    return dist(Random::gen);
+    return Random::gen.range(min, max);
 }
 
 glm::vec3 Random::range_vec3(float min_val, float max_val) {
+    return Random::gen.range_vec3(min_val, max_val);
+}
+
+glm::vec3 Random::range_vec3(const glm::vec3& min_vec, const glm::vec3& max_vec) {
+    return Random::gen.range_vec3(min_vec, max_vec);
+}
+
+uint32_t Random::next_seed() {
+    return Random::gen.next_uint();
+}
+
+RandomStream::RandomStream() : RandomStream(Random::next_seed()) {}
+
+RandomStream::RandomStream(uint64_t seed, uint64_t stream) : state(0), increment((stream << 1u) | 1u) {
+    // The seeding from the reference pcg32_srandom_r
+    next_uint();
+    state += seed;
+    next_uint();
+}
+
+uint32_t RandomStream::next_uint() {
+    uint64_t old_state = state;
+    state = old_state * PCG_MULTIPLIER + increment;
+    // XSH RR, xorshift the high bits down, then rotate by the top 5 bits
+    auto xorshifted = (uint32_t) (((old_state >> 18u) ^ old_state) >> 27u);
+    auto rotation = (uint32_t) (old_state >> 59u);
+    return (xorshifted >> rotation) | (xorshifted << ((-rotation) & 31u));
+}
+
+float RandomStream::next_float() {
+    return (float) (next_uint() >> 8u) * UNIT_SCALE;
+}
+
+float RandomStream::range(float min, float max) {
+    if (min >= max) return min;
+    // Written the same way as fill_range, so that the two agree exactly.
+    // Scaling the largest unit value can round up to max itself, so it is clamped to the float below max to keep the range half open
+    float value = (float) (int32_t) (next_uint() >> 8u) * ((max - min) * UNIT_SCALE) + min;
+    return std::min(value, std::nextafter(max, min));
+}
+
+int RandomStream::range(int min, int max) {
+    if (min >= max) return min;
+    // Lemire's multiply and reject, the rejection only removes the bias and is rarely taken
+    auto bound = (uint32_t) ((int64_t) max - min) + 1u;
+    if (bound == 0) {
+        // The whole range of int
+        return (int) next_uint();
+    }
+    uint64_t product = (uint64_t) next_uint() * bound;
+    auto low = (uint32_t) product;
+    if (low < bound) {
+        uint32_t threshold = -bound % bound;
+        while (low < threshold) {
+            product = (uint64_t) next_uint() * bound;
+            low = (uint32_t) product;
+        }
+    }
+    return (int) ((int64_t) min + (int64_t) (product >> 32u));
+}
+
+glm::vec3 RandomStream::range_vec3(float min_val, float max_val) {
     return glm::vec3(
         range(min_val, max_val),
         range(min_val, max_val),
@@ -29,10 +103,37 @@ glm::vec3 Random::range_vec3(float min_val, float max_val) {
     );
 }
 
-glm::vec3 Random::range_vec3(const glm::vec3& min_vec, const glm::vec3& max_vec) {
+glm::vec3 RandomStream::range_vec3(const glm::vec3& min_vec, const glm::vec3& max_vec) {
     return glm::vec3(
         range(min_vec.x, max_vec.x),
         range(min_vec.y, max_vec.y),
         range(min_vec.z, max_vec.z)
     );
-} 
\ No newline at end of file
+}
+
+void RandomStream::fill_range(float* out, size_t count, float min, float max) {
+    if (min >= max) {
+        std::fill(out, out + count, min);
+        return;
+    }
+
+    float scale = (max - min) * UNIT_SCALE;
+    float upper = std::nextafter(max, min);
+    size_t i = 0;
+#ifdef RANDOM_SSE
+    // Each PCG step depends on the last, so the generating stays scalar, but the conversion to floats in the range is done four at a time
+    __m128 scale4 = _mm_set1_ps(scale);
+    __m128 min4 = _mm_set1_ps(min);
+    __m128 upper4 = _mm_set1_ps(upper);
+    for (; i + 4 <= count; i += 4) {
+        // A braced list is evaluated in order, so these come out in the same order as the scalar loop's
+        alignas(16) uint32_t generated[4] = {next_uint(), next_uint(), next_uint(), next_uint()};
+        __m128i bits = _mm_load_si128((const __m128i*) generated);
+        __m128 unit = _mm_cvtepi32_ps(_mm_srli_epi32(bits, 8));
+        _mm_storeu_ps(out + i, _mm_min_ps(_mm_add_ps(_mm_mul_ps(unit, scale4), min4), upper4));
+    }
+#endif
+    for (; i < count; ++i) {
+        out[i] = std::min((float) (int32_t) (next_uint() >> 8u) * scale + min, upper);
+    }
+}
@@ -0,0 +1,314 @@
+#include "SignedDistanceField.h"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "Math.h"
+#include "RadixSort.h"
+
+namespace {
+    /// The closest point to p on triangle abc, from Ericson's Real-Time Collision Detection, 5.1.5
+    glm::vec3 closest_point_on_triangle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+        glm::vec3 ab = b - a;
+        glm::vec3 ac = c - a;
+        glm::vec3 ap = p - a;
+        float d1 = glm::dot(ab, ap);
+        float d2 = glm::dot(ac, ap);
+        if (d1 <= 0.0f && d2 <= 0.0f) return a;
+
+        glm::vec3 bp = p - b;
+        float d3 = glm::dot(ab, bp);
+        float d4 = glm::dot(ac, bp);
+        if (d3 >= 0.0f && d4 <= d3) return b;
+
+        float vc = d1 * d4 - d3 * d2;
+        if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+            return a + ab * (d1 / (d1 - d3));
+        }
+
+        glm::vec3 cp = p - c;
+        float d5 = glm::dot(ab, cp);
+        float d6 = glm::dot(ac, cp);
+        if (d6 >= 0.0f && d5 <= d6) return c;
+
+        float vb = d5 * d2 - d1 * d6;
+        if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+            return a + ac * (d2 / (d2 - d6));
+        }
+
+        float va = d3 * d6 - d5 * d4;
+        if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+            return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+        }
+
+        float denominator = 1.0f / (va + vb + vc);
+        return a + ab * (vb * denominator) + ac * (vc * denominator);
+    }
+}
+
+void SignedDistanceField::clear() {
+    grid.clear();
+    samples.clear();
+    grid_size = glm::ivec3{0};
+}
+
+void SignedDistanceField::build(const std::vector<Triangle>& triangles, float new_cell_size, float new_band, JobSystem& job_system) {
+    clear();
+    band = std::max(new_band, 1e-4f);
+    cell_size = std::max(new_cell_size, 1e-4f);
+    if (triangles.empty()) return;
+
+    BoundingBox bounds{};
+    for (const auto& triangle: triangles) {
+        bounds.expand(triangle.a);
+        bounds.expand(triangle.b);
+        bounds.expand(triangle.c);
+    }
+    bounds.min -= glm::vec3{band};
+    bounds.max += glm::vec3{band};
+    origin = bounds.min;
+
+    float brick_size;
+    do {
+        inverse_cell_size = 1.0f / cell_size;
+        brick_size = cell_size * (float) BRICK_CELLS;
+        grid_size = glm::max(glm::ivec3{glm::ceil((bounds.max - origin) / brick_size)}, glm::ivec3{1});
+        if ((size_t) grid_size.x * grid_size.y * grid_size.z <= MAX_GRID_BRICKS) break;
+        cell_size *= 2.0f;
+    } while (true);
+
+    // Every (brick, triangle) pair where the triangle comes within band of the brick, as (brick in grid << 32 | triangle),
+    // so that sorting them groups each brick's triangles together
+    float brick_reach = glm::length(glm::vec3{brick_size}) * 0.5f + band;
+    std::vector<uint64_t> pairs{};
+    for (auto t = 0u; t < (uint) triangles.size(); ++t) {
+        const auto& triangle = triangles[t];
+        glm::vec3 low = glm::min(glm::min(triangle.a, triangle.b), triangle.c) - glm::vec3{band};
+        glm::vec3 high = glm::max(glm::max(triangle.a, triangle.b), triangle.c) + glm::vec3{band};
+        glm::ivec3 first = glm::clamp(glm::ivec3{glm::floor((low - origin) / brick_size)}, glm::ivec3{0}, grid_size - 1);
+        glm::ivec3 last = glm::clamp(glm::ivec3{glm::floor((high - origin) / brick_size)}, glm::ivec3{0}, grid_size - 1);
+        for (int z = first.z; z <= last.z; ++z) {
+            for (int y = first.y; y <= last.y; ++y) {
+                for (int x = first.x; x <= last.x; ++x) {
+                    // A large triangle's box covers many bricks it passes nowhere near
+                    glm::vec3 centre = origin + (glm::vec3{x, y, z} + 0.5f) * brick_size;
+                    if (glm::distance(centre, closest_point_on_triangle(centre, triangle.a, triangle.b, triangle.c)) > brick_reach) continue;
+                    auto brick = (uint64_t) ((z * grid_size.y + y) * grid_size.x + x);
+                    pairs.push_back(brick << 32 | t);
+                }
+            }
+        }
+    }
+
+    std::vector<uint64_t> scratch{};
+    uint key_bits = 1;
+    while ((1ull << key_bits) < (uint64_t) grid_size.x * grid_size.y * grid_size.z) {
+        ++key_bits;
+    }
+    RadixSort::sort(pairs, scratch, 32, key_bits, job_system);
+
+    // [stored brick] -> where its pairs start, with one past the end at the back
+    std::vector<uint> brick_starts{};
+    grid.assign((size_t) grid_size.x * grid_size.y * grid_size.z, EMPTY_BRICK);
+    for (auto i = 0u; i < (uint) pairs.size(); ++i) {
+        auto brick = (uint) (pairs[i] >> 32);
+        if (i == 0 || brick != (uint) (pairs[i - 1] >> 32)) {
+            grid[brick] = (int) brick_starts.size();
+            brick_starts.push_back(i);
+        }
+    }
+    auto brick_count = (uint) brick_starts.size();
+    brick_starts.push_back((uint) pairs.size());
+
+    std::vector<glm::ivec3> brick_positions(brick_count);
+    for (auto brick = 0u; brick < (uint) grid.size(); ++brick) {
+        if (grid[brick] != EMPTY_BRICK) {
+            brick_positions[grid[brick]] = {brick % grid_size.x, (brick / grid_size.x) % grid_size.y, brick / (grid_size.x * grid_size.y)};
+        }
+    }
+
+    samples.resize((size_t) brick_count * SAMPLES_PER_BRICK);
+    float distance_scale = (float) INT16_MAX / band;
+    // Triangles closer than this to the nearest are counted as just as near, which happens along shared edges and at shared corners
+    float tie_distance_squared = cell_size * cell_size * 1e-6f;
+    // Only the samples this close to a triangle's box can have it within the band, allowing for ties
+    float sample_reach = band + cell_size * 1e-3f;
+
+    job_system.parallel_for(brick_count, 1, [&](uint begin, uint end) {
+        // Per sample of the brick being filled, the nearest triangle so far
+        std::vector<float> nearest_squared(SAMPLES_PER_BRICK);
+        std::vector<float> nearest_alignment(SAMPLES_PER_BRICK);
+        std::vector<float> nearest_side(SAMPLES_PER_BRICK);
+        // The triangle the sign came from
+        std::vector<uint> nearest_triangle(SAMPLES_PER_BRICK);
+        // Whether a sample has its sign, as of the last pass spreading them
+        std::vector<uint8_t> has_sign(SAMPLES_PER_BRICK);
+        std::vector<uint> unsigned_samples{};
+        std::vector<uint> newly_signed{};
+
+        auto sample_position = [&](const glm::vec3& corner, uint s) {
+            glm::uvec3 index{s % BRICK_SAMPLES, (s / BRICK_SAMPLES) % BRICK_SAMPLES, s / (BRICK_SAMPLES * BRICK_SAMPLES)};
+            return corner + glm::vec3{index} * cell_size;
+        };
+        auto consider = [&](uint s, const glm::vec3& position, uint t, const glm::vec3& normal, float normal_length) {
+            const auto& triangle = triangles[t];
+            glm::vec3 offset = position - closest_point_on_triangle(position, triangle.a, triangle.b, triangle.c);
+            float distance_squared = glm::dot(offset, offset);
+            if (distance_squared > nearest_squared[s] + tie_distance_squared) return;
+
+            // Where several triangles are nearest, along an edge or at a corner, the sign comes from the one the point
+            // faces most squarely. Summing their normals instead cancels out in places like the middle of a box
+            float scale = normal_length * std::sqrt(distance_squared);
+            float facing = scale > 0.0f ? glm::dot(offset, normal) / scale : 0.0f;
+            if (distance_squared < nearest_squared[s] - tie_distance_squared || std::abs(facing) > nearest_alignment[s]) {
+                nearest_alignment[s] = std::abs(facing);
+                nearest_side[s] = facing < 0.0f ? -1.0f : 1.0f;
+                nearest_triangle[s] = t;
+            }
+            nearest_squared[s] = std::min(nearest_squared[s], distance_squared);
+        };
+
+        for (auto brick = begin; brick < end; ++brick) {
+            glm::vec3 corner = origin + glm::vec3{brick_positions[brick]} * brick_size;
+            std::fill(nearest_squared.begin(), nearest_squared.end(), std::numeric_limits<float>::max());
+            std::fill(nearest_alignment.begin(), nearest_alignment.end(), -1.0f);
+            std::fill(nearest_side.begin(), nearest_side.end(), 1.0f);
+
+            // Each triangle only against the samples within the band of its box, since the distances are clamped to the band.
+            // The triangles are taken in the same order for every sample, so ties go the same way whichever samples a triangle reaches
+            for (auto pair = brick_starts[brick]; pair < brick_starts[brick + 1]; ++pair) {
+                auto t = (uint32_t) pairs[pair];
+                const auto& triangle = triangles[t];
+                glm::vec3 normal = glm::cross(triangle.b - triangle.a, triangle.c - triangle.a);
+                float normal_length = glm::length(normal);
+
+                glm::vec3 low = glm::min(glm::min(triangle.a, triangle.b), triangle.c);
+                glm::vec3 high = glm::max(glm::max(triangle.a, triangle.b), triangle.c);
+                glm::ivec3 first = glm::max(glm::ivec3{glm::ceil((low - sample_reach - corner) * inverse_cell_size)}, glm::ivec3{0});
+                glm::ivec3 last = glm::min(glm::ivec3{glm::floor((high + sample_reach - corner) * inverse_cell_size)}, glm::ivec3{BRICK_SAMPLES - 1});
+                for (int z = first.z; z <= last.z; ++z) {
+                    for (int y = first.y; y <= last.y; ++y) {
+                        for (int x = first.x; x <= last.x; ++x) {
+                            auto s = (uint) ((z * BRICK_SAMPLES + y) * BRICK_SAMPLES + x);
+                            glm::vec3 position = sample_position(corner, s);
+                            // The box is never further than the triangle, so this skips most of the closest point tests
+                            glm::vec3 outside = glm::max(glm::max(low - position, position - high), glm::vec3{0.0f});
+                            float box_distance_squared = glm::dot(outside, outside);
+                            if (box_distance_squared > sample_reach * sample_reach || box_distance_squared > nearest_squared[s] + tie_distance_squared) continue;
+                            consider(s, position, t, normal, normal_length);
+                        }
+                    }
+                }
+            }
+
+            // The samples out past the band of every triangle are clamped to the band, so only their sign is still needed,
+            // and the triangles that reached them aren't necessarily the nearest. Instead they take the nearest of the triangles
+            // their neighbours took their signs from, spreading out from the samples within the band
+            unsigned_samples.clear();
+            for (auto s = 0u; s < SAMPLES_PER_BRICK; ++s) {
+                has_sign[s] = nearest_squared[s] <= band * band;
+                if (!has_sign[s]) {
+                    nearest_squared[s] = std::numeric_limits<float>::max();
+                    nearest_alignment[s] = -1.0f;
+                    unsigned_samples.push_back(s);
+                }
+            }
+            if (unsigned_samples.size() == SAMPLES_PER_BRICK) {
+                // No triangle comes within the band of any sample, which can happen at the edge of the bricks' reach,
+                // so every sample looks through all of the brick's triangles
+                for (auto s = 0u; s < SAMPLES_PER_BRICK; ++s) {
+                    glm::vec3 position = sample_position(corner, s);
+                    for (auto pair = brick_starts[brick]; pair < brick_starts[brick + 1]; ++pair) {
+                        auto t = (uint32_t) pairs[pair];
+                        glm::vec3 normal = glm::cross(triangles[t].b - triangles[t].a, triangles[t].c - triangles[t].a);
+                        consider(s, position, t, normal, glm::length(normal));
+                    }
+                }
+                unsigned_samples.clear();
+            }
+            while (!unsigned_samples.empty()) {
+                size_t still_unsigned = 0;
+                newly_signed.clear();
+                for (auto s: unsigned_samples) {
+                    glm::ivec3 index{s % BRICK_SAMPLES, (s / BRICK_SAMPLES) % BRICK_SAMPLES, s / (BRICK_SAMPLES * BRICK_SAMPLES)};
+                    glm::vec3 position = sample_position(corner, s);
+                    for (auto axis = 0; axis < 3; ++axis) {
+                        for (auto direction: {-1, 1}) {
+                            glm::ivec3 neighbour = index;
+                            neighbour[axis] += direction;
+                            if (neighbour[axis] < 0 || neighbour[axis] >= (int) BRICK_SAMPLES) continue;
+                            auto n = (uint) ((neighbour.z * BRICK_SAMPLES + neighbour.y) * BRICK_SAMPLES + neighbour.x);
+                            if (!has_sign[n]) continue;
+                            auto t = nearest_triangle[n];
+                            glm::vec3 normal = glm::cross(triangles[t].b - triangles[t].a, triangles[t].c - triangles[t].a);
+                            consider(s, position, t, normal, glm::length(normal));
+                        }
+                    }
+                    if (nearest_alignment[s] >= 0.0f) {
+                        newly_signed.push_back(s);
+                    } else {
+                        unsigned_samples[still_unsigned++] = s;
+                    }
+                }
+                // Only degenerate triangles can leave samples unsigned with signed neighbours, they keep the sign they have
+                if (newly_signed.empty()) break;
+                // Samples signed this pass only count as neighbours from the next, so that the triangles come from the nearest samples within the band
+                for (auto s: newly_signed) {
+                    has_sign[s] = 1;
+                }
+                unsigned_samples.resize(still_unsigned);
+            }
+
+            int16_t* brick_samples = &samples[(size_t) brick * SAMPLES_PER_BRICK];
+            for (auto s = 0u; s < SAMPLES_PER_BRICK; ++s) {
+                float distance = std::min(std::sqrt(nearest_squared[s]), band) * nearest_side[s];
+                brick_samples[s] = (int16_t) std::lround(distance * distance_scale);
+            }
+        }
+    });
+}
+
+bool SignedDistanceField::sample(const glm::vec3& position, float& distance, glm::vec3& gradient) const {
+    if (samples.empty()) return false;
+
+    glm::vec3 scaled = (position - origin) * inverse_cell_size;
+    if (scaled.x < 0.0f || scaled.y < 0.0f || scaled.z < 0.0f) return false;
+    glm::ivec3 brick = glm::ivec3{scaled} / (int) BRICK_CELLS;
+    if (brick.x >= grid_size.x || brick.y >= grid_size.y || brick.z >= grid_size.z) return false;
+    int stored = grid[(brick.z * grid_size.y + brick.y) * grid_size.x + brick.x];
+    if (stored == EMPTY_BRICK) return false;
+
+    glm::vec3 local = scaled - glm::vec3{brick * (int) BRICK_CELLS};
+    glm::ivec3 cell = glm::min(glm::ivec3{local}, glm::ivec3{BRICK_CELLS - 1});
+    glm::vec3 t = local - glm::vec3{cell};
+
+    const int16_t* s = &samples[(size_t) stored * SAMPLES_PER_BRICK + (cell.z * BRICK_SAMPLES + cell.y) * BRICK_SAMPLES + cell.x];
+    constexpr uint DY = BRICK_SAMPLES;
+    constexpr uint DZ = BRICK_SAMPLES * BRICK_SAMPLES;
+    float s000 = s[0], s100 = s[1], s010 = s[DY], s110 = s[DY + 1];
+    float s001 = s[DZ], s101 = s[DZ + 1], s011 = s[DZ + DY], s111 = s[DZ + DY + 1];
+
+    // Trilinear, with the gradient of the same interpolation so that it matches the distance exactly
+    float x00 = s000 + (s100 - s000) * t.x;
+    float x10 = s010 + (s110 - s010) * t.x;
+    float x01 = s001 + (s101 - s001) * t.x;
+    float x11 = s011 + (s111 - s011) * t.x;
+    float y0 = x00 + (x10 - x00) * t.y;
+    float y1 = x01 + (x11 - x01) * t.y;
+    float value = y0 + (y1 - y0) * t.z;
+
+    float dx0 = (s100 - s000) + ((s110 - s010) - (s100 - s000)) * t.y;
+    float dx1 = (s101 - s001) + ((s111 - s011) - (s101 - s001)) * t.y;
+    float dy0 = x10 - x00;
+    float dy1 = x11 - x01;
+
+    float distance_unscale = band / (float) INT16_MAX;
+    distance = value * distance_unscale;
+    gradient = glm::vec3{
+        dx0 + (dx1 - dx0) * t.z,
+        dy0 + (dy1 - dy0) * t.z,
+        y1 - y0
+    } * (distance_unscale * inverse_cell_size);
+    return true;
+}
@@ -0,0 +1,60 @@
+#ifndef SIGNED_DISTANCE_FIELD_H
+#define SIGNED_DISTANCE_FIELD_H
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "HelperTypes.h"
+#include "JobSystem.h"
+
+/// A coarse signed distance field around a set of triangles, negative behind their faces, for cheap collision against them.
+///
+/// Only stored near the surfaces: space is split into bricks of BRICK_CELLS cells a side, and only the bricks within band
+/// of a triangle hold samples, as 16 bit distances at the corners of their cells. The rest of space is just an empty slot in a
+/// dense grid of bricks, so sampling costs the same however many triangles there are, and never needs more than one brick.
+class SignedDistanceField {
+public:
+    static constexpr uint BRICK_CELLS = 8;
+    // Samples along each side of a brick, which shares its outer samples with its neighbours so that sampling stays inside one brick
+    static constexpr uint BRICK_SAMPLES = BRICK_CELLS + 1;
+    static constexpr uint SAMPLES_PER_BRICK = BRICK_SAMPLES * BRICK_SAMPLES * BRICK_SAMPLES;
+    // If the grid of bricks would be bigger than this, the cells are made bigger until it isn't
+    static constexpr size_t MAX_GRID_BRICKS = 1u << 21;
+    static constexpr int EMPTY_BRICK = -1;
+
+    struct Triangle {
+        glm::vec3 a, b, c;
+    };
+
+private:
+    float cell_size = 1.0f;
+    float inverse_cell_size = 1.0f;
+    float band = 1.0f;
+    // The corner of brick (0, 0, 0)
+    glm::vec3 origin{0.0f};
+    glm::ivec3 grid_size{0};
+    // [brick in grid] -> index into the stored bricks, or EMPTY_BRICK
+    std::vector<int> grid{};
+    // [stored brick] -> [sample, x fastest] -> distance, scaled so that +-INT16_MAX is +-band
+    std::vector<int16_t> samples{};
+
+public:
+    /// Replace the field with one around triangles, with cells of cell_size, holding distances out to band from the triangles.
+    /// The bricks are filled in across the job system's threads
+    void build(const std::vector<Triangle>& triangles, float new_cell_size, float new_band, JobSystem& job_system);
+    void clear();
+
+    [[nodiscard]] bool empty() const { return samples.empty(); }
+    [[nodiscard]] float get_cell_size() const { return cell_size; }
+    [[nodiscard]] float get_band() const { return band; }
+    [[nodiscard]] size_t get_brick_count() const { return samples.size() / SAMPLES_PER_BRICK; }
+    [[nodiscard]] size_t memory_size() const { return samples.size() * sizeof(int16_t) + grid.size() * sizeof(int); }
+
+    /// Sample the distance at position, and its gradient, which points away from the nearest surface.
+    /// Returns false if position is further than the band from every triangle, so has no distance stored
+    bool sample(const glm::vec3& position, float& distance, glm::vec3& gradient) const;
+};
+
+#endif //SIGNED_DISTANCE_FIELD_H